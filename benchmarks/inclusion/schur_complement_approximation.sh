@@ -0,0 +1,34 @@
+#!/bin/bash
+
+# Compare the number of outer Stokes iterations of the two Schur
+# complement approximations for increasing viscosity jumps.
+
+# Number of processors to run on
+NP=1
+
+for schur in "weighted mass matrix" "weighted BFBt"
+do
+  echo "----Schur complement approximation: $schur----"
+
+  for jump in "1e2" "1e4" "1e6" "1e8"
+  do
+    echo "viscosity jump $jump:"
+    cp global.prm.base temp.prm
+    echo "set Output directory = output/${schur// /_}/jump$jump" >> temp.prm
+    echo "subsection Material model" >> temp.prm
+    echo "subsection Inclusion" >> temp.prm
+    echo "set Viscosity jump = $jump" >> temp.prm
+    echo "end" >> temp.prm
+    echo "end" >> temp.prm
+    echo "subsection Mesh refinement" >> temp.prm
+    echo "set Initial global refinement = 6" >> temp.prm
+    echo "end" >> temp.prm
+    echo "subsection Solver parameters" >> temp.prm
+    echo "subsection Stokes solver parameters" >> temp.prm
+    echo "set Schur complement approximation = $schur" >> temp.prm
+    echo "end" >> temp.prm
+    echo "end" >> temp.prm
+    mpirun -n $NP ./aspect temp.prm | grep "Solving Stokes system"
+    rm -f temp.prm
+  done
+done
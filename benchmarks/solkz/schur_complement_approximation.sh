@@ -0,0 +1,29 @@
+#!/bin/bash
+
+# Compare the number of outer Stokes iterations of the two Schur
+# complement approximations under mesh refinement.
+
+# Number of processors to run on
+NP=1
+
+for schur in "weighted mass matrix" "weighted BFBt"
+do
+  echo "----Schur complement approximation: $schur----"
+
+  for r in "4" "5" "6" "7"
+  do
+    echo "ref $r:"
+    cp solkz.prm temp.prm
+    echo "set Output directory = output/${schur// /_}/ref$r" >> temp.prm
+    echo "subsection Mesh refinement" >> temp.prm
+    echo "set Initial global refinement = $r" >> temp.prm
+    echo "end" >> temp.prm
+    echo "subsection Solver parameters" >> temp.prm
+    echo "subsection Stokes solver parameters" >> temp.prm
+    echo "set Schur complement approximation = $schur" >> temp.prm
+    echo "end" >> temp.prm
+    echo "end" >> temp.prm
+    mpirun -n $NP ./aspect temp.prm | grep "Solving Stokes system"
+    rm -f temp.prm
+  done
+done
@@ -0,0 +1,490 @@
+/*
+  Copyright (C) 2026 by the authors of the ASPECT code.
+
+  This file is part of ASPECT.
+
+  ASPECT is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2, or (at your option)
+  any later version.
+
+  ASPECT is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with ASPECT; see the file LICENSE.  If not see
+  <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef _aspect_krylov_solvers_h
+#define _aspect_krylov_solvers_h
+
+#include <aspect/global.h>
+
+#ifndef ASPECT_USE_PETSC
+
+#include <deal.II/lac/solver.h>
+#include <deal.II/lac/solver_control.h>
+#include <deal.II/lac/vector_memory.h>
+
+#include <cmath>
+#include <numeric>
+#include <vector>
+
+namespace aspect
+{
+  using namespace dealii;
+
+  namespace internal
+  {
+    /**
+     * Helper functions for Krylov solvers that reduce the number of global
+     * communications per iteration by first computing the local
+     * contributions to several scalar products, and then summing all of
+     * them up in one single MPI reduction, which is possibly non-blocking.
+     */
+    namespace KrylovSolvers
+    {
+      /**
+       * Return the contribution of the locally owned elements of @p a and
+       * @p b to their scalar product.
+       */
+      inline
+      double
+      local_scalar_product (const LinearAlgebra::Vector &a,
+                            const LinearAlgebra::Vector &b)
+      {
+        return std::inner_product (a.begin(), a.end(), b.begin(), 0.0);
+      }
+
+
+
+      /**
+       * Same as above, but for block vectors.
+       */
+      inline
+      double
+      local_scalar_product (const LinearAlgebra::BlockVector &a,
+                            const LinearAlgebra::BlockVector &b)
+      {
+        double result = 0;
+        for (unsigned int b_index=0; b_index<a.n_blocks(); ++b_index)
+          result += local_scalar_product (a.block(b_index), b.block(b_index));
+        return result;
+      }
+
+
+
+      /**
+       * Return the MPI communicator a vector lives on.
+       */
+      inline
+      MPI_Comm
+      get_mpi_communicator (const LinearAlgebra::Vector &v)
+      {
+        return v.get_mpi_communicator();
+      }
+
+
+
+      /**
+       * Same as above, but for block vectors.
+       */
+      inline
+      MPI_Comm
+      get_mpi_communicator (const LinearAlgebra::BlockVector &v)
+      {
+        return v.block(0).get_mpi_communicator();
+      }
+
+
+
+      /**
+       * Sum up the local contributions in @p values over all processes in
+       * one blocking reduction, and write the sums into @p values.
+       */
+      inline
+      void
+      sum (std::vector<double> &values,
+           const MPI_Comm       mpi_communicator)
+      {
+        const int ierr = MPI_Allreduce (MPI_IN_PLACE, values.data(), values.size(),
+                                        MPI_DOUBLE, MPI_SUM, mpi_communicator);
+        AssertThrow (ierr == MPI_SUCCESS, ExcInternalError());
+      }
+
+
+
+      /**
+       * Start summing up the local contributions in @p values over all
+       * processes. The sum is written into @p values once finish_sum()
+       * has been called on @p request, and other work can be done in the
+       * meantime. If the MPI library does not support non-blocking
+       * collective operations, the sum is computed right away.
+       */
+      inline
+      void
+      start_sum (std::vector<double> &values,
+                 const MPI_Comm       mpi_communicator,
+                 MPI_Request         &request)
+      {
+#if MPI_VERSION >= 3
+        const int ierr = MPI_Iallreduce (MPI_IN_PLACE, values.data(), values.size(),
+                                         MPI_DOUBLE, MPI_SUM, mpi_communicator, &request);
+#else
+        const int ierr = MPI_Allreduce (MPI_IN_PLACE, values.data(), values.size(),
+                                        MPI_DOUBLE, MPI_SUM, mpi_communicator);
+        request = MPI_REQUEST_NULL;
+#endif
+        AssertThrow (ierr == MPI_SUCCESS, ExcInternalError());
+      }
+
+
+
+      /**
+       * Wait for a sum started with start_sum() to be complete.
+       */
+      inline
+      void
+      finish_sum (MPI_Request &request)
+      {
+        const int ierr = MPI_Wait (&request, MPI_STATUS_IGNORE);
+        AssertThrow (ierr == MPI_SUCCESS, ExcInternalError());
+      }
+    }
+
+
+
+    /**
+     * A preconditioned conjugate gradient method in the pipelined
+     * formulation of Ghysels and Vanroose (Parallel Computing, 2014). The
+     * iterates are mathematically identical to the ones of the standard
+     * CG method, but all three scalar products of one iteration are
+     * summed up in a single non-blocking reduction, which is overlapped
+     * with the application of the preconditioner and the matrix-vector
+     * product of the same iteration. This comes at the cost of four
+     * additional vector updates per iteration and a slightly reduced
+     * attainable accuracy, which is irrelevant for the moderate
+     * tolerances of the inner solvers of the Stokes preconditioner.
+     *
+     * The class can be used as a drop-in replacement of SolverCG.
+     */
+    template <class VectorType>
+    class SolverPipelinedCG : public Solver<VectorType>
+    {
+      public:
+        /**
+         * Constructor.
+         */
+        explicit SolverPipelinedCG (SolverControl &solver_control);
+
+        /**
+         * Solve the linear system $Ax=b$ for $x$, using the preconditioner
+         * @p preconditioner. @p x is used as the starting guess.
+         */
+        template <class MatrixType, class PreconditionerType>
+        void
+        solve (const MatrixType         &A,
+               VectorType               &x,
+               const VectorType         &b,
+               const PreconditionerType &preconditioner);
+    };
+
+
+
+    /**
+     * A flexible, restarted GMRES method (i.e., a right-preconditioned GMRES
+     * method that allows for a different preconditioner in every iteration,
+     * like deal.II's SolverFGMRES) in which the new basis vector of every
+     * iteration is orthogonalized with the classical Gram-Schmidt method
+     * with one reorthogonalization step. In contrast to the modified
+     * Gram-Schmidt method that needs one global reduction for every
+     * previous basis vector, this requires exactly two blocking global
+     * reductions per iteration independent of the size of the Krylov
+     * space, while being as stable as the modified Gram-Schmidt method.
+     * The norm of the orthogonalized vector is computed as part of the
+     * second reduction.
+     *
+     * The reductions are not overlapped with other work: the next basis
+     * vector, and with it the next application of the preconditioner,
+     * depends on their result. Because the preconditioner of the outer
+     * Stokes solver contains inner iterative solves, the basis can also not
+     * be computed ahead of the preconditioner application as in pipelined
+     * or s-step GMRES methods.
+     *
+     * The class can be used as a drop-in replacement of SolverFGMRES.
+     */
+    template <class VectorType>
+    class SolverFGMRESClassicalGramSchmidt : public Solver<VectorType>
+    {
+      public:
+        /**
+         * Constructor. @p max_basis_size is the maximal number of basis
+         * vectors before the method is restarted.
+         */
+        SolverFGMRESClassicalGramSchmidt (SolverControl      &solver_control,
+                                          const unsigned int  max_basis_size);
+
+        /**
+         * Solve the linear system $Ax=b$ for $x$, using the preconditioner
+         * @p preconditioner. @p x is used as the starting guess.
+         */
+        template <class MatrixType, class PreconditionerType>
+        void
+        solve (const MatrixType         &A,
+               VectorType               &x,
+               const VectorType         &b,
+               const PreconditionerType &preconditioner);
+
+      private:
+        const unsigned int max_basis_size;
+    };
+
+
+
+    template <class VectorType>
+    SolverPipelinedCG<VectorType>::SolverPipelinedCG (SolverControl &solver_control)
+      :
+      Solver<VectorType> (solver_control)
+    {}
+
+
+
+    template <class VectorType>
+    template <class MatrixType, class PreconditionerType>
+    void
+    SolverPipelinedCG<VectorType>::solve (const MatrixType         &A,
+                                          VectorType               &x,
+                                          const VectorType         &b,
+                                          const PreconditionerType &preconditioner)
+    {
+      // the notation follows Algorithm 3 of Ghysels and Vanroose: r is the
+      // residual, u=Pr the preconditioned residual, w=Au, and p, s=Ap,
+      // q=Ps, z=Aq are the search direction and its images
+      VectorType r, u, w, m, n, p, s, q, z;
+      for (VectorType *v : {&r, &u, &w, &m, &n, &p, &s, &q, &z})
+        v->reinit (x);
+
+      A.vmult (r, x);
+      r.sadd (-1., 1., b);
+      preconditioner.vmult (u, r);
+      A.vmult (w, u);
+
+      const MPI_Comm mpi_communicator = KrylovSolvers::get_mpi_communicator (x);
+
+      double gamma_old = 0;
+      double alpha_old = 0;
+      std::vector<double> scalar_products (3);
+
+      SolverControl::State state = SolverControl::iterate;
+      for (unsigned int step = 0; state == SolverControl::iterate; ++step)
+        {
+          scalar_products[0] = KrylovSolvers::local_scalar_product (r, u);
+          scalar_products[1] = KrylovSolvers::local_scalar_product (w, u);
+          scalar_products[2] = KrylovSolvers::local_scalar_product (r, r);
+
+          MPI_Request request;
+          KrylovSolvers::start_sum (scalar_products, mpi_communicator, request);
+
+          // overlap the reduction with the expensive operations
+          preconditioner.vmult (m, w);
+          A.vmult (n, m);
+
+          KrylovSolvers::finish_sum (request);
+
+          const double gamma = scalar_products[0];
+          const double delta = scalar_products[1];
+          const double residual_norm = std::sqrt (scalar_products[2]);
+
+          state = this->iteration_status (step, residual_norm, x);
+          if (state != SolverControl::iterate)
+            break;
+
+          const double beta = (step == 0 ? 0. : gamma / gamma_old);
+          const double denominator = (step == 0 ? delta : delta - beta * gamma / alpha_old);
+          AssertThrow (denominator > 0 && gamma > 0,
+                       ExcMessage ("The pipelined CG method broke down, which indicates "
+                                   "that the matrix or the preconditioner is not "
+                                   "symmetric and positive definite."));
+          const double alpha = gamma / denominator;
+
+          z.sadd (beta, 1., n);
+          q.sadd (beta, 1., m);
+          s.sadd (beta, 1., w);
+          p.sadd (beta, 1., u);
+
+          x.add (alpha, p);
+          r.add (-alpha, s);
+          u.add (-alpha, q);
+          w.add (-alpha, z);
+
+          gamma_old = gamma;
+          alpha_old = alpha;
+        }
+
+      AssertThrow (state == SolverControl::success,
+                   SolverControl::NoConvergence (this->control().last_step(),
+                                                 this->control().last_value()));
+    }
+
+
+
+    template <class VectorType>
+    SolverFGMRESClassicalGramSchmidt<VectorType>::
+    SolverFGMRESClassicalGramSchmidt (SolverControl      &solver_control,
+                                      const unsigned int  max_basis_size)
+      :
+      Solver<VectorType> (solver_control),
+      max_basis_size (max_basis_size)
+    {
+      Assert (max_basis_size > 0, ExcMessage ("The basis size needs to be positive."));
+    }
+
+
+
+    template <class VectorType>
+    template <class MatrixType, class PreconditionerType>
+    void
+    SolverFGMRESClassicalGramSchmidt<VectorType>::solve (const MatrixType         &A,
+                                                         VectorType               &x,
+                                                         const VectorType         &b,
+                                                         const PreconditionerType &preconditioner)
+    {
+      const MPI_Comm mpi_communicator = KrylovSolvers::get_mpi_communicator (x);
+
+      // the orthonormal basis v and the preconditioned basis z, which are
+      // only allocated as far as they are needed
+      std::vector<VectorType> v (max_basis_size+1);
+      std::vector<VectorType> z (max_basis_size);
+      VectorType w;
+      w.reinit (x);
+
+      // the Hessenberg matrix, the Givens rotations that bring it into
+      // upper triangular form, and the rotated right hand side of the
+      // least squares problem
+      std::vector<std::vector<double> > H (max_basis_size,
+                                           std::vector<double>(max_basis_size+1, 0.));
+      std::vector<double> givens_c (max_basis_size), givens_s (max_basis_size);
+      std::vector<double> g (max_basis_size+1);
+      std::vector<double> scalar_products;
+
+      unsigned int step = 0;
+      SolverControl::State state = SolverControl::iterate;
+      while (state == SolverControl::iterate)
+        {
+          if (v[0].size() == 0)
+            v[0].reinit (x);
+          A.vmult (v[0], x);
+          v[0].sadd (-1., 1., b);
+          const double residual_norm = v[0].l2_norm();
+
+          state = this->iteration_status (step, residual_norm, x);
+          if (state != SolverControl::iterate)
+            break;
+
+          v[0] /= residual_norm;
+          std::fill (g.begin(), g.end(), 0.);
+          g[0] = residual_norm;
+
+          unsigned int basis_size = 0;
+          for (; basis_size<max_basis_size && state == SolverControl::iterate; ++basis_size)
+            {
+              const unsigned int j = basis_size;
+              if (z[j].size() == 0)
+                z[j].reinit (x);
+              if (v[j+1].size() == 0)
+                v[j+1].reinit (x);
+
+              preconditioner.vmult (z[j], v[j]);
+              A.vmult (w, z[j]);
+
+              // classical Gram-Schmidt, applied twice, where each pass
+              // computes all its scalar products (and the norm of the
+              // vector) in one blocking reduction
+              double norm_squared = 0;
+              for (unsigned int pass=0; pass<2; ++pass)
+                {
+                  scalar_products.resize (j+2);
+                  for (unsigned int i=0; i<=j; ++i)
+                    scalar_products[i] = KrylovSolvers::local_scalar_product (v[i], w);
+                  scalar_products[j+1] = KrylovSolvers::local_scalar_product (w, w);
+
+                  KrylovSolvers::sum (scalar_products, mpi_communicator);
+
+                  double projection_norm_squared = 0;
+                  for (unsigned int i=0; i<=j; ++i)
+                    {
+                      w.add (-scalar_products[i], v[i]);
+                      H[j][i] += scalar_products[i];
+                      projection_norm_squared += scalar_products[i] * scalar_products[i];
+                    }
+
+                  // by Pythagoras, the norm of the orthogonalized vector
+                  // follows from the norm before the pass and the
+                  // projections, which is accurate after the second pass
+                  // where the projections are tiny
+                  norm_squared = scalar_products[j+1] - projection_norm_squared;
+                }
+
+              const double norm = (norm_squared > 0
+                                   ?
+                                   std::sqrt (norm_squared)
+                                   :
+                                   w.l2_norm());
+              H[j][j+1] = norm;
+              if (norm > 0)
+                v[j+1].equ (1./norm, w);
+
+              // apply the previous Givens rotations to the new column, and
+              // compute a new one that eliminates the subdiagonal entry
+              for (unsigned int i=0; i<j; ++i)
+                {
+                  const double tmp = givens_c[i] * H[j][i] + givens_s[i] * H[j][i+1];
+                  H[j][i+1] = -givens_s[i] * H[j][i] + givens_c[i] * H[j][i+1];
+                  H[j][i] = tmp;
+                }
+              const double r = std::sqrt (H[j][j]*H[j][j] + H[j][j+1]*H[j][j+1]);
+              givens_c[j] = H[j][j] / r;
+              givens_s[j] = H[j][j+1] / r;
+              H[j][j] = r;
+              H[j][j+1] = 0;
+              g[j+1] = -givens_s[j] * g[j];
+              g[j] = givens_c[j] * g[j];
+
+              ++step;
+              state = this->iteration_status (step, std::fabs(g[j+1]), x);
+
+              // a lucky breakdown means the solution is in the current space
+              if (norm == 0 && state == SolverControl::iterate)
+                state = SolverControl::success;
+            }
+
+          // solve the upper triangular least squares system and update the
+          // solution with the preconditioned basis vectors
+          std::vector<double> y (basis_size);
+          for (int i=static_cast<int>(basis_size)-1; i>=0; --i)
+            {
+              double sum = g[i];
+              for (unsigned int k=i+1; k<basis_size; ++k)
+                sum -= H[k][i] * y[k];
+              y[i] = sum / H[i][i];
+            }
+          for (unsigned int i=0; i<basis_size; ++i)
+            x.add (y[i], z[i]);
+
+          for (unsigned int i=0; i<basis_size; ++i)
+            std::fill (H[i].begin(), H[i].end(), 0.);
+        }
+
+      AssertThrow (state == SolverControl::success,
+                   SolverControl::NoConvergence (this->control().last_step(),
+                                                 this->control().last_value()));
+    }
+  }
+}
+
+#endif
+#endif
@@ -22,6 +22,7 @@
 #define _aspect_material_model_diffusion_dislocation_h
 
 #include <aspect/material_model/interface.h>
+#include <aspect/material_model/rheology_kernels.h>
 #include <aspect/simulator_access.h>
 
 namespace aspect
@@ -151,11 +152,21 @@ namespace aspect
                               const std::vector<double> &parameter_values,
                               const enum averaging_scheme &average_type) const;
 
+        /**
+         * Compute the viscosities of all compositional fields at one point
+         * assuming that they all experience the same strain rate. The
+         * factors by which the stress exponentials of the diffusion and
+         * dislocation creep laws have to be multiplied to obtain the strain
+         * rates are computed by the caller for all points of a cell at once,
+         * see RheologyKernels::compute_strain_rate_prefactors().
+         */
         std::vector<double>
         calculate_isostrain_viscosities ( const std::vector<double> &volume_fractions,
                                           const double &pressure,
                                           const double &temperature,
-                                          const SymmetricTensor<2,dim> &strain_rate) const;
+                                          const SymmetricTensor<2,dim> &strain_rate,
+                                          const std::vector<double> &prefactors_stress_diffusion,
+                                          const std::vector<double> &prefactors_stress_dislocation) const;
 
 
         std::vector<double> prefactors_diffusion;
@@ -169,6 +180,13 @@ namespace aspect
         std::vector<double> activation_energies_dislocation;
         std::vector<double> activation_volumes_dislocation;
 
+        /**
+         * The diffusion and dislocation creep laws of each compositional
+         * field, built from the parameters above.
+         */
+        std::vector<RheologyKernels::PowerLawCreep> diffusion_creep;
+        std::vector<RheologyKernels::PowerLawCreep> dislocation_creep;
+
     };
 
   }
@@ -24,6 +24,10 @@
 
 #include <aspect/material_model/interface.h>
 #include <aspect/simulator_access.h>
+
+#include <deal.II/base/table.h>
+#include <deal.II/base/thread_management.h>
+
 #include <array>
 
 namespace aspect
@@ -63,6 +67,24 @@ namespace aspect
 
     namespace Lookup
     {
+      /**
+       * A structure that holds all material properties that a MaterialLookup
+       * provides at one pressure-temperature point, as returned by
+       * MaterialLookup::evaluate_all().
+       */
+      struct MaterialLookupValues
+      {
+        double density;
+        double thermal_expansivity;
+        double specific_heat;
+        double seismic_Vp;
+        double seismic_Vs;
+        double enthalpy;
+        double dHdT;
+        double dHdp;
+        double dRhodp;
+      };
+
       /**
        * A base class that can be used to look up material data from an external
        * data source (e.g. a table in a file). The class consists of data members
@@ -136,6 +158,27 @@ namespace aspect
           dRhodp (const double temperature,
                   const double pressure) const;
 
+          /**
+           * Return all properties of the table at the given temperature and
+           * pressure. The values are identical to the ones returned by the
+           * functions for the individual properties above, but the position
+           * in the table and the interpolation weights are only computed
+           * once, and the properties of one table entry are read from
+           * contiguous memory.
+           */
+          MaterialLookupValues
+          evaluate_all (const double temperature,
+                        const double pressure) const;
+
+          /**
+           * Same as above, but for all points of a cell at once. The
+           * vector @p values is resized to the number of points.
+           */
+          void
+          evaluate_all (const std::vector<double> &temperatures,
+                        const std::vector<double> &pressures,
+                        std::vector<MaterialLookupValues> &values) const;
+
           /**
            * Returns the size of the data tables in pressure (first entry)
            * and temperature (second entry) dimensions.
@@ -145,8 +188,57 @@ namespace aspect
 
         protected:
           /**
-           * Access that data value of the property that is stored in table
-           * @p values at pressure @p pressure and temperature @p temperature.
+           * The properties that are stored in the table. They are the last
+           * index of property_values, so all properties of one
+           * pressure-temperature point are stored next to each other.
+           */
+          enum Property
+          {
+            density_property,
+            thermal_expansivity_property,
+            specific_heat_property,
+            vp_property,
+            vs_property,
+            enthalpy_property,
+            n_properties
+          };
+
+          /**
+           * The position of a pressure-temperature point in the table: the
+           * indices of the table entry with the next lower temperature and
+           * pressure, and the coordinates of the point in the reference cell
+           * between this entry and the next higher ones.
+           */
+          struct TablePosition
+          {
+            unsigned int inT;
+            unsigned int inp;
+            double xi;
+            double eta;
+          };
+
+          /**
+           * Compute the position of a pressure-temperature point in the
+           * table.
+           */
+          TablePosition
+          get_table_position (const double temperature,
+                              const double pressure) const;
+
+          /**
+           * Access the data value of the property @p property at the table
+           * position @p position. @p interpol controls whether to perform
+           * linear interpolation between the closest data points, or simply
+           * use the closest point value.
+           */
+          double
+          value (const TablePosition &position,
+                 const Property property,
+                 const bool interpol) const;
+
+          /**
+           * Access that data value of the property @p property at pressure
+           * @p pressure and temperature @p temperature.
            * @p interpol controls whether to perform linear interpolation
            * between the closest data points, or simply use the closest point
            * value.
@@ -154,7 +246,7 @@ namespace aspect
           double
           value (const double temperature,
                  const double pressure,
-                 const Table<2, double> &values,
+                 const Property property,
                  const bool interpol) const;
 
           /**
@@ -167,12 +259,11 @@ namespace aspect
            */
           double get_np(const double pressure) const;
 
-          dealii::Table<2,double> density_values;
-          dealii::Table<2,double> thermal_expansivity_values;
-          dealii::Table<2,double> specific_heat_values;
-          dealii::Table<2,double> vp_values;
-          dealii::Table<2,double> vs_values;
-          dealii::Table<2,double> enthalpy_values;
+          /**
+           * The values of all properties, indexed by temperature, pressure
+           * and Property.
+           */
+          dealii::Table<3,double> property_values;
 
           double delta_press;
           double min_press;
@@ -244,6 +335,16 @@ namespace aspect
         void
         initialize ();
 
+        /**
+         * Called at the beginning of each time step. If the grain size
+         * evolution is integrated with the adaptive scheme, write the number
+         * of substeps and dislocation viscosity iterations of the previous
+         * time step into the statistics file.
+         */
+        virtual
+        void
+        update ();
+
         /**
          * Return whether the model is compressible or not.  Incompressibility
          * does not necessarily imply that the density is constant; rather, it
@@ -354,6 +455,21 @@ namespace aspect
          */
         double dislocation_viscosity_iteration_threshold;
         unsigned int dislocation_viscosity_iteration_number;
+
+        /**
+         * The scheme used to integrate the grain size evolution over one
+         * time step: either substeps whose length is doubled or halved
+         * depending on the relative change of the grain size, or the
+         * adaptive embedded Runge-Kutta scheme of Bogacki and Shampine, whose
+         * substeps are controlled by the relative tolerance below.
+         */
+        enum GrainSizeEvolutionScheme
+        {
+          fixed_substeps,
+          adaptive_runge_kutta
+        } grain_size_evolution_scheme;
+
+        double grain_size_evolution_tolerance;
         std::vector<double> dislocation_creep_exponent;
         std::vector<double> dislocation_activation_energy;
         std::vector<double> dislocation_activation_volume;
@@ -447,6 +563,18 @@ namespace aspect
                                               const std::vector<double> &compositional_fields,
                                               const Point<dim> &position) const;
 
+        /**
+         * Return the property @p property at point @p q of the values
+         * @p lookup_values that were computed by MaterialLookup::evaluate_all()
+         * for each of the material tables. If there is more than one table,
+         * the values are weighted by the compositional fields in the same way
+         * as in the density() and similar functions.
+         */
+        double average_lookup_property (const std::vector<std::vector<Lookup::MaterialLookupValues> > &lookup_values,
+                                        const unsigned int q,
+                                        double Lookup::MaterialLookupValues::*property,
+                                        const std::vector<double> &compositional_fields) const;
+
         /**
          * Returns the p-wave velocity as calculated by HeFESTo.
          */
@@ -520,6 +648,66 @@ namespace aspect
         void
         convert_log_grain_size (std::vector<double> &compositional_fields) const;
 
+        /**
+         * The quantities of one point that stay constant while the grain
+         * size evolution is integrated over a time step, and the current
+         * dislocation viscosity, which is used as starting guess for the
+         * next evaluation of the grain size evolution rate.
+         */
+        struct GrainSizeEvolutionPoint
+        {
+          unsigned int phase_index;
+          double growth_prefactor;
+          double second_strain_rate_invariant;
+          double reference_grain_size;
+          double reference_diffusion_viscosity;
+          double diffusion_grain_size_exponent;
+          double full_strain_rate_dislocation_viscosity;
+          double dislocation_strain_rate_exponent;
+          double dislocation_viscosity;
+        };
+
+        /**
+         * Return the rate of change of the grain size at the point @p point
+         * for the grain size @p grain_size, i.e. the difference of grain
+         * growth and grain size reduction. The diffusion viscosity is scaled
+         * from its value at the reference grain size, and the dislocation
+         * viscosity is found by a fixed point iteration that starts from the
+         * dislocation viscosity stored in @p point and stores its result
+         * there. The number of iterations is added to
+         * @p n_dislocation_iterations.
+         */
+        double
+        grain_size_evolution_rate (GrainSizeEvolutionPoint &point,
+                                   const double grain_size,
+                                   unsigned int &n_dislocation_iterations) const;
+
+        /**
+         * Same as grain_size_change(), but for all points of @p in at once
+         * and using the adaptive Runge-Kutta scheme. All points take their
+         * substeps in lock-step, each with its own substep size, until every
+         * point has reached the end of the time step. @p pressures are the
+         * pressures that are used instead of the ones of @p in, and
+         * @p grain_sizes the grain sizes at the points.
+         */
+        void
+        grain_size_changes (const typename Interface<dim>::MaterialModelInputs &in,
+                            const std::vector<double> &pressures,
+                            const std::vector<double> &grain_sizes,
+                            const std::vector<int> &crossed_transitions,
+                            const unsigned int field_index,
+                            std::vector<double> &changes) const;
+
+        /**
+         * The number of substeps and dislocation viscosity iterations taken
+         * by the adaptive grain size evolution scheme on this process since
+         * the last call to update(), and a mutex that guards them, because
+         * evaluate() is called from several threads.
+         */
+        mutable unsigned int n_grain_size_substeps;
+        mutable unsigned int n_dislocation_viscosity_iterations;
+        mutable Threads::Mutex grain_size_statistics_mutex;
+
         /**
          * list of depth, width and Clapeyron slopes for the different phase
          * transitions and in which phase they occur
@@ -34,6 +34,7 @@
 #include <deal.II/fe/component_mask.h>
 #include <deal.II/numerics/data_postprocessor.h>
 #include <deal.II/base/signaling_nan.h>
+#include <deal.II/base/aligned_vector.h>
 
 namespace aspect
 {
@@ -166,6 +167,360 @@ namespace aspect
     }
 
 
+    /**
+     * A namespace whose enum members are used to describe which of the
+     * properties in MaterialModelOutputs a caller of
+     * MaterialModel::Interface::evaluate() actually needs.
+     */
+    namespace MaterialProperties
+    {
+      /**
+       * An enum with one bit for each of the properties stored in
+       * MaterialModelOutputs. Callers that only need some of them can set
+       * MaterialModelOutputs::requested_properties to a combination of
+       * these values, and material models may then skip computing the
+       * others, whose values are left undefined. Additional outputs are
+       * not affected: they are computed whenever they are attached to the
+       * outputs object.
+       */
+      enum Property
+      {
+        uninitialized                  = 0,
+
+        viscosity                      = 1,
+        density                        = 2,
+        thermal_expansion_coefficient  = 4,
+        specific_heat                  = 8,
+        thermal_conductivity           = 16,
+        compressibility                = 32,
+        entropy_derivative_pressure    = 64,
+        entropy_derivative_temperature = 128,
+        reaction_terms                 = 256,
+
+        equation_of_state_properties   = density | thermal_expansion_coefficient | specific_heat
+                                         | compressibility | entropy_derivative_pressure
+                                         | entropy_derivative_temperature,
+        all_properties                 = viscosity | equation_of_state_properties
+                                         | thermal_conductivity | reaction_terms
+      };
+
+
+      /**
+       * Provide an operator that or's two Property variables.
+       */
+      inline Property operator | (const Property p1,
+                                  const Property p2)
+      {
+        return Property((int)p1 | (int)p2);
+      }
+
+      inline Property operator |= (Property &p1,
+                                   const Property p2)
+      {
+        p1 = (p1 | p2);
+        return p1;
+      }
+    }
+
+
+
+    /**
+     * A view of a sequence of values that are stored at a fixed distance
+     * (the stride) from each other in memory. Objects of this type are
+     * returned by the accessors of CompositionTable and refer to either the
+     * values of all fields at one point (with a stride equal to the number of
+     * points) or to the values of one field at all points (with unit
+     * stride).
+     *
+     * The view can be used in place of a std::vector<double> in most
+     * existing code: it provides operator[] and size(), and it converts
+     * implicitly to a std::vector<double>. The conversion copies the values,
+     * however, so code that is evaluated often should use the view directly
+     * or fill an existing vector with copy_to().
+     *
+     * @tparam Number Either double or const double.
+     */
+    template <typename Number>
+    class StridedArrayView
+    {
+      public:
+        /**
+         * Constructor. Create a view of the @p n_entries values
+         * <code>data[0], data[stride], ..., data[(n_entries-1)*stride]</code>.
+         */
+        StridedArrayView (Number             *data,
+                          const unsigned int  n_entries,
+                          const unsigned int  stride);
+
+        /**
+         * Return a reference to the value with index @p i.
+         */
+        Number &operator[] (const unsigned int i) const;
+
+        /**
+         * Return the number of values in the view.
+         */
+        unsigned int size () const;
+
+        /**
+         * Copy the values of the view into @p values, which is resized if
+         * necessary. This does not allocate memory if @p values is already
+         * large enough.
+         */
+        void copy_to (std::vector<double> &values) const;
+
+        /**
+         * Return a copy of the values of the view.
+         */
+        operator std::vector<double> () const;
+
+      private:
+        Number       *data;
+        unsigned int  n_entries;
+        unsigned int  stride;
+    };
+
+
+
+    /**
+     * A table of values of all compositional fields (or quantities of the
+     * same shape, such as reaction terms) at a set of points. The values are
+     * stored contiguously in a single aligned array in which the values of
+     * each field at all points follow each other, i.e., in the layout
+     * [field][point]. Material models can therefore loop over the points
+     * of one field with unit stride, see field() and field_data(), which
+     * allows the compiler to vectorize such loops, and creating a table
+     * only requires a single memory allocation.
+     *
+     * For compatibility with code written for the previous layout as a
+     * std::vector<std::vector<double> > indexed as [point][field],
+     * <code>table[q][c]</code> still returns the value of field c at point q,
+     * by way of a StridedArrayView with a stride equal to the number of
+     * points.
+     */
+    class CompositionTable
+    {
+      public:
+        /**
+         * Constructor. Create a table for @p n_points points and
+         * @p n_fields fields, and set all values to @p value.
+         */
+        CompositionTable (const unsigned int n_points = 0,
+                          const unsigned int n_fields = 0,
+                          const double       value = 0.0);
+
+        /**
+         * Change the size of the table to @p n_points points and
+         * @p n_fields fields and set all values to @p value.
+         */
+        void reinit (const unsigned int n_points,
+                     const unsigned int n_fields,
+                     const double       value = 0.0);
+
+        /**
+         * Return the values of all fields at the point with index @p q.
+         */
+        StridedArrayView<double> operator[] (const unsigned int q);
+
+        /**
+         * Return the values of all fields at the point with index @p q.
+         */
+        StridedArrayView<const double> operator[] (const unsigned int q) const;
+
+        /**
+         * Return the values of the field with index @p c at all points.
+         */
+        StridedArrayView<double> field (const unsigned int c);
+
+        /**
+         * Return the values of the field with index @p c at all points.
+         */
+        StridedArrayView<const double> field (const unsigned int c) const;
+
+        /**
+         * Return a pointer to the contiguous values of the field with index
+         * @p c at all points.
+         */
+        double *field_data (const unsigned int c);
+
+        /**
+         * Return a pointer to the contiguous values of the field with index
+         * @p c at all points.
+         */
+        const double *field_data (const unsigned int c) const;
+
+        /**
+         * Return the number of points, i.e., the size of the table in the
+         * same sense as for the previous std::vector<std::vector<double> >
+         * layout.
+         */
+        unsigned int size () const;
+
+        /**
+         * Return the number of points.
+         */
+        unsigned int n_points () const;
+
+        /**
+         * Return the number of fields.
+         */
+        unsigned int n_fields () const;
+
+      private:
+        /**
+         * The values, with the value of field c at point q stored at index
+         * c*n_points()+q.
+         */
+        AlignedVector<double> values;
+
+        unsigned int n_table_points;
+        unsigned int n_table_fields;
+    };
+
+
+
+    template <typename Number>
+    inline
+    StridedArrayView<Number>::StridedArrayView (Number             *data_in,
+                                                const unsigned int  n_entries_in,
+                                                const unsigned int  stride_in)
+      :
+      data (data_in),
+      n_entries (n_entries_in),
+      stride (stride_in)
+    {}
+
+
+
+    template <typename Number>
+    inline
+    Number &
+    StridedArrayView<Number>::operator[] (const unsigned int i) const
+    {
+      AssertIndexRange (i, n_entries);
+      return data[i*stride];
+    }
+
+
+
+    template <typename Number>
+    inline
+    unsigned int
+    StridedArrayView<Number>::size () const
+    {
+      return n_entries;
+    }
+
+
+
+    template <typename Number>
+    inline
+    void
+    StridedArrayView<Number>::copy_to (std::vector<double> &values) const
+    {
+      values.resize (n_entries);
+      for (unsigned int i=0; i<n_entries; ++i)
+        values[i] = data[i*stride];
+    }
+
+
+
+    template <typename Number>
+    inline
+    StridedArrayView<Number>::operator std::vector<double> () const
+    {
+      std::vector<double> values;
+      copy_to (values);
+      return values;
+    }
+
+
+
+    inline
+    StridedArrayView<double>
+    CompositionTable::operator[] (const unsigned int q)
+    {
+      AssertIndexRange (q, n_table_points);
+      return StridedArrayView<double> (values.begin() + q, n_table_fields, n_table_points);
+    }
+
+
+
+    inline
+    StridedArrayView<const double>
+    CompositionTable::operator[] (const unsigned int q) const
+    {
+      AssertIndexRange (q, n_table_points);
+      return StridedArrayView<const double> (values.begin() + q, n_table_fields, n_table_points);
+    }
+
+
+
+    inline
+    StridedArrayView<double>
+    CompositionTable::field (const unsigned int c)
+    {
+      return StridedArrayView<double> (field_data(c), n_table_points, 1);
+    }
+
+
+
+    inline
+    StridedArrayView<const double>
+    CompositionTable::field (const unsigned int c) const
+    {
+      return StridedArrayView<const double> (field_data(c), n_table_points, 1);
+    }
+
+
+
+    inline
+    double *
+    CompositionTable::field_data (const unsigned int c)
+    {
+      AssertIndexRange (c, n_table_fields);
+      return values.begin() + c*n_table_points;
+    }
+
+
+
+    inline
+    const double *
+    CompositionTable::field_data (const unsigned int c) const
+    {
+      AssertIndexRange (c, n_table_fields);
+      return values.begin() + c*n_table_points;
+    }
+
+
+
+    inline
+    unsigned int
+    CompositionTable::size () const
+    {
+      return n_table_points;
+    }
+
+
+
+    inline
+    unsigned int
+    CompositionTable::n_points () const
+    {
+      return n_table_points;
+    }
+
+
+
+    inline
+    unsigned int
+    CompositionTable::n_fields () const
+    {
+      return n_table_fields;
+    }
+
+
+
     template <int dim>     class AdditionalMaterialInputs;
 
 
@@ -272,9 +627,12 @@ namespace aspect
         /**
          * Values of the compositional fields at the points given in the
          * #position vector: composition[i][c] is the compositional field c at
-         * point i.
+         * point i. The values are stored field by field, see
+         * CompositionTable, so that composition.field(c) or
+         * composition.field_data(c) provide the values of field c at all
+         * points with unit stride.
          */
-        std::vector<std::vector<double> > composition;
+        CompositionTable composition;
 
         /**
          * Strain rate at the points given in the #position vector. Only the
@@ -462,7 +820,28 @@ namespace aspect
        * SimulatorAccess so you can query the time step used by the simulator
        * in order to compute the reaction increment.
        */
-      std::vector<std::vector<double> > reaction_terms;
+      CompositionTable reaction_terms;
+
+      /**
+       * The properties the caller of MaterialModel::Interface::evaluate()
+       * needs, as a combination of MaterialProperties::Property values.
+       * Material models may skip computing the properties that are not
+       * requested, which then keep undefined values. The constructor
+       * requests all properties.
+       *
+       * The assembly of the Stokes preconditioner only requests the
+       * viscosity (unless melt transport is used), so assemblers in
+       * Assemblers::Manager::stokes_preconditioner must not read other
+       * properties. An assembler that needs them has to add them to this
+       * member in its create_additional_material_model_outputs()
+       * function, which is called after the member has been set.
+       */
+      MaterialProperties::Property requested_properties;
+
+      /**
+       * Return whether @p property is among the #requested_properties.
+       */
+      bool requests_property (const MaterialProperties::Property property) const;
 
       /**
        * Vector of shared pointers to additional material model output
@@ -1230,6 +1609,15 @@ namespace aspect
     }
 
 
+    template <int dim>
+    inline
+    bool
+    MaterialModelOutputs<dim>::requests_property (const MaterialProperties::Property property) const
+    {
+      return (requested_properties & property) != 0;
+    }
+
+
     /**
      * Given a class name, a name, and a description for the parameter file
      * for a material model, register it with the functions that can declare
@@ -0,0 +1,152 @@
+/*
+  Copyright (C) 2018 by the authors of the ASPECT code.
+
+  This file is part of ASPECT.
+
+  ASPECT is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2, or (at your option)
+  any later version.
+
+  ASPECT is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with ASPECT; see the file LICENSE.  If not see
+  <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _aspect_material_model_rheology_kernels_h
+#define _aspect_material_model_rheology_kernels_h
+
+#include <aspect/global.h>
+
+namespace aspect
+{
+  namespace MaterialModel
+  {
+    /**
+     * A namespace for functions that evaluate viscous flow laws at many
+     * points at once. Material models such as ViscoPlastic and
+     * DiffusionDislocation evaluate the same flow law for every quadrature
+     * point of a cell and every compositional field. The batched functions
+     * in this namespace write the flow laws in logarithmic form, so that each
+     * evaluation only requires a single call to std::exp instead of one
+     * exponential and several powers, and they loop over arrays of points
+     * without dependencies between iterations, which allows the compiler to
+     * vectorize them. For every batched function there is a function that
+     * evaluates the flow law at a single point in the form in which it is
+     * usually written, which serves as the reference for the batched one.
+     */
+    namespace RheologyKernels
+    {
+      /**
+       * The parameters of a power law creep mechanism in which the square
+       * root of the second invariant of the deviatoric strain rate
+       * $\dot\varepsilon_{II}$ depends on the corresponding stress invariant
+       * $\sigma_{II}$, the grain size $d$, pressure $P$ and temperature $T$
+       * as
+       * @f[
+       *   \dot\varepsilon_{II} = A \sigma_{II}^n d^{-m}
+       *   \exp\left(-\frac{E + PV}{RT}\right),
+       * @f]
+       * with prefactor $A$, stress exponent $n$, grain size exponent $m$,
+       * activation energy $E$ and activation volume $V$. Diffusion creep is
+       * the special case $n=1$, and dislocation creep the special case
+       * $m=0$.
+       */
+      struct PowerLawCreep
+      {
+        /**
+         * Constructor. Store the parameters and precompute the logarithms
+         * of the factors of the flow law that do not depend on the point.
+         */
+        PowerLawCreep (const double prefactor,
+                       const double stress_exponent,
+                       const double grain_size_exponent,
+                       const double activation_energy,
+                       const double activation_volume,
+                       const double grain_size);
+
+        double prefactor;
+        double stress_exponent;
+        double grain_size_exponent;
+        double activation_energy;
+        double activation_volume;
+        double grain_size;
+
+        /**
+         * The logarithm of $\frac 12 A^{-1/n} d^{m/n}$.
+         */
+        double log_viscosity_prefactor;
+
+        /**
+         * The exponent $\frac{1-n}{n}$ of the strain rate in the viscosity.
+         */
+        double strain_rate_exponent;
+
+        /**
+         * The logarithm of $A d^{-m}$.
+         */
+        double log_strain_rate_prefactor;
+      };
+
+      /**
+       * Return the viscosity
+       * @f[
+       *   \eta = \frac 12 A^{-1/n} d^{m/n} \dot\varepsilon_{II}^{\frac{1-n}{n}}
+       *   \exp\left(\frac{E + PV}{nRT}\right)
+       * @f]
+       * of the creep mechanism @p creep at the given pressure, temperature
+       * and strain rate invariant.
+       */
+      double
+      compute_viscosity (const PowerLawCreep &creep,
+                         const double         pressure,
+                         const double         temperature,
+                         const double         strain_rate);
+
+      /**
+       * Compute the same viscosity as compute_viscosity() at @p n_points
+       * points at once. Instead of the strain rates, the function takes
+       * their natural logarithms, which callers can compute once per point
+       * and reuse for all creep mechanisms and compositional fields. All
+       * arrays need to have @p n_points entries.
+       */
+      void
+      compute_viscosities (const PowerLawCreep &creep,
+                           const unsigned int   n_points,
+                           const double        *pressures,
+                           const double        *temperatures,
+                           const double        *log_strain_rates,
+                           double              *viscosities);
+
+      /**
+       * Return the factor $A d^{-m} \exp\left(-\frac{\max(E + PV,0)}{RT}\right)$
+       * by which $\sigma_{II}^n$ has to be multiplied to obtain the strain
+       * rate of the creep mechanism @p creep. The activation enthalpy is
+       * limited to non-negative values.
+       */
+      double
+      compute_strain_rate_prefactor (const PowerLawCreep &creep,
+                                     const double         pressure,
+                                     const double         temperature);
+
+      /**
+       * Compute the same factor as compute_strain_rate_prefactor() at
+       * @p n_points points at once. All arrays need to have @p n_points
+       * entries.
+       */
+      void
+      compute_strain_rate_prefactors (const PowerLawCreep &creep,
+                                      const unsigned int   n_points,
+                                      const double        *pressures,
+                                      const double        *temperatures,
+                                      double              *prefactors);
+    }
+  }
+}
+
+#endif
@@ -22,6 +22,7 @@
 #define _aspect_material_model_visco_plastic_h
 
 #include <aspect/material_model/interface.h>
+#include <aspect/material_model/rheology_kernels.h>
 #include <aspect/simulator_access.h>
 
 namespace aspect
@@ -212,6 +213,15 @@ namespace aspect
                               const std::vector<double> &parameter_values,
                               const averaging_scheme &average_type) const;
 
+        /**
+         * Return the square root of the second invariant of the deviatoric
+         * strain rate, limited from below by the minimum strain rate, or
+         * the reference strain rate in the first iteration of the first
+         * time step.
+         */
+        double
+        calculate_strain_rate_invariant ( const SymmetricTensor<2,dim> &strain_rate ) const;
+
         std::pair<std::vector<double>, std::vector<double> >
         calculate_isostrain_viscosities ( const std::vector<double> &volume_fractions,
                                           const double &pressure,
@@ -221,6 +231,22 @@ namespace aspect
                                           const ViscosityScheme &viscous_type,
                                           const YieldScheme &yield_type) const;
 
+        /**
+         * Same as above, but with the strain rate invariant @p edot_ii and
+         * the diffusion and dislocation creep viscosities of all
+         * compositional fields at the current point already computed, as
+         * evaluate() does for all points of a cell at once.
+         */
+        std::pair<std::vector<double>, std::vector<double> >
+        calculate_isostrain_viscosities ( const std::vector<double> &volume_fractions,
+                                          const double pressure,
+                                          const double edot_ii,
+                                          const std::vector<double> &composition,
+                                          const std::vector<double> &viscosities_diffusion,
+                                          const std::vector<double> &viscosities_dislocation,
+                                          const ViscosityScheme &viscous_type,
+                                          const YieldScheme &yield_type) const;
+
         /**
          * A function that computes the strain weakened values
          * of cohesion and internal friction angle for a given
@@ -310,6 +336,14 @@ namespace aspect
         std::vector<double> activation_energies_dislocation;
         std::vector<double> activation_volumes_dislocation;
 
+        /**
+         * The diffusion (with stress exponent one) and dislocation (without
+         * grain size dependence) creep laws of all compositional fields,
+         * built from the parameters above.
+         */
+        std::vector<RheologyKernels::PowerLawCreep> diffusion_creep;
+        std::vector<RheologyKernels::PowerLawCreep> dislocation_creep;
+
         std::vector<double> angles_internal_friction;
         std::vector<double> cohesions;
         std::vector<double> exponents_stress_limiter;
@@ -273,6 +273,14 @@ namespace aspect
         execute(internal::Assembly::Scratch::ScratchBase<dim>   &scratch,
                 internal::Assembly::CopyData::CopyDataBase<dim> &data) const;
 
+        /**
+         * Same as execute(), but for the concrete scratch and copy data
+         * types, and without virtual dispatch.
+         */
+        void
+        assemble(internal::Assembly::Scratch::AdvectionSystem<dim> &scratch,
+                 internal::Assembly::CopyData::AdvectionSystem<dim> &data) const;
+
         /**
          * Compute the residual of the advection system on a single cell in
          * the case of melt migration.
@@ -111,6 +111,213 @@ namespace aspect
       };
     };
 
+    /**
+     * A struct that describes the available iterative solvers for the
+     * linear Stokes system.
+     */
+    struct StokesSolverType
+    {
+      /**
+       * This enum lists the available iterative Stokes solvers. Both
+       * use the same FGMRES iteration with a block Schur complement
+       * preconditioner, but differ in how the operators are represented
+       * and how the velocity block is preconditioned: 'block AMG' uses
+       * assembled sparse matrices and an algebraic multigrid
+       * preconditioner, 'block GMG' uses matrix-free operators and a
+       * geometric multigrid preconditioner.
+       */
+      enum Kind
+      {
+        block_amg,
+        block_gmg
+      };
+
+      /**
+       * This function translates an input string into the
+       * available enum options.
+       */
+      static
+      Kind
+      parse(const std::string &input)
+      {
+        if (input == "block AMG")
+          return StokesSolverType::block_amg;
+        else if (input == "block GMG")
+          return StokesSolverType::block_gmg;
+        else
+          AssertThrow(false, ExcNotImplemented());
+
+        return StokesSolverType::Kind();
+      }
+    };
+
+    /**
+     * A struct that describes the available approximations of the Schur
+     * complement in the block preconditioner of the iterative Stokes solver.
+     */
+    struct SchurComplementApproximation
+    {
+      /**
+       * This enum lists the available approximations: the pressure mass
+       * matrix weighted by the inverse of the viscosity, and the weighted
+       * BFBt approximation that is built from the divergence and gradient
+       * blocks of the Stokes matrix and the diagonal of its velocity block.
+       */
+      enum Kind
+      {
+        weighted_mass_matrix,
+        weighted_bfbt
+      };
+
+      /**
+       * This function translates an input string into the
+       * available enum options.
+       */
+      static
+      Kind
+      parse(const std::string &input)
+      {
+        if (input == "weighted mass matrix")
+          return SchurComplementApproximation::weighted_mass_matrix;
+        else if (input == "weighted BFBt")
+          return SchurComplementApproximation::weighted_bfbt;
+        else
+          AssertThrow(false, ExcNotImplemented());
+
+        return SchurComplementApproximation::Kind();
+      }
+    };
+
+    /**
+     * A struct that contains information about which preconditioner
+     * should be used for the linear systems of the temperature and
+     * compositional fields.
+     */
+    struct AdvectionPreconditioner
+    {
+      /**
+       * This enum lists the available preconditioners: an incomplete LU
+       * decomposition, algebraic multigrid (for diffusion dominated
+       * fields), the point Jacobi method and a Chebyshev iteration
+       * around it (for advection dominated fields), and an automatic
+       * choice between algebraic multigrid and the point Jacobi method
+       * based on the cell Peclet numbers of the field.
+       */
+      enum Kind
+      {
+        ilu,
+        amg,
+        jacobi,
+        chebyshev,
+        automatic
+      };
+
+      /**
+       * This function translates an input string into the
+       * available enum options.
+       */
+      static
+      Kind
+      parse(const std::string &input)
+      {
+        if (input == "ILU")
+          return AdvectionPreconditioner::ilu;
+        else if (input == "AMG")
+          return AdvectionPreconditioner::amg;
+        else if (input == "Jacobi")
+          return AdvectionPreconditioner::jacobi;
+        else if (input == "Chebyshev")
+          return AdvectionPreconditioner::chebyshev;
+        else if (input == "automatic")
+          return AdvectionPreconditioner::automatic;
+        else
+          AssertThrow(false, ExcNotImplemented());
+
+        return AdvectionPreconditioner::Kind();
+      }
+    };
+
+    /**
+     * A struct that describes the available variants of the Krylov
+     * methods used in the iterative Stokes solver.
+     */
+    struct KrylovSolverVariant
+    {
+      /**
+       * This enum lists the available variants: the standard CG and FGMRES
+       * methods, and variants of them with fewer global reductions per
+       * iteration (a pipelined CG method for the inner solves in the
+       * preconditioner that overlaps its reduction with other work, and an
+       * FGMRES method with classical Gram-Schmidt orthogonalization for the
+       * outer solve that needs two blocking reductions per iteration), at
+       * the cost of some more vector operations.
+       */
+      enum Kind
+      {
+        standard,
+        pipelined_cg_classical_gram_schmidt
+      };
+
+      /**
+       * This function translates an input string into the
+       * available enum options.
+       */
+      static
+      Kind
+      parse(const std::string &input)
+      {
+        if (input == "standard")
+          return KrylovSolverVariant::standard;
+        else if (input == "pipelined CG and classical Gram-Schmidt FGMRES")
+          return KrylovSolverVariant::pipelined_cg_classical_gram_schmidt;
+        else
+          AssertThrow(false, ExcNotImplemented());
+
+        return KrylovSolverVariant::Kind();
+      }
+    };
+
+    /**
+     * A struct that describes how the initial guess for the solution of
+     * a time step is extrapolated from the solutions of previous time
+     * steps.
+     */
+    struct InitialGuessExtrapolation
+    {
+      /**
+       * This enum lists the available extrapolation schemes: no
+       * extrapolation (i.e., start from the solution of the previous time
+       * step), linear extrapolation from the last two, and quadratic
+       * extrapolation from the last three solutions.
+       */
+      enum Kind
+      {
+        none,
+        linear,
+        quadratic
+      };
+
+      /**
+       * This function translates an input string into the
+       * available enum options.
+       */
+      static
+      Kind
+      parse(const std::string &input)
+      {
+        if (input == "none")
+          return InitialGuessExtrapolation::none;
+        else if (input == "linear")
+          return InitialGuessExtrapolation::linear;
+        else if (input == "quadratic")
+          return InitialGuessExtrapolation::quadratic;
+        else
+          AssertThrow(false, ExcNotImplemented());
+
+        return InitialGuessExtrapolation::Kind();
+      }
+    };
+
     /**
      * A struct that contains information about which
      * formulation of the basic equations should be solved,
@@ -310,6 +517,7 @@ namespace aspect
 
     double                         nonlinear_tolerance;
     double                         nonlinear_switch_tolerance;
+    unsigned int                   anderson_acceleration_depth;
     bool                           resume_computation;
     double                         start_time;
     double                         CFL_number;
@@ -325,6 +533,9 @@ namespace aspect
     double                         adiabatic_surface_temperature;
     unsigned int                   timing_output_frequency;
     bool                           use_direct_stokes_solver;
+    typename StokesSolverType::Kind stokes_solver_type;
+    typename SchurComplementApproximation::Kind schur_complement_approximation;
+    typename KrylovSolverVariant::Kind stokes_krylov_solver_variant;
     double                         linear_stokes_solver_tolerance;
     double                         linear_solver_A_block_tolerance;
     bool                           use_full_A_block_preconditioner;
@@ -333,13 +544,23 @@ namespace aspect
     unsigned int                   AMG_smoother_sweeps;
     double                         AMG_aggregation_threshold;
     bool                           AMG_output_details;
+    bool                           AMG_use_rigid_body_modes;
     unsigned int                   max_nonlinear_iterations;
     unsigned int                   max_nonlinear_iterations_in_prerefinement;
     unsigned int                   n_cheap_stokes_solver_steps;
     unsigned int                   n_expensive_stokes_solver_steps;
     unsigned int                   stokes_gmres_restart_length;
+    double                         stokes_preconditioner_reuse_factor;
+    unsigned int                   stokes_krylov_recycling_dimension;
+    bool                           use_incremental_stokes_assembly;
+    double                         incremental_stokes_assembly_tolerance;
+    typename InitialGuessExtrapolation::Kind initial_guess_extrapolation;
     double                         temperature_solver_tolerance;
     double                         composition_solver_tolerance;
+    typename AdvectionPreconditioner::Kind advection_preconditioner;
+    unsigned int                   advection_chebyshev_degree;
+    double                         advection_chebyshev_eigenvalue_ratio;
+    bool                           cache_advection_material_model_outputs;
     bool                           use_operator_splitting;
 
     /**
@@ -474,6 +695,8 @@ namespace aspect
     bool                           use_locally_conservative_discretization;
     bool                           use_discontinuous_temperature_discretization;
     bool                           use_discontinuous_composition_discretization;
+    bool                           use_explicit_discontinuous_composition_advection;
+    double                         explicit_discontinuous_advection_cfl_number;
     unsigned int                   temperature_degree;
     unsigned int                   composition_degree;
     std::string                    pressure_normalization;
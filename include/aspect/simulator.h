@@ -97,10 +97,26 @@ namespace aspect
   template <int dim>
   class FreeSurfaceHandler;
 
+  template <int dim>
+  class StokesMatrixFreeHandler;
+
   namespace internal
   {
+    class DirectStokesSolver;
+
+    template <int dim>
+    class AdvectionMaterialModelCache;
+
+    template <int dim>
+    class IncrementalStokesAssembly;
+
+    template <int dim>
+    struct ExplicitAdvectionScratch;
+
     namespace Assembly
     {
+      template <int dim>      class CellCongruenceClasses;
+
       namespace Scratch
       {
         template <int dim>      struct StokesPreconditioner;
@@ -553,14 +569,28 @@ namespace aspect
       void build_stokes_preconditioner ();
 
       /**
-       * Initialize the preconditioner for the advection equation of field
-       * index.
+       * Compute the Poisson-type matrix $BD^{-1}B^T$, the inverse diagonal
+       * weight $D^{-1}$ and the algebraic multigrid preconditioner that make
+       * up the weighted BFBt approximation of the Schur complement. This
+       * function is called by build_stokes_preconditioner() if this
+       * approximation is selected.
+       *
+       * This function is implemented in
+       * <code>source/simulator/assembly.cc</code>.
+       */
+      void build_weighted_bfbt_preconditioner ();
+
+      /**
+       * Initialize a preconditioner of the given type for the advection
+       * equation of field index. The type must not be
+       * Parameters::AdvectionPreconditioner::automatic.
        *
        * This function is implemented in
        * <code>source/simulator/assembly.cc</code>.
        */
-      void build_advection_preconditioner (const AdvectionField &advection_field,
-                                           aspect::LinearAlgebra::PreconditionILU &preconditioner);
+      void build_advection_preconditioner (const AdvectionField                                          &advection_field,
+                                           const typename Parameters<dim>::AdvectionPreconditioner::Kind  preconditioner_type,
+                                           std::shared_ptr<aspect::LinearAlgebra::PreconditionBase>      &preconditioner);
 
       /**
        * Initiate the assembly of the Stokes matrix and right hand side.
@@ -626,6 +656,29 @@ namespace aspect
        */
       void assemble_advection_system (const AdvectionField &advection_field);
 
+      /**
+       * Return whether the system of the given advection field is solved
+       * with the matrix and preconditioner of the compositional field
+       * composition_matrix_field instead of its own matrix, because both
+       * matrices are identical. In that case, assemble_advection_system()
+       * only assembles the right hand side of the field.
+       *
+       * This function is implemented in
+       * <code>source/simulator/assembly.cc</code>.
+       */
+      bool reuses_composition_matrix (const AdvectionField &advection_field) const;
+
+      /**
+       * Free the matrix and the preconditioner of the compositional field
+       * composition_matrix_field, unless it is the matrix of the first
+       * compositional field whose memory is always kept, and set
+       * composition_matrix_field to numbers::invalid_unsigned_int.
+       *
+       * This function is implemented in
+       * <code>source/simulator/assembly.cc</code>.
+       */
+      void release_composition_matrix ();
+
       /**
        * Solve one block of the temperature/composition linear system.
        * Return the initial nonlinear residual, i.e., if the linear system to
@@ -638,6 +691,41 @@ namespace aspect
        */
       double solve_advection (const AdvectionField &advection_field);
 
+      /**
+       * Advect the discontinuous compositional field @p advection_field
+       * over the current time step with an explicit, strong stability
+       * preserving third order Runge-Kutta method (SSP-RK3) instead of
+       * assembling and solving a linear system. The time step is split into
+       * as many equal substeps as the CFL condition on the most restrictive
+       * cell requires. The right hand side of each stage is the upwind
+       * discontinuous Galerkin discretization of the advection term that is
+       * also used by the implicit assemblers, and it is multiplied by the
+       * cell-wise inverse of the mass matrix. If the limiter for
+       * discontinuous composition solutions is enabled, it is applied after
+       * every stage. Without operator splitting, the reaction terms of the
+       * material model are added to every stage as a constant rate. The
+       * result is written into the solution vector.
+       *
+       * This function is implemented in
+       * <code>source/simulator/solver.cc</code>.
+       */
+      void advect_composition_explicitly (const AdvectionField &advection_field);
+
+      /**
+       * Evaluate the upwind discontinuous Galerkin discretization of the
+       * advection term of @p advection_field for the state currently stored
+       * in the solution vector, multiply it by the cell-wise inverse mass
+       * matrices stored in @p scratch, and write the result into
+       * @p field_rate. This is the right hand side of each stage of
+       * advect_composition_explicitly().
+       *
+       * This function is implemented in
+       * <code>source/simulator/solver.cc</code>.
+       */
+      void compute_explicit_advection_rate (const AdvectionField                    &advection_field,
+                                            internal::ExplicitAdvectionScratch<dim> &scratch,
+                                            LinearAlgebra::Vector                   &field_rate);
+
       /**
        * Interpolate a particular particle property to the solution field.
        */
@@ -1585,6 +1673,7 @@ namespace aspect
       double                                                    time;
       double                                                    time_step;
       double                                                    old_time_step;
+      double                                                    old_old_time_step;
       unsigned int                                              timestep_number;
       unsigned int                                              pre_refinement_step;
       unsigned int                                              nonlinear_iteration;
@@ -1711,6 +1800,17 @@ namespace aspect
       LinearAlgebra::BlockVector                                old_old_solution;
       LinearAlgebra::BlockVector                                system_rhs;
 
+      /**
+       * The solution three time steps back, without ghost entries. This
+       * vector is only used (and allocated) for the quadratic extrapolation
+       * of the initial guess of a time step. Since it is not transferred
+       * to a new mesh, n_solution_shifts_since_mesh_change counts how many
+       * time steps ago the mesh was last changed, which determines whether
+       * this vector and old_old_solution contain useful values.
+       */
+      LinearAlgebra::BlockVector                                old_old_old_solution;
+      unsigned int                                              n_solution_shifts_since_mesh_change;
+
       LinearAlgebra::BlockVector                                current_linearization_point;
 
       // only used if is_compressible()
@@ -1724,12 +1824,115 @@ namespace aspect
       std::shared_ptr<LinearAlgebra::PreconditionAMG>     Amg_preconditioner;
       std::shared_ptr<LinearAlgebra::PreconditionBase>    Mp_preconditioner;
 
+      /**
+       * The direct solver for the Stokes system, if 'Use direct solver for
+       * Stokes system' is set. It keeps the symbolic factorization of the
+       * Stokes matrix between solves, so that only the numeric
+       * factorization is recomputed in every solve. It is reset in
+       * setup_system_matrix() whenever the matrix (and possibly its
+       * sparsity pattern) is recreated.
+       */
+      std::shared_ptr<internal::DirectStokesSolver>       direct_stokes_solver;
+
+      /**
+       * The material model and heating model outputs on all cells that were
+       * computed while assembling the last advection field, if 'Cache
+       * material model outputs for advection assembly' is set. They are
+       * reused when assembling the other advection fields with the same
+       * linearization point, see assemble_advection_system(). The object is
+       * reset in setup_system_matrix() whenever the degrees of freedom
+       * change.
+       */
+      std::shared_ptr<internal::AdvectionMaterialModelCache<dim> > advection_material_model_cache;
+
+      /**
+       * The contributions of all cells to the Stokes system of the current
+       * time step, if 'Use incremental assembly' is set and the Stokes
+       * system can be assembled incrementally, see assemble_stokes_system().
+       * The object is reset in setup_system_matrix() whenever the degrees of
+       * freedom change.
+       */
+      std::shared_ptr<internal::IncrementalStokesAssembly<dim> > incremental_stokes_assembly;
+
+      /**
+       * The congruence classes of the locally owned cells, which allow the
+       * Stokes assemblers to reuse shape function data between cells that
+       * are translations of each other. The classes are recomputed in
+       * setup_dofs(); cells are only classified if the mapping does not
+       * depend on a curved geometry or a free surface.
+       */
+      std::shared_ptr<internal::Assembly::CellCongruenceClasses<dim> > cell_congruence_classes;
+
+      /**
+       * The data of the weighted BFBt approximation of the Schur complement,
+       * see build_weighted_bfbt_preconditioner(): the pressure matrix
+       * $BD^{-1}B^T$, the inverse of the diagonal $D$ of the velocity block,
+       * an algebraic multigrid preconditioner for the former, and, if the
+       * pressure is only determined up to a constant, the normalized vector
+       * that spans the null space of $BD^{-1}B^T$.
+       */
+      LinearAlgebra::SparseMatrix                         bfbt_pressure_matrix;
+      LinearAlgebra::Vector                               bfbt_inverse_diagonal;
+      LinearAlgebra::Vector                               bfbt_null_space;
+      bool                                                bfbt_has_null_space;
+      std::shared_ptr<LinearAlgebra::PreconditionAMG>     Bfbt_preconditioner;
+
+      /**
+       * Compositional fields that are advected as finite element fields by
+       * the built-in assemblers alone, and that have the same artificial
+       * viscosity, have identical system matrices. While
+       * assemble_and_solve_composition() works through the compositional
+       * fields, composition_matrix_field is the index of the last such field
+       * whose matrix was assembled (or numbers::invalid_unsigned_int if there
+       * is none), and composition_matrix_artificial_viscosity is the
+       * artificial viscosity it was assembled with. The following fields
+       * with the same artificial viscosity then only assemble their right
+       * hand side, and solve with the matrix of that field and the
+       * preconditioner composition_preconditioner built for it, see
+       * reuses_composition_matrix().
+       */
+      unsigned int                                        composition_matrix_field;
+      Vector<double>                                      composition_matrix_artificial_viscosity;
+      std::shared_ptr<LinearAlgebra::PreconditionBase>    composition_preconditioner;
+
+      /**
+       * The largest cell Peclet number on each cell, and whether the
+       * majority of locally owned cells have a Peclet number less than one,
+       * for the last advection field that was assembled. These are only
+       * computed if the 'Advection solver preconditioner' is `automatic',
+       * and are used to choose the preconditioner in solve_advection().
+       */
+      Vector<float>                                       advection_cell_peclet_numbers;
+      bool                                                advection_field_is_diffusion_dominated;
+
       bool                                                      rebuild_sparsity_and_matrices;
       bool                                                      rebuild_stokes_matrix;
       bool                                                      assemble_newton_stokes_matrix;
       bool                                                      assemble_newton_stokes_system;
       bool                                                      rebuild_stokes_preconditioner;
 
+      /**
+       * The number of outer GMRES iterations of the first Stokes solve after
+       * the Stokes preconditioner was last rebuilt, and of the most recent
+       * Stokes solve. build_stokes_preconditioner() compares the two to decide
+       * whether the existing preconditioner is still good enough to be reused,
+       * see the 'Preconditioner reuse iteration factor' parameter.
+       * stokes_iterations_after_preconditioner_rebuild is
+       * numbers::invalid_unsigned_int until the first solve with a newly
+       * built preconditioner.
+       */
+      unsigned int                                              stokes_iterations_after_preconditioner_rebuild;
+      unsigned int                                              last_stokes_iterations;
+
+      /**
+       * The vectors spanning the recycled space used by the outer Stokes
+       * solver if 'Krylov recycling space dimension' is positive. These are
+       * the normalized corrections of the most recent Stokes solves, in the
+       * layout of the Stokes part of the solution vector. The space is
+       * cleared whenever the mesh changes.
+       */
+      std::vector<LinearAlgebra::BlockVector>                   stokes_recycled_space;
+
       /**
        * @}
        */
@@ -1743,9 +1946,16 @@ namespace aspect
        */
       std::shared_ptr<FreeSurfaceHandler<dim> > free_surface;
 
+      /**
+       * Shared pointer for an instance of the StokesMatrixFreeHandler. It
+       * is only allocated if the 'block GMG' Stokes solver is selected.
+       */
+      std::shared_ptr<StokesMatrixFreeHandler<dim> > stokes_matrix_free;
+
       friend class boost::serialization::access;
       friend class SimulatorAccess<dim>;
       friend class FreeSurfaceHandler<dim>;  // FreeSurfaceHandler needs access to the internals of the Simulator
+      friend class StokesMatrixFreeHandler<dim>;  // StokesMatrixFreeHandler needs access to the internals of the Simulator
       friend struct Parameters<dim>;
   };
 }
@@ -43,6 +43,14 @@ namespace aspect
         execute(internal::Assembly::Scratch::ScratchBase<dim>  &scratch,
                 internal::Assembly::CopyData::CopyDataBase<dim> &data) const;
 
+        /**
+         * Same as execute(), but for the concrete scratch and copy data
+         * types, and without virtual dispatch.
+         */
+        void
+        assemble(internal::Assembly::Scratch::AdvectionSystem<dim> &scratch,
+                 internal::Assembly::CopyData::AdvectionSystem<dim> &data) const;
+
         virtual
         std::vector<double>
         compute_residual(internal::Assembly::Scratch::ScratchBase<dim>  &scratch) const;
@@ -25,8 +25,12 @@
 #include <aspect/heating_model/interface.h>
 #include <aspect/material_model/interface.h>
 
+#include <deal.II/base/table.h>
 #include <deal.II/fe/fe_values.h>
 
+#include <functional>
+#include <typeinfo>
+
 namespace aspect
 {
   using namespace dealii;
@@ -47,6 +51,60 @@ namespace aspect
   {
     namespace Assembly
     {
+      /**
+       * A classification of the locally owned active cells into congruence
+       * classes: two cells belong to the same class if one is a translation
+       * of the other, i.e., if the vectors from their first vertex to all
+       * other vertices are the same. If the mapping of a cell only depends
+       * on its vertices, then the Jacobians, JxW values and mapped shape
+       * gradients of all cells in one class are the same, so that shape
+       * function data computed on one cell can be reused on all other
+       * cells of its class. On box geometries, all cells of the same
+       * refinement level typically form one class.
+       *
+       * The Simulator recomputes the classes in setup_dofs().
+       */
+      template <int dim>
+      class CellCongruenceClasses
+      {
+        public:
+          /**
+           * Constructor. Initially, no cell is classified.
+           */
+          CellCongruenceClasses ();
+
+          /**
+           * Classify all locally owned active cells of @p triangulation. If
+           * @p mapping_depends_only_on_vertices is false, for example for
+           * curved or moving meshes, no cell is classified.
+           */
+          void reinit (const Triangulation<dim> &triangulation,
+                       const bool                mapping_depends_only_on_vertices);
+
+          /**
+           * Return the congruence class of @p cell, or
+           * numbers::invalid_unsigned_int if the cell was not classified.
+           */
+          unsigned int
+          get_class (const typename DoFHandler<dim>::active_cell_iterator &cell) const;
+
+          /**
+           * Return the number of congruence classes.
+           */
+          unsigned int
+          n_classes () const;
+
+        private:
+          /**
+           * The class of each cell, indexed by its active cell index.
+           */
+          std::vector<unsigned int> cell_classes;
+
+          unsigned int n_congruence_classes;
+      };
+
+
+
       namespace Scratch
       {
         /**
@@ -117,6 +175,46 @@ namespace aspect
           std::vector<double>                  phi_p_c;
           std::vector<Tensor<1,dim> >          grad_phi_p;
 
+          /**
+           * The values and gradients of the Stokes shape functions on the
+           * current cell, indexed by (Stokes dof, quadrature point) and
+           * (Stokes dof, coordinate direction, quadrature point). All Stokes
+           * shape functions are primitive, so these are the values and
+           * gradients of their only nonzero vector component, which is
+           * stored in @p dof_component_indices. The quadrature point index
+           * runs fastest, so that loops over quadrature points can be
+           * vectorized.
+           *
+           * These tables are filled at most once per cell by the first
+           * assembler that needs them, see @p stokes_shape_data_is_current.
+           */
+          Table<2,double>                      stokes_shape_values;
+          Table<3,double>                      stokes_shape_gradients;
+
+          /**
+           * Whether the tables above contain the data of the current cell.
+           * This flag is reset by reinit().
+           */
+          bool                                 stokes_shape_data_is_current;
+
+          /**
+           * The congruence class of the current cell (see
+           * CellCongruenceClasses) and the one of the cell whose data the
+           * tables above contain. If both are the same valid class, the
+           * tables need not be computed again for the current cell.
+           * Unclassified cells use numbers::invalid_unsigned_int.
+           */
+          unsigned int                         cell_congruence_class;
+          unsigned int                         stokes_shape_data_congruence_class;
+
+          /**
+           * Work arrays with one entry per quadrature point for the
+           * coefficients (including the JxW values) of the terms that are
+           * assembled.
+           */
+          std::vector<double>                  coefficients_times_JxW;
+          std::vector<double>                  second_coefficients_times_JxW;
+
           /**
            * Material model inputs and outputs computed at the current
            * linearization point.
@@ -387,6 +485,14 @@ namespace aspect
 
           Vector<double> local_rhs;
           Vector<double> local_pressure_shape_function_integrals;
+
+          /**
+           * Whether the local contributions have to be copied into the
+           * global matrix and right hand side. This is false for cells that
+           * are skipped in an incremental assembly of the Stokes system,
+           * see the 'Use incremental assembly' parameter.
+           */
+          bool has_local_contributions;
         };
 
         /**
@@ -598,6 +704,11 @@ namespace aspect
     {
       public:
 
+        /**
+         * Constructor.
+         */
+        Manager ();
+
         /**
          * Reset the state of the manager and remove all Assemblers.
          */
@@ -720,7 +831,125 @@ namespace aspect
         Properties stokes_system_assembler_on_boundary_face_properties;
         std::vector<Properties> advection_system_assembler_properties;
         std::vector<Properties> advection_system_assembler_on_face_properties;
+
+        /**
+         * Statically composed versions of the cell assemblers in
+         * stokes_preconditioner, stokes_system, and advection_system. If one
+         * of these lists consists of exactly one of the combinations of
+         * built-in assemblers that are used most often, then
+         * Simulator::set_assemblers() sets the corresponding function object
+         * to one that calls the assemblers one after the other with
+         * neither a <code>dynamic_cast</code> of the scratch and copy data
+         * objects nor a virtual function call, see compose_statically().
+         * Otherwise, for example if a plugin has added its own assembler,
+         * the function object is empty, and the assemblers in the list are
+         * called through the Interface class.
+         */
+        std::function<void (internal::Assembly::Scratch::StokesPreconditioner<dim> &,
+                            internal::Assembly::CopyData::StokesPreconditioner<dim> &)> static_stokes_preconditioner;
+        std::function<void (internal::Assembly::Scratch::StokesSystem<dim> &,
+                            internal::Assembly::CopyData::StokesSystem<dim> &)> static_stokes_system;
+        std::function<void (internal::Assembly::Scratch::AdvectionSystem<dim> &,
+                            internal::Assembly::CopyData::AdvectionSystem<dim> &)> static_advection_system;
+
+        /**
+         * Whether static_stokes_preconditioner and static_stokes_system call
+         * the assemble_boussinesq() functions of the built-in assemblers,
+         * whose loop bounds are fixed at compile time. Simulator::set_assemblers()
+         * selects them for incompressible models without melt transport,
+         * free surface, or additional forces. In that case, the Stokes
+         * assembly also skips the cell data that only compressible models
+         * need.
+         */
+        bool stokes_system_is_boussinesq;
+    };
+
+
+
+    /**
+     * A sequence of assemblers whose types are known at compile time. The
+     * class is only a vehicle for the recursion over the list of types in
+     * compose_statically() and is not meant to be used otherwise.
+     */
+    template <int dim, class ScratchType, class CopyDataType, class... AssemblerTypes>
+    struct StaticAssemblerSequence;
+
+    template <int dim, class ScratchType, class CopyDataType>
+    struct StaticAssemblerSequence<dim, ScratchType, CopyDataType>
+    {
+      static bool matches (const std::unique_ptr<Interface<dim> > *,
+                           const unsigned int n_assemblers)
+      {
+        return (n_assemblers == 0);
+      }
+
+      static void assemble (const Interface<dim> *const *,
+                            ScratchType &,
+                            CopyDataType &)
+      {}
+    };
+
+    template <int dim, class ScratchType, class CopyDataType, class AssemblerType, class... OtherAssemblerTypes>
+    struct StaticAssemblerSequence<dim, ScratchType, CopyDataType, AssemblerType, OtherAssemblerTypes...>
+    {
+      typedef StaticAssemblerSequence<dim, ScratchType, CopyDataType, OtherAssemblerTypes...> Tail;
+
+      /**
+       * Return whether the @p n_assemblers assemblers pointed to by
+       * @p assemblers have exactly the types of this sequence. The dynamic
+       * type has to match exactly, so that classes derived from one of the
+       * built-in assemblers are not mistaken for it.
+       */
+      static bool matches (const std::unique_ptr<Interface<dim> > *assemblers,
+                           const unsigned int                      n_assemblers)
+      {
+        return (n_assemblers > 0
+                && typeid(*assemblers[0]) == typeid(AssemblerType)
+                && Tail::matches (assemblers+1, n_assemblers-1));
+      }
+
+      static void assemble (const Interface<dim> *const *assemblers,
+                            ScratchType                 &scratch,
+                            CopyDataType                &data)
+      {
+        static_cast<const AssemblerType *>(assemblers[0])->assemble (scratch, data);
+        Tail::assemble (assemblers+1, scratch, data);
+      }
     };
+
+
+
+    /**
+     * If the dynamic types of the objects in @p assemblers are exactly
+     * @p AssemblerTypes (in this order), return a function object that
+     * calls the (non-virtual) <code>assemble()</code> functions of these
+     * objects with the concrete scratch and copy data types one after the
+     * other. This way, the compiler sees the complete sequence of
+     * assemblers, and no <code>dynamic_cast</code> or virtual function call
+     * is necessary on each cell. Otherwise, return an empty function object.
+     *
+     * The returned function object stores pointers to the assemblers, so
+     * it must not be used after the elements of @p assemblers have been
+     * destroyed.
+     */
+    template <int dim, class ScratchType, class CopyDataType, class... AssemblerTypes>
+    std::function<void (ScratchType &, CopyDataType &)>
+    compose_statically (const std::vector<std::unique_ptr<Interface<dim> > > &assemblers)
+    {
+      typedef StaticAssemblerSequence<dim, ScratchType, CopyDataType, AssemblerTypes...> Sequence;
+
+      if (!Sequence::matches (assemblers.data(), assemblers.size()))
+        return std::function<void (ScratchType &, CopyDataType &)>();
+
+      std::vector<const Interface<dim> *> assembler_pointers;
+      for (unsigned int i=0; i<assemblers.size(); ++i)
+        assembler_pointers.push_back (assemblers[i].get());
+
+      return [assembler_pointers] (ScratchType &scratch, CopyDataType &data)
+      {
+        Sequence::assemble (assembler_pointers.data(), scratch, data);
+      };
+    }
   }
 }
 
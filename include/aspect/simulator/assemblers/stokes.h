@@ -29,6 +29,34 @@ namespace aspect
 {
   namespace Assemblers
   {
+    /**
+     * The number of quadrature points and of Stokes degrees of freedom per
+     * cell for the Stokes element $Q_k\times Q_{k-1}$ with continuous
+     * pressure, velocity degree $k$ = @p velocity_degree, and the Gauss
+     * quadrature with $k+1$ points in each direction that the Stokes
+     * assembly uses. These are the sizes that the assemble_boussinesq()
+     * functions below fix at compile time.
+     */
+    template <int dim, int velocity_degree>
+    struct StokesElementSizes
+    {
+      static const unsigned int n_q_points
+        = (dim == 2
+           ?
+           (velocity_degree+1) * (velocity_degree+1)
+           :
+           (velocity_degree+1) * (velocity_degree+1) * (velocity_degree+1));
+
+      static const unsigned int stokes_dofs_per_cell
+        = (dim == 2
+           ?
+           dim * (velocity_degree+1) * (velocity_degree+1)
+           + velocity_degree * velocity_degree
+           :
+           dim * (velocity_degree+1) * (velocity_degree+1) * (velocity_degree+1)
+           + velocity_degree * velocity_degree * velocity_degree);
+    };
+
     /**
      * A class containing the functions to assemble the Stokes preconditioner.
      */
@@ -41,6 +69,38 @@ namespace aspect
         void
         execute(internal::Assembly::Scratch::ScratchBase<dim>   &scratch,
                 internal::Assembly::CopyData::CopyDataBase<dim> &data) const;
+
+        /**
+         * Same as execute(), but for the concrete scratch and copy data
+         * types, and without virtual dispatch.
+         */
+        void
+        assemble(internal::Assembly::Scratch::StokesPreconditioner<dim> &scratch,
+                 internal::Assembly::CopyData::StokesPreconditioner<dim> &data) const;
+
+        /**
+         * Same as assemble(), but with the number of quadrature points and
+         * of Stokes degrees of freedom per cell fixed at compile time to
+         * the values of StokesElementSizes for the given
+         * @p velocity_degree, so that the compiler can fully unroll the
+         * loops over them. Instantiated for the velocity degrees 2 and 3.
+         */
+        template <int velocity_degree>
+        void
+        assemble_boussinesq(internal::Assembly::Scratch::StokesPreconditioner<dim> &scratch,
+                            internal::Assembly::CopyData::StokesPreconditioner<dim> &data) const;
+
+      private:
+        /**
+         * The implementation of assemble() and assemble_boussinesq(). The
+         * template arguments are the number of quadrature points and of
+         * Stokes degrees of freedom per cell, or zero if they are only
+         * known at run time.
+         */
+        template <unsigned int n_q_points, unsigned int stokes_dofs_per_cell>
+        void
+        assemble_terms(internal::Assembly::Scratch::StokesPreconditioner<dim> &scratch,
+                       internal::Assembly::CopyData::StokesPreconditioner<dim> &data) const;
     };
 
     /**
@@ -56,6 +116,14 @@ namespace aspect
         void
         execute(internal::Assembly::Scratch::ScratchBase<dim>   &scratch,
                 internal::Assembly::CopyData::CopyDataBase<dim> &data) const;
+
+        /**
+         * Same as execute(), but for the concrete scratch and copy data
+         * types, and without virtual dispatch.
+         */
+        void
+        assemble(internal::Assembly::Scratch::StokesPreconditioner<dim> &scratch,
+                 internal::Assembly::CopyData::StokesPreconditioner<dim> &data) const;
     };
 
     /**
@@ -72,10 +140,45 @@ namespace aspect
         execute(internal::Assembly::Scratch::ScratchBase<dim>   &scratch,
                 internal::Assembly::CopyData::CopyDataBase<dim> &data) const;
 
+        /**
+         * Same as execute(), but for the concrete scratch and copy data
+         * types, and without virtual dispatch.
+         */
+        void
+        assemble(internal::Assembly::Scratch::StokesSystem<dim> &scratch,
+                 internal::Assembly::CopyData::StokesSystem<dim> &data) const;
+
+        /**
+         * Same as assemble(), but for incompressible models without
+         * additional right hand side or elastic forces, and with the number
+         * of quadrature points and of Stokes degrees of freedom per cell
+         * fixed at compile time to the values of StokesElementSizes for the
+         * given @p velocity_degree, so that the compiler can fully unroll
+         * the loops over them. Instantiated for the velocity degrees 2 and
+         * 3.
+         */
+        template <int velocity_degree>
+        void
+        assemble_boussinesq(internal::Assembly::Scratch::StokesSystem<dim> &scratch,
+                            internal::Assembly::CopyData::StokesSystem<dim> &data) const;
+
         /**
          * Create AdditionalMaterialOutputsStokesRHS if we need to do so.
          */
         virtual void create_additional_material_model_outputs(MaterialModel::MaterialModelOutputs<dim> &outputs) const;
+
+      private:
+        /**
+         * The implementation of assemble() and assemble_boussinesq(). The
+         * first two template arguments are the number of quadrature points
+         * and of Stokes degrees of freedom per cell, or zero if they are
+         * only known at run time. If @p include_additional_forces is false,
+         * additional right hand side and elastic forces are ignored.
+         */
+        template <unsigned int n_q_points, unsigned int stokes_dofs_per_cell, bool include_additional_forces>
+        void
+        assemble_terms(internal::Assembly::Scratch::StokesSystem<dim> &scratch,
+                       internal::Assembly::CopyData::StokesSystem<dim> &data) const;
     };
 
     /**
@@ -91,6 +194,14 @@ namespace aspect
         void
         execute(internal::Assembly::Scratch::ScratchBase<dim>   &scratch,
                 internal::Assembly::CopyData::CopyDataBase<dim> &data) const;
+
+        /**
+         * Same as execute(), but for the concrete scratch and copy data
+         * types, and without virtual dispatch.
+         */
+        void
+        assemble(internal::Assembly::Scratch::StokesSystem<dim> &scratch,
+                 internal::Assembly::CopyData::StokesSystem<dim> &data) const;
     };
 
     /**
@@ -111,6 +222,14 @@ namespace aspect
         void
         execute(internal::Assembly::Scratch::ScratchBase<dim>   &scratch,
                 internal::Assembly::CopyData::CopyDataBase<dim> &data) const;
+
+        /**
+         * Same as execute(), but for the concrete scratch and copy data
+         * types, and without virtual dispatch.
+         */
+        void
+        assemble(internal::Assembly::Scratch::StokesSystem<dim> &scratch,
+                 internal::Assembly::CopyData::StokesSystem<dim> &data) const;
     };
 
     /**
@@ -131,6 +250,14 @@ namespace aspect
         void
         execute(internal::Assembly::Scratch::ScratchBase<dim>   &scratch,
                 internal::Assembly::CopyData::CopyDataBase<dim> &data) const;
+
+        /**
+         * Same as execute(), but for the concrete scratch and copy data
+         * types, and without virtual dispatch.
+         */
+        void
+        assemble(internal::Assembly::Scratch::StokesSystem<dim> &scratch,
+                 internal::Assembly::CopyData::StokesSystem<dim> &data) const;
     };
 
     /**
@@ -151,6 +278,14 @@ namespace aspect
         void
         execute(internal::Assembly::Scratch::ScratchBase<dim>   &scratch,
                 internal::Assembly::CopyData::CopyDataBase<dim> &data) const;
+
+        /**
+         * Same as execute(), but for the concrete scratch and copy data
+         * types, and without virtual dispatch.
+         */
+        void
+        assemble(internal::Assembly::Scratch::StokesSystem<dim> &scratch,
+                 internal::Assembly::CopyData::StokesSystem<dim> &data) const;
     };
 
 
@@ -175,6 +310,14 @@ namespace aspect
         void
         execute(internal::Assembly::Scratch::ScratchBase<dim>   &scratch,
                 internal::Assembly::CopyData::CopyDataBase<dim> &data) const;
+
+        /**
+         * Same as execute(), but for the concrete scratch and copy data
+         * types, and without virtual dispatch.
+         */
+        void
+        assemble(internal::Assembly::Scratch::StokesSystem<dim> &scratch,
+                 internal::Assembly::CopyData::StokesSystem<dim> &data) const;
     };
 
     /**
@@ -208,6 +351,14 @@ namespace aspect
         void
         execute(internal::Assembly::Scratch::ScratchBase<dim>   &scratch,
                 internal::Assembly::CopyData::CopyDataBase<dim> &data) const;
+
+        /**
+         * Same as execute(), but for the concrete scratch and copy data
+         * types, and without virtual dispatch.
+         */
+        void
+        assemble(internal::Assembly::Scratch::StokesSystem<dim> &scratch,
+                 internal::Assembly::CopyData::StokesSystem<dim> &data) const;
     };
   }
 }
@@ -0,0 +1,521 @@
+/*
+  Copyright (C) 2018 by the authors of the ASPECT code.
+
+  This file is part of ASPECT.
+
+  ASPECT is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2, or (at your option)
+  any later version.
+
+  ASPECT is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with ASPECT; see the file LICENSE.  If not see
+  <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef _aspect_stokes_matrix_free_h
+#define _aspect_stokes_matrix_free_h
+
+#include <aspect/global.h>
+#include <aspect/simulator.h>
+
+#if DEAL_II_VERSION_GTE(9,1,0)
+
+#include <deal.II/base/table.h>
+#include <deal.II/base/vectorization.h>
+
+#include <deal.II/lac/la_parallel_vector.h>
+#include <deal.II/lac/la_parallel_block_vector.h>
+
+#include <deal.II/fe/fe_system.h>
+#include <deal.II/fe/fe_q.h>
+#include <deal.II/fe/fe_dgq.h>
+
+#include <deal.II/matrix_free/matrix_free.h>
+#include <deal.II/matrix_free/operators.h>
+#include <deal.II/matrix_free/fe_evaluation.h>
+
+#include <deal.II/multigrid/mg_constrained_dofs.h>
+#include <deal.II/multigrid/mg_transfer_matrix_free.h>
+
+namespace aspect
+{
+  using namespace dealii;
+
+  /**
+   * This namespace contains the matrix-free operators used by the
+   * geometric multigrid (GMG) Stokes solver. None of these operators
+   * ever store a matrix; instead, they compute the action of the
+   * respective operator cell by cell using sum factorization on
+   * $Q_k\times Q_{k-1}$ elements. The only data stored per cell are
+   * the viscosity values (at quadrature points on the active level and
+   * cell averages on the coarser multigrid levels).
+   */
+  namespace MatrixFreeStokesOperators
+  {
+    /**
+     * Operator for the entire Stokes block, i.e., the action of
+     * @f[
+     *   \begin{pmatrix} A & B^T \\ B & 0 \end{pmatrix}
+     * @f]
+     * including the pressure scaling, in exactly the same form as the
+     * matrix assembled by Assemblers::StokesIncompressibleTerms and
+     * Assemblers::StokesCompressibleStrainRateViscosityTerm.
+     */
+    template <int dim, int degree_v, typename number>
+    class StokesOperator
+      : public MatrixFreeOperators::Base<dim, dealii::LinearAlgebra::distributed::BlockVector<number> >
+    {
+      public:
+        /**
+         * Constructor.
+         */
+        StokesOperator ();
+
+        /**
+         * Reset the object.
+         */
+        void clear ();
+
+        /**
+         * Set the viscosity (multiplied by two) at every quadrature point of
+         * every cell batch, the pressure scaling, and whether the
+         * compressible strain rate term should be included.
+         */
+        void fill_cell_data (const Table<2, VectorizedArray<number> > &viscosity_x_2,
+                             const double pressure_scaling,
+                             const bool is_compressible);
+
+        /**
+         * Computing the diagonal of the full Stokes operator is not
+         * necessary (and not implemented) since the operator is never
+         * smoothed directly.
+         */
+        virtual void compute_diagonal ();
+
+      private:
+        /**
+         * Perform the operator evaluation on all cells.
+         */
+        virtual void apply_add (dealii::LinearAlgebra::distributed::BlockVector<number> &dst,
+                                const dealii::LinearAlgebra::distributed::BlockVector<number> &src) const;
+
+        /**
+         * Perform the operator evaluation on a range of cells.
+         */
+        void local_apply (const dealii::MatrixFree<dim, number> &data,
+                          dealii::LinearAlgebra::distributed::BlockVector<number> &dst,
+                          const dealii::LinearAlgebra::distributed::BlockVector<number> &src,
+                          const std::pair<unsigned int, unsigned int> &cell_range) const;
+
+        /**
+         * A pointer to the viscosity table, which is owned by the
+         * StokesMatrixFreeHandler.
+         */
+        const Table<2, VectorizedArray<number> > *viscosity_x_2;
+
+        double pressure_scaling;
+        bool is_compressible;
+    };
+
+    /**
+     * Operator for the pressure mass matrix weighted by the inverse of the
+     * viscosity and by the square of the pressure scaling, which is used
+     * as the approximation of the Schur complement.
+     */
+    template <int dim, int degree_p, typename number>
+    class MassMatrixOperator
+      : public MatrixFreeOperators::Base<dim, dealii::LinearAlgebra::distributed::Vector<number> >
+    {
+      public:
+        /**
+         * Constructor.
+         */
+        MassMatrixOperator ();
+
+        /**
+         * Reset the object.
+         */
+        void clear ();
+
+        /**
+         * Set the viscosity (multiplied by two) at every quadrature point
+         * of every cell batch and the pressure scaling.
+         */
+        void fill_cell_data (const Table<2, VectorizedArray<number> > &viscosity_x_2,
+                             const double pressure_scaling);
+
+        /**
+         * Compute the diagonal of this operator, which is used as a
+         * Jacobi preconditioner in the Schur complement solve.
+         */
+        virtual void compute_diagonal ();
+
+      private:
+        virtual void apply_add (dealii::LinearAlgebra::distributed::Vector<number> &dst,
+                                const dealii::LinearAlgebra::distributed::Vector<number> &src) const;
+
+        void local_apply (const dealii::MatrixFree<dim, number> &data,
+                          dealii::LinearAlgebra::distributed::Vector<number> &dst,
+                          const dealii::LinearAlgebra::distributed::Vector<number> &src,
+                          const std::pair<unsigned int, unsigned int> &cell_range) const;
+
+        void local_compute_diagonal (const MatrixFree<dim,number> &data,
+                                     dealii::LinearAlgebra::distributed::Vector<number> &dst,
+                                     const unsigned int &dummy,
+                                     const std::pair<unsigned int,unsigned int> &cell_range) const;
+
+        const Table<2, VectorizedArray<number> > *viscosity_x_2;
+        double pressure_scaling;
+    };
+
+    /**
+     * Operator for the velocity (A) block of the Stokes system. It is used
+     * both on the active level (for the inner CG solve of the expensive
+     * preconditioner) and on every level of the multigrid hierarchy. On
+     * the multigrid levels, the viscosity table only contains a single
+     * (averaged) value per cell, which is then used at all quadrature
+     * points.
+     */
+    template <int dim, int degree_v, typename number>
+    class ABlockOperator
+      : public MatrixFreeOperators::Base<dim, dealii::LinearAlgebra::distributed::Vector<number> >
+    {
+      public:
+        /**
+         * Constructor.
+         */
+        ABlockOperator ();
+
+        /**
+         * Reset the object.
+         */
+        void clear ();
+
+        /**
+         * Set the viscosity (multiplied by two) either at every quadrature
+         * point, or once per cell batch if the second dimension of the
+         * table is one, and whether the compressible strain rate term
+         * should be included.
+         */
+        void fill_cell_data (const Table<2, VectorizedArray<number> > &viscosity_x_2,
+                             const bool is_compressible);
+
+        /**
+         * Compute the diagonal of this operator, which is used by the
+         * Chebyshev smoother.
+         */
+        virtual void compute_diagonal ();
+
+      private:
+        virtual void apply_add (dealii::LinearAlgebra::distributed::Vector<number> &dst,
+                                const dealii::LinearAlgebra::distributed::Vector<number> &src) const;
+
+        void local_apply (const dealii::MatrixFree<dim, number> &data,
+                          dealii::LinearAlgebra::distributed::Vector<number> &dst,
+                          const dealii::LinearAlgebra::distributed::Vector<number> &src,
+                          const std::pair<unsigned int, unsigned int> &cell_range) const;
+
+        void local_compute_diagonal (const MatrixFree<dim,number> &data,
+                                     dealii::LinearAlgebra::distributed::Vector<number> &dst,
+                                     const unsigned int &dummy,
+                                     const std::pair<unsigned int,unsigned int> &cell_range) const;
+
+        const Table<2, VectorizedArray<number> > *viscosity_x_2;
+        bool is_compressible;
+    };
+  }
+
+
+
+  /**
+   * This class implements the matrix-free geometric multigrid (GMG)
+   * solver for the Stokes system that is selected by setting
+   * 'Solver parameters/Stokes solver parameters/Stokes solver type' to
+   * 'block GMG'. It owns separate DoFHandler objects for the velocity and
+   * the pressure (with degrees of freedom distributed on all multigrid
+   * levels), the constraints for these, the matrix-free operators, and
+   * the multigrid transfer. The right hand side is still assembled by
+   * Simulator::assemble_stokes_system(), but the Stokes matrix and the
+   * preconditioner matrices are never assembled. The outer iteration is
+   * the same FGMRES iteration with the same block Schur complement
+   * preconditioner as used by Simulator::solve_stokes() for the
+   * AMG-preconditioned solver.
+   *
+   * The class needs access to the internals of the Simulator and is
+   * therefore declared a friend of that class.
+   */
+  template <int dim>
+  class StokesMatrixFreeHandler
+  {
+    public:
+      /**
+       * The polynomial degree of the velocity element. The pressure uses
+       * degree velocity_degree-1.
+       */
+      static const int velocity_degree = 2;
+
+      /**
+       * Vector types used by the matrix-free operators.
+       */
+      typedef dealii::LinearAlgebra::distributed::Vector<double> VectorType;
+      typedef dealii::LinearAlgebra::distributed::BlockVector<double> BlockVectorType;
+
+      typedef MatrixFreeStokesOperators::StokesOperator<dim,velocity_degree,double> StokesMatrixType;
+      typedef MatrixFreeStokesOperators::MassMatrixOperator<dim,velocity_degree-1,double> SchurComplementMatrixType;
+      typedef MatrixFreeStokesOperators::ABlockOperator<dim,velocity_degree,double> ABlockMatrixType;
+
+      /**
+       * The level operators, the transfer, and the level viscosities of
+       * the geometric multigrid V-cycle for the velocity block. The
+       * V-cycle is only used as a preconditioner inside the outer FGMRES
+       * iteration, which operates on double precision vectors, so it can
+       * be done in single precision (@p number = float) without affecting
+       * the accuracy of the converged solution, while halving the memory
+       * traffic of the level operators.
+       */
+      template <typename number>
+      struct MultigridData
+      {
+        typedef MatrixFreeStokesOperators::ABlockOperator<dim,velocity_degree,number> LevelMatrixType;
+        typedef dealii::LinearAlgebra::distributed::Vector<number> LevelVectorType;
+
+        MGLevelObject<LevelMatrixType> matrices;
+        MGTransferMatrixFree<dim,number> transfer;
+
+        /**
+         * Twice the cell-averaged viscosity of all cell batches of each
+         * multigrid level.
+         */
+        MGLevelObject<Table<2, VectorizedArray<number> > > viscosity_x_2;
+      };
+
+      /**
+       * Initialize this class, allowing it to read in relevant parameters
+       * as well as giving it a reference to the Simulator that owns it.
+       * The constructor checks that the model only uses features that
+       * the matrix-free solver supports.
+       */
+      StokesMatrixFreeHandler (Simulator<dim> &, ParameterHandler &prm);
+
+      /**
+       * Destructor.
+       */
+      ~StokesMatrixFreeHandler ();
+
+      /**
+       * Distribute the degrees of freedom of the velocity and pressure
+       * DoFHandler objects on all levels, set up the constraints, the
+       * matrix-free objects, and the multigrid transfer. This is called
+       * at the end of Simulator::setup_dofs().
+       */
+      void setup_dofs ();
+
+      /**
+       * Evaluate the material model at the current linearization point and
+       * store the viscosity at all quadrature points of the active level,
+       * then compute cell averages of the viscosity on all multigrid
+       * levels. This replaces the assembly of the Stokes matrix and is
+       * called from Simulator::assemble_stokes_system() whenever the
+       * matrix would have to be rebuilt.
+       */
+      void evaluate_viscosity ();
+
+      /**
+       * Compute the diagonals of the level operators and of the Schur
+       * complement approximation. This replaces the setup of the AMG
+       * preconditioner and is called from
+       * Simulator::build_stokes_preconditioner().
+       */
+      void build_preconditioner ();
+
+      /**
+       * Solve the Stokes system with the matrix-free operators, and store
+       * the result in @p distributed_stokes_solution as well as in the
+       * velocity and pressure blocks of Simulator::solution. Return the
+       * initial nonlinear residual and the final linear residual, like
+       * Simulator::solve_stokes().
+       */
+      std::pair<double,double> solve (LinearAlgebra::BlockVector &distributed_stokes_solution);
+
+      /**
+       * Compute the norm of the part of the right hand side that is not
+       * balanced by the (scaled) pressure stored in
+       * @p linearized_stokes_variables, with a zero velocity. This is the
+       * matrix-free equivalent of Simulator::compute_initial_stokes_residual().
+       */
+      double compute_initial_stokes_residual (const LinearAlgebra::BlockVector &linearized_stokes_variables) const;
+
+      /**
+       * Declare parameters. Apart from the ones declared here, the solver
+       * uses the tolerances and iteration limits of the
+       * 'Stokes solver parameters' subsection.
+       */
+      static
+      void declare_parameters (ParameterHandler &prm);
+
+      /**
+       * Parse parameters.
+       */
+      void parse_parameters (ParameterHandler &prm);
+
+    private:
+      /**
+       * Set up the matrix-free level operators and the transfer of
+       * @p mg_data, once mg_constrained_dofs has been initialized.
+       */
+      template <typename number>
+      void setup_multigrid_levels (MultigridData<number> &mg_data);
+
+      /**
+       * Store the level viscosities given by the piecewise constant
+       * @p level_viscosity_projection in @p mg_data and pass them on to the
+       * level operators.
+       */
+      template <typename number>
+      void fill_level_viscosity (MultigridData<number> &mg_data,
+                                 const MGLevelObject<VectorType> &level_viscosity_projection,
+                                 const bool is_compressible);
+
+      /**
+       * Solve the Stokes system with the outer FGMRES iteration,
+       * preconditioned by the block Schur preconditioner that uses one
+       * V-cycle on the levels of @p mg_data for the velocity block. Print
+       * the number of iterations and return the final linear residual.
+       */
+      template <typename number>
+      double solve_with_multigrid (MultigridData<number> &mg_data,
+                                   BlockVectorType &solution,
+                                   const BlockVectorType &rhs,
+                                   const double solver_tolerance);
+
+      /**
+       * Copy the velocity and pressure blocks of a vector that uses the
+       * numbering of Simulator::dof_handler into a block vector that uses
+       * the numbering of dof_handler_v and dof_handler_p, and vice versa.
+       */
+      void copy_to_matrix_free (const LinearAlgebra::BlockVector &src,
+                                BlockVectorType &dst) const;
+      void copy_from_matrix_free (const BlockVectorType &src,
+                                  LinearAlgebra::BlockVector &dst) const;
+
+      Simulator<dim> &sim;
+
+      /**
+       * Polynomial degree of the Chebyshev smoother used on each
+       * multigrid level.
+       */
+      unsigned int chebyshev_degree;
+
+      /**
+       * Whether the multigrid V-cycle is done in single precision, i.e.,
+       * whether mg_data_float or mg_data_double is used.
+       */
+      bool use_single_precision_multigrid;
+
+      FESystem<dim> fe_v;
+      FE_Q<dim> fe_p;
+      FE_DGQ<dim> fe_projection;
+
+      DoFHandler<dim> dof_handler_v;
+      DoFHandler<dim> dof_handler_p;
+      DoFHandler<dim> dof_handler_projection;
+
+      ConstraintMatrix constraints_v;
+      ConstraintMatrix constraints_p;
+
+      /**
+       * For every locally owned degree of freedom of dof_handler_v and
+       * dof_handler_p (indexed in the order of the locally owned index
+       * set), the corresponding global index in Simulator::dof_handler.
+       */
+      std::vector<types::global_dof_index> velocity_index_map;
+      std::vector<types::global_dof_index> pressure_index_map;
+
+      /**
+       * The matrix-free storage on the active level. It contains both the
+       * velocity (index 0) and the pressure (index 1) DoFHandler, so that
+       * all active level operators share the same cell batches and can
+       * share the viscosity table.
+       */
+      std::shared_ptr<MatrixFree<dim,double> > stokes_mf_storage;
+
+      StokesMatrixType stokes_matrix;
+      ABlockMatrixType velocity_matrix;
+      SchurComplementMatrixType mass_matrix;
+
+      MGConstrainedDoFs mg_constrained_dofs;
+      MGTransferMatrixFree<dim,double> mg_transfer_projection;
+
+      /**
+       * The multigrid hierarchy in double and in single precision. Only
+       * one of them is set up, depending on use_single_precision_multigrid.
+       */
+      MultigridData<double> mg_data_double;
+      MultigridData<float> mg_data_float;
+
+      /**
+       * Twice the viscosity at all quadrature points of all active cell
+       * batches.
+       */
+      Table<2, VectorizedArray<double> > active_viscosity_x_2;
+  };
+}
+
+#else
+
+namespace aspect
+{
+  using namespace dealii;
+
+  /**
+   * The matrix-free GMG Stokes solver requires deal.II 9.1 or newer. For
+   * older versions, this class only provides the interface used by the
+   * Simulator and refuses to be constructed.
+   */
+  template <int dim>
+  class StokesMatrixFreeHandler
+  {
+    public:
+      StokesMatrixFreeHandler (Simulator<dim> &, ParameterHandler &)
+      {
+        AssertThrow (false,
+                     ExcMessage ("The 'block GMG' Stokes solver requires deal.II 9.1 or newer."));
+      }
+
+      void setup_dofs () {}
+
+      void evaluate_viscosity () {}
+
+      void build_preconditioner () {}
+
+      std::pair<double,double> solve (LinearAlgebra::BlockVector &)
+      {
+        return std::pair<double,double>(0.,0.);
+      }
+
+      double compute_initial_stokes_residual (const LinearAlgebra::BlockVector &) const
+      {
+        return 0.;
+      }
+
+      /**
+       * Declare the same parameters as the matrix-free solver, so that
+       * input files that set them can still be read.
+       */
+      static
+      void declare_parameters (ParameterHandler &prm);
+
+      void parse_parameters (ParameterHandler &) {}
+  };
+}
+
+#endif
+
+#endif
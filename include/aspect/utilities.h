@@ -30,6 +30,7 @@
 #include <deal.II/base/table_indices.h>
 #include <deal.II/base/function_lib.h>
 #include <deal.II/dofs/dof_handler.h>
+#include <deal.II/fe/mapping.h>
 #include <deal.II/fe/component_mask.h>
 
 #include <aspect/coordinate_systems.h>
@@ -162,6 +163,38 @@ namespace aspect
                                                         const ComponentMask &component_mask);
 
 
+    /**
+     * Initialize the algebraic multigrid @p preconditioner for @p matrix,
+     * which discretizes an elliptic operator acting on the vector-valued
+     * field of @p dof_handler that starts at component
+     * @p first_vector_component, with the settings in @p amg_data. Rather
+     * than only the constant modes of each component, the preconditioner
+     * uses all rigid body modes (the @p dim translations and the
+     * rotations around the axes through the centroid of the domain) as its
+     * near null space. They are computed from the positions of the support
+     * points of the degrees of freedom given by @p mapping. All other
+     * parameters of the preconditioner are set from @p amg_data by
+     * deal.II. This improves the coarse spaces for
+     * problems where rotations are (nearly) not resisted, e.g., for
+     * spherical geometries with free slip boundaries.
+     *
+     * The rows of @p matrix need to be numbered like the degrees of
+     * freedom of @p dof_handler, and the vector-valued field needs to be
+     * discretized by a scalar base element with support points.
+     *
+     * This function is only implemented for Trilinos and deal.II 9.2 or
+     * newer.
+     */
+    template <int dim>
+    void
+    initialize_amg_with_rigid_body_modes (LinearAlgebra::PreconditionAMG                       &preconditioner,
+                                          const LinearAlgebra::SparseMatrix                    &matrix,
+                                          const LinearAlgebra::PreconditionAMG::AdditionalData &amg_data,
+                                          const Mapping<dim>                                   &mapping,
+                                          const DoFHandler<dim>                                &dof_handler,
+                                          const unsigned int                                    first_vector_component);
+
+
 
     namespace Coordinates
     {
@@ -47,6 +47,40 @@ namespace aspect
         property_map (&property_map_pairs[0],
                       &property_map_pairs[0] +
                       sizeof(property_map_pairs)/sizeof(property_map_pairs[0]));
+
+
+        /**
+         * Return the flag with which the given property can be requested
+         * from a material model.
+         */
+        MaterialProperties::Property
+        requested_property_flag (const MaterialProperty property)
+        {
+          switch (property)
+            {
+              case viscosity:
+                return MaterialProperties::viscosity;
+              case density:
+                return MaterialProperties::density;
+              case thermal_expansion_coefficient:
+                return MaterialProperties::thermal_expansion_coefficient;
+              case specific_heat:
+                return MaterialProperties::specific_heat;
+              case thermal_conductivity:
+                return MaterialProperties::thermal_conductivity;
+              case compressibility:
+                return MaterialProperties::compressibility;
+              case entropy_derivative_pressure:
+                return MaterialProperties::entropy_derivative_pressure;
+              case entropy_derivative_temperature:
+                return MaterialProperties::entropy_derivative_temperature;
+              case reaction_terms:
+                return MaterialProperties::reaction_terms;
+            }
+
+          Assert (false, ExcInternalError());
+          return MaterialProperties::uninitialized;
+        }
       }
     }
 
@@ -89,6 +123,19 @@ namespace aspect
 
       for (unsigned int i=0; i<models.size(); ++i)
         {
+          // only ask each model for the requested properties it is
+          // responsible for, and skip models that do not provide any of them
+          MaterialProperties::Property requested_properties = MaterialProperties::uninitialized;
+          for (std::map<Property::MaterialProperty, unsigned int>::const_iterator
+               property = model_property_map.begin(); property != model_property_map.end(); ++property)
+            if (property->second == i
+                && out.requests_property(Property::requested_property_flag(property->first)))
+              requested_properties |= Property::requested_property_flag(property->first);
+
+          if (requested_properties == MaterialProperties::uninitialized)
+            continue;
+
+          base_output.requested_properties = requested_properties;
           models[i]->evaluate(in, base_output);
           copy_required_properties(i, base_output, out);
         }
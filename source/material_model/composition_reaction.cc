@@ -39,7 +39,7 @@ namespace aspect
       for (unsigned int i=0; i < in.position.size(); ++i)
         {
           const double temperature = in.temperature[i];
-          const std::vector<double> &composition = in.composition[i];
+          const StridedArrayView<const double> composition = in.composition[i];
           const double delta_temp = temperature-reference_T;
           double temperature_dependence = std::max(std::min(std::exp(-thermal_viscosity_exponent*delta_temp/reference_T),1e2),1e-2);
 
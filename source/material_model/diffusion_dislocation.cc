@@ -22,6 +22,8 @@
 #include <aspect/utilities.h>
 #include <aspect/adiabatic_conditions/interface.h>
 
+#include <deal.II/base/table.h>
+
 namespace aspect
 {
   namespace MaterialModel
@@ -82,7 +84,9 @@ namespace aspect
     calculate_isostrain_viscosities ( const std::vector<double> &volume_fractions,
                                       const double &pressure,
                                       const double &temperature,
-                                      const SymmetricTensor<2,dim> &strain_rate) const
+                                      const SymmetricTensor<2,dim> &strain_rate,
+                                      const std::vector<double> &prefactors_stress_diffusion,
+                                      const std::vector<double> &prefactors_stress_dislocation) const
     {
       // This function calculates viscosities assuming that all the compositional fields
       // experience the same strain rate (isostrain).
@@ -105,16 +109,11 @@ namespace aspect
           // where ii indicates the square root of the second invariant and
           // i corresponds to diffusion or dislocation creep
 
-          // For diffusion creep, viscosity is grain size dependent
-          const double prefactor_stress_diffusion = prefactors_diffusion[j] *
-                                                    std::pow(grain_size, -grain_size_exponents_diffusion[j]) *
-                                                    std::exp(-(std::max(activation_energies_diffusion[j] + pressure*activation_volumes_diffusion[j],0.0))/
-                                                             (constants::gas_constant*temperature));
-
-          // For dislocation creep, viscosity is grain size independent (m=0)
-          const double prefactor_stress_dislocation = prefactors_dislocation[j] *
-                                                      std::exp(-(std::max(activation_energies_dislocation[j] + pressure*activation_volumes_dislocation[j],0.0))/
-                                                               (constants::gas_constant*temperature));
+          // The factors A_i * d^{-m} \exp\left(-\frac{E_i^\ast + PV_i^\ast}{n_iRT}\right)
+          // are computed by the caller. For diffusion creep, viscosity is grain size
+          // dependent, for dislocation creep, viscosity is grain size independent (m=0).
+          const double prefactor_stress_diffusion = prefactors_stress_diffusion[j];
+          const double prefactor_stress_dislocation = prefactors_stress_dislocation[j];
 
           // Because the ratios of the diffusion and dislocation strain rates are not known, stress is also unknown
           // We use Newton's method to find the second invariant of the stress tensor.
@@ -132,17 +131,22 @@ namespace aspect
           while (std::abs(strain_rate_residual) > strain_rate_residual_threshold
                  && stress_iteration < stress_max_iteration_number)
             {
+              // Compute the powers of the stress once and use them for both
+              // the residual and its derivative.
+              const double stress_power_diffusion = std::pow(stress_ii, stress_exponents_diffusion[j]-1);
+              const double stress_power_dislocation = std::pow(stress_ii, stress_exponents_dislocation[j]-1);
+
               strain_rate_residual = prefactor_stress_diffusion *
-                                     std::pow(stress_ii, stress_exponents_diffusion[j]) +
+                                     stress_power_diffusion * stress_ii +
                                      prefactor_stress_dislocation *
-                                     std::pow(stress_ii, stress_exponents_dislocation[j]) - edot_ii;
+                                     stress_power_dislocation * stress_ii - edot_ii;
 
               strain_rate_deriv = stress_exponents_diffusion[j] *
                                   prefactor_stress_diffusion *
-                                  std::pow(stress_ii, stress_exponents_diffusion[j]-1) +
+                                  stress_power_diffusion +
                                   stress_exponents_dislocation[j] *
                                   prefactor_stress_dislocation *
-                                  std::pow(stress_ii, stress_exponents_dislocation[j]-1);
+                                  stress_power_dislocation;
 
               // If the strain rate derivative is zero, we catch it below.
               if (strain_rate_deriv>std::numeric_limits<double>::min())
@@ -161,8 +165,8 @@ namespace aspect
                                                   || !numbers::is_finite(strain_rate_residual)
                                                   || !numbers::is_finite(strain_rate_deriv)
                                                   || strain_rate_deriv < std::numeric_limits<double>::min()
-                                                  || !numbers::is_finite(std::pow(stress_ii, stress_exponents_diffusion[j]-1))
-                                                  || !numbers::is_finite(std::pow(stress_ii, stress_exponents_dislocation[j]-1))
+                                                  || !numbers::is_finite(stress_power_diffusion)
+                                                  || !numbers::is_finite(stress_power_dislocation)
                                                   || stress_iteration == stress_max_iteration_number;
               if (abort_newton_iteration)
                 {
@@ -170,24 +174,26 @@ namespace aspect
                   double dislocation_strain_rate = min_strain_rate;
                   stress_iteration = 0;
 
+                  // These factors do not change during the fixpoint iteration
+                  const double diffusion_prefactor = 0.5 * std::pow(prefactors_diffusion[j],-1.0/stress_exponents_diffusion[j]);
+                  const double diffusion_grain_size_dependence = std::pow(grain_size, grain_size_exponents_diffusion[j]/stress_exponents_diffusion[j]);
+                  const double diffusion_T_and_P_dependence = std::exp(std::max(activation_energies_diffusion[j] + pressure*activation_volumes_diffusion[j],0.0)/
+                                                                       (constants::gas_constant*temperature));
+                  const double dislocation_prefactor = 0.5 * std::pow(prefactors_dislocation[j],-1.0/stress_exponents_dislocation[j]);
+                  const double dislocation_T_and_P_dependence = std::exp(std::max(activation_energies_dislocation[j] + pressure*activation_volumes_dislocation[j],0.0)/
+                                                                         (stress_exponents_dislocation[j]*constants::gas_constant*temperature));
+
                   do
                     {
                       const double old_diffusion_strain_rate = diffusion_strain_rate;
 
-                      const double diffusion_prefactor = 0.5 * std::pow(prefactors_diffusion[j],-1.0/stress_exponents_diffusion[j]);
-                      const double diffusion_grain_size_dependence = std::pow(grain_size, grain_size_exponents_diffusion[j]/stress_exponents_diffusion[j]);
                       const double diffusion_strain_rate_dependence = std::pow(diffusion_strain_rate, (1.-stress_exponents_diffusion[j])/stress_exponents_diffusion[j]);
-                      const double diffusion_T_and_P_dependence = std::exp(std::max(activation_energies_diffusion[j] + pressure*activation_volumes_diffusion[j],0.0)/
-                                                                           (constants::gas_constant*temperature));
 
                       const double diffusion_viscosity = std::min(std::max(diffusion_prefactor * diffusion_grain_size_dependence
                                                                            * diffusion_strain_rate_dependence * diffusion_T_and_P_dependence,
                                                                            min_visc), max_visc);
 
-                      const double dislocation_prefactor = 0.5 * std::pow(prefactors_dislocation[j],-1.0/stress_exponents_dislocation[j]);
                       const double dislocation_strain_rate_dependence = std::pow(dislocation_strain_rate, (1.-stress_exponents_dislocation[j])/stress_exponents_dislocation[j]);
-                      const double dislocation_T_and_P_dependence = std::exp(std::max(activation_energies_dislocation[j] + pressure*activation_volumes_dislocation[j],0.0)/
-                                                                             (stress_exponents_dislocation[j]*constants::gas_constant*temperature));
 
                       const double dislocation_viscosity = std::min(std::max(dislocation_prefactor * dislocation_strain_rate_dependence
                                                                              * dislocation_T_and_P_dependence,
@@ -226,12 +232,30 @@ namespace aspect
     evaluate(const MaterialModel::MaterialModelInputs<dim> &in,
              MaterialModel::MaterialModelOutputs<dim> &out) const
     {
+      // Compute the pressure and temperature dependent factors of the creep
+      // laws of all compositional fields at all points at once
+      const unsigned int n_points = in.temperature.size();
+      const unsigned int n_phases = diffusion_creep.size();
+      Table<2,double> prefactors_diffusion_table (n_phases, n_points);
+      Table<2,double> prefactors_dislocation_table (n_phases, n_points);
+      if (in.strain_rate.size() && n_points > 0)
+        for (unsigned int j=0; j < n_phases; ++j)
+          {
+            RheologyKernels::compute_strain_rate_prefactors(diffusion_creep[j], n_points, &in.pressure[0],
+                                                            &in.temperature[0], &prefactors_diffusion_table[j][0]);
+            RheologyKernels::compute_strain_rate_prefactors(dislocation_creep[j], n_points, &in.pressure[0],
+                                                            &in.temperature[0], &prefactors_dislocation_table[j][0]);
+          }
+
+      std::vector<double> composition;
+      std::vector<double> prefactors_stress_diffusion (n_phases);
+      std::vector<double> prefactors_stress_dislocation (n_phases);
       for (unsigned int i=0; i < in.temperature.size(); ++i)
         {
           // const Point<dim> position = in.position[i];
           const double temperature = in.temperature[i];
           const double pressure= in.pressure[i];
-          const std::vector<double> composition = in.composition[i];
+          in.composition[i].copy_to(composition);
           const std::vector<double> volume_fractions = compute_volume_fractions(composition);
 
           // Averaging composition-field dependent properties
@@ -258,8 +282,14 @@ namespace aspect
               // isostrain amongst all compositions, allowing calculation of the viscosity ratio.
               // TODO: This is only consistent with viscosity averaging if the arithmetic averaging
               // scheme is chosen. It would be useful to have a function to calculate isostress viscosities.
+              for (unsigned int j=0; j < n_phases; ++j)
+                {
+                  prefactors_stress_diffusion[j] = prefactors_diffusion_table[j][i];
+                  prefactors_stress_dislocation[j] = prefactors_dislocation_table[j][i];
+                }
               const std::vector<double> composition_viscosities =
-                calculate_isostrain_viscosities(volume_fractions, pressure, temperature, in.strain_rate[i]);
+                calculate_isostrain_viscosities(volume_fractions, pressure, temperature, in.strain_rate[i],
+                                                prefactors_stress_diffusion, prefactors_stress_dislocation);
 
               // The isostrain condition implies that the viscosity averaging should be arithmetic (see above).
               // We have given the user freedom to apply alternative bounds, because in diffusion-dominated
@@ -529,6 +559,23 @@ namespace aspect
                                                                                    n_fields,
                                                                                    "Activation volumes for dislocation creep");
 
+          diffusion_creep.clear();
+          dislocation_creep.clear();
+          for (unsigned int i = 0; i<n_fields; ++i)
+            {
+              diffusion_creep.push_back(RheologyKernels::PowerLawCreep(prefactors_diffusion[i],
+                                                                       stress_exponents_diffusion[i],
+                                                                       grain_size_exponents_diffusion[i],
+                                                                       activation_energies_diffusion[i],
+                                                                       activation_volumes_diffusion[i],
+                                                                       grain_size));
+              dislocation_creep.push_back(RheologyKernels::PowerLawCreep(prefactors_dislocation[i],
+                                                                         stress_exponents_dislocation[i],
+                                                                         0.0,
+                                                                         activation_energies_dislocation[i],
+                                                                         activation_volumes_dislocation[i],
+                                                                         grain_size));
+            }
         }
         prm.leave_subsection();
       }
@@ -87,50 +87,50 @@ namespace aspect
       MaterialLookup::specific_heat(double temperature,
                                     double pressure) const
       {
-        return value(temperature,pressure,specific_heat_values,interpolation);
+        return value(temperature,pressure,specific_heat_property,interpolation);
       }
 
       double
       MaterialLookup::density(double temperature,
                               double pressure) const
       {
-        return value(temperature,pressure,density_values,interpolation);
+        return value(temperature,pressure,density_property,interpolation);
       }
 
       double
       MaterialLookup::thermal_expansivity(const double temperature,
                                           const double pressure) const
       {
-        return value(temperature,pressure,thermal_expansivity_values,interpolation);
+        return value(temperature,pressure,thermal_expansivity_property,interpolation);
       }
 
       double
       MaterialLookup::seismic_Vp(const double temperature,
                                  const double pressure) const
       {
-        return value(temperature,pressure,vp_values,false);
+        return value(temperature,pressure,vp_property,false);
       }
 
       double
       MaterialLookup::seismic_Vs(const double temperature,
                                  const double pressure) const
       {
-        return value(temperature,pressure,vs_values,false);
+        return value(temperature,pressure,vs_property,false);
       }
 
       double
       MaterialLookup::enthalpy(const double temperature,
                                const double pressure) const
       {
-        return value(temperature,pressure,enthalpy_values,true);
+        return value(temperature,pressure,enthalpy_property,true);
       }
 
       double
       MaterialLookup::dHdT (const double temperature,
                             const double pressure) const
       {
-        const double h = value(temperature,pressure,enthalpy_values,interpolation);
-        const double dh = value(temperature+delta_temp,pressure,enthalpy_values,interpolation);
+        const double h = value(temperature,pressure,enthalpy_property,interpolation);
+        const double dh = value(temperature+delta_temp,pressure,enthalpy_property,interpolation);
         return (dh - h) / delta_temp;
       }
 
@@ -138,8 +138,8 @@ namespace aspect
       MaterialLookup::dHdp (const double temperature,
                             const double pressure) const
       {
-        const double h = value(temperature,pressure,enthalpy_values,interpolation);
-        const double dh = value(temperature,pressure+delta_press,enthalpy_values,interpolation);
+        const double h = value(temperature,pressure,enthalpy_property,interpolation);
+        const double dh = value(temperature,pressure+delta_press,enthalpy_property,interpolation);
         return (dh - h) / delta_press;
       }
 
@@ -215,46 +215,110 @@ namespace aspect
       MaterialLookup::dRhodp (const double temperature,
                               const double pressure) const
       {
-        const double rho = value(temperature,pressure,density_values,interpolation);
-        const double drho = value(temperature,pressure+delta_press,density_values,interpolation);
+        const double rho = value(temperature,pressure,density_property,interpolation);
+        const double drho = value(temperature,pressure+delta_press,density_property,interpolation);
         return (drho - rho) / delta_press;
       }
 
-      double
-      MaterialLookup::value (const double temperature,
-                             const double pressure,
-                             const Table<2, double> &values,
-                             const bool interpol) const
+      MaterialLookupValues
+      MaterialLookup::evaluate_all (const double temperature,
+                                    const double pressure) const
       {
-        const double nT = get_nT(temperature);
-        const unsigned int inT = static_cast<unsigned int>(nT);
+        // The derivatives are the same finite differences as in the
+        // functions above, which need the table positions of the
+        // neighboring points in temperature and pressure.
+        const TablePosition position = get_table_position(temperature,pressure);
+        const TablePosition position_dT = get_table_position(temperature+delta_temp,pressure);
+        const TablePosition position_dp = get_table_position(temperature,pressure+delta_press);
+
+        MaterialLookupValues values;
+        values.density = value(position,density_property,interpolation);
+        values.thermal_expansivity = value(position,thermal_expansivity_property,interpolation);
+        values.specific_heat = value(position,specific_heat_property,interpolation);
+        values.seismic_Vp = value(position,vp_property,false);
+        values.seismic_Vs = value(position,vs_property,false);
+        values.enthalpy = value(position,enthalpy_property,true);
+
+        const double h = (interpolation
+                          ?
+                          values.enthalpy
+                          :
+                          value(position,enthalpy_property,false));
+        values.dHdT = (value(position_dT,enthalpy_property,interpolation) - h) / delta_temp;
+        values.dHdp = (value(position_dp,enthalpy_property,interpolation) - h) / delta_press;
+        values.dRhodp = (value(position_dp,density_property,interpolation) - values.density) / delta_press;
+
+        return values;
+      }
+
+      void
+      MaterialLookup::evaluate_all (const std::vector<double> &temperatures,
+                                    const std::vector<double> &pressures,
+                                    std::vector<MaterialLookupValues> &values) const
+      {
+        Assert(temperatures.size() == pressures.size(),ExcInternalError());
+        values.resize(temperatures.size());
+        for (unsigned int q=0; q<temperatures.size(); ++q)
+          values[q] = evaluate_all(temperatures[q],pressures[q]);
+      }
 
+      MaterialLookup::TablePosition
+      MaterialLookup::get_table_position (const double temperature,
+                                          const double pressure) const
+      {
+        const double nT = get_nT(temperature);
         const double np = get_np(pressure);
-        const unsigned int inp = static_cast<unsigned int>(np);
 
-        Assert(inT<values.n_rows(), ExcMessage("Attempting to look up a temperature value with index greater than the number of rows."));
-        Assert(inp<values.n_cols(), ExcMessage("Attempting to look up a pressure value with index greater than the number of columns."));
+        TablePosition position;
+        position.inT = static_cast<unsigned int>(nT);
+        position.inp = static_cast<unsigned int>(np);
+
+        Assert(position.inT<property_values.size(0), ExcMessage("Attempting to look up a temperature value with index greater than the number of rows."));
+        Assert(position.inp<property_values.size(1), ExcMessage("Attempting to look up a pressure value with index greater than the number of columns."));
+
+        // compute the coordinates of this point in the
+        // reference cell between the data points
+        position.xi = nT-position.inT;
+        position.eta = np-position.inp;
+
+        Assert ((0 <= position.xi) && (position.xi <= 1), ExcInternalError());
+        Assert ((0 <= position.eta) && (position.eta <= 1), ExcInternalError());
+
+        return position;
+      }
+
+      double
+      MaterialLookup::value (const TablePosition &position,
+                             const Property property,
+                             const bool interpol) const
+      {
+        const unsigned int inT = position.inT;
+        const unsigned int inp = position.inp;
 
         if (!interpol)
-          return values[inT][inp];
+          return property_values[inT][inp][property];
         else
           {
-            // compute the coordinates of this point in the
-            // reference cell between the data points
-            const double xi = nT-inT;
-            const double eta = np-inp;
-
-            Assert ((0 <= xi) && (xi <= 1), ExcInternalError());
-            Assert ((0 <= eta) && (eta <= 1), ExcInternalError());
+            const double xi = position.xi;
+            const double eta = position.eta;
 
             // use these coordinates for a bilinear interpolation
-            return ((1-xi)*(1-eta)*values[inT][inp] +
-                    xi    *(1-eta)*values[inT+1][inp] +
-                    (1-xi)*eta    *values[inT][inp+1] +
-                    xi    *eta    *values[inT+1][inp+1]);
+            return ((1-xi)*(1-eta)*property_values[inT][inp][property] +
+                    xi    *(1-eta)*property_values[inT+1][inp][property] +
+                    (1-xi)*eta    *property_values[inT][inp+1][property] +
+                    xi    *eta    *property_values[inT+1][inp+1][property]);
           }
       }
 
+      double
+      MaterialLookup::value (const double temperature,
+                             const double pressure,
+                             const Property property,
+                             const bool interpol) const
+      {
+        return value(get_table_position(temperature,pressure),property,interpol);
+      }
+
       std::array<double,2>
       MaterialLookup::get_pT_steps() const
       {
@@ -342,12 +406,7 @@ namespace aspect
           Assert(i == n_temperature * n_pressure,
                  ExcMessage("Material table size not consistent."));
 
-          density_values.reinit(n_temperature,n_pressure);
-          thermal_expansivity_values.reinit(n_temperature,n_pressure);
-          specific_heat_values.reinit(n_temperature,n_pressure);
-          vp_values.reinit(n_temperature,n_pressure);
-          vs_values.reinit(n_temperature,n_pressure);
-          enthalpy_values.reinit(n_temperature,n_pressure);
+          property_values.reinit(n_temperature,n_pressure,n_properties);
 
           i = 0;
           while (!in.eof())
@@ -374,7 +433,7 @@ namespace aspect
               if (in.fail())
                 {
                   in.clear();
-                  rho = density_values[(i-1)%n_temperature][(i-1)/n_temperature];
+                  rho = property_values[(i-1)%n_temperature][(i-1)/n_temperature][density_property];
                 }
               else
                 rho *= 1e3; // conversion from [g/cm^3] to [kg/m^3]
@@ -387,13 +446,13 @@ namespace aspect
               if (in.fail())
                 {
                   in.clear();
-                  vs = vs_values[(i-1)%n_temperature][(i-1)/n_temperature];
+                  vs = property_values[(i-1)%n_temperature][(i-1)/n_temperature][vs_property];
                 }
               in >> vp;
               if (in.fail())
                 {
                   in.clear();
-                  vp = vp_values[(i-1)%n_temperature][(i-1)/n_temperature];
+                  vp = property_values[(i-1)%n_temperature][(i-1)/n_temperature][vp_property];
                 }
               in >> vsq >> vpq;
 
@@ -401,7 +460,7 @@ namespace aspect
               if (in.fail())
                 {
                   in.clear();
-                  h = enthalpy_values[(i-1)%n_temperature][(i-1)/n_temperature];
+                  h = property_values[(i-1)%n_temperature][(i-1)/n_temperature][enthalpy_property];
                 }
               else
                 h *= 1e6; // conversion from [kJ/g] to [J/kg]
@@ -410,12 +469,12 @@ namespace aspect
               if (in.eof())
                 break;
 
-              density_values[i/n_pressure][i%n_pressure]=rho;
-              thermal_expansivity_values[i/n_pressure][i%n_pressure]=alpha;
-              specific_heat_values[i/n_pressure][i%n_pressure]=cp;
-              vp_values[i/n_pressure][i%n_pressure]=vp;
-              vs_values[i/n_pressure][i%n_pressure]=vs;
-              enthalpy_values[i/n_pressure][i%n_pressure]=h;
+              property_values[i/n_pressure][i%n_pressure][density_property]=rho;
+              property_values[i/n_pressure][i%n_pressure][thermal_expansivity_property]=alpha;
+              property_values[i/n_pressure][i%n_pressure][specific_heat_property]=cp;
+              property_values[i/n_pressure][i%n_pressure][vp_property]=vp;
+              property_values[i/n_pressure][i%n_pressure][vs_property]=vs;
+              property_values[i/n_pressure][i%n_pressure][enthalpy_property]=h;
 
               i++;
             }
@@ -455,7 +514,7 @@ namespace aspect
                 if (in.fail() || (cp <= std::numeric_limits<double>::min()))
                   {
                     in.clear();
-                    cp = specific_heat_values[(i-1)%n_temperature][(i-1)/n_temperature];
+                    cp = property_values[(i-1)%n_temperature][(i-1)/n_temperature][specific_heat_property];
                   }
                 else
                   cp *= 1e3; // conversion from [J/g/K] to [J/kg/K]
@@ -464,7 +523,7 @@ namespace aspect
                 if (in.fail() || (alpha_eff <= std::numeric_limits<double>::min()))
                   {
                     in.clear();
-                    alpha_eff = thermal_expansivity_values[(i-1)%n_temperature][(i-1)/n_temperature];
+                    alpha_eff = property_values[(i-1)%n_temperature][(i-1)/n_temperature][thermal_expansivity_property];
                   }
                 else
                   {
@@ -481,8 +540,8 @@ namespace aspect
                 if (in.eof())
                   break;
 
-                specific_heat_values[i/n_pressure][i%n_pressure]=cp;
-                thermal_expansivity_values[i/n_pressure][i%n_pressure]=alpha_eff;
+                property_values[i/n_pressure][i%n_pressure][specific_heat_property]=cp;
+                property_values[i/n_pressure][i%n_pressure][thermal_expansivity_property]=alpha_eff;
 
                 i++;
               }
@@ -542,12 +601,7 @@ namespace aspect
         max_temp = min_temp + (n_temperature-1) * delta_temp;
         max_press = min_press + (n_pressure-1) * delta_press;
 
-        density_values.reinit(n_temperature,n_pressure);
-        thermal_expansivity_values.reinit(n_temperature,n_pressure);
-        specific_heat_values.reinit(n_temperature,n_pressure);
-        vp_values.reinit(n_temperature,n_pressure);
-        vs_values.reinit(n_temperature,n_pressure);
-        enthalpy_values.reinit(n_temperature,n_pressure);
+        property_values.reinit(n_temperature,n_pressure,n_properties);
 
         unsigned int i = 0;
         while (!in.eof())
@@ -559,49 +613,49 @@ namespace aspect
             if (in.fail())
               {
                 in.clear();
-                rho = density_values[(i-1)%n_temperature][(i-1)/n_temperature];
+                rho = property_values[(i-1)%n_temperature][(i-1)/n_temperature][density_property];
               }
             in >> alpha;
             if (in.fail())
               {
                 in.clear();
-                alpha = thermal_expansivity_values[(i-1)%n_temperature][(i-1)/n_temperature];
+                alpha = property_values[(i-1)%n_temperature][(i-1)/n_temperature][thermal_expansivity_property];
               }
             in >> cp;
             if (in.fail())
               {
                 in.clear();
-                cp = specific_heat_values[(i-1)%n_temperature][(i-1)/n_temperature];
+                cp = property_values[(i-1)%n_temperature][(i-1)/n_temperature][specific_heat_property];
               }
             in >> vp;
             if (in.fail())
               {
                 in.clear();
-                vp = vp_values[(i-1)%n_temperature][(i-1)/n_temperature];
+                vp = property_values[(i-1)%n_temperature][(i-1)/n_temperature][vp_property];
               }
             in >> vs;
             if (in.fail())
               {
                 in.clear();
-                vs = vs_values[(i-1)%n_temperature][(i-1)/n_temperature];
+                vs = property_values[(i-1)%n_temperature][(i-1)/n_temperature][vs_property];
               }
             in >> h;
             if (in.fail())
               {
                 in.clear();
-                h = enthalpy_values[(i-1)%n_temperature][(i-1)/n_temperature];
+                h = property_values[(i-1)%n_temperature][(i-1)/n_temperature][enthalpy_property];
               }
 
             getline(in, temp);
             if (in.eof())
               break;
 
-            density_values[i%n_temperature][i/n_temperature]=rho;
-            thermal_expansivity_values[i%n_temperature][i/n_temperature]=alpha;
-            specific_heat_values[i%n_temperature][i/n_temperature]=cp;
-            vp_values[i%n_temperature][i/n_temperature]=vp;
-            vs_values[i%n_temperature][i/n_temperature]=vs;
-            enthalpy_values[i%n_temperature][i/n_temperature]=h;
+            property_values[i%n_temperature][i/n_temperature][density_property]=rho;
+            property_values[i%n_temperature][i/n_temperature][thermal_expansivity_property]=alpha;
+            property_values[i%n_temperature][i/n_temperature][specific_heat_property]=cp;
+            property_values[i%n_temperature][i/n_temperature][vp_property]=vp;
+            property_values[i%n_temperature][i/n_temperature][vs_property]=vs;
+            property_values[i%n_temperature][i/n_temperature][enthalpy_property]=h;
 
             i++;
           }
@@ -616,6 +670,9 @@ namespace aspect
     void
     GrainSize<dim>::initialize()
     {
+      n_grain_size_substeps = 0;
+      n_dislocation_viscosity_iterations = 0;
+
       n_material_data = material_file_names.size();
       for (unsigned i = 0; i < n_material_data; i++)
         {
@@ -637,6 +694,32 @@ namespace aspect
 
 
 
+    template <int dim>
+    void
+    GrainSize<dim>::update()
+    {
+      if (grain_size_evolution_scheme != adaptive_runge_kutta)
+        return;
+
+      // The counters contain the substeps and iterations of all evaluations
+      // since the last call, i.e. of the previous time step, whose row is
+      // the last one in the statistics object.
+      const unsigned int n_substeps = Utilities::MPI::sum(n_grain_size_substeps,
+                                                          this->get_mpi_communicator());
+      const unsigned int n_iterations = Utilities::MPI::sum(n_dislocation_viscosity_iterations,
+                                                            this->get_mpi_communicator());
+      if (this->get_timestep_number() > 0)
+        {
+          this->get_statistics_object().add_value("Grain size evolution substeps", n_substeps);
+          this->get_statistics_object().add_value("Grain size dislocation viscosity iterations", n_iterations);
+        }
+
+      n_grain_size_substeps = 0;
+      n_dislocation_viscosity_iterations = 0;
+    }
+
+
+
     template <int dim>
     double
     GrainSize<dim>::
@@ -857,6 +940,250 @@ namespace aspect
 
 
 
+    template <int dim>
+    double
+    GrainSize<dim>::
+    grain_size_evolution_rate (GrainSizeEvolutionPoint &point,
+                               const double grain_size,
+                               unsigned int &n_dislocation_iterations) const
+    {
+      const unsigned int phase_index = point.phase_index;
+
+      // grain size growth due to Ostwald ripening
+      const double grain_size_growth_rate = point.growth_prefactor
+                                            * std::pow(grain_size,1.0-grain_growth_exponent[phase_index]);
+
+      // without deformation there is no grain size reduction
+      if (std::abs(point.second_strain_rate_invariant) <= 1e-30)
+        return grain_size_growth_rate;
+
+      // The diffusion viscosity is a power law of the grain size, and the
+      // dislocation viscosity a power law of the dislocation strain rate,
+      // which is a fraction of the full strain rate. This allows us to
+      // do the same fixed point iteration as dislocation_viscosity()
+      // without evaluating the flow laws again.
+      const double diff_viscosity = point.reference_diffusion_viscosity
+                                    * std::pow(grain_size / point.reference_grain_size,
+                                               point.diffusion_grain_size_exponent);
+
+      double dis_viscosity = point.dislocation_viscosity;
+      double dis_viscosity_old = 0;
+      unsigned int i = 0;
+      while ((std::abs((dis_viscosity-dis_viscosity_old) / dis_viscosity) > dislocation_viscosity_iteration_threshold)
+             && (i < dislocation_viscosity_iteration_number))
+        {
+          dis_viscosity_old = dis_viscosity;
+          dis_viscosity = point.full_strain_rate_dislocation_viscosity
+                          * std::pow(diff_viscosity / (diff_viscosity + dis_viscosity),
+                                     point.dislocation_strain_rate_exponent);
+          ++i;
+        }
+
+      Assert(i<dislocation_viscosity_iteration_number,ExcInternalError());
+
+      point.dislocation_viscosity = dis_viscosity;
+      n_dislocation_iterations += i;
+
+      const double current_viscosity = dis_viscosity * diff_viscosity / (dis_viscosity + diff_viscosity);
+      const double dislocation_strain_rate = point.second_strain_rate_invariant
+                                             * current_viscosity / dis_viscosity;
+
+      double grain_size_reduction_rate = 0.0;
+      if (use_paleowattmeter)
+        {
+          // paleowattmeter: Austin and Evans (2007): Paleowattmeters: A scaling relation for dynamically recrystallized grain size. Geology 35, 343-346
+          const double stress = 2.0 * point.second_strain_rate_invariant * current_viscosity;
+          grain_size_reduction_rate = 2.0 * stress * boundary_area_change_work_fraction[phase_index] * dislocation_strain_rate * std::pow(grain_size,2)
+                                      / (geometric_constant[phase_index] * grain_boundary_energy[phase_index]);
+        }
+      else
+        {
+          // paleopiezometer: Hall and Parmentier (2003): Influence of grain size evolution on convective instability. Geochem. Geophys. Geosyst., 4(3).
+          grain_size_reduction_rate = reciprocal_required_strain[phase_index] * dislocation_strain_rate * grain_size;
+        }
+
+      return grain_size_growth_rate - grain_size_reduction_rate;
+    }
+
+
+
+    template <int dim>
+    void
+    GrainSize<dim>::
+    grain_size_changes (const typename Interface<dim>::MaterialModelInputs &in,
+                        const std::vector<double> &pressures,
+                        const std::vector<double> &grain_sizes,
+                        const std::vector<int> &crossed_transitions,
+                        const unsigned int field_index,
+                        std::vector<double> &changes) const
+    {
+      const unsigned int n_points = in.position.size();
+      const double timestep = this->get_timestep();
+
+      changes.assign(n_points, 0.0);
+      if (timestep == 0.0)
+        return;
+
+      // Set up the quantities that do not change during the time step,
+      // so that the substeps only need to evaluate power laws. The
+      // diffusion and dislocation viscosities are computed once at the
+      // initial grain size and the full strain rate.
+      std::vector<GrainSizeEvolutionPoint> points(n_points);
+      std::vector<double> grain_size(n_points);
+      std::vector<double> time(n_points, 0.0);
+      std::vector<double> substep(n_points, 500 * 3600 * 24 * 365.25);
+      std::vector<double> rate(n_points);
+      std::vector<bool> active(n_points, false);
+      std::vector<double> composition(this->n_compositional_fields(), 0.0);
+      const unsigned int grain_size_index = this->introspection().compositional_index_for_name("grain_size");
+
+      unsigned int n_substeps = 0;
+      unsigned int n_dislocation_iterations = 0;
+      unsigned int n_active = 0;
+      for (unsigned int q=0; q<n_points; ++q)
+        {
+          grain_size[q] = grain_sizes[q];
+          if ((grain_sizes[q] != grain_sizes[q])
+              || grain_sizes[q] < std::numeric_limits<double>::min())
+            continue;
+
+          GrainSizeEvolutionPoint &point = points[q];
+          const double temperature = in.temperature[q];
+          const double pressure = pressures[q];
+          point.phase_index = get_phase_index(in.position[q], temperature, pressure);
+
+          const unsigned int phase_index = point.phase_index;
+          point.growth_prefactor = grain_growth_rate_constant[phase_index] / grain_growth_exponent[phase_index]
+                                   * std::exp(- (grain_growth_activation_energy[phase_index] + pressure * grain_growth_activation_volume[phase_index])
+                                              / (constants::gas_constant * temperature));
+
+          const SymmetricTensor<2,dim> shear_strain_rate = in.strain_rate[q] - 1./dim * trace(in.strain_rate[q]) * unit_symmetric_tensor<dim>();
+          point.second_strain_rate_invariant = std::sqrt(std::abs(second_invariant(shear_strain_rate)));
+
+          if (std::abs(point.second_strain_rate_invariant) > 1e-30)
+            {
+              composition[grain_size_index] = grain_sizes[q];
+              point.reference_grain_size = grain_sizes[q];
+              point.reference_diffusion_viscosity = diffusion_viscosity(temperature, pressure, composition,
+                                                                        in.strain_rate[q], in.position[q]);
+              point.diffusion_grain_size_exponent = diffusion_creep_grain_size_exponent[phase_index]
+                                                    / diffusion_creep_exponent[phase_index];
+              point.full_strain_rate_dislocation_viscosity = dislocation_viscosity_fixed_strain_rate(temperature, pressure,
+                                                             std::vector<double>(),
+                                                             in.strain_rate[q], in.position[q]);
+              point.dislocation_strain_rate_exponent = (1.0 - dislocation_creep_exponent[phase_index])
+                                                       / dislocation_creep_exponent[phase_index];
+              point.dislocation_viscosity = point.full_strain_rate_dislocation_viscosity;
+            }
+
+          rate[q] = grain_size_evolution_rate(point, grain_size[q], n_dislocation_iterations);
+          active[q] = true;
+          ++n_active;
+        }
+
+      // Integrate with the embedded Runge-Kutta pair of Bogacki and Shampine
+      // (third order with a second order error estimate). The rate at the
+      // end of an accepted substep is the first stage of the next one.
+      // In each sweep every point that has not yet reached the end of the
+      // time step takes one substep.
+      while (n_active > 0)
+        {
+          for (unsigned int q=0; q<n_points; ++q)
+            {
+              if (!active[q])
+                continue;
+
+              GrainSizeEvolutionPoint &point = points[q];
+              const double h = std::min(substep[q], timestep - time[q]);
+              const double d = grain_size[q];
+              const double k1 = rate[q];
+
+              // remember the dislocation viscosity in case the substep is rejected
+              const double dislocation_viscosity_guess = point.dislocation_viscosity;
+
+              bool valid_substep = (d + 0.5 * h * k1 > 0);
+              double k2 = 0.0, k3 = 0.0, k4 = 0.0, new_grain_size = 0.0;
+              if (valid_substep)
+                {
+                  k2 = grain_size_evolution_rate(point, d + 0.5 * h * k1, n_dislocation_iterations);
+                  valid_substep = (d + 0.75 * h * k2 > 0);
+                }
+              if (valid_substep)
+                {
+                  k3 = grain_size_evolution_rate(point, d + 0.75 * h * k2, n_dislocation_iterations);
+                  new_grain_size = d + h * (2./9. * k1 + 1./3. * k2 + 4./9. * k3);
+                  valid_substep = (new_grain_size > 0) && numbers::is_finite(new_grain_size);
+                }
+
+              double error_ratio = std::numeric_limits<double>::max();
+              if (valid_substep)
+                {
+                  k4 = grain_size_evolution_rate(point, new_grain_size, n_dislocation_iterations);
+                  const double error = h * (-5./72. * k1 + 1./12. * k2 + 1./9. * k3 - 1./8. * k4);
+                  error_ratio = std::abs(error) / (grain_size_evolution_tolerance * std::max(d, new_grain_size));
+                }
+              ++n_substeps;
+
+              if (error_ratio <= 1.0)
+                {
+                  time[q] = (h < timestep - time[q] ? time[q] + h : timestep);
+                  grain_size[q] = new_grain_size;
+                  rate[q] = k4;
+                  if (time[q] >= timestep)
+                    {
+                      active[q] = false;
+                      --n_active;
+                    }
+                }
+              else
+                point.dislocation_viscosity = dislocation_viscosity_guess;
+
+              // choose the next substep size from the error estimate, but
+              // change it by at most a factor of five
+              if (error_ratio == std::numeric_limits<double>::max())
+                substep[q] = 0.25 * h;
+              else if (error_ratio == 0.0)
+                substep[q] = 5.0 * h;
+              else
+                substep[q] = h * std::min(5.0, std::max(0.2, 0.9 * std::pow(error_ratio, -1./3.)));
+
+              // a substep that is zero or too small to change the time
+              // would be accepted without making progress
+              AssertThrow(!active[q] || time[q] + substep[q] > time[q],
+                          ExcMessage("The grain size substep became too small to advance "
+                                     "the integration of the grain size evolution. This is "
+                                     "likely an effect of unrealistic input parameters."));
+            }
+        }
+
+      for (unsigned int q=0; q<n_points; ++q)
+        {
+          if ((grain_sizes[q] != grain_sizes[q])
+              || grain_sizes[q] < std::numeric_limits<double>::min())
+            continue;
+
+          // reduce grain size to recrystallized_grain_size when crossing phase transitions,
+          // in the same way as in grain_size_change()
+          double phase_grain_size_reduction = 0.0;
+          if (this->introspection().name_for_compositional_index(field_index) == "grain_size"
+              &&
+              this->get_timestep_number() > 0)
+            {
+              if (crossed_transitions[q] != -1)
+                if (recrystallized_grain_size[crossed_transitions[q]] > 0.0)
+                  phase_grain_size_reduction = grain_size[q] - recrystallized_grain_size[crossed_transitions[q]];
+            }
+
+          changes[q] = std::max(grain_size[q], minimum_grain_size) - grain_sizes[q] - phase_grain_size_reduction;
+        }
+
+      Threads::Mutex::ScopedLock lock(grain_size_statistics_mutex);
+      n_grain_size_substeps += n_substeps;
+      n_dislocation_viscosity_iterations += n_dislocation_iterations;
+    }
+
+
+
     template <int dim>
     double
     GrainSize<dim>::
@@ -1232,6 +1559,25 @@ namespace aspect
 
 
 
+    template <int dim>
+    double
+    GrainSize<dim>::
+    average_lookup_property (const std::vector<std::vector<Lookup::MaterialLookupValues> > &lookup_values,
+                             const unsigned int q,
+                             double Lookup::MaterialLookupValues::*property,
+                             const std::vector<double> &compositional_fields) const
+    {
+      if (n_material_data == 1)
+        return lookup_values[0][q].*property;
+
+      double value = 0.0;
+      for (unsigned i = 0; i < n_material_data; i++)
+        value += compositional_fields[i] * lookup_values[i][q].*property;
+      return value;
+    }
+
+
+
     template <int dim>
     std::array<std::pair<double, unsigned int>,2>
     GrainSize<dim>::
@@ -1280,17 +1626,60 @@ namespace aspect
     GrainSize<dim>::
     evaluate(const typename Interface<dim>::MaterialModelInputs &in, typename Interface<dim>::MaterialModelOutputs &out) const
     {
+      // the compositions at the current point, once as given and once with
+      // the grain size converted to its actual value; kept outside the loop
+      // so that they are only allocated once
+      std::vector<double> input_composition;
+      std::vector<double> composition;
+
+      // the thermal expansion coefficient and specific heat computed below
+      // depend on the cell average of the density
+      const bool compute_thermal_properties = out.requests_property(MaterialProperties::thermal_expansion_coefficient)
+                                              || out.requests_property(MaterialProperties::specific_heat);
+      const bool compute_density = out.requests_property(MaterialProperties::density)
+                                   || compute_thermal_properties;
+      const bool compute_viscosity = out.requests_property(MaterialProperties::viscosity)
+                                     || out.template get_additional_output<DislocationViscosityOutputs<dim> >() != NULL;
+
+      // Use the adiabatic pressure instead of the real one, because of oscillations
+      std::vector<double> pressures (in.position.size());
+      for (unsigned int i=0; i<in.position.size(); ++i)
+        pressures[i] = (this->get_adiabatic_conditions().is_initialized())
+                       ?
+                       this->get_adiabatic_conditions().pressure(in.position[i])
+                       :
+                       in.pressure[i];
+
+      // Look up all properties from the material tables for all points at
+      // once, instead of once per property and point
+      std::vector<std::vector<Lookup::MaterialLookupValues> > lookup_values (n_material_data);
+      if (use_table_properties
+          && (compute_density || out.requests_property(MaterialProperties::compressibility)))
+        for (unsigned int j=0; j<n_material_data; ++j)
+          material_lookup[j]->evaluate_all(in.temperature, pressures, lookup_values[j]);
+
+      // If the grain size evolution is integrated with the adaptive scheme,
+      // collect the grain sizes of all points and integrate them together
+      // after the loop below.
+      const bool integrate_grain_sizes_together = (grain_size_evolution_scheme == adaptive_runge_kutta)
+                                                  && in.strain_rate.size() > 0
+                                                  && out.requests_property(MaterialProperties::reaction_terms);
+      std::vector<double> grain_sizes;
+      std::vector<int> crossed_transitions;
+      if (integrate_grain_sizes_together)
+        {
+          grain_sizes.resize(in.position.size());
+          crossed_transitions.resize(in.position.size());
+        }
+
       for (unsigned int i=0; i<in.position.size(); ++i)
         {
-          // Use the adiabatic pressure instead of the real one, because of oscillations
-          const double pressure = (this->get_adiabatic_conditions().is_initialized())
-                                  ?
-                                  this->get_adiabatic_conditions().pressure(in.position[i])
-                                  :
-                                  in.pressure[i];
+          const double pressure = pressures[i];
+
+          in.composition[i].copy_to(input_composition);
 
           // convert the grain size from log to normal
-          std::vector<double> composition (in.composition[i]);
+          composition = input_composition;
           if (advect_log_grainsize)
             convert_log_grain_size(composition);
           else
@@ -1311,43 +1700,47 @@ namespace aspect
           // be -1 if we crossed no transition, or the number of the transition, if we crossed it.
           // If the adiabatic profile is not yet available, use the default position of the
           // transition and do not worry about pressure deviations.
-          if (this->get_adiabatic_conditions().is_initialized())
-            for (unsigned int phase=0; phase<transition_depths.size(); ++phase)
-              {
-                // first, get the pressure at which the phase transition occurs normally
-                const Point<dim,double> transition_point = this->get_geometry_model().representative_point(transition_depths[phase]);
-                const Point<dim,double> transition_plus_width = this->get_geometry_model().representative_point(transition_depths[phase] + transition_widths[phase]);
-                const Point<dim,double> transition_minus_width = this->get_geometry_model().representative_point(transition_depths[phase] - transition_widths[phase]);
-                const double transition_pressure = this->get_adiabatic_conditions().pressure(transition_point);
-                const double pressure_width = 0.5 * (this->get_adiabatic_conditions().pressure(transition_plus_width)
-                                                     - this->get_adiabatic_conditions().pressure(transition_minus_width));
-
-
-                // then calculate the deviation from the transition point (both in temperature
-                // and in pressure)
-                double pressure_deviation = pressure - transition_pressure
-                                            - transition_slopes[phase] * (in.temperature[i] - transition_temperatures[phase]);
-
-                // If we are close to the the phase boundary (pressure difference
-                // is smaller than phase boundary width), and the velocity points
-                // away from the phase transition the material has crossed the transition.
-                if ((std::abs(pressure_deviation) < pressure_width)
-                    &&
-                    ((in.velocity[i] * this->get_gravity_model().gravity_vector(in.position[i])) * pressure_deviation > 0))
-                  crossed_transition = phase;
-              }
-          else
-            for (unsigned int j=0; j<in.position.size(); ++j)
-              for (unsigned int k=0; k<transition_depths.size(); ++k)
-                if ((phase_function(in.position[i], in.temperature[i], pressure, k)
-                     != phase_function(in.position[j], in.temperature[j], in.pressure[j], k))
-                    &&
-                    ((in.velocity[i] * this->get_gravity_model().gravity_vector(in.position[i]))
-                     * ((in.position[i] - in.position[j]) * this->get_gravity_model().gravity_vector(in.position[i])) > 0))
-                  crossed_transition = k;
+          // The crossed transition is only needed for the reaction terms.
+          if (out.requests_property(MaterialProperties::reaction_terms))
+            {
+              if (this->get_adiabatic_conditions().is_initialized())
+                for (unsigned int phase=0; phase<transition_depths.size(); ++phase)
+                  {
+                    // first, get the pressure at which the phase transition occurs normally
+                    const Point<dim,double> transition_point = this->get_geometry_model().representative_point(transition_depths[phase]);
+                    const Point<dim,double> transition_plus_width = this->get_geometry_model().representative_point(transition_depths[phase] + transition_widths[phase]);
+                    const Point<dim,double> transition_minus_width = this->get_geometry_model().representative_point(transition_depths[phase] - transition_widths[phase]);
+                    const double transition_pressure = this->get_adiabatic_conditions().pressure(transition_point);
+                    const double pressure_width = 0.5 * (this->get_adiabatic_conditions().pressure(transition_plus_width)
+                                                         - this->get_adiabatic_conditions().pressure(transition_minus_width));
+
+
+                    // then calculate the deviation from the transition point (both in temperature
+                    // and in pressure)
+                    double pressure_deviation = pressure - transition_pressure
+                                                - transition_slopes[phase] * (in.temperature[i] - transition_temperatures[phase]);
+
+                    // If we are close to the the phase boundary (pressure difference
+                    // is smaller than phase boundary width), and the velocity points
+                    // away from the phase transition the material has crossed the transition.
+                    if ((std::abs(pressure_deviation) < pressure_width)
+                        &&
+                        ((in.velocity[i] * this->get_gravity_model().gravity_vector(in.position[i])) * pressure_deviation > 0))
+                      crossed_transition = phase;
+                  }
+              else
+                for (unsigned int j=0; j<in.position.size(); ++j)
+                  for (unsigned int k=0; k<transition_depths.size(); ++k)
+                    if ((phase_function(in.position[i], in.temperature[i], pressure, k)
+                         != phase_function(in.position[j], in.temperature[j], in.pressure[j], k))
+                        &&
+                        ((in.velocity[i] * this->get_gravity_model().gravity_vector(in.position[i]))
+                         * ((in.position[i] - in.position[j]) * this->get_gravity_model().gravity_vector(in.position[i])) > 0))
+                      crossed_transition = k;
+            }
 
 
-          if (in.strain_rate.size() > 0)
+          if (in.strain_rate.size() > 0 && compute_viscosity)
             {
               double effective_viscosity;
               double disl_viscosity = std::numeric_limits<double>::max();
@@ -1371,19 +1764,38 @@ namespace aspect
                 disl_viscosities_out->dislocation_viscosities[i] = std::min(std::max(min_eta,disl_viscosity),1e300);
             }
 
-          out.densities[i] = density(in.temperature[i], pressure, in.composition[i], in.position[i]);
+          if (compute_density)
+            out.densities[i] = (use_table_properties
+                                ?
+                                average_lookup_property(lookup_values, i, &Lookup::MaterialLookupValues::density, input_composition)
+                                :
+                                density(in.temperature[i], pressure, input_composition, in.position[i]));
           out.thermal_conductivities[i] = k_value;
-          out.compressibilities[i] = compressibility(in.temperature[i], pressure, composition, in.position[i]);
+          if (out.requests_property(MaterialProperties::compressibility))
+            out.compressibilities[i] = (use_table_properties
+                                        ?
+                                        average_lookup_property(lookup_values, i, &Lookup::MaterialLookupValues::dRhodp, composition)
+                                        / average_lookup_property(lookup_values, i, &Lookup::MaterialLookupValues::density, composition)
+                                        :
+                                        compressibility(in.temperature[i], pressure, composition, in.position[i]));
 
           if (DislocationViscosityOutputs<dim> *disl_viscosities_out = out.template get_additional_output<DislocationViscosityOutputs<dim> >())
             disl_viscosities_out->boundary_area_change_work_fractions[i] =
               boundary_area_change_work_fraction[get_phase_index(in.position[i],in.temperature[i],pressure)];
 
-          if (in.strain_rate.size() > 0)
+          if (in.strain_rate.size() > 0 && out.requests_property(MaterialProperties::reaction_terms))
             for (unsigned int c=0; c<composition.size(); ++c)
               {
                 if (this->introspection().name_for_compositional_index(c) == "grain_size")
                   {
+                    if (integrate_grain_sizes_together)
+                      {
+                        // the reaction term is set after the loop over all points
+                        grain_sizes[i] = composition[c];
+                        crossed_transitions[i] = crossed_transition;
+                        continue;
+                      }
+
                     out.reaction_terms[i][c] = grain_size_change(in.temperature[i], pressure, composition,
                                                                  in.strain_rate[i], in.velocity[i], in.position[i], c, crossed_transition);
                     if (advect_log_grainsize)
@@ -1397,15 +1809,32 @@ namespace aspect
           if (use_table_properties)
             if (SeismicAdditionalOutputs<dim> *seismic_out = out.template get_additional_output<SeismicAdditionalOutputs<dim> >())
               {
-                seismic_out->vp[i] = seismic_Vp(in.temperature[i], in.pressure[i], in.composition[i], in.position[i]);
-                seismic_out->vs[i] = seismic_Vs(in.temperature[i], in.pressure[i], in.composition[i], in.position[i]);
+                seismic_out->vp[i] = seismic_Vp(in.temperature[i], in.pressure[i], input_composition, in.position[i]);
+                seismic_out->vs[i] = seismic_Vs(in.temperature[i], in.pressure[i], input_composition, in.position[i]);
               }
         }
 
+      if (integrate_grain_sizes_together)
+        {
+          const unsigned int grain_size_index = this->introspection().compositional_index_for_name("grain_size");
+          std::vector<double> changes;
+          grain_size_changes(in, pressures, grain_sizes, crossed_transitions, grain_size_index, changes);
+
+          for (unsigned int i=0; i<in.position.size(); ++i)
+            out.reaction_terms[i][grain_size_index] = (advect_log_grainsize
+                                                       ?
+                                                       - changes[i] / grain_sizes[i]
+                                                       :
+                                                       changes[i]);
+        }
+
       /* We separate the calculation of specific heat and thermal expansivity,
        * because they depend on cell-wise averaged values that are only available
        * here
        */
+      if (!compute_thermal_properties)
+        return;
+
       double average_temperature(0.0);
       double average_density(0.0);
       for (unsigned int i = 0; i < in.position.size(); ++i)
@@ -1423,13 +1852,6 @@ namespace aspect
 
       for (unsigned int i = 0; i < in.position.size(); ++i)
         {
-          //Use the adiabatic pressure instead of the real one, because of oscillations
-          const double pressure = (this->get_adiabatic_conditions().is_initialized())
-                                  ?
-                                  this->get_adiabatic_conditions().pressure(in.position[i])
-                                  :
-                                  in.pressure[i];
-
           if (!use_table_properties)
             {
               out.thermal_expansion_coefficients[i] = thermal_alpha;
@@ -1449,8 +1871,8 @@ namespace aspect
                 {
                   if (material_lookup.size() == 1)
                     {
-                      out.thermal_expansion_coefficients[i] = (1 - out.densities[i] * material_lookup[0]->dHdp(in.temperature[i],pressure)) / in.temperature[i];
-                      out.specific_heat[i] = material_lookup[0]->dHdT(in.temperature[i],pressure);
+                      out.thermal_expansion_coefficients[i] = (1 - out.densities[i] * lookup_values[0][i].dHdp) / in.temperature[i];
+                      out.specific_heat[i] = lookup_values[0][i].dHdT;
                     }
                   else
                     {
@@ -1460,8 +1882,10 @@ namespace aspect
             }
           else
             {
-              out.thermal_expansion_coefficients[i] = thermal_expansion_coefficient(in.temperature[i], pressure, in.composition[i], in.position[i]);
-              out.specific_heat[i] = specific_heat(in.temperature[i], pressure, in.composition[i], in.position[i]);
+              // the values are limited to their bounds below
+              in.composition[i].copy_to(input_composition);
+              out.thermal_expansion_coefficients[i] = average_lookup_property(lookup_values, i, &Lookup::MaterialLookupValues::thermal_expansivity, input_composition);
+              out.specific_heat[i] = average_lookup_property(lookup_values, i, &Lookup::MaterialLookupValues::specific_heat, input_composition);
             }
 
           out.thermal_expansion_coefficients[i] = std::max(std::min(out.thermal_expansion_coefficients[i],max_thermal_expansivity),min_thermal_expansivity);
@@ -1602,6 +2026,29 @@ namespace aspect
                              "dislocation strain rate, which depends on the dislocation "
                              "viscosity itself. This number determines the maximum "
                              "number of iterations that are performed. ");
+          prm.declare_entry ("Grain size evolution scheme", "fixed substeps",
+                             Patterns::Selection ("fixed substeps|adaptive Runge-Kutta"),
+                             "The scheme that is used to integrate the grain size evolution "
+                             "over one time step. 'fixed substeps' starts with substeps of "
+                             "500 years and doubles or halves them depending on how much "
+                             "the grain size changes within a substep. 'adaptive Runge-Kutta' "
+                             "uses the embedded Runge-Kutta pair of Bogacki and Shampine, "
+                             "and chooses the substeps such that the estimated error of "
+                             "each substep is below the 'Grain size evolution tolerance'. "
+                             "It integrates all points of a cell together with common "
+                             "substeps, but evaluates the growth and reduction rates one "
+                             "point after the other, i.e., the evaluation is not vectorized. "
+                             "The number of substeps and dislocation viscosity iterations "
+                             "of all material model evaluations of a time step are written "
+                             "to the statistics file at the beginning of the next time step, "
+                             "so the counts of the final time step are not written.");
+          prm.declare_entry ("Grain size evolution tolerance", "1e-4",
+                             Patterns::Double (0),
+                             "The tolerance for the estimated error of a substep relative "
+                             "to the grain size, if the 'adaptive Runge-Kutta' scheme is "
+                             "used to integrate the grain size evolution. Needs to be "
+                             "positive. "
+                             "Units: none.");
           prm.declare_entry ("Dislocation creep exponent", "3.5",
                              Patterns::List (Patterns::Double(0)),
                              "The power-law exponent $n_{dis}$ for dislocation creep. "
@@ -1814,6 +2261,15 @@ namespace aspect
           // rheology parameters
           dislocation_viscosity_iteration_threshold = prm.get_double("Dislocation viscosity iteration threshold");
           dislocation_viscosity_iteration_number = prm.get_integer("Dislocation viscosity iteration number");
+          if (prm.get ("Grain size evolution scheme") == "fixed substeps")
+            grain_size_evolution_scheme = fixed_substeps;
+          else if (prm.get ("Grain size evolution scheme") == "adaptive Runge-Kutta")
+            grain_size_evolution_scheme = adaptive_runge_kutta;
+          else
+            AssertThrow (false, ExcNotImplemented());
+          grain_size_evolution_tolerance = prm.get_double("Grain size evolution tolerance");
+          AssertThrow (grain_size_evolution_tolerance > 0,
+                       ExcMessage ("The 'Grain size evolution tolerance' needs to be positive."));
           dislocation_creep_exponent            = Utilities::string_to_double
                                                   (Utilities::split_string_list(prm.get ("Dislocation creep exponent")));
           dislocation_activation_energy         = Utilities::string_to_double
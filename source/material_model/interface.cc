@@ -67,6 +67,31 @@ namespace aspect
 
 
 
+    CompositionTable::CompositionTable (const unsigned int n_points,
+                                        const unsigned int n_fields,
+                                        const double       value)
+      :
+      n_table_points (0),
+      n_table_fields (0)
+    {
+      reinit (n_points, n_fields, value);
+    }
+
+
+
+    void
+    CompositionTable::reinit (const unsigned int n_points,
+                              const unsigned int n_fields,
+                              const double       value)
+    {
+      n_table_points = n_points;
+      n_table_fields = n_fields;
+      values.resize (n_points * n_fields);
+      values.fill (value);
+    }
+
+
+
     std::vector<double>
     compute_volume_fractions(const std::vector<double> &compositional_fields,
                              const ComponentMask &field_mask)
@@ -301,7 +326,7 @@ namespace aspect
       pressure(n_points, numbers::signaling_nan<double>()),
       pressure_gradient(n_points, numbers::signaling_nan<Tensor<1,dim> >()),
       velocity(n_points, numbers::signaling_nan<Tensor<1,dim> >()),
-      composition(n_points, std::vector<double>(n_comp, numbers::signaling_nan<double>())),
+      composition(n_points, n_comp, numbers::signaling_nan<double>()),
       strain_rate(n_points, numbers::signaling_nan<SymmetricTensor<2,dim> >()),
       cell (NULL),
       current_cell()
@@ -317,7 +342,7 @@ namespace aspect
       pressure(input_data.solution_values.size(), numbers::signaling_nan<double>()),
       pressure_gradient(input_data.solution_values.size(), numbers::signaling_nan<Tensor<1,dim> >()),
       velocity(input_data.solution_values.size(), numbers::signaling_nan<Tensor<1,dim> >()),
-      composition(input_data.solution_values.size(), std::vector<double>(introspection.n_compositional_fields, numbers::signaling_nan<double>())),
+      composition(input_data.solution_values.size(), introspection.n_compositional_fields, numbers::signaling_nan<double>()),
       strain_rate(input_data.solution_values.size(), numbers::signaling_nan<SymmetricTensor<2,dim> >()),
       cell(&current_cell),
       current_cell(input_data.template get_cell<DoFHandler<dim> >())
@@ -357,7 +382,7 @@ namespace aspect
       pressure(fe_values.n_quadrature_points, numbers::signaling_nan<double>()),
       pressure_gradient(fe_values.n_quadrature_points, numbers::signaling_nan<Tensor<1,dim> >()),
       velocity(fe_values.n_quadrature_points, numbers::signaling_nan<Tensor<1,dim> >()),
-      composition(fe_values.n_quadrature_points, std::vector<double>(introspection.n_compositional_fields, numbers::signaling_nan<double>())),
+      composition(fe_values.n_quadrature_points, introspection.n_compositional_fields, numbers::signaling_nan<double>()),
       strain_rate(fe_values.n_quadrature_points, numbers::signaling_nan<SymmetricTensor<2,dim> >()),
       cell(cell_x.state() == IteratorState::valid ? &current_cell : NULL),
 #if DEAL_II_VERSION_GTE(9,0,0)
@@ -404,19 +429,17 @@ namespace aspect
       else
         this->strain_rate.resize(0);
 
-      // Vectors for evaluating the compositional field parts of the finite element solution
-      std::vector<std::vector<double> > composition_values (introspection.n_compositional_fields, std::vector<double> (fe_values.n_quadrature_points));
+      // Evaluate the compositional fields one after the other and copy
+      // them into the contiguous storage of each field
+      std::vector<double> composition_values (fe_values.n_quadrature_points);
       for (unsigned int c=0; c<introspection.n_compositional_fields; ++c)
         {
-          fe_values[introspection.extractors.compositional_fields[c]].get_function_values(solution_vector,composition_values[c]);
+          fe_values[introspection.extractors.compositional_fields[c]].get_function_values(solution_vector,composition_values);
+          std::copy (composition_values.begin(), composition_values.end(), this->composition.field_data(c));
         }
 
       for (unsigned int i=0; i<fe_values.n_quadrature_points; ++i)
-        {
-          this->position[i] = fe_values.quadrature_point(i);
-          for (unsigned int c=0; c<introspection.n_compositional_fields; ++c)
-            this->composition[i][c] = composition_values[c][i];
-        }
+        this->position[i] = fe_values.quadrature_point(i);
 
       DEAL_II_DISABLE_EXTRA_DIAGNOSTICS
       this->cell = cell_x.state() == IteratorState::valid ? &cell_x : NULL;
@@ -442,7 +465,8 @@ namespace aspect
       compressibilities(n_points, numbers::signaling_nan<double>()),
       entropy_derivative_pressure(n_points, numbers::signaling_nan<double>()),
       entropy_derivative_temperature(n_points, numbers::signaling_nan<double>()),
-      reaction_terms(n_points, std::vector<double>(n_comp, numbers::signaling_nan<double>()))
+      reaction_terms(n_points, n_comp, numbers::signaling_nan<double>()),
+      requested_properties(MaterialProperties::all_properties)
     {}
 
 
@@ -746,21 +770,31 @@ namespace aspect
                                        expansion_matrix);
           }
 
-        average_property (operation, projection_matrix, expansion_matrix, values_out.viscosities);
-        average_property (operation, projection_matrix, expansion_matrix,
-                          values_out.densities);
-        average_property (operation, projection_matrix, expansion_matrix,
-                          values_out.thermal_expansion_coefficients);
-        average_property (operation, projection_matrix, expansion_matrix,
-                          values_out.specific_heat);
-        average_property (operation, projection_matrix, expansion_matrix,
-                          values_out.thermal_conductivities);
-        average_property (operation, projection_matrix, expansion_matrix,
-                          values_out.compressibilities);
-        average_property (operation, projection_matrix, expansion_matrix,
-                          values_out.entropy_derivative_pressure);
-        average_property (operation, projection_matrix, expansion_matrix,
-                          values_out.entropy_derivative_temperature);
+        // only average the properties the material model was asked to
+        // compute; the others may not hold valid numbers
+        if (values_out.requests_property (MaterialProperties::viscosity))
+          average_property (operation, projection_matrix, expansion_matrix, values_out.viscosities);
+        if (values_out.requests_property (MaterialProperties::density))
+          average_property (operation, projection_matrix, expansion_matrix,
+                            values_out.densities);
+        if (values_out.requests_property (MaterialProperties::thermal_expansion_coefficient))
+          average_property (operation, projection_matrix, expansion_matrix,
+                            values_out.thermal_expansion_coefficients);
+        if (values_out.requests_property (MaterialProperties::specific_heat))
+          average_property (operation, projection_matrix, expansion_matrix,
+                            values_out.specific_heat);
+        if (values_out.requests_property (MaterialProperties::thermal_conductivity))
+          average_property (operation, projection_matrix, expansion_matrix,
+                            values_out.thermal_conductivities);
+        if (values_out.requests_property (MaterialProperties::compressibility))
+          average_property (operation, projection_matrix, expansion_matrix,
+                            values_out.compressibilities);
+        if (values_out.requests_property (MaterialProperties::entropy_derivative_pressure))
+          average_property (operation, projection_matrix, expansion_matrix,
+                            values_out.entropy_derivative_pressure);
+        if (values_out.requests_property (MaterialProperties::entropy_derivative_temperature))
+          average_property (operation, projection_matrix, expansion_matrix,
+                            values_out.entropy_derivative_temperature);
 
         // the reaction terms are unfortunately stored in reverse
         // indexing. it's also not quite clear whether these should
@@ -145,11 +145,13 @@ namespace aspect
     evaluate(const MaterialModelInputs<dim> &in,
              MaterialModelOutputs<dim> &out) const
     {
+      const bool compute_viscosity = out.requests_property(MaterialProperties::viscosity);
+
       for (unsigned int i=0; i < in.position.size(); ++i)
         {
           const double temperature = in.temperature[i];
           const double pressure = in.pressure[i];
-          const std::vector<double> composition = in.composition[i];
+          const StridedArrayView<const double> composition = in.composition[i];
           const Point<dim> position = in.position[i];
 
           // Assign constant material properties
@@ -161,23 +163,24 @@ namespace aspect
           }
 
           // Calculate Viscosity
-          {
-            const double delta_temp = temperature-reference_T;
-            double visc_temperature_dependence = std::max(std::min(std::exp(-thermal_viscosity_exponent*delta_temp/reference_T),1e2),1e-2);
+          if (compute_viscosity)
+            {
+              const double delta_temp = temperature-reference_T;
+              double visc_temperature_dependence = std::max(std::min(std::exp(-thermal_viscosity_exponent*delta_temp/reference_T),1e2),1e-2);
 
-            if (std::isnan(visc_temperature_dependence))
-              visc_temperature_dependence = 1.0;
+              if (std::isnan(visc_temperature_dependence))
+                visc_temperature_dependence = 1.0;
 
-            double visc_composition_dependence = 1.0;
-            if ((composition_viscosity_prefactor != 1.0) && (composition.size() > 0))
-              {
-                // geometric interpolation
-                out.viscosities[i] = (pow(10, ((1-composition[0]) * log10(eta*visc_temperature_dependence)
-                                               + composition[0] * log10(eta*composition_viscosity_prefactor*visc_temperature_dependence))));
-              }
-            else
-              out.viscosities[i] = visc_composition_dependence * visc_temperature_dependence * eta;
-          }
+              double visc_composition_dependence = 1.0;
+              if ((composition_viscosity_prefactor != 1.0) && (composition.size() > 0))
+                {
+                  // geometric interpolation
+                  out.viscosities[i] = (pow(10, ((1-composition[0]) * log10(eta*visc_temperature_dependence)
+                                                 + composition[0] * log10(eta*composition_viscosity_prefactor*visc_temperature_dependence))));
+                }
+              else
+                out.viscosities[i] = visc_composition_dependence * visc_temperature_dependence * eta;
+            }
 
           // Calculate density
           // and phase dependence of viscosity
@@ -259,52 +262,55 @@ namespace aspect
             // in the end, all the influences are added up
             out.densities[i] = (reference_rho + density_composition_dependence + pressure_dependence + phase_dependence)
                                * density_temperature_dependence;
-            out.viscosities[i] = std::max(min_viscosity, std::min(max_viscosity, out.viscosities[i] * viscosity_phase_dependence));
+            if (compute_viscosity)
+              out.viscosities[i] = std::max(min_viscosity, std::min(max_viscosity, out.viscosities[i] * viscosity_phase_dependence));
           }
 
           // Calculate entropy derivative
-          {
-            double entropy_gradient_pressure = 0.0;
-            double entropy_gradient_temperature = 0.0;
-            const double rho = out.densities[i];
-            unsigned int number_of_phase_transitions;
+          if (out.requests_property(MaterialProperties::entropy_derivative_pressure)
+              || out.requests_property(MaterialProperties::entropy_derivative_temperature))
+            {
+              double entropy_gradient_pressure = 0.0;
+              double entropy_gradient_temperature = 0.0;
+              const double rho = out.densities[i];
+              unsigned int number_of_phase_transitions;
 
-            // transition defined by depth
-            if (use_depth)
-              number_of_phase_transitions= transition_depths.size();
-            // transition defined by pressure
-            else
-              number_of_phase_transitions= transition_pressures.size();
+              // transition defined by depth
+              if (use_depth)
+                number_of_phase_transitions= transition_depths.size();
+              // transition defined by pressure
+              else
+                number_of_phase_transitions= transition_pressures.size();
 
 
-            if (this->get_adiabatic_conditions().is_initialized() && this->include_latent_heat())
-              for (unsigned int phase=0; phase<number_of_phase_transitions; ++phase)
-                {
-                  // calculate derivative of the phase function
-                  const double PhaseFunctionDerivative = phase_function_derivative(position,
-                                                                                   temperature,
-                                                                                   pressure,
-                                                                                   phase);
-
-                  // calculate the change of entropy across the phase transition
-                  double entropy_change = 0.0;
-                  if (composition.size()==0)      // only one compositional field
-                    entropy_change = transition_slopes[phase] * density_jumps[phase] / (rho * rho);
-                  else
-                    {
-                      if (transition_phases[phase] == 0)     // 1st compositional field
-                        entropy_change = transition_slopes[phase] * density_jumps[phase] / (rho * rho) * (1.0 - composition[0]);
-                      else if (transition_phases[phase] == 1) // 2nd compositional field
-                        entropy_change = transition_slopes[phase] * density_jumps[phase] / (rho * rho) * composition[0];
-                    }
-                  // we need DeltaS * DX/Dpressure_deviation for the pressure derivative
-                  // and - DeltaS * DX/Dpressure_deviation * gamma for the temperature derivative
-                  entropy_gradient_pressure += PhaseFunctionDerivative * entropy_change;
-                  entropy_gradient_temperature -= PhaseFunctionDerivative * entropy_change * transition_slopes[phase];
-                }
-            out.entropy_derivative_pressure[i] = entropy_gradient_pressure;
-            out.entropy_derivative_temperature[i] = entropy_gradient_temperature;
-          }
+              if (this->get_adiabatic_conditions().is_initialized() && this->include_latent_heat())
+                for (unsigned int phase=0; phase<number_of_phase_transitions; ++phase)
+                  {
+                    // calculate derivative of the phase function
+                    const double PhaseFunctionDerivative = phase_function_derivative(position,
+                                                                                     temperature,
+                                                                                     pressure,
+                                                                                     phase);
+
+                    // calculate the change of entropy across the phase transition
+                    double entropy_change = 0.0;
+                    if (composition.size()==0)      // only one compositional field
+                      entropy_change = transition_slopes[phase] * density_jumps[phase] / (rho * rho);
+                    else
+                      {
+                        if (transition_phases[phase] == 0)     // 1st compositional field
+                          entropy_change = transition_slopes[phase] * density_jumps[phase] / (rho * rho) * (1.0 - composition[0]);
+                        else if (transition_phases[phase] == 1) // 2nd compositional field
+                          entropy_change = transition_slopes[phase] * density_jumps[phase] / (rho * rho) * composition[0];
+                      }
+                    // we need DeltaS * DX/Dpressure_deviation for the pressure derivative
+                    // and - DeltaS * DX/Dpressure_deviation * gamma for the temperature derivative
+                    entropy_gradient_pressure += PhaseFunctionDerivative * entropy_change;
+                    entropy_gradient_temperature -= PhaseFunctionDerivative * entropy_change * transition_slopes[phase];
+                  }
+              out.entropy_derivative_pressure[i] = entropy_gradient_pressure;
+              out.entropy_derivative_temperature[i] = entropy_gradient_temperature;
+            }
 
           // Assign reaction terms
           for (unsigned int c=0; c<in.composition[i].size(); ++c)
@@ -0,0 +1,157 @@
+/*
+  Copyright (C) 2018 by the authors of the ASPECT code.
+
+  This file is part of ASPECT.
+
+  ASPECT is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2, or (at your option)
+  any later version.
+
+  ASPECT is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with ASPECT; see the file LICENSE.  If not see
+  <http://www.gnu.org/licenses/>.
+*/
+
+#include <aspect/material_model/rheology_kernels.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace aspect
+{
+  namespace MaterialModel
+  {
+    namespace RheologyKernels
+    {
+      namespace
+      {
+        /**
+         * Return $m \log d$, with the convention that the grain size
+         * does not matter if the exponent is zero, even for $d=0$.
+         */
+        double
+        log_grain_size_dependence (const double grain_size_exponent,
+                                   const double grain_size)
+        {
+          return (grain_size_exponent != 0.
+                  ?
+                  grain_size_exponent * std::log(grain_size)
+                  :
+                  0.);
+        }
+      }
+
+
+
+      PowerLawCreep::PowerLawCreep (const double prefactor,
+                                    const double stress_exponent,
+                                    const double grain_size_exponent,
+                                    const double activation_energy,
+                                    const double activation_volume,
+                                    const double grain_size)
+        :
+        prefactor (prefactor),
+        stress_exponent (stress_exponent),
+        grain_size_exponent (grain_size_exponent),
+        activation_energy (activation_energy),
+        activation_volume (activation_volume),
+        grain_size (grain_size),
+        log_viscosity_prefactor (std::log(0.5)
+                                 + (log_grain_size_dependence(grain_size_exponent, grain_size)
+                                    - std::log(prefactor)) / stress_exponent),
+        strain_rate_exponent ((1. - stress_exponent) / stress_exponent),
+        log_strain_rate_prefactor (std::log(prefactor)
+                                   - log_grain_size_dependence(grain_size_exponent, grain_size))
+      {}
+
+
+
+      double
+      compute_viscosity (const PowerLawCreep &creep,
+                         const double         pressure,
+                         const double         temperature,
+                         const double         strain_rate)
+      {
+        const double n = creep.stress_exponent;
+        return 0.5 * std::pow(creep.prefactor, -1./n) *
+               std::pow(creep.grain_size, creep.grain_size_exponent/n) *
+               std::pow(strain_rate, (1. - n)/n) *
+               std::exp((creep.activation_energy + pressure*creep.activation_volume)/
+                        (n*constants::gas_constant*temperature));
+      }
+
+
+
+      void
+      compute_viscosities (const PowerLawCreep &creep,
+                           const unsigned int   n_points,
+                           const double        *pressures,
+                           const double        *temperatures,
+                           const double        *log_strain_rates,
+                           double              *viscosities)
+      {
+        const double log_prefactor = creep.log_viscosity_prefactor;
+        const double strain_rate_exponent = creep.strain_rate_exponent;
+        const double energy = creep.activation_energy;
+        const double volume = creep.activation_volume;
+        const double nR = creep.stress_exponent * constants::gas_constant;
+
+        // a strain rate exponent of zero (diffusion creep) must not
+        // multiply the logarithm of a zero strain rate
+        if (strain_rate_exponent == 0.)
+          {
+            DEAL_II_OPENMP_SIMD_PRAGMA
+            for (unsigned int q=0; q<n_points; ++q)
+              viscosities[q] = std::exp(log_prefactor
+                                        + (energy + pressures[q]*volume) / (nR*temperatures[q]));
+          }
+        else
+          {
+            DEAL_II_OPENMP_SIMD_PRAGMA
+            for (unsigned int q=0; q<n_points; ++q)
+              viscosities[q] = std::exp(log_prefactor
+                                        + strain_rate_exponent * log_strain_rates[q]
+                                        + (energy + pressures[q]*volume) / (nR*temperatures[q]));
+          }
+      }
+
+
+
+      double
+      compute_strain_rate_prefactor (const PowerLawCreep &creep,
+                                     const double         pressure,
+                                     const double         temperature)
+      {
+        return creep.prefactor *
+               std::pow(creep.grain_size, -creep.grain_size_exponent) *
+               std::exp(-(std::max(creep.activation_energy + pressure*creep.activation_volume,0.0))/
+                        (constants::gas_constant*temperature));
+      }
+
+
+
+      void
+      compute_strain_rate_prefactors (const PowerLawCreep &creep,
+                                      const unsigned int   n_points,
+                                      const double        *pressures,
+                                      const double        *temperatures,
+                                      double              *prefactors)
+      {
+        const double log_prefactor = creep.log_strain_rate_prefactor;
+        const double energy = creep.activation_energy;
+        const double volume = creep.activation_volume;
+
+        DEAL_II_OPENMP_SIMD_PRAGMA
+        for (unsigned int q=0; q<n_points; ++q)
+          prefactors[q] = std::exp(log_prefactor
+                                   - std::max(energy + pressures[q]*volume, 0.0) / (constants::gas_constant*temperatures[q]));
+      }
+    }
+  }
+}
@@ -466,20 +466,34 @@ namespace aspect
     Steinberger<dim>::evaluate(const MaterialModel::MaterialModelInputs<dim> &in,
                                MaterialModel::MaterialModelOutputs<dim> &out) const
     {
+      // Every property is a table lookup, so only compute the ones that
+      // were requested. With latent heat, the thermal expansion coefficient
+      // and the specific heat computed below also depend on the density.
+      const bool compute_thermal_properties = out.requests_property(MaterialProperties::thermal_expansion_coefficient)
+                                              || out.requests_property(MaterialProperties::specific_heat);
+      const bool compute_density = out.requests_property(MaterialProperties::density)
+                                   || (latent_heat && compute_thermal_properties);
+
+      std::vector<double> composition;
       for (unsigned int i=0; i < in.temperature.size(); ++i)
         {
+          in.composition[i].copy_to(composition);
+
           // We are only asked to give viscosities if strain_rate.size() > 0.
-          if (in.strain_rate.size() > 0)
-            out.viscosities[i]                  = viscosity                     (in.temperature[i], in.pressure[i], in.composition[i], in.strain_rate[i], in.position[i]);
+          if (in.strain_rate.size() > 0 && out.requests_property(MaterialProperties::viscosity))
+            out.viscosities[i]                  = viscosity                     (in.temperature[i], in.pressure[i], composition, in.strain_rate[i], in.position[i]);
 
-          out.densities[i]                      = density                       (in.temperature[i], in.pressure[i], in.composition[i], in.position[i]);
-          if (!latent_heat)
+          if (compute_density)
+            out.densities[i]                    = density                       (in.temperature[i], in.pressure[i], composition, in.position[i]);
+          if (!latent_heat && compute_thermal_properties)
             {
-              out.thermal_expansion_coefficients[i] = thermal_expansion_coefficient (in.temperature[i], in.pressure[i], in.composition[i], in.position[i]);
-              out.specific_heat[i]                  = specific_heat                 (in.temperature[i], in.pressure[i], in.composition[i], in.position[i]);
+              out.thermal_expansion_coefficients[i] = thermal_expansion_coefficient (in.temperature[i], in.pressure[i], composition, in.position[i]);
+              out.specific_heat[i]                  = specific_heat                 (in.temperature[i], in.pressure[i], composition, in.position[i]);
             }
-          out.thermal_conductivities[i]         = thermal_conductivity          (in.temperature[i], in.pressure[i], in.composition[i], in.position[i]);
-          out.compressibilities[i]              = compressibility               (in.temperature[i], in.pressure[i], in.composition[i], in.position[i]);
+          if (out.requests_property(MaterialProperties::thermal_conductivity))
+            out.thermal_conductivities[i]       = thermal_conductivity          (in.temperature[i], in.pressure[i], composition, in.position[i]);
+          if (out.requests_property(MaterialProperties::compressibility))
+            out.compressibilities[i]            = compressibility               (in.temperature[i], in.pressure[i], composition, in.position[i]);
           out.entropy_derivative_pressure[i]    = 0;
           out.entropy_derivative_temperature[i] = 0;
           for (unsigned int c=0; c<in.composition[i].size(); ++c)
@@ -488,12 +502,12 @@ namespace aspect
           // fill seismic velocities outputs if they exist
           if (SeismicAdditionalOutputs<dim> *seismic_out = out.template get_additional_output<SeismicAdditionalOutputs<dim> >())
             {
-              seismic_out->vp[i] = seismic_Vp(in.temperature[i], in.pressure[i], in.composition[i], in.position[i]);
-              seismic_out->vs[i] = seismic_Vs(in.temperature[i], in.pressure[i], in.composition[i], in.position[i]);
+              seismic_out->vp[i] = seismic_Vp(in.temperature[i], in.pressure[i], composition, in.position[i]);
+              seismic_out->vs[i] = seismic_Vs(in.temperature[i], in.pressure[i], composition, in.position[i]);
             }
         }
 
-      if (latent_heat)
+      if (latent_heat && compute_thermal_properties)
         {
           /* We separate the calculation of specific heat and thermal expansivity,
            * because they may depend on cell-wise averaged values that are only
@@ -22,6 +22,7 @@
 #include <aspect/utilities.h>
 #include <deal.II/fe/fe_values.h>
 #include <deal.II/base/signaling_nan.h>
+#include <deal.II/base/table.h>
 #include <aspect/newton.h>
 #include <aspect/adiabatic_conditions/interface.h>
 
@@ -124,6 +125,24 @@ namespace aspect
     }
 
 
+    template <int dim>
+    double
+    ViscoPlastic<dim>::
+    calculate_strain_rate_invariant ( const SymmetricTensor<2,dim> &strain_rate ) const
+    {
+      // Calculate the square root of the second moment invariant for the deviatoric strain rate tensor.
+      // The first time this function is called (first iteration of first time step)
+      // a specified "reference" strain rate is used as the returned value would
+      // otherwise be zero.
+      return ( (this->get_timestep_number() == 0 && strain_rate.norm() <= std::numeric_limits<double>::min())
+               ?
+               ref_strain_rate
+               :
+               std::max(std::sqrt(std::fabs(second_invariant(deviator(strain_rate)))),
+                        min_strain_rate) );
+    }
+
+
     template <int dim>
     std::pair<std::vector<double>, std::vector<double> >
     ViscoPlastic<dim>::
@@ -134,21 +153,44 @@ namespace aspect
                                       const SymmetricTensor<2,dim> &strain_rate,
                                       const ViscosityScheme &viscous_type,
                                       const YieldScheme &yield_type) const
+    {
+      const double edot_ii = calculate_strain_rate_invariant(strain_rate);
+      const double log_edot_ii = std::log(edot_ii);
+
+      // Evaluate the creep laws in the same way as evaluate() does for
+      // all points of a cell, so that finite difference derivatives
+      // computed with this function are consistent with the viscosity
+      std::vector<double> viscosities_diffusion(volume_fractions.size());
+      std::vector<double> viscosities_dislocation(volume_fractions.size());
+      for (unsigned int j=0; j < volume_fractions.size(); ++j)
+        {
+          RheologyKernels::compute_viscosities(diffusion_creep[j], 1, &pressure, &temperature,
+                                               &log_edot_ii, &viscosities_diffusion[j]);
+          RheologyKernels::compute_viscosities(dislocation_creep[j], 1, &pressure, &temperature,
+                                               &log_edot_ii, &viscosities_dislocation[j]);
+        }
+
+      return calculate_isostrain_viscosities(volume_fractions, pressure, edot_ii, composition,
+                                             viscosities_diffusion, viscosities_dislocation,
+                                             viscous_type, yield_type);
+    }
+
+
+    template <int dim>
+    std::pair<std::vector<double>, std::vector<double> >
+    ViscoPlastic<dim>::
+    calculate_isostrain_viscosities ( const std::vector<double> &volume_fractions,
+                                      const double pressure,
+                                      const double edot_ii,
+                                      const std::vector<double> &composition,
+                                      const std::vector<double> &viscosities_diffusion,
+                                      const std::vector<double> &viscosities_dislocation,
+                                      const ViscosityScheme &viscous_type,
+                                      const YieldScheme &yield_type) const
     {
       // This function calculates viscosities assuming that all the compositional fields
       // experience the same strain rate (isostrain).
 
-      // Calculate the square root of the second moment invariant for the deviatoric strain rate tensor.
-      // The first time this function is called (first iteration of first time step)
-      // a specified "reference" strain rate is used as the returned value would
-      // otherwise be zero.
-      const double edot_ii = ( (this->get_timestep_number() == 0 && strain_rate.norm() <= std::numeric_limits<double>::min())
-                               ?
-                               ref_strain_rate
-                               :
-                               std::max(std::sqrt(std::fabs(second_invariant(deviator(strain_rate)))),
-                                        min_strain_rate) );
-
       // Calculate viscosities for each of the individual compositional phases
       std::vector<double> composition_viscosities(volume_fractions.size());
       std::vector<double> composition_yielding(volume_fractions.size());
@@ -159,19 +201,12 @@ namespace aspect
           // A: prefactor, edot_ii: square root of second invariant of deviatoric strain rate tensor,
           // d: grain size, m: grain size exponent, E: activation energy, P: pressure,
           // V; activation volume, n: stress exponent, R: gas constant, T: temperature.
-          // Note: values of A, d, m, E, V and n are distinct for diffusion & dislocation creep
-
-          // Diffusion creep: viscosity is grain size dependent (m!=0) and strain-rate independent (n=1)
-          double viscosity_diffusion = 0.5 / prefactors_diffusion[j] *
-                                       std::exp((activation_energies_diffusion[j] + pressure*activation_volumes_diffusion[j])/
-                                                (constants::gas_constant*temperature)) *
-                                       std::pow(grain_size, grain_size_exponents_diffusion[j]);
-
-          // For dislocation creep, viscosity is grain size independent (m=0) and strain-rate dependent (n>1)
-          double viscosity_dislocation = 0.5 * std::pow(prefactors_dislocation[j],-1/stress_exponents_dislocation[j]) *
-                                         std::exp((activation_energies_dislocation[j] + pressure*activation_volumes_dislocation[j])/
-                                                  (constants::gas_constant*temperature*stress_exponents_dislocation[j])) *
-                                         std::pow(edot_ii,((1. - stress_exponents_dislocation[j])/stress_exponents_dislocation[j]));
+          // Note: values of A, d, m, E, V and n are distinct for diffusion & dislocation creep.
+          // Diffusion creep is grain size dependent (m!=0) and strain-rate independent (n=1),
+          // dislocation creep is grain size independent (m=0) and strain-rate dependent (n>1).
+          // Both are computed by the caller.
+          const double viscosity_diffusion = viscosities_diffusion[j];
+          const double viscosity_dislocation = viscosities_dislocation[j];
 
           // Composite viscosity
           double viscosity_composite = (viscosity_diffusion * viscosity_dislocation)/(viscosity_diffusion + viscosity_dislocation);
@@ -273,17 +308,15 @@ namespace aspect
             }
 
 
-          // Stress limiter rheology
-          double viscosity_limiter;
-          viscosity_limiter = yield_strength / (2.0 * ref_strain_rate) *
-                              std::pow((edot_ii/ref_strain_rate), 1./exponents_stress_limiter[j] - 1.0);
-
           // Select if yield viscosity is based on Drucker Prager or stress limiter rheology
           double viscosity_yield;
           switch (yield_type)
             {
               case stress_limiter:
               {
+                // Stress limiter rheology
+                const double viscosity_limiter = yield_strength / (2.0 * ref_strain_rate) *
+                                                 std::pow((edot_ii/ref_strain_rate), 1./exponents_stress_limiter[j] - 1.0);
                 viscosity_yield = 1. / ( 1./viscosity_limiter + 1./viscosity_pre_yield);
                 break;
               }
@@ -373,12 +406,48 @@ namespace aspect
             }
         }
 
+      // The viscosity is by far the most expensive property to compute.
+      // Besides the viscosity itself, the strain weakening reaction terms and
+      // the plastic and derivative outputs depend on it.
+      const bool compute_viscosity = out.requests_property(MaterialProperties::viscosity)
+                                     || out.requests_property(MaterialProperties::reaction_terms)
+                                     || derivatives != NULL
+                                     || out.template get_additional_output<PlasticAdditionalOutputs<dim> >() != NULL;
+
+      // Evaluate the creep laws of all compositional fields at all points
+      // at once, as this is where most of the time is spent
+      const unsigned int n_points = in.temperature.size();
+      const unsigned int n_phases = diffusion_creep.size();
+      std::vector<double> edot_ii (n_points);
+      Table<2,double> viscosities_diffusion_table (n_phases, n_points);
+      Table<2,double> viscosities_dislocation_table (n_phases, n_points);
+      if (in.strain_rate.size() && compute_viscosity && n_points > 0)
+        {
+          std::vector<double> log_edot_ii (n_points);
+          for (unsigned int i=0; i < n_points; ++i)
+            {
+              edot_ii[i] = calculate_strain_rate_invariant(in.strain_rate[i]);
+              log_edot_ii[i] = std::log(edot_ii[i]);
+            }
+
+          for (unsigned int j=0; j < n_phases; ++j)
+            {
+              RheologyKernels::compute_viscosities(diffusion_creep[j], n_points, &in.pressure[0], &in.temperature[0],
+                                                   &log_edot_ii[0], &viscosities_diffusion_table[j][0]);
+              RheologyKernels::compute_viscosities(dislocation_creep[j], n_points, &in.pressure[0], &in.temperature[0],
+                                                   &log_edot_ii[0], &viscosities_dislocation_table[j][0]);
+            }
+        }
+
       // Loop through points
+      std::vector<double> composition;
+      std::vector<double> viscosities_diffusion (n_phases);
+      std::vector<double> viscosities_dislocation (n_phases);
       for (unsigned int i=0; i < in.temperature.size(); ++i)
         {
           const double temperature = in.temperature[i];
           const double pressure = in.pressure[i];
-          const std::vector<double> &composition = in.composition[i];
+          in.composition[i].copy_to(composition);
           const std::vector<double> volume_fractions = compute_volume_fractions(composition, composition_mask);
           const SymmetricTensor<2,dim> strain_rate = in.strain_rate[i];
 
@@ -412,14 +481,21 @@ namespace aspect
           // calculate effective viscosity
           // and retrieve whether the material is plastically yielding
           bool plastic_yielding = false;
-          if (in.strain_rate.size())
+          if (in.strain_rate.size() && compute_viscosity)
             {
               // Currently, the viscosities for each of the compositional fields are calculated assuming
               // isostrain amongst all compositions, allowing calculation of the viscosity ratio.
               // TODO: This is only consistent with viscosity averaging if the arithmetic averaging
               // scheme is chosen. It would be useful to have a function to calculate isostress viscosities.
+              for (unsigned int j=0; j < n_phases; ++j)
+                {
+                  viscosities_diffusion[j] = viscosities_diffusion_table[j][i];
+                  viscosities_dislocation[j] = viscosities_dislocation_table[j][i];
+                }
               const std::pair<std::vector<double>, std::vector<double> > calculate_viscosities =
-                calculate_isostrain_viscosities(volume_fractions, pressure, temperature, composition, strain_rate,viscous_flow_law,yield_mechanism);
+                calculate_isostrain_viscosities(volume_fractions, pressure, edot_ii[i], composition,
+                                                viscosities_diffusion, viscosities_dislocation,
+                                                viscous_flow_law, yield_mechanism);
               const std::vector<double> composition_viscosities = calculate_viscosities.first;
               const std::vector<double> composition_yielding = calculate_viscosities.second;
 
@@ -525,34 +601,44 @@ namespace aspect
                 }
             }
 
-          out.densities[i] = density;
-          out.thermal_expansion_coefficients[i] = thermal_expansivity;
+          if (out.requests_property(MaterialProperties::density))
+            out.densities[i] = density;
+          if (out.requests_property(MaterialProperties::thermal_expansion_coefficient))
+            out.thermal_expansion_coefficients[i] = thermal_expansivity;
           // Specific heat at the given positions.
-          out.specific_heat[i] = heat_capacity;
+          if (out.requests_property(MaterialProperties::specific_heat))
+            out.specific_heat[i] = heat_capacity;
           // Thermal conductivity at the given positions. If the temperature equation uses
           // the reference density profile formulation, use the reference density to
           // calculate thermal conductivity. Otherwise, use the real density. If the adiabatic
           // conditions are not yet initialized, the real density will still be used.
-          if (this->get_parameters().formulation_temperature_equation ==
-              Parameters<dim>::Formulation::TemperatureEquation::reference_density_profile &&
-              this->get_adiabatic_conditions().is_initialized())
-            out.thermal_conductivities[i] = thermal_diffusivity * heat_capacity *
-                                            this->get_adiabatic_conditions().density(in.position[i]);
-          else
-            out.thermal_conductivities[i] = thermal_diffusivity * heat_capacity * density;
+          if (out.requests_property(MaterialProperties::thermal_conductivity))
+            {
+              if (this->get_parameters().formulation_temperature_equation ==
+                  Parameters<dim>::Formulation::TemperatureEquation::reference_density_profile &&
+                  this->get_adiabatic_conditions().is_initialized())
+                out.thermal_conductivities[i] = thermal_diffusivity * heat_capacity *
+                                                this->get_adiabatic_conditions().density(in.position[i]);
+              else
+                out.thermal_conductivities[i] = thermal_diffusivity * heat_capacity * density;
+            }
           // Compressibility at the given positions.
           // The compressibility is given as
           // $\frac 1\rho \frac{\partial\rho}{\partial p}$.
-          out.compressibilities[i] = 0.0;
+          if (out.requests_property(MaterialProperties::compressibility))
+            out.compressibilities[i] = 0.0;
           // Pressure derivative of entropy at the given positions.
-          out.entropy_derivative_pressure[i] = 0.0;
+          if (out.requests_property(MaterialProperties::entropy_derivative_pressure))
+            out.entropy_derivative_pressure[i] = 0.0;
           // Temperature derivative of entropy at the given positions.
-          out.entropy_derivative_temperature[i] = 0.0;
+          if (out.requests_property(MaterialProperties::entropy_derivative_temperature))
+            out.entropy_derivative_temperature[i] = 0.0;
           // Change in composition due to chemical reactions at the
           // given positions. The term reaction_terms[i][c] is the
           // change in compositional field c at point i.
-          for (unsigned int c=0; c<in.composition[i].size(); ++c)
-            out.reaction_terms[i][c] = 0.0;
+          if (out.requests_property(MaterialProperties::reaction_terms))
+            for (unsigned int c=0; c<in.composition[i].size(); ++c)
+              out.reaction_terms[i][c] = 0.0;
           // If strain weakening is used, overwrite the first reaction term,
           // which represents the second invariant of the (plastic) strain tensor.
           // If plastic strain is tracked (so not the total strain), only overwrite
@@ -560,7 +646,8 @@ namespace aspect
           // If viscous strain is also tracked, overwrite the second rection term as well.
           double edot_ii = 0.;
           double e_ii = 0.;
-          if  (use_strain_weakening == true && use_finite_strain_tensor == false && this->get_timestep_number() > 0 && in.strain_rate.size())
+          if  (use_strain_weakening == true && use_finite_strain_tensor == false && this->get_timestep_number() > 0 && in.strain_rate.size()
+               && out.requests_property(MaterialProperties::reaction_terms))
             {
               edot_ii = std::max(sqrt(std::fabs(second_invariant(deviator(strain_rate)))),min_strain_rate);
               e_ii = edot_ii*this->get_timestep();
@@ -620,7 +707,8 @@ namespace aspect
       // We need the velocity gradient for the finite strain (they are not included in material model inputs),
       // so we get them from the finite element.
       if (in.current_cell.state() == IteratorState::valid && use_strain_weakening == true
-          && use_finite_strain_tensor == true && this->get_timestep_number() > 0 && in.strain_rate.size())
+          && use_finite_strain_tensor == true && this->get_timestep_number() > 0 && in.strain_rate.size()
+          && out.requests_property(MaterialProperties::reaction_terms))
         {
           const QGauss<dim> quadrature_formula (this->get_fe().base_element(this->introspection().base_elements.velocities).degree+1);
           FEValues<dim> fe_values (this->get_mapping(),
@@ -1093,6 +1181,23 @@ namespace aspect
           activation_volumes_dislocation = Utilities::possibly_extend_from_1_to_N (Utilities::string_to_double(Utilities::split_string_list(prm.get("Activation volumes for dislocation creep"))),
                                                                                    n_fields,
                                                                                    "Activation volumes for dislocation creep");
+
+          diffusion_creep.clear();
+          dislocation_creep.clear();
+          for (unsigned int i = 0; i<n_fields; ++i)
+            {
+              diffusion_creep.push_back(RheologyKernels::PowerLawCreep(prefactors_diffusion[i], 1.0,
+                                                                       grain_size_exponents_diffusion[i],
+                                                                       activation_energies_diffusion[i],
+                                                                       activation_volumes_diffusion[i],
+                                                                       grain_size));
+              dislocation_creep.push_back(RheologyKernels::PowerLawCreep(prefactors_dislocation[i],
+                                                                         stress_exponents_dislocation[i],
+                                                                         0.0,
+                                                                         activation_energies_dislocation[i],
+                                                                         activation_volumes_dislocation[i],
+                                                                         grain_size));
+            }
           // Plasticity parameters
           angles_internal_friction = Utilities::possibly_extend_from_1_to_N (Utilities::string_to_double(Utilities::split_string_list(prm.get("Angles of internal friction"))),
                                                                              n_fields,
@@ -25,12 +25,82 @@
 
 #include <deal.II/base/signaling_nan.h>
 
+#include <map>
+
 namespace aspect
 {
   namespace internal
   {
     namespace Assembly
     {
+      template <int dim>
+      CellCongruenceClasses<dim>::CellCongruenceClasses ()
+        :
+        n_congruence_classes (0)
+      {}
+
+
+
+      template <int dim>
+      void
+      CellCongruenceClasses<dim>::reinit (const Triangulation<dim> &triangulation,
+                                          const bool                mapping_depends_only_on_vertices)
+      {
+        cell_classes.assign (triangulation.n_active_cells(), numbers::invalid_unsigned_int);
+        n_congruence_classes = 0;
+
+        if (!mapping_depends_only_on_vertices)
+          return;
+
+        // compare the vertex offsets in units of a small fraction of the
+        // smallest cell size, so that round-off does not matter
+        double min_vertex_distance = std::numeric_limits<double>::max();
+        for (typename Triangulation<dim>::active_cell_iterator cell = triangulation.begin_active();
+             cell != triangulation.end(); ++cell)
+          if (cell->is_locally_owned())
+            min_vertex_distance = std::min (min_vertex_distance, cell->minimum_vertex_distance());
+        const double resolution = 1e-8 * min_vertex_distance;
+
+        std::map<std::vector<long long int>, unsigned int> classes;
+        std::vector<long long int> offsets ((GeometryInfo<dim>::vertices_per_cell-1) * dim);
+        for (typename Triangulation<dim>::active_cell_iterator cell = triangulation.begin_active();
+             cell != triangulation.end(); ++cell)
+          if (cell->is_locally_owned())
+            {
+              for (unsigned int v=1; v<GeometryInfo<dim>::vertices_per_cell; ++v)
+                for (unsigned int d=0; d<dim; ++d)
+                  offsets[(v-1)*dim+d] = std::llround ((cell->vertex(v)[d] - cell->vertex(0)[d]) / resolution);
+
+              const std::pair<std::map<std::vector<long long int>, unsigned int>::iterator, bool> new_class
+                = classes.insert (std::make_pair (offsets, n_congruence_classes));
+              if (new_class.second)
+                ++n_congruence_classes;
+              cell_classes[cell->active_cell_index()] = new_class.first->second;
+            }
+      }
+
+
+
+      template <int dim>
+      unsigned int
+      CellCongruenceClasses<dim>::get_class (const typename DoFHandler<dim>::active_cell_iterator &cell) const
+      {
+        if (cell->active_cell_index() < cell_classes.size())
+          return cell_classes[cell->active_cell_index()];
+        return numbers::invalid_unsigned_int;
+      }
+
+
+
+      template <int dim>
+      unsigned int
+      CellCongruenceClasses<dim>::n_classes () const
+      {
+        return n_congruence_classes;
+      }
+
+
+
       namespace Scratch
       {
         template <int dim>
@@ -55,6 +125,13 @@ namespace aspect
           phi_p (stokes_dofs_per_cell, numbers::signaling_nan<double>()),
           phi_p_c (add_compaction_pressure ? stokes_dofs_per_cell : 0, numbers::signaling_nan<double>()),
           grad_phi_p (add_compaction_pressure ? stokes_dofs_per_cell : 0, numbers::signaling_nan<Tensor<1,dim> >()),
+          stokes_shape_values (stokes_dofs_per_cell, quadrature.size()),
+          stokes_shape_gradients (stokes_dofs_per_cell, dim, quadrature.size()),
+          stokes_shape_data_is_current (false),
+          cell_congruence_class (numbers::invalid_unsigned_int),
+          stokes_shape_data_congruence_class (numbers::invalid_unsigned_int),
+          coefficients_times_JxW (quadrature.size(), numbers::signaling_nan<double>()),
+          second_coefficients_times_JxW (quadrature.size(), numbers::signaling_nan<double>()),
           material_model_inputs(quadrature.size(), n_compositional_fields),
           material_model_outputs(quadrature.size(), n_compositional_fields),
           rebuild_stokes_matrix(rebuild_matrix)
@@ -80,6 +157,13 @@ namespace aspect
           phi_p (scratch.phi_p),
           phi_p_c (scratch.phi_p_c),
           grad_phi_p(scratch.grad_phi_p),
+          stokes_shape_values (scratch.stokes_shape_values),
+          stokes_shape_gradients (scratch.stokes_shape_gradients),
+          stokes_shape_data_is_current (false),
+          cell_congruence_class (numbers::invalid_unsigned_int),
+          stokes_shape_data_congruence_class (numbers::invalid_unsigned_int),
+          coefficients_times_JxW (scratch.coefficients_times_JxW),
+          second_coefficients_times_JxW (scratch.second_coefficients_times_JxW),
           material_model_inputs(scratch.material_model_inputs),
           material_model_outputs(scratch.material_model_outputs),
           rebuild_stokes_matrix(scratch.rebuild_stokes_matrix)
@@ -100,6 +184,8 @@ namespace aspect
           this->cell = cell_ref;
           this->face_number = numbers::invalid_unsigned_int;
           finite_element_values.reinit (cell_ref);
+          stokes_shape_data_is_current = false;
+          cell_congruence_class = numbers::invalid_unsigned_int;
         }
 
 
@@ -428,7 +514,8 @@ namespace aspect
           local_pressure_shape_function_integrals (do_pressure_rhs_compatibility_modification ?
                                                    stokes_dofs_per_cell
                                                    :
-                                                   0)
+                                                   0),
+          has_local_contributions (true)
         {}
 
 
@@ -439,7 +526,8 @@ namespace aspect
           :
           StokesPreconditioner<dim> (data),
           local_rhs (data.local_rhs),
-          local_pressure_shape_function_integrals (data.local_pressure_shape_function_integrals.size())
+          local_pressure_shape_function_integrals (data.local_pressure_shape_function_integrals.size()),
+          has_local_contributions (data.has_local_contributions)
         {}
 
 
@@ -542,6 +630,13 @@ namespace aspect
     }
 
 
+    template <int dim>
+    Manager<dim>::Manager ()
+      :
+      stokes_system_is_boussinesq (false)
+    {}
+
+
     template <int dim>
     void Manager<dim>::reset ()
     {
@@ -551,6 +646,11 @@ namespace aspect
       advection_system.clear();
       advection_system_on_boundary_face.clear();
       advection_system_on_interior_face.clear();
+
+      static_stokes_preconditioner = nullptr;
+      static_stokes_system = nullptr;
+      static_advection_system = nullptr;
+      stokes_system_is_boussinesq = false;
     }
 
     template <int dim>
@@ -571,6 +671,7 @@ namespace aspect
 #define INSTANTIATE(dim) \
   namespace internal { \
     namespace Assembly { \
+      template class CellCongruenceClasses<dim>; \
       namespace Scratch { \
         template struct StokesPreconditioner<dim>; \
         template struct StokesSystem<dim>; \
@@ -23,95 +23,249 @@
 #include <aspect/utilities.h>
 
 #include <deal.II/base/signaling_nan.h>
+#include <deal.II/base/vectorization.h>
 
 namespace aspect
 {
   namespace Assemblers
   {
+    namespace
+    {
+      /**
+       * Fill the component-separated shape function data of the Stokes
+       * degrees of freedom in @p scratch, unless another assembler has
+       * already done so for the current cell.
+       */
+      template <int dim, unsigned int static_n_q_points = 0>
+      void
+      compute_stokes_shape_data (internal::Assembly::Scratch::StokesPreconditioner<dim> &scratch,
+                                 const Introspection<dim>                                &introspection,
+                                 const unsigned int                                       stokes_dofs_per_cell)
+      {
+        if (scratch.stokes_shape_data_is_current)
+          return;
+
+        // the tables are the same on all cells of a congruence class, so
+        // we need not compute them again if the previous cell this scratch
+        // object was used on was in the same class
+        if (scratch.cell_congruence_class != numbers::invalid_unsigned_int
+            && scratch.cell_congruence_class == scratch.stokes_shape_data_congruence_class)
+          {
+            scratch.stokes_shape_data_is_current = true;
+            return;
+          }
+
+        const FEValues<dim> &fe_values = scratch.finite_element_values;
+        const FiniteElement<dim> &fe = fe_values.get_fe();
+        const unsigned int n_q_points = (static_n_q_points != 0
+                                         ?
+                                         static_n_q_points
+                                         :
+                                         fe_values.n_quadrature_points);
+        Assert (n_q_points == fe_values.n_quadrature_points, ExcInternalError());
+
+        for (unsigned int i = 0, i_stokes = 0; i_stokes < stokes_dofs_per_cell; ++i)
+          {
+            const unsigned int component = fe.system_to_component_index(i).first;
+            if (introspection.is_stokes_component(component))
+              {
+                Assert (fe.is_primitive(i), ExcInternalError());
+                scratch.dof_component_indices[i_stokes] = component;
+
+                for (unsigned int q = 0; q < n_q_points; ++q)
+                  {
+                    scratch.stokes_shape_values(i_stokes, q) = fe_values.shape_value(i, q);
+
+                    const Tensor<1,dim> gradient = fe_values.shape_grad(i, q);
+                    for (unsigned int d = 0; d < dim; ++d)
+                      scratch.stokes_shape_gradients(i_stokes, d, q) = gradient[d];
+                  }
+                ++i_stokes;
+              }
+          }
+
+        scratch.stokes_shape_data_is_current = true;
+        scratch.stokes_shape_data_congruence_class = scratch.cell_congruence_class;
+      }
+
+
+
+      /**
+       * Return the integral over the cell of the product of the scalar
+       * functions @p a and @p b (given at the quadrature points) with the
+       * coefficients @p c, which already include the JxW values. The
+       * quadrature points are processed in chunks of the SIMD width. If
+       * @p static_n_q_points is not zero, it is used instead of
+       * @p n_q_points so that the trip counts of the loops are known at
+       * compile time.
+       */
+      template <unsigned int static_n_q_points = 0>
+      inline
+      double
+      integrate_product (const double       *a,
+                         const double       *b,
+                         const double       *c,
+                         const unsigned int  runtime_n_q_points)
+      {
+        const unsigned int n_q_points = (static_n_q_points != 0 ? static_n_q_points : runtime_n_q_points);
+        const unsigned int n_lanes = VectorizedArray<double>::n_array_elements;
+
+        VectorizedArray<double> vectorized_sum = 0.;
+        unsigned int q = 0;
+        for (; q + n_lanes <= n_q_points; q += n_lanes)
+          {
+            VectorizedArray<double> a_q, b_q, c_q;
+            a_q.load (a + q);
+            b_q.load (b + q);
+            c_q.load (c + q);
+            vectorized_sum += c_q * a_q * b_q;
+          }
+
+        double sum = 0;
+        for (unsigned int v = 0; v < n_lanes; ++v)
+          sum += vectorized_sum[v];
+        for (; q < n_q_points; ++q)
+          sum += c[q] * a[q] * b[q];
+        return sum;
+      }
+
+
+
+      /**
+       * Return $\int_K 2 c\, \varepsilon(\varphi_i) : \varepsilon(\varphi_j)$
+       * for the velocity shape functions $\varphi_i = \phi_i
+       * \mathbf{e}_{d_i}$ and $\varphi_j = \phi_j \mathbf{e}_{d_j}$, where
+       * the coefficient $c$ includes the JxW values. Because only one
+       * component of each shape function is nonzero, this is
+       * $\int_K c\, (\delta_{d_i d_j} \nabla\phi_i \cdot \nabla\phi_j
+       * + \partial_{d_j}\phi_i\, \partial_{d_i}\phi_j)$.
+       */
+      template <int dim, unsigned int static_n_q_points = 0>
+      inline
+      double
+      integrate_symmetric_gradient_product (const Table<3,double> &shape_gradients,
+                                            const unsigned int     i,
+                                            const unsigned int     direction_i,
+                                            const unsigned int     j,
+                                            const unsigned int     direction_j,
+                                            const double          *c,
+                                            const unsigned int     n_q_points)
+      {
+        double sum = integrate_product<static_n_q_points> (&shape_gradients(i, direction_j, 0),
+                                                           &shape_gradients(j, direction_i, 0),
+                                                           c, n_q_points);
+        if (direction_i == direction_j)
+          for (unsigned int d = 0; d < dim; ++d)
+            sum += integrate_product<static_n_q_points> (&shape_gradients(i, d, 0),
+                                                         &shape_gradients(j, d, 0),
+                                                         c, n_q_points);
+        return sum;
+      }
+    }
+
+
+
     template <int dim>
     void
     StokesPreconditioner<dim>::
     execute (internal::Assembly::Scratch::ScratchBase<dim>   &scratch_base,
              internal::Assembly::CopyData::CopyDataBase<dim> &data_base) const
     {
-      internal::Assembly::Scratch::StokesPreconditioner<dim> &scratch = dynamic_cast<internal::Assembly::Scratch::StokesPreconditioner<dim>& > (scratch_base);
-      internal::Assembly::CopyData::StokesPreconditioner<dim> &data = dynamic_cast<internal::Assembly::CopyData::StokesPreconditioner<dim>& > (data_base);
+      assemble (dynamic_cast<internal::Assembly::Scratch::StokesPreconditioner<dim>& > (scratch_base),
+                dynamic_cast<internal::Assembly::CopyData::StokesPreconditioner<dim>& > (data_base));
+    }
+
 
+
+    template <int dim>
+    void
+    StokesPreconditioner<dim>::
+    assemble (internal::Assembly::Scratch::StokesPreconditioner<dim> &scratch,
+              internal::Assembly::CopyData::StokesPreconditioner<dim> &data) const
+    {
+      assemble_terms<0,0> (scratch, data);
+    }
+
+
+
+    template <int dim>
+    template <int velocity_degree>
+    void
+    StokesPreconditioner<dim>::
+    assemble_boussinesq (internal::Assembly::Scratch::StokesPreconditioner<dim> &scratch,
+                         internal::Assembly::CopyData::StokesPreconditioner<dim> &data) const
+    {
+      assemble_terms<StokesElementSizes<dim,velocity_degree>::n_q_points,
+                     StokesElementSizes<dim,velocity_degree>::stokes_dofs_per_cell> (scratch, data);
+    }
+
+
+
+    template <int dim>
+    template <unsigned int static_n_q_points, unsigned int static_stokes_dofs_per_cell>
+    void
+    StokesPreconditioner<dim>::
+    assemble_terms (internal::Assembly::Scratch::StokesPreconditioner<dim> &scratch,
+                    internal::Assembly::CopyData::StokesPreconditioner<dim> &data) const
+    {
       const Introspection<dim> &introspection = this->introspection();
-      const FiniteElement<dim> &fe = this->get_fe();
-      const unsigned int stokes_dofs_per_cell = data.local_dof_indices.size();
-      const unsigned int n_q_points           = scratch.finite_element_values.n_quadrature_points;
+      const unsigned int stokes_dofs_per_cell = (static_stokes_dofs_per_cell != 0
+                                                 ?
+                                                 static_stokes_dofs_per_cell
+                                                 :
+                                                 data.local_dof_indices.size());
+      const unsigned int n_q_points           = (static_n_q_points != 0
+                                                 ?
+                                                 static_n_q_points
+                                                 :
+                                                 scratch.finite_element_values.n_quadrature_points);
+      Assert (stokes_dofs_per_cell == data.local_dof_indices.size(), ExcInternalError());
       const double pressure_scaling = this->get_pressure_scaling();
       const bool assemble_A_approximation = !this->get_parameters().use_full_A_block_preconditioner;
+      const unsigned int pressure_component_index = introspection.component_indices.pressure;
+      const unsigned int first_velocity_component_index = introspection.component_indices.velocities[0];
 
-      // First loop over all dofs and find those that are in the Stokes system
-      // save the component (pressure and dim velocities) each belongs to.
-      for (unsigned int i = 0, i_stokes = 0; i_stokes < stokes_dofs_per_cell; /*increment at end of loop*/)
-        {
-          if (introspection.is_stokes_component(fe.system_to_component_index(i).first))
-            {
-              scratch.dof_component_indices[i_stokes] = fe.system_to_component_index(i).first;
-              ++i_stokes;
-            }
-          ++i;
-        }
+      compute_stokes_shape_data<dim,static_n_q_points> (scratch, introspection, stokes_dofs_per_cell);
 
-      // Loop over all quadrature points and assemble their contributions to
-      // the preconditioner matrix
       for (unsigned int q = 0; q < n_q_points; ++q)
         {
-          for (unsigned int i = 0, i_stokes = 0; i_stokes < stokes_dofs_per_cell; /*increment at end of loop*/)
-            {
-              if (introspection.is_stokes_component(fe.system_to_component_index(i).first))
-                {
-                  if (assemble_A_approximation)
-                    scratch.grads_phi_u[i_stokes] =
-                      scratch.finite_element_values[introspection.extractors
-                                                    .velocities].symmetric_gradient(i, q);
-                  scratch.phi_p[i_stokes] = scratch.finite_element_values[introspection
-                                                                          .extractors.pressure].value(i, q);
-                  ++i_stokes;
-                }
-              ++i;
-            }
-
           const double eta = scratch.material_model_outputs.viscosities[q];
-          const double one_over_eta = 1. / eta;
-
           const double JxW = scratch.finite_element_values.JxW(q);
 
-          if (assemble_A_approximation)
-            {
-              for (unsigned int i = 0; i < stokes_dofs_per_cell; ++i)
-                for (unsigned int j = 0; j < stokes_dofs_per_cell; ++j)
-                  if (scratch.dof_component_indices[i] ==
-                      scratch.dof_component_indices[j])
-                    {
-                      data.local_matrix(i, j) += ((2.0 * eta * (scratch.grads_phi_u[i]
-                                                                * scratch.grads_phi_u[j]))
-                                                  + one_over_eta * pressure_scaling
-                                                  * pressure_scaling
-                                                  * (scratch.phi_p[i]
-                                                     * scratch.phi_p[j]))
-                                                 * JxW;
-                    }
+          scratch.coefficients_times_JxW[q] = eta * JxW;
+          scratch.second_coefficients_times_JxW[q] = pressure_scaling * pressure_scaling / eta * JxW;
+        }
 
-            }
-          else
-            {
-              const unsigned int pressure_component_index = this->introspection().component_indices.pressure;
-              for (unsigned int i = 0; i < stokes_dofs_per_cell; ++i)
-                if (scratch.dof_component_indices[i] == pressure_component_index)
-                  for (unsigned int j = 0; j < stokes_dofs_per_cell; ++j)
-                    if (scratch.dof_component_indices[j] == pressure_component_index)
-                      {
-                        data.local_matrix(i, j) += (one_over_eta * pressure_scaling
-                                                    * pressure_scaling
-                                                    * (scratch.phi_p[i]
-                                                       * scratch.phi_p[j]))
-                                                   * JxW;
-                      }
-            }
+      // Both the A block approximation (which only couples shape functions
+      // of the same vector component) and the pressure mass matrix are
+      // symmetric, so only compute the upper triangle and mirror it
+      for (unsigned int i = 0; i < stokes_dofs_per_cell; ++i)
+        {
+          const unsigned int component_i = scratch.dof_component_indices[i];
+          if (component_i != pressure_component_index && !assemble_A_approximation)
+            continue;
+
+          for (unsigned int j = i; j < stokes_dofs_per_cell; ++j)
+            if (scratch.dof_component_indices[j] == component_i)
+              {
+                const double value
+                  = (component_i == pressure_component_index
+                     ?
+                     integrate_product<static_n_q_points> (&scratch.stokes_shape_values(i, 0),
+                                                           &scratch.stokes_shape_values(j, 0),
+                                                           scratch.second_coefficients_times_JxW.data(),
+                                                           n_q_points)
+                     :
+                     integrate_symmetric_gradient_product<dim,static_n_q_points> (scratch.stokes_shape_gradients,
+                                                                                  i, component_i - first_velocity_component_index,
+                                                                                  j, component_i - first_velocity_component_index,
+                                                                                  scratch.coefficients_times_JxW.data(),
+                                                                                  n_q_points));
+
+                data.local_matrix(i, j) += value;
+                if (j != i)
+                  data.local_matrix(j, i) += value;
+              }
         }
     }
 
@@ -123,53 +277,54 @@ namespace aspect
     execute (internal::Assembly::Scratch::ScratchBase<dim>   &scratch_base,
              internal::Assembly::CopyData::CopyDataBase<dim> &data_base) const
     {
-      internal::Assembly::Scratch::StokesPreconditioner<dim> &scratch = dynamic_cast<internal::Assembly::Scratch::StokesPreconditioner<dim>& > (scratch_base);
-      internal::Assembly::CopyData::StokesPreconditioner<dim> &data = dynamic_cast<internal::Assembly::CopyData::StokesPreconditioner<dim>& > (data_base);
+      assemble (dynamic_cast<internal::Assembly::Scratch::StokesPreconditioner<dim>& > (scratch_base),
+                dynamic_cast<internal::Assembly::CopyData::StokesPreconditioner<dim>& > (data_base));
+    }
+
+
+
+    template <int dim>
+    void
+    StokesCompressiblePreconditioner<dim>::
+    assemble (internal::Assembly::Scratch::StokesPreconditioner<dim> &scratch,
+              internal::Assembly::CopyData::StokesPreconditioner<dim> &data) const
+    {
 
       const Introspection<dim> &introspection = this->introspection();
-      const FiniteElement<dim> &fe = this->get_fe();
       const unsigned int stokes_dofs_per_cell = data.local_dof_indices.size();
       const unsigned int n_q_points           = scratch.finite_element_values.n_quadrature_points;
+      const unsigned int pressure_component_index = introspection.component_indices.pressure;
+      const unsigned int first_velocity_component_index = introspection.component_indices.velocities[0];
 
-      // First loop over all dofs and find those that are in the Stokes system
-      // save the component (pressure and dim velocities) each belongs to.
-      for (unsigned int i = 0, i_stokes = 0; i_stokes < stokes_dofs_per_cell; /*increment at end of loop*/)
-        {
-          if (introspection.is_stokes_component(fe.system_to_component_index(i).first))
-            {
-              scratch.dof_component_indices[i_stokes] = fe.system_to_component_index(i).first;
-              ++i_stokes;
-            }
-          ++i;
-        }
+      compute_stokes_shape_data (scratch, introspection, stokes_dofs_per_cell);
 
-      // Loop over all quadrature points and assemble their contributions to
-      // the preconditioner matrix
       for (unsigned int q = 0; q < n_q_points; ++q)
+        scratch.coefficients_times_JxW[q] = - scratch.material_model_outputs.viscosities[q] * 2.0 / 3.0
+                                            * scratch.finite_element_values.JxW(q);
+
+      // the term -2/3 eta (div phi_i)(div phi_j) for shape functions of the
+      // same component is symmetric, so only compute the upper triangle.
+      // the divergence of a primitive shape function is the derivative of
+      // its nonzero component in the direction of that component
+      for (unsigned int i = 0; i < stokes_dofs_per_cell; ++i)
         {
-          for (unsigned int i = 0, i_stokes = 0; i_stokes < stokes_dofs_per_cell; /*increment at end of loop*/)
-            {
-              if (introspection.is_stokes_component(fe.system_to_component_index(i).first))
-                {
-                  scratch.grads_phi_u[i_stokes] = scratch.finite_element_values[introspection.extractors.velocities].symmetric_gradient(i,q);
-                  scratch.div_phi_u[i_stokes]   = scratch.finite_element_values[introspection.extractors.velocities].divergence (i, q);
-
-                  ++i_stokes;
-                }
-              ++i;
-            }
-
-          const double eta_two_thirds = scratch.material_model_outputs.viscosities[q] * 2.0 / 3.0;
+          const unsigned int component_i = scratch.dof_component_indices[i];
+          if (component_i == pressure_component_index)
+            continue;
 
-          const double JxW = scratch.finite_element_values.JxW(q);
-
-          for (unsigned int i = 0; i < stokes_dofs_per_cell; ++i)
-            for (unsigned int j = 0; j < stokes_dofs_per_cell; ++j)
-              if (scratch.dof_component_indices[i] ==
-                  scratch.dof_component_indices[j])
-                data.local_matrix(i, j) += (- eta_two_thirds * (scratch.div_phi_u[i] * scratch.div_phi_u[j])
-                                           )
-                                           * JxW;
+          const unsigned int direction = component_i - first_velocity_component_index;
+          for (unsigned int j = i; j < stokes_dofs_per_cell; ++j)
+            if (scratch.dof_component_indices[j] == component_i)
+              {
+                const double value = integrate_product (&scratch.stokes_shape_gradients(i, direction, 0),
+                                                        &scratch.stokes_shape_gradients(j, direction, 0),
+                                                        scratch.coefficients_times_JxW.data(),
+                                                        n_q_points);
+
+                data.local_matrix(i, j) += value;
+                if (j != i)
+                  data.local_matrix(j, i) += value;
+              }
         }
     }
 
@@ -181,81 +336,175 @@ namespace aspect
     execute (internal::Assembly::Scratch::ScratchBase<dim>   &scratch_base,
              internal::Assembly::CopyData::CopyDataBase<dim> &data_base) const
     {
-      internal::Assembly::Scratch::StokesSystem<dim> &scratch = dynamic_cast<internal::Assembly::Scratch::StokesSystem<dim>& > (scratch_base);
-      internal::Assembly::CopyData::StokesSystem<dim> &data = dynamic_cast<internal::Assembly::CopyData::StokesSystem<dim>& > (data_base);
+      assemble (dynamic_cast<internal::Assembly::Scratch::StokesSystem<dim>& > (scratch_base),
+                dynamic_cast<internal::Assembly::CopyData::StokesSystem<dim>& > (data_base));
+    }
+
+
+
+    template <int dim>
+    void
+    StokesIncompressibleTerms<dim>::
+    assemble (internal::Assembly::Scratch::StokesSystem<dim> &scratch,
+              internal::Assembly::CopyData::StokesSystem<dim> &data) const
+    {
+      assemble_terms<0,0,true> (scratch, data);
+    }
+
+
 
+    template <int dim>
+    template <int velocity_degree>
+    void
+    StokesIncompressibleTerms<dim>::
+    assemble_boussinesq (internal::Assembly::Scratch::StokesSystem<dim> &scratch,
+                         internal::Assembly::CopyData::StokesSystem<dim> &data) const
+    {
+      Assert (!this->get_parameters().enable_additional_stokes_rhs
+              && !this->get_parameters().enable_elasticity,
+              ExcInternalError());
+
+      assemble_terms<StokesElementSizes<dim,velocity_degree>::n_q_points,
+                     StokesElementSizes<dim,velocity_degree>::stokes_dofs_per_cell,
+                     false> (scratch, data);
+    }
+
+
+
+    template <int dim>
+    template <unsigned int static_n_q_points, unsigned int static_stokes_dofs_per_cell, bool include_additional_forces>
+    void
+    StokesIncompressibleTerms<dim>::
+    assemble_terms (internal::Assembly::Scratch::StokesSystem<dim> &scratch,
+                    internal::Assembly::CopyData::StokesSystem<dim> &data) const
+    {
       const Introspection<dim> &introspection = this->introspection();
-      const FiniteElement<dim> &fe = this->get_fe();
-      const unsigned int stokes_dofs_per_cell = data.local_dof_indices.size();
-      const unsigned int n_q_points    = scratch.finite_element_values.n_quadrature_points;
+      const unsigned int stokes_dofs_per_cell = (static_stokes_dofs_per_cell != 0
+                                                 ?
+                                                 static_stokes_dofs_per_cell
+                                                 :
+                                                 data.local_dof_indices.size());
+      const unsigned int n_q_points    = (static_n_q_points != 0
+                                          ?
+                                          static_n_q_points
+                                          :
+                                          scratch.finite_element_values.n_quadrature_points);
+      Assert (stokes_dofs_per_cell == data.local_dof_indices.size(), ExcInternalError());
       const double pressure_scaling = this->get_pressure_scaling();
+      const unsigned int pressure_component_index = introspection.component_indices.pressure;
+      const unsigned int first_velocity_component_index = introspection.component_indices.velocities[0];
 
       const MaterialModel::AdditionalMaterialOutputsStokesRHS<dim>
-      *force = scratch.material_model_outputs.template get_additional_output<MaterialModel::AdditionalMaterialOutputsStokesRHS<dim> >();
+      *force = (include_additional_forces
+                ?
+                scratch.material_model_outputs.template get_additional_output<MaterialModel::AdditionalMaterialOutputsStokesRHS<dim> >()
+                :
+                NULL);
 
       const MaterialModel::ElasticOutputs<dim>
-      *elastic_outputs = scratch.material_model_outputs.template get_additional_output<MaterialModel::ElasticOutputs<dim> >();
-
-      for (unsigned int q=0; q<n_q_points; ++q)
-        {
-          for (unsigned int i=0, i_stokes=0; i_stokes<stokes_dofs_per_cell; /*increment at end of loop*/)
-            {
-              if (introspection.is_stokes_component(fe.system_to_component_index(i).first))
-                {
-                  scratch.phi_u[i_stokes] = scratch.finite_element_values[introspection.extractors.velocities].value (i,q);
-                  scratch.phi_p[i_stokes] = scratch.finite_element_values[introspection.extractors.pressure].value (i, q);
-                  if (scratch.rebuild_stokes_matrix)
-                    {
-                      scratch.grads_phi_u[i_stokes] = scratch.finite_element_values[introspection.extractors.velocities].symmetric_gradient(i,q);
-                      scratch.div_phi_u[i_stokes]   = scratch.finite_element_values[introspection.extractors.velocities].divergence (i, q);
-                    }
-                  ++i_stokes;
-                }
-              ++i;
-            }
+      *elastic_outputs = (include_additional_forces
+                          ?
+                          scratch.material_model_outputs.template get_additional_output<MaterialModel::ElasticOutputs<dim> >()
+                          :
+                          NULL);
 
+      const bool use_force = (include_additional_forces
+                              && force != NULL && this->get_parameters().enable_additional_stokes_rhs);
+      const bool use_elastic_force = (include_additional_forces
+                                      && elastic_outputs != NULL && this->get_parameters().enable_elasticity);
 
-          // Viscosity scalar
-          const double eta = (scratch.rebuild_stokes_matrix
-                              ?
-                              scratch.material_model_outputs.viscosities[q]
-                              :
-                              numbers::signaling_nan<double>());
+      compute_stokes_shape_data<dim,static_n_q_points> (scratch, introspection, stokes_dofs_per_cell);
 
+      // the right hand side: each velocity shape function only tests the
+      // component of the force that corresponds to its nonzero component
+      for (unsigned int q=0; q<n_q_points; ++q)
+        {
           const Tensor<1,dim>
           gravity = this->get_gravity_model().gravity_vector (scratch.finite_element_values.quadrature_point(q));
 
           const double density = scratch.material_model_outputs.densities[q];
           const double JxW = scratch.finite_element_values.JxW(q);
 
+          Tensor<1,dim> body_force = density * gravity;
+          if (use_force)
+            body_force += force->rhs_u[q];
+
           for (unsigned int i=0; i<stokes_dofs_per_cell; ++i)
             {
-              data.local_rhs(i) += (density * gravity * scratch.phi_u[i])
-                                   * JxW;
+              const unsigned int component_i = scratch.dof_component_indices[i];
+              if (component_i == pressure_component_index)
+                {
+                  if (use_force)
+                    data.local_rhs(i) += pressure_scaling * force->rhs_p[q]
+                                         * scratch.stokes_shape_values(i,q) * JxW;
+                }
+              else
+                {
+                  const unsigned int direction = component_i - first_velocity_component_index;
+                  double value = body_force[direction] * scratch.stokes_shape_values(i,q);
+
+                  // the elastic force F tested with the symmetric gradient
+                  // 1/2 (e_d (x) grad phi + grad phi (x) e_d)
+                  if (use_elastic_force)
+                    for (unsigned int d=0; d<dim; ++d)
+                      value += 0.5 * (elastic_outputs->elastic_force[q][direction][d]
+                                      + elastic_outputs->elastic_force[q][d][direction])
+                               * scratch.stokes_shape_gradients(i,d,q);
+
+                  data.local_rhs(i) += value * JxW;
+                }
+            }
+        }
+
+      if (!scratch.rebuild_stokes_matrix)
+        return;
 
-              if (force != NULL && this->get_parameters().enable_additional_stokes_rhs)
-                data.local_rhs(i) += (force->rhs_u[q] * scratch.phi_u[i]
-                                      + pressure_scaling * force->rhs_p[q] * scratch.phi_p[i])
-                                     * JxW;
+      for (unsigned int q=0; q<n_q_points; ++q)
+        {
+          const double JxW = scratch.finite_element_values.JxW(q);
+          scratch.coefficients_times_JxW[q] = scratch.material_model_outputs.viscosities[q] * JxW;
+          scratch.second_coefficients_times_JxW[q] = - pressure_scaling * JxW;
+        }
 
-              if (elastic_outputs != NULL && this->get_parameters().enable_elasticity)
-                data.local_rhs(i) += (scalar_product(elastic_outputs->elastic_force[q],Tensor<2,dim>(scratch.grads_phi_u[i])))
-                                     * JxW;
+      // the matrix is symmetric: the A block is, and we assemble \nabla p as
+      // -(p, div v) and the term -div(u) as -(div u, q), so that the two
+      // off-diagonal blocks are adjoint to each other. consequently, only
+      // compute the upper triangle and mirror it
+      for (unsigned int i=0; i<stokes_dofs_per_cell; ++i)
+        {
+          const unsigned int component_i = scratch.dof_component_indices[i];
+          const bool i_is_pressure = (component_i == pressure_component_index);
+          const unsigned int direction_i = component_i - first_velocity_component_index;
 
-              if (scratch.rebuild_stokes_matrix)
-                for (unsigned int j=0; j<stokes_dofs_per_cell; ++j)
-                  {
-                    data.local_matrix(i,j) += ( (eta * 2.0 * (scratch.grads_phi_u[i] * scratch.grads_phi_u[j]))
-                                                // assemble \nabla p as -(p, div v):
-                                                - (pressure_scaling *
-                                                   scratch.div_phi_u[i] * scratch.phi_p[j])
-                                                // assemble the term -div(u) as -(div u, q).
-                                                // Note the negative sign to make this
-                                                // operator adjoint to the grad p term:
-                                                - (pressure_scaling *
-                                                   scratch.phi_p[i] * scratch.div_phi_u[j]))
-                                              * JxW;
-                  }
+          for (unsigned int j=i; j<stokes_dofs_per_cell; ++j)
+            {
+              const unsigned int component_j = scratch.dof_component_indices[j];
+              const bool j_is_pressure = (component_j == pressure_component_index);
+              const unsigned int direction_j = component_j - first_velocity_component_index;
+
+              double value;
+              if (i_is_pressure && j_is_pressure)
+                continue;
+              else if (i_is_pressure)
+                value = integrate_product<static_n_q_points> (&scratch.stokes_shape_values(i, 0),
+                                                              &scratch.stokes_shape_gradients(j, direction_j, 0),
+                                                              scratch.second_coefficients_times_JxW.data(),
+                                                              n_q_points);
+              else if (j_is_pressure)
+                value = integrate_product<static_n_q_points> (&scratch.stokes_shape_gradients(i, direction_i, 0),
+                                                              &scratch.stokes_shape_values(j, 0),
+                                                              scratch.second_coefficients_times_JxW.data(),
+                                                              n_q_points);
+              else
+                value = integrate_symmetric_gradient_product<dim,static_n_q_points> (scratch.stokes_shape_gradients,
+                                                                                     i, direction_i,
+                                                                                     j, direction_j,
+                                                                                     scratch.coefficients_times_JxW.data(),
+                                                                                     n_q_points);
+
+              data.local_matrix(i,j) += value;
+              if (j != i)
+                data.local_matrix(j,i) += value;
             }
         }
     }
@@ -304,8 +553,18 @@ namespace aspect
     execute (internal::Assembly::Scratch::ScratchBase<dim>   &scratch_base,
              internal::Assembly::CopyData::CopyDataBase<dim> &data_base) const
     {
-      internal::Assembly::Scratch::StokesSystem<dim> &scratch = dynamic_cast<internal::Assembly::Scratch::StokesSystem<dim>& > (scratch_base);
-      internal::Assembly::CopyData::StokesSystem<dim> &data = dynamic_cast<internal::Assembly::CopyData::StokesSystem<dim>& > (data_base);
+      assemble (dynamic_cast<internal::Assembly::Scratch::StokesSystem<dim>& > (scratch_base),
+                dynamic_cast<internal::Assembly::CopyData::StokesSystem<dim>& > (data_base));
+    }
+
+
+
+    template <int dim>
+    void
+    StokesCompressibleStrainRateViscosityTerm<dim>::
+    assemble (internal::Assembly::Scratch::StokesSystem<dim> &scratch,
+              internal::Assembly::CopyData::StokesSystem<dim> &data) const
+    {
 
       if (!scratch.rebuild_stokes_matrix)
         return;
@@ -352,8 +611,18 @@ namespace aspect
     execute (internal::Assembly::Scratch::ScratchBase<dim>   &scratch_base,
              internal::Assembly::CopyData::CopyDataBase<dim> &data_base) const
     {
-      internal::Assembly::Scratch::StokesSystem<dim> &scratch = dynamic_cast<internal::Assembly::Scratch::StokesSystem<dim>& > (scratch_base);
-      internal::Assembly::CopyData::StokesSystem<dim> &data = dynamic_cast<internal::Assembly::CopyData::StokesSystem<dim>& > (data_base);
+      assemble (dynamic_cast<internal::Assembly::Scratch::StokesSystem<dim>& > (scratch_base),
+                dynamic_cast<internal::Assembly::CopyData::StokesSystem<dim>& > (data_base));
+    }
+
+
+
+    template <int dim>
+    void
+    StokesReferenceDensityCompressibilityTerm<dim>::
+    assemble (internal::Assembly::Scratch::StokesSystem<dim> &scratch,
+              internal::Assembly::CopyData::StokesSystem<dim> &data) const
+    {
 
       // assemble RHS of:
       //  - div u = 1/rho * drho/dz g/||g||* u
@@ -401,8 +670,18 @@ namespace aspect
     execute (internal::Assembly::Scratch::ScratchBase<dim>   &scratch_base,
              internal::Assembly::CopyData::CopyDataBase<dim> &data_base) const
     {
-      internal::Assembly::Scratch::StokesSystem<dim> &scratch = dynamic_cast<internal::Assembly::Scratch::StokesSystem<dim>& > (scratch_base);
-      internal::Assembly::CopyData::StokesSystem<dim> &data = dynamic_cast<internal::Assembly::CopyData::StokesSystem<dim>& > (data_base);
+      assemble (dynamic_cast<internal::Assembly::Scratch::StokesSystem<dim>& > (scratch_base),
+                dynamic_cast<internal::Assembly::CopyData::StokesSystem<dim>& > (data_base));
+    }
+
+
+
+    template <int dim>
+    void
+    StokesImplicitReferenceDensityCompressibilityTerm<dim>::
+    assemble (internal::Assembly::Scratch::StokesSystem<dim> &scratch,
+              internal::Assembly::CopyData::StokesSystem<dim> &data) const
+    {
 
       // assemble compressibility term of:
       //  - div u - 1/rho * drho/dz g/||g||* u = 0
@@ -455,8 +734,18 @@ namespace aspect
     execute (internal::Assembly::Scratch::ScratchBase<dim>   &scratch_base,
              internal::Assembly::CopyData::CopyDataBase<dim> &data_base) const
     {
-      internal::Assembly::Scratch::StokesSystem<dim> &scratch = dynamic_cast<internal::Assembly::Scratch::StokesSystem<dim>& > (scratch_base);
-      internal::Assembly::CopyData::StokesSystem<dim> &data = dynamic_cast<internal::Assembly::CopyData::StokesSystem<dim>& > (data_base);
+      assemble (dynamic_cast<internal::Assembly::Scratch::StokesSystem<dim>& > (scratch_base),
+                dynamic_cast<internal::Assembly::CopyData::StokesSystem<dim>& > (data_base));
+    }
+
+
+
+    template <int dim>
+    void
+    StokesIsothermalCompressionTerm<dim>::
+    assemble (internal::Assembly::Scratch::StokesSystem<dim> &scratch,
+              internal::Assembly::CopyData::StokesSystem<dim> &data) const
+    {
 
       // assemble RHS of:
       //  - div \mathbf{u} = \frac{1}{\rho} \frac{\partial rho}{\partial p} \rho \mathbf{g} \cdot \mathbf{u}
@@ -514,8 +803,18 @@ namespace aspect
     execute (internal::Assembly::Scratch::ScratchBase<dim>   &scratch_base,
              internal::Assembly::CopyData::CopyDataBase<dim> &data_base) const
     {
-      internal::Assembly::Scratch::StokesSystem<dim> &scratch = dynamic_cast<internal::Assembly::Scratch::StokesSystem<dim>& > (scratch_base);
-      internal::Assembly::CopyData::StokesSystem<dim> &data = dynamic_cast<internal::Assembly::CopyData::StokesSystem<dim>& > (data_base);
+      assemble (dynamic_cast<internal::Assembly::Scratch::StokesSystem<dim>& > (scratch_base),
+                dynamic_cast<internal::Assembly::CopyData::StokesSystem<dim>& > (data_base));
+    }
+
+
+
+    template <int dim>
+    void
+    StokesHydrostaticCompressionTerm<dim>::
+    assemble (internal::Assembly::Scratch::StokesSystem<dim> &scratch,
+              internal::Assembly::CopyData::StokesSystem<dim> &data) const
+    {
 
       // assemble RHS of:
       // $ -\nabla \cdot \mathbf{u} = \left( \kappa \rho \textbf{g} - \alpha \nabla T \right) \cdot \textbf{u}$
@@ -582,11 +881,22 @@ namespace aspect
 
     template <int dim>
     void
-    StokesPressureRHSCompatibilityModification<dim>::execute (internal::Assembly::Scratch::ScratchBase<dim>   &scratch_base,
-                                                              internal::Assembly::CopyData::CopyDataBase<dim> &data_base) const
+    StokesPressureRHSCompatibilityModification<dim>::
+    execute (internal::Assembly::Scratch::ScratchBase<dim>   &scratch_base,
+             internal::Assembly::CopyData::CopyDataBase<dim> &data_base) const
+    {
+      assemble (dynamic_cast<internal::Assembly::Scratch::StokesSystem<dim>& > (scratch_base),
+                dynamic_cast<internal::Assembly::CopyData::StokesSystem<dim>& > (data_base));
+    }
+
+
+
+    template <int dim>
+    void
+    StokesPressureRHSCompatibilityModification<dim>::
+    assemble (internal::Assembly::Scratch::StokesSystem<dim> &scratch,
+              internal::Assembly::CopyData::StokesSystem<dim> &data) const
     {
-      internal::Assembly::Scratch::StokesSystem<dim> &scratch = dynamic_cast<internal::Assembly::Scratch::StokesSystem<dim>& > (scratch_base);
-      internal::Assembly::CopyData::StokesSystem<dim> &data = dynamic_cast<internal::Assembly::CopyData::StokesSystem<dim>& > (data_base);
 
       const Introspection<dim> &introspection = this->introspection();
       const FiniteElement<dim> &fe = scratch.finite_element_values.get_fe();
@@ -673,7 +983,15 @@ namespace aspect
   template class StokesIsothermalCompressionTerm<dim>; \
   template class StokesHydrostaticCompressionTerm<dim>; \
   template class StokesPressureRHSCompatibilityModification<dim>; \
-  template class StokesBoundaryTraction<dim>;
+  template class StokesBoundaryTraction<dim>; \
+  template void StokesPreconditioner<dim>::assemble_boussinesq<2> (internal::Assembly::Scratch::StokesPreconditioner<dim> &, \
+                                                                   internal::Assembly::CopyData::StokesPreconditioner<dim> &) const; \
+  template void StokesPreconditioner<dim>::assemble_boussinesq<3> (internal::Assembly::Scratch::StokesPreconditioner<dim> &, \
+                                                                   internal::Assembly::CopyData::StokesPreconditioner<dim> &) const; \
+  template void StokesIncompressibleTerms<dim>::assemble_boussinesq<2> (internal::Assembly::Scratch::StokesSystem<dim> &, \
+                                                                        internal::Assembly::CopyData::StokesSystem<dim> &) const; \
+  template void StokesIncompressibleTerms<dim>::assemble_boussinesq<3> (internal::Assembly::Scratch::StokesSystem<dim> &, \
+                                                                        internal::Assembly::CopyData::StokesSystem<dim> &) const;
 
     ASPECT_INSTANTIATE(INSTANTIATE)
   }
@@ -28,6 +28,7 @@
 #include <aspect/melt.h>
 #include <aspect/newton.h>
 #include <aspect/free_surface.h>
+#include <aspect/stokes_matrix_free.h>
 #include <aspect/simulator/assemblers/stokes.h>
 #include <aspect/simulator/assemblers/advection.h>
 
@@ -44,6 +45,7 @@
 #include <deal.II/dofs/dof_tools.h>
 #include <deal.II/fe/fe_values.h>
 
+#include <algorithm>
 #include <limits>
 
 
@@ -81,20 +83,18 @@ namespace aspect
     else
       material_model_inputs.strain_rate.resize(0);
 
-    // the values of the compositional fields are stored as block vectors for each field
-    // we have to extract them in this structure
-    std::vector<std::vector<double> > composition_values (introspection.n_compositional_fields,
-                                                          std::vector<double> (n_q_points));
+    // the values of the compositional fields are stored as block vectors for each field,
+    // and the material model inputs store them field by field as well, so we can copy
+    // the values of each field into its contiguous storage
+    std::vector<double> composition_values (n_q_points);
 
     for (unsigned int c=0; c<introspection.n_compositional_fields; ++c)
-      input_finite_element_values[introspection.extractors.compositional_fields[c]].get_function_values(input_solution,
-          composition_values[c]);
-
-    // then we copy these values to exchange the inner and outer vector, because for the material
-    // model we need a vector with values of all the compositional fields for every quadrature point
-    for (unsigned int q=0; q<n_q_points; ++q)
-      for (unsigned int c=0; c<introspection.n_compositional_fields; ++c)
-        material_model_inputs.composition[q][c] = composition_values[c][q];
+      {
+        input_finite_element_values[introspection.extractors.compositional_fields[c]].get_function_values(input_solution,
+            composition_values);
+        std::copy (composition_values.begin(), composition_values.end(),
+                   material_model_inputs.composition.field_data(c));
+      }
 
     DEAL_II_DISABLE_EXTRA_DIAGNOSTICS
     material_model_inputs.cell = &cell;
@@ -119,6 +119,559 @@ namespace aspect
         if (SimulatorAccess<dim> *p = dynamic_cast<SimulatorAccess<dim>* >(assemblers[i].get()))
           p->initialize_simulator(simulator);
     }
+
+
+
+    // Try to compose the Stokes system assemblers statically as the
+    // sequence AssemblerTypes, with or without the assembler for the
+    // pressure right hand side compatibility modification at the end.
+    template <int dim, class... AssemblerTypes>
+    std::function<void (internal::Assembly::Scratch::StokesSystem<dim> &,
+                        internal::Assembly::CopyData::StokesSystem<dim> &)>
+    compose_stokes_system_statically (const std::vector<std::unique_ptr<Assemblers::Interface<dim> > > &assemblers)
+    {
+      typedef internal::Assembly::Scratch::StokesSystem<dim> ScratchType;
+      typedef internal::Assembly::CopyData::StokesSystem<dim> CopyDataType;
+
+      std::function<void (ScratchType &, CopyDataType &)> composed_assemblers
+        = Assemblers::compose_statically<dim, ScratchType, CopyDataType,
+          AssemblerTypes...> (assemblers);
+
+      if (!composed_assemblers)
+        composed_assemblers
+          = Assemblers::compose_statically<dim, ScratchType, CopyDataType,
+            AssemblerTypes..., Assemblers::StokesPressureRHSCompatibilityModification<dim> > (assemblers);
+
+      return composed_assemblers;
+    }
+
+
+
+    // Same as above, but also try all of the built-in assemblers for the
+    // terms of the mass conservation equation after AssemblerTypes.
+    template <int dim, class... AssemblerTypes>
+    std::function<void (internal::Assembly::Scratch::StokesSystem<dim> &,
+                        internal::Assembly::CopyData::StokesSystem<dim> &)>
+    compose_stokes_system_with_mass_conservation_statically (const std::vector<std::unique_ptr<Assemblers::Interface<dim> > > &assemblers)
+    {
+      std::function<void (internal::Assembly::Scratch::StokesSystem<dim> &,
+                          internal::Assembly::CopyData::StokesSystem<dim> &)> composed_assemblers
+        = compose_stokes_system_statically<dim, AssemblerTypes...> (assemblers);
+
+      if (!composed_assemblers)
+        composed_assemblers = compose_stokes_system_statically<dim, AssemblerTypes...,
+        Assemblers::StokesIsothermalCompressionTerm<dim> > (assemblers);
+      if (!composed_assemblers)
+        composed_assemblers = compose_stokes_system_statically<dim, AssemblerTypes...,
+        Assemblers::StokesHydrostaticCompressionTerm<dim> > (assemblers);
+      if (!composed_assemblers)
+        composed_assemblers = compose_stokes_system_statically<dim, AssemblerTypes...,
+        Assemblers::StokesReferenceDensityCompressibilityTerm<dim> > (assemblers);
+      if (!composed_assemblers)
+        composed_assemblers = compose_stokes_system_statically<dim, AssemblerTypes...,
+        Assemblers::StokesImplicitReferenceDensityCompressibilityTerm<dim> > (assemblers);
+
+      return composed_assemblers;
+    }
+
+
+
+    // If the cell assemblers of the Stokes and advection systems are one of
+    // the combinations of built-in assemblers set up by
+    // set_default_assemblers() or the melt handler, replace the per-cell
+    // loop over the (virtual) assemblers by statically composed ones.
+    template <int dim>
+    void
+    compose_assemblers_statically (Assemblers::Manager<dim> &assemblers)
+    {
+      typedef internal::Assembly::Scratch::StokesPreconditioner<dim> PreconditionerScratch;
+      typedef internal::Assembly::CopyData::StokesPreconditioner<dim> PreconditionerCopyData;
+      typedef internal::Assembly::Scratch::AdvectionSystem<dim> AdvectionScratch;
+      typedef internal::Assembly::CopyData::AdvectionSystem<dim> AdvectionCopyData;
+
+      assemblers.static_stokes_preconditioner
+        = Assemblers::compose_statically<dim, PreconditionerScratch, PreconditionerCopyData,
+          Assemblers::StokesPreconditioner<dim> > (assemblers.stokes_preconditioner);
+      if (!assemblers.static_stokes_preconditioner)
+        assemblers.static_stokes_preconditioner
+          = Assemblers::compose_statically<dim, PreconditionerScratch, PreconditionerCopyData,
+            Assemblers::StokesPreconditioner<dim>,
+            Assemblers::StokesCompressiblePreconditioner<dim> > (assemblers.stokes_preconditioner);
+
+      assemblers.static_stokes_system
+        = compose_stokes_system_with_mass_conservation_statically<dim,
+          Assemblers::StokesIncompressibleTerms<dim> > (assemblers.stokes_system);
+      if (!assemblers.static_stokes_system)
+        assemblers.static_stokes_system
+          = compose_stokes_system_with_mass_conservation_statically<dim,
+            Assemblers::StokesIncompressibleTerms<dim>,
+            Assemblers::StokesCompressibleStrainRateViscosityTerm<dim> > (assemblers.stokes_system);
+
+      assemblers.static_advection_system
+        = Assemblers::compose_statically<dim, AdvectionScratch, AdvectionCopyData,
+          Assemblers::AdvectionSystem<dim> > (assemblers.advection_system);
+      if (!assemblers.static_advection_system)
+        assemblers.static_advection_system
+          = Assemblers::compose_statically<dim, AdvectionScratch, AdvectionCopyData,
+            Assemblers::MeltAdvectionSystem<dim> > (assemblers.advection_system);
+    }
+
+
+
+    // Return whether all assemblers in the given list are of the type
+    // AssemblerType.
+    template <int dim, class AssemblerType>
+    bool
+    all_assemblers_are_of_type (const std::vector<std::unique_ptr<Assemblers::Interface<dim> > > &assemblers)
+    {
+      for (unsigned int i=0; i<assemblers.size(); ++i)
+        if (typeid(*assemblers[i]) != typeid(AssemblerType))
+          return false;
+      return true;
+    }
+
+
+
+    // Let the statically composed Stokes assemblers call the kernels of the
+    // built-in assemblers whose loop bounds are fixed at compile time for
+    // the given velocity degree.
+    template <int dim, int velocity_degree>
+    void
+    use_boussinesq_stokes_assemblers (Assemblers::Manager<dim> &assemblers)
+    {
+      const Assemblers::StokesPreconditioner<dim> &preconditioner
+        = static_cast<const Assemblers::StokesPreconditioner<dim> &> (*assemblers.stokes_preconditioner[0]);
+      const Assemblers::StokesIncompressibleTerms<dim> &stokes_terms
+        = static_cast<const Assemblers::StokesIncompressibleTerms<dim> &> (*assemblers.stokes_system[0]);
+
+      assemblers.static_stokes_preconditioner
+        = [&preconditioner] (internal::Assembly::Scratch::StokesPreconditioner<dim> &scratch,
+                             internal::Assembly::CopyData::StokesPreconditioner<dim> &data)
+      {
+        preconditioner.template assemble_boussinesq<velocity_degree> (scratch, data);
+      };
+      assemblers.static_stokes_system
+        = [&stokes_terms] (internal::Assembly::Scratch::StokesSystem<dim> &scratch,
+                           internal::Assembly::CopyData::StokesSystem<dim> &data)
+      {
+        stokes_terms.template assemble_boussinesq<velocity_degree> (scratch, data);
+      };
+      assemblers.stokes_system_is_boussinesq = true;
+    }
+
+
+
+    // If the model is an incompressible (Boussinesq) model whose Stokes
+    // preconditioner and system are assembled by exactly the built-in
+    // assemblers, and the Stokes element is one for which the kernels with
+    // fixed loop bounds are instantiated, use these kernels.
+    template <int dim>
+    void
+    compose_boussinesq_assemblers_statically (Assemblers::Manager<dim> &assemblers,
+                                              const Parameters<dim>    &parameters,
+                                              const bool                material_model_is_compressible)
+    {
+      if (material_model_is_compressible
+          || parameters.include_melt_transport
+          || parameters.free_surface_enabled
+          || parameters.enable_additional_stokes_rhs
+          || parameters.enable_elasticity
+          || parameters.use_locally_conservative_discretization
+          || assemblers.stokes_preconditioner.size() != 1
+          || assemblers.stokes_system.size() != 1
+          || !all_assemblers_are_of_type<dim, Assemblers::StokesPreconditioner<dim> > (assemblers.stokes_preconditioner)
+          || !all_assemblers_are_of_type<dim, Assemblers::StokesIncompressibleTerms<dim> > (assemblers.stokes_system)
+          || !assemblers.stokes_system_on_boundary_face.empty())
+        return;
+
+      switch (parameters.stokes_velocity_degree)
+        {
+          case 2:
+            use_boussinesq_stokes_assemblers<dim,2> (assemblers);
+            break;
+          case 3:
+            use_boussinesq_stokes_assemblers<dim,3> (assemblers);
+            break;
+          default:
+            break;
+        }
+    }
+
+
+
+    // Return whether the system matrix of the advection field with the given
+    // field index is only assembled by the built-in advection assemblers.
+    // For compositional fields, these assemblers compute the same matrix for
+    // every field, except for the artificial viscosity.
+    template <int dim>
+    bool
+    has_only_builtin_advection_assemblers (const Assemblers::Manager<dim> &assemblers,
+                                           const unsigned int              field_index)
+    {
+      if (!all_assemblers_are_of_type<dim, Assemblers::AdvectionSystem<dim> > (assemblers.advection_system))
+        return false;
+
+      if (assemblers.advection_system_assembler_on_face_properties[field_index].need_face_finite_element_evaluation)
+        return (all_assemblers_are_of_type<dim, Assemblers::AdvectionSystemBoundaryFace<dim> > (assemblers.advection_system_on_boundary_face)
+                &&
+                all_assemblers_are_of_type<dim, Assemblers::AdvectionSystemInteriorFace<dim> > (assemblers.advection_system_on_interior_face));
+
+      return true;
+    }
+
+
+
+    // Return whether the Stokes system assembled by the given assemblers
+    // only depends on the viscosity and density (and the additional
+    // material model outputs) on each cell, so that it can be assembled
+    // incrementally.
+    template <int dim>
+    bool
+    allows_incremental_stokes_assembly (const std::vector<std::unique_ptr<Assemblers::Interface<dim> > > &assemblers)
+    {
+      for (unsigned int i=0; i<assemblers.size(); ++i)
+        if (typeid(*assemblers[i]) != typeid(Assemblers::StokesIncompressibleTerms<dim>)
+            &&
+            typeid(*assemblers[i]) != typeid(Assemblers::StokesCompressibleStrainRateViscosityTerm<dim>))
+          return false;
+      return true;
+    }
+  }
+
+
+
+  namespace internal
+  {
+    /**
+     * A class that stores the material model and heating model outputs
+     * computed in the quadrature points of each cell during the assembly of
+     * one advection field, so that the assembly of the other advection
+     * fields can reuse them instead of evaluating the material model again.
+     * The stored outputs are only valid as long as the linearization point
+     * they were computed from, the time step, and the quadrature formula do
+     * not change; prepare() checks this and discards all stored outputs
+     * otherwise. The Simulator deletes this object whenever the mesh or the
+     * degrees of freedom change.
+     */
+    template <int dim>
+    class AdvectionMaterialModelCache
+    {
+      public:
+        /**
+         * Constructor. The cache is initially empty.
+         */
+        AdvectionMaterialModelCache ();
+
+        /**
+         * Prepare the cache for the assembly of an advection field with the
+         * given linearization point (which is a vector with the partitioning
+         * of the locally owned degrees of freedom), time step number, and
+         * number of quadrature points per cell. If any of these differs from
+         * the previous call, all stored outputs are invalidated. This
+         * function needs to be called on all processors, and before the
+         * cells are assembled in parallel.
+         */
+        void prepare (const LinearAlgebra::BlockVector &linearization_point,
+                      const unsigned int                timestep_number,
+                      const unsigned int                n_q_points,
+                      const unsigned int                n_active_cells,
+                      const MPI_Comm                    mpi_communicator);
+
+        /**
+         * If outputs for the cell with the given active cell index are
+         * stored, copy them into @p material_model_outputs and
+         * @p heating_model_outputs and return true. Otherwise return false.
+         */
+        bool get (const unsigned int                        active_cell_index,
+                  MaterialModel::MaterialModelOutputs<dim> &material_model_outputs,
+                  HeatingModel::HeatingModelOutputs        &heating_model_outputs) const;
+
+        /**
+         * Store the outputs for the cell with the given active cell index.
+         * Different threads may call this function at the same time as long
+         * as they do so for different cells.
+         */
+        void store (const unsigned int                              active_cell_index,
+                    const MaterialModel::MaterialModelOutputs<dim> &material_model_outputs,
+                    const HeatingModel::HeatingModelOutputs        &heating_model_outputs);
+
+      private:
+        LinearAlgebra::BlockVector linearization_point;
+        unsigned int timestep_number;
+        unsigned int n_q_points;
+
+        std::vector<std::unique_ptr<MaterialModel::MaterialModelOutputs<dim> > > material_model_outputs;
+        std::vector<std::unique_ptr<HeatingModel::HeatingModelOutputs> > heating_model_outputs;
+
+        /**
+         * Whether the outputs stored for a cell are valid. We do not use a
+         * std::vector<bool> here, because different threads write the
+         * flags of different cells concurrently.
+         */
+        std::vector<unsigned char> is_valid;
+    };
+
+
+
+    template <int dim>
+    AdvectionMaterialModelCache<dim>::AdvectionMaterialModelCache ()
+      :
+      timestep_number (numbers::invalid_unsigned_int),
+      n_q_points (numbers::invalid_unsigned_int)
+    {}
+
+
+
+    template <int dim>
+    void
+    AdvectionMaterialModelCache<dim>::prepare (const LinearAlgebra::BlockVector &linearization_point,
+                                               const unsigned int                timestep_number,
+                                               const unsigned int                n_q_points,
+                                               const unsigned int                n_active_cells,
+                                               const MPI_Comm                    mpi_communicator)
+    {
+      bool is_unchanged = (timestep_number == this->timestep_number
+                           && n_q_points == this->n_q_points
+                           && n_active_cells == is_valid.size()
+                           && linearization_point.n_blocks() == this->linearization_point.n_blocks()
+                           && linearization_point.size() == this->linearization_point.size());
+
+      if (is_unchanged)
+        for (unsigned int b=0; b<linearization_point.n_blocks(); ++b)
+          if (linearization_point.block(b).locally_owned_elements() != this->linearization_point.block(b).locally_owned_elements()
+              || !std::equal (linearization_point.block(b).begin(),
+                              linearization_point.block(b).end(),
+                              this->linearization_point.block(b).begin()))
+            {
+              is_unchanged = false;
+              break;
+            }
+
+      // the material model inputs on a cell also depend on the ghost
+      // entries of the linearization point, so all processors need to agree
+      if (dealii::Utilities::MPI::min (is_unchanged ? 1 : 0, mpi_communicator) == 1)
+        return;
+
+      this->linearization_point = linearization_point;
+      this->timestep_number = timestep_number;
+      this->n_q_points = n_q_points;
+
+      if (material_model_outputs.size() != n_active_cells)
+        {
+          material_model_outputs.clear();
+          heating_model_outputs.clear();
+          material_model_outputs.resize (n_active_cells);
+          heating_model_outputs.resize (n_active_cells);
+        }
+      is_valid.assign (n_active_cells, 0);
+    }
+
+
+
+    template <int dim>
+    bool
+    AdvectionMaterialModelCache<dim>::get (const unsigned int                        active_cell_index,
+                                           MaterialModel::MaterialModelOutputs<dim> &material_model_outputs,
+                                           HeatingModel::HeatingModelOutputs        &heating_model_outputs) const
+    {
+      Assert (active_cell_index < is_valid.size(), ExcInternalError());
+      if (!is_valid[active_cell_index])
+        return false;
+
+      material_model_outputs = *this->material_model_outputs[active_cell_index];
+      heating_model_outputs = *this->heating_model_outputs[active_cell_index];
+      return true;
+    }
+
+
+
+    template <int dim>
+    void
+    AdvectionMaterialModelCache<dim>::store (const unsigned int                              active_cell_index,
+                                             const MaterialModel::MaterialModelOutputs<dim> &material_model_outputs,
+                                             const HeatingModel::HeatingModelOutputs        &heating_model_outputs)
+    {
+      Assert (active_cell_index < is_valid.size(), ExcInternalError());
+      Assert (material_model_outputs.additional_outputs.empty(),
+              ExcMessage ("Additional material model outputs can not be stored in the cache."));
+
+      if (this->material_model_outputs[active_cell_index])
+        {
+          *this->material_model_outputs[active_cell_index] = material_model_outputs;
+          *this->heating_model_outputs[active_cell_index] = heating_model_outputs;
+        }
+      else
+        {
+          this->material_model_outputs[active_cell_index]
+            = std_cxx14::make_unique<MaterialModel::MaterialModelOutputs<dim> > (material_model_outputs);
+          this->heating_model_outputs[active_cell_index]
+            = std_cxx14::make_unique<HeatingModel::HeatingModelOutputs> (heating_model_outputs);
+        }
+      is_valid[active_cell_index] = 1;
+    }
+
+
+
+    /**
+     * A class that stores the contributions of every locally owned cell to
+     * the Stokes matrix and right hand side, together with the viscosity
+     * and density they were computed from. In the later nonlinear
+     * iterations of a time step, this allows to skip the cells whose
+     * viscosity and density did not change, and to only add the difference
+     * between the new and the old contributions of all other cells to the
+     * system, instead of assembling the whole system from scratch. Because
+     * the constraints (and the gravity and the mesh) may change from one
+     * time step to the next, the Simulator creates a new object in the
+     * first assembly of every time step.
+     */
+    template <int dim>
+    class IncrementalStokesAssembly
+    {
+      public:
+        /**
+         * Constructor.
+         */
+        IncrementalStokesAssembly (const unsigned int n_active_cells,
+                                   const unsigned int timestep_number);
+
+        /**
+         * Return whether the contributions of all locally owned cells have
+         * been stored in the given time step, i.e., whether the next
+         * assembly only needs to add differences.
+         */
+        bool is_complete_for (const unsigned int timestep_number) const;
+
+        /**
+         * Record that the contributions of all locally owned cells have
+         * been stored.
+         */
+        void set_complete ();
+
+        /**
+         * Return whether the viscosity and density in @p material_model_outputs
+         * differ from the ones the stored contributions of the cell with the
+         * given active cell index were computed from by no more than the
+         * relative @p tolerance. This is never the case if nothing is stored
+         * for the cell yet, or if there are additional material model
+         * outputs, which we can not compare.
+         */
+        bool cell_is_unchanged (const unsigned int                              active_cell_index,
+                                const MaterialModel::MaterialModelOutputs<dim> &material_model_outputs,
+                                const double                                    tolerance) const;
+
+        /**
+         * Store the contributions of the cell with the given active cell
+         * index in @p data and the viscosity and density they were
+         * computed from, and replace the contributions in @p data by their
+         * difference to the previously stored ones (if any). Different
+         * threads may call this function at the same time as long as they
+         * do so for different cells.
+         */
+        void replace_contributions (const unsigned int                              active_cell_index,
+                                    const MaterialModel::MaterialModelOutputs<dim> &material_model_outputs,
+                                    internal::Assembly::CopyData::StokesSystem<dim> &data);
+
+      private:
+        struct CellContributions
+        {
+          std::vector<double> viscosities;
+          std::vector<double> densities;
+          FullMatrix<double>  local_matrix;
+          Vector<double>      local_rhs;
+        };
+
+        const unsigned int timestep_number;
+        bool is_complete;
+        std::vector<std::unique_ptr<CellContributions> > cell_contributions;
+    };
+
+
+
+    template <int dim>
+    IncrementalStokesAssembly<dim>::IncrementalStokesAssembly (const unsigned int n_active_cells,
+                                                               const unsigned int timestep_number)
+      :
+      timestep_number (timestep_number),
+      is_complete (false),
+      cell_contributions (n_active_cells)
+    {}
+
+
+
+    template <int dim>
+    bool
+    IncrementalStokesAssembly<dim>::is_complete_for (const unsigned int timestep_number) const
+    {
+      return (is_complete && timestep_number == this->timestep_number);
+    }
+
+
+
+    template <int dim>
+    void
+    IncrementalStokesAssembly<dim>::set_complete ()
+    {
+      is_complete = true;
+    }
+
+
+
+    template <int dim>
+    bool
+    IncrementalStokesAssembly<dim>::cell_is_unchanged (const unsigned int                              active_cell_index,
+                                                       const MaterialModel::MaterialModelOutputs<dim> &material_model_outputs,
+                                                       const double                                    tolerance) const
+    {
+      Assert (active_cell_index < cell_contributions.size(), ExcInternalError());
+
+      if (!cell_contributions[active_cell_index]
+          || !material_model_outputs.additional_outputs.empty())
+        return false;
+
+      const CellContributions &stored = *cell_contributions[active_cell_index];
+      for (unsigned int q=0; q<material_model_outputs.viscosities.size(); ++q)
+        if (std::abs(material_model_outputs.viscosities[q] - stored.viscosities[q]) > tolerance * std::abs(stored.viscosities[q])
+            ||
+            std::abs(material_model_outputs.densities[q] - stored.densities[q]) > tolerance * std::abs(stored.densities[q]))
+          return false;
+
+      return true;
+    }
+
+
+
+    template <int dim>
+    void
+    IncrementalStokesAssembly<dim>::replace_contributions (const unsigned int                              active_cell_index,
+                                                           const MaterialModel::MaterialModelOutputs<dim> &material_model_outputs,
+                                                           internal::Assembly::CopyData::StokesSystem<dim> &data)
+    {
+      Assert (active_cell_index < cell_contributions.size(), ExcInternalError());
+
+      if (!cell_contributions[active_cell_index])
+        {
+          cell_contributions[active_cell_index] = std_cxx14::make_unique<CellContributions> ();
+          CellContributions &stored = *cell_contributions[active_cell_index];
+          stored.viscosities = material_model_outputs.viscosities;
+          stored.densities = material_model_outputs.densities;
+          stored.local_matrix = data.local_matrix;
+          stored.local_rhs = data.local_rhs;
+          return;
+        }
+
+      CellContributions &stored = *cell_contributions[active_cell_index];
+      stored.viscosities = material_model_outputs.viscosities;
+      stored.densities = material_model_outputs.densities;
+
+      // swap the new and the old contributions, and then compute
+      // new minus old in data
+      stored.local_matrix.swap (data.local_matrix);
+      stored.local_rhs.swap (data.local_rhs);
+
+      data.local_matrix *= -1.;
+      data.local_matrix.add (1., stored.local_matrix);
+      data.local_rhs.sadd (-1., 1., stored.local_rhs);
+    }
   }
 
   template <int dim>
@@ -290,6 +843,11 @@ namespace aspect
     initialize_simulator(*this,assemblers->advection_system);
     initialize_simulator(*this,assemblers->advection_system_on_boundary_face);
     initialize_simulator(*this,assemblers->advection_system_on_interior_face);
+
+    compose_assemblers_statically(*assemblers);
+    compose_boussinesq_assemblers_statically(*assemblers,
+                                             parameters,
+                                             material_model->is_compressible());
   }
 
 
@@ -311,6 +869,7 @@ namespace aspect
 
     // Prepare the data structures for assembly
     scratch.reinit(cell);
+    scratch.cell_congruence_class = cell_congruence_classes->get_class(cell);
     data.local_matrix = 0;
 
     compute_material_model_input_values (current_linearization_point,
@@ -319,6 +878,18 @@ namespace aspect
                                          true,
                                          scratch.material_model_inputs);
 
+    // the preconditioner only depends on the viscosity (and on additional
+    // outputs, which are always computed), except for models with melt
+    // transport, whose assemblers also query other properties. Assemblers
+    // that need more properties can add them to the requested properties
+    // in create_additional_material_model_outputs(), which is called below.
+    scratch.material_model_outputs.requested_properties
+      = (parameters.include_melt_transport
+         ?
+         MaterialModel::MaterialProperties::all_properties
+         :
+         MaterialModel::MaterialProperties::viscosity);
+
     for (unsigned int i=0; i<assemblers->stokes_preconditioner.size(); ++i)
       assemblers->stokes_preconditioner[i]->create_additional_material_model_outputs(scratch.material_model_outputs);
 
@@ -330,8 +901,11 @@ namespace aspect
                                                scratch.finite_element_values.get_mapping(),
                                                scratch.material_model_outputs);
 
-    for (unsigned int i=0; i<assemblers->stokes_preconditioner.size(); ++i)
-      assemblers->stokes_preconditioner[i]->execute(scratch,data);
+    if (assemblers->static_stokes_preconditioner)
+      assemblers->static_stokes_preconditioner(scratch,data);
+    else
+      for (unsigned int i=0; i<assemblers->stokes_preconditioner.size(); ++i)
+        assemblers->stokes_preconditioner[i]->execute(scratch,data);
   }
 
 
@@ -416,9 +990,43 @@ namespace aspect
     if (parameters.use_direct_stokes_solver)
       return;
 
+    // If requested, keep the existing AMG preconditioner (and the matrix
+    // it was built from) as long as the outer iteration count of the
+    // Stokes solver has not grown by more than the given factor since the
+    // first solve with this preconditioner. The preconditioner is reset
+    // in setup_system_preconditioner() whenever the mesh changes, which
+    // forces a rebuild.
+    if (parameters.stokes_preconditioner_reuse_factor > 0
+        && !stokes_matrix_free
+        && Amg_preconditioner
+        && stokes_iterations_after_preconditioner_rebuild != numbers::invalid_unsigned_int
+        && last_stokes_iterations != numbers::invalid_unsigned_int
+        && last_stokes_iterations <= parameters.stokes_preconditioner_reuse_factor
+        * std::max (stokes_iterations_after_preconditioner_rebuild, 1U))
+      {
+        pcout << "   Reusing Stokes preconditioner." << std::endl;
+        rebuild_stokes_preconditioner = false;
+        return;
+      }
+
     TimerOutput::Scope timer (computing_timer, "   Build Stokes preconditioner");
     pcout << "   Rebuilding Stokes preconditioner..." << std::flush;
 
+    // the next Stokes solve sets the reference iteration count for
+    // deciding whether to reuse this preconditioner later on
+    stokes_iterations_after_preconditioner_rebuild = numbers::invalid_unsigned_int;
+
+    // the matrix-free Stokes solver only needs the diagonals of its
+    // multigrid level operators and of the Schur complement approximation
+    if (stokes_matrix_free)
+      {
+        stokes_matrix_free->build_preconditioner();
+        rebuild_stokes_preconditioner = false;
+
+        pcout << std::endl;
+        return;
+      }
+
     // first assemble the raw matrices necessary for the preconditioner
     assemble_stokes_preconditioner ();
 
@@ -504,13 +1112,29 @@ namespace aspect
         Mp_preconditioner_AMG->initialize (system_preconditioner_matrix.block(1,1), Amg_data);
       }
 
-    if (parameters.free_surface_enabled || parameters.include_melt_transport || parameters.use_full_A_block_preconditioner)
-      Amg_preconditioner->initialize (system_matrix.block(0,0),
-                                      Amg_data);
+    const LinearAlgebra::SparseMatrix &velocity_preconditioner_matrix
+      = ((parameters.free_surface_enabled || parameters.include_melt_transport || parameters.use_full_A_block_preconditioner)
+         ?
+         system_matrix.block(0,0)
+         :
+         system_preconditioner_matrix.block(0,0));
+
+    // the velocity block is the first block, so its rows are numbered
+    // like the velocity degrees of freedom
+    if (parameters.AMG_use_rigid_body_modes)
+      Utilities::initialize_amg_with_rigid_body_modes (*Amg_preconditioner,
+                                                       velocity_preconditioner_matrix,
+                                                       Amg_data,
+                                                       *mapping,
+                                                       dof_handler,
+                                                       introspection.component_indices.velocities[0]);
     else
-      Amg_preconditioner->initialize (system_preconditioner_matrix.block(0,0),
+      Amg_preconditioner->initialize (velocity_preconditioner_matrix,
                                       Amg_data);
 
+    if (parameters.schur_complement_approximation == Parameters<dim>::SchurComplementApproximation::weighted_bfbt)
+      build_weighted_bfbt_preconditioner ();
+
     rebuild_stokes_preconditioner = false;
 
     pcout << std::endl;
@@ -518,6 +1142,109 @@ namespace aspect
 
 
 
+  template <int dim>
+  void
+  Simulator<dim>::build_weighted_bfbt_preconditioner ()
+  {
+#ifdef ASPECT_USE_PETSC
+    AssertThrow (false, ExcNotImplemented());
+#else
+    const IndexSet &velocity_partitioning = introspection.index_sets.stokes_partitioning[0];
+    const IndexSet &pressure_partitioning = introspection.index_sets.stokes_partitioning[1];
+
+    // the diagonal weight D is the diagonal of the velocity block, which
+    // scales with the local viscosity
+    bfbt_inverse_diagonal.reinit (velocity_partitioning, mpi_communicator);
+    for (unsigned int k=0; k<velocity_partitioning.n_elements(); ++k)
+      {
+        const types::global_dof_index i = velocity_partitioning.nth_index_in_set(k);
+        const double diagonal = system_matrix.block(0,0).diag_element(i);
+        bfbt_inverse_diagonal(i) = (diagonal != 0 ? 1./diagonal : 0.);
+      }
+    bfbt_inverse_diagonal.compress (VectorOperation::insert);
+
+    // compute B D^{-1} B^T from the gradient block B^T. We use B^T for both
+    // factors so that the result is symmetric also for compressible models
+    LinearAlgebra::SparseMatrix product;
+    system_matrix.block(0,1).Tmmult (product, system_matrix.block(0,1), bfbt_inverse_diagonal);
+
+    // the rows of constrained pressure degrees of freedom (e.g., on hanging
+    // nodes) are empty, which the AMG cannot deal with. copy the product into
+    // a matrix that also has the diagonal entries, and put the average
+    // diagonal entry into these rows
+    TrilinosWrappers::SparsityPattern sp (pressure_partitioning, pressure_partitioning,
+                                          mpi_communicator);
+    double diagonal_sum = 0;
+    types::global_dof_index n_nonzero_diagonals = 0;
+    for (unsigned int k=0; k<pressure_partitioning.n_elements(); ++k)
+      {
+        const types::global_dof_index i = pressure_partitioning.nth_index_in_set(k);
+        sp.add (i, i);
+        for (LinearAlgebra::SparseMatrix::const_iterator entry = product.begin(i);
+             entry != product.end(i); ++entry)
+          sp.add (i, entry->column());
+
+        const double diagonal = product.diag_element(i);
+        if (diagonal != 0)
+          {
+            diagonal_sum += diagonal;
+            ++n_nonzero_diagonals;
+          }
+      }
+    sp.compress ();
+
+    const double average_diagonal = Utilities::MPI::sum (diagonal_sum, mpi_communicator)
+                                    / std::max<types::global_dof_index> (Utilities::MPI::sum (n_nonzero_diagonals, mpi_communicator),
+                                                                         1);
+
+    bfbt_pressure_matrix.reinit (sp);
+    bfbt_null_space.reinit (pressure_partitioning, mpi_communicator);
+    for (unsigned int k=0; k<pressure_partitioning.n_elements(); ++k)
+      {
+        const types::global_dof_index i = pressure_partitioning.nth_index_in_set(k);
+        for (LinearAlgebra::SparseMatrix::const_iterator entry = product.begin(i);
+             entry != product.end(i); ++entry)
+          bfbt_pressure_matrix.set (i, entry->column(), entry->value());
+
+        if (product.diag_element(i) == 0)
+          bfbt_pressure_matrix.set (i, i, average_diagonal);
+        else
+          bfbt_null_space(i) = 1.;
+      }
+    bfbt_pressure_matrix.compress (VectorOperation::insert);
+    bfbt_null_space.compress (VectorOperation::insert);
+
+    // if there are no open boundaries, the pressure (restricted to the
+    // unconstrained degrees of freedom) is only determined up to a constant,
+    // and so is the solution with B D^{-1} B^T. find out whether this is the
+    // case, so that we can project the right hand sides of these solves
+    // onto the range of the matrix
+    {
+      LinearAlgebra::Vector tmp (bfbt_null_space);
+      bfbt_pressure_matrix.vmult (tmp, bfbt_null_space);
+      const double null_space_norm = bfbt_null_space.l2_norm();
+      bfbt_has_null_space = (null_space_norm > 0
+                             &&
+                             tmp.l2_norm() <= 1e-10 * average_diagonal * null_space_norm);
+      if (bfbt_has_null_space)
+        bfbt_null_space /= null_space_norm;
+    }
+
+    LinearAlgebra::PreconditionAMG::AdditionalData Amg_data;
+    Amg_data.elliptic = true;
+    Amg_data.higher_order_elements = false;
+    Amg_data.smoother_type = parameters.AMG_smoother_type.c_str();
+    Amg_data.smoother_sweeps = parameters.AMG_smoother_sweeps;
+    Amg_data.aggregation_threshold = parameters.AMG_aggregation_threshold;
+    Amg_data.output_details = parameters.AMG_output_details;
+
+    Bfbt_preconditioner.reset (new LinearAlgebra::PreconditionAMG());
+    Bfbt_preconditioner->initialize (bfbt_pressure_matrix, Amg_data);
+#endif
+  }
+
+
+
   template <int dim>
   void
   Simulator<dim>::
@@ -537,12 +1264,14 @@ namespace aspect
 
     // Prepare the data structures for assembly
     scratch.reinit(cell);
+    scratch.cell_congruence_class = cell_congruence_classes->get_class(cell);
 
     if (rebuild_stokes_matrix)
       data.local_matrix = 0;
     data.local_rhs = 0;
     if (do_pressure_rhs_compatibility_modification)
       data.local_pressure_shape_function_integrals = 0;
+    data.has_local_contributions = true;
 
     // initialize the material model data on the cell
     compute_material_model_input_values (current_linearization_point,
@@ -551,8 +1280,10 @@ namespace aspect
                                          assemble_newton_stokes_system ? true : rebuild_stokes_matrix,
                                          scratch.material_model_inputs);
 
-    for (unsigned int i=0; i<assemblers->stokes_system.size(); ++i)
-      assemblers->stokes_system[i]->create_additional_material_model_outputs(scratch.material_model_outputs);
+    // the Boussinesq kernels do not use any additional outputs
+    if (!assemblers->stokes_system_is_boussinesq)
+      for (unsigned int i=0; i<assemblers->stokes_system.size(); ++i)
+        assemblers->stokes_system[i]->create_additional_material_model_outputs(scratch.material_model_outputs);
 
     material_model->evaluate(scratch.material_model_inputs,
                              scratch.material_model_outputs);
@@ -562,8 +1293,21 @@ namespace aspect
                                                scratch.finite_element_values.get_mapping(),
                                                scratch.material_model_outputs);
 
-    scratch.finite_element_values[introspection.extractors.velocities].get_function_values(current_linearization_point,
-        scratch.velocity_values);
+    // in an incremental assembly, the contributions of cells whose
+    // viscosity and density did not change are already part of the system
+    if (incremental_stokes_assembly
+        && incremental_stokes_assembly->cell_is_unchanged (cell->active_cell_index(),
+                                                           scratch.material_model_outputs,
+                                                           parameters.incremental_stokes_assembly_tolerance))
+      {
+        data.has_local_contributions = false;
+        return;
+      }
+
+    // only the assemblers of compressible models need the velocity
+    if (!assemblers->stokes_system_is_boussinesq)
+      scratch.finite_element_values[introspection.extractors.velocities].get_function_values(current_linearization_point,
+          scratch.velocity_values);
     if (assemble_newton_stokes_system)
       scratch.finite_element_values[introspection.extractors.velocities].get_function_divergences(current_linearization_point,scratch.velocity_divergence);
     if (parameters.formulation_mass_conservation == Parameters<dim>::Formulation::MassConservation::hydrostatic_compression)
@@ -585,8 +1329,16 @@ namespace aspect
 
     // trigger the invocation of the various functions that actually do
     // all of the assembling
-    for (unsigned int i=0; i<assemblers->stokes_system.size(); ++i)
-      assemblers->stokes_system[i]->execute(scratch,data);
+    if (assemblers->static_stokes_system)
+      assemblers->static_stokes_system(scratch,data);
+    else
+      for (unsigned int i=0; i<assemblers->stokes_system.size(); ++i)
+        assemblers->stokes_system[i]->execute(scratch,data);
+
+    if (incremental_stokes_assembly)
+      incremental_stokes_assembly->replace_contributions (cell->active_cell_index(),
+                                                          scratch.material_model_outputs,
+                                                          data);
 
     if (!assemblers->stokes_system_on_boundary_face.empty())
       {
@@ -641,7 +1393,18 @@ namespace aspect
   Simulator<dim>::
   copy_local_to_global_stokes_system (const internal::Assembly::CopyData::StokesSystem<dim> &data)
   {
-    if (rebuild_stokes_matrix == true)
+    if (!data.has_local_contributions)
+      return;
+
+    // The matrix-free Stokes solver never needs the assembled matrix, but
+    // we still use the local matrix to account for inhomogeneous
+    // constraints in the right hand side.
+    if (rebuild_stokes_matrix == true && stokes_matrix_free)
+      current_constraints.distribute_local_to_global (data.local_rhs,
+                                                      data.local_dof_indices,
+                                                      system_rhs,
+                                                      data.local_matrix);
+    else if (rebuild_stokes_matrix == true)
       current_constraints.distribute_local_to_global (data.local_matrix,
                                                       data.local_rhs,
                                                       data.local_dof_indices,
@@ -673,10 +1436,36 @@ namespace aspect
                                 :
                                 "   Assemble Stokes system rhs")));
 
-    if (rebuild_stokes_matrix == true)
-      system_matrix = 0;
+    // see if the Stokes system can be assembled incrementally, see the
+    // 'Use incremental assembly' parameter. if so, and if the contributions
+    // of all cells have already been stored in this time step, we only add
+    // the changes of the contributions to the existing matrix and right hand
+    // side. otherwise, we assemble them from scratch and store them.
+    const bool use_incremental_assembly = (parameters.use_incremental_stokes_assembly
+                                           && rebuild_stokes_matrix
+                                           && !assemble_newton_stokes_system
+                                           && !parameters.include_melt_transport
+                                           && !stokes_matrix_free
+                                           && !do_pressure_rhs_compatibility_modification
+                                           && assemblers->stokes_system_on_boundary_face.empty()
+                                           && allows_incremental_stokes_assembly (assemblers->stokes_system));
+    if (!use_incremental_assembly)
+      incremental_stokes_assembly.reset();
+    else if (!incremental_stokes_assembly
+             || !incremental_stokes_assembly->is_complete_for (timestep_number))
+      incremental_stokes_assembly = std::make_shared<internal::IncrementalStokesAssembly<dim> > (triangulation.n_active_cells(),
+                                    timestep_number);
+
+    const bool assemble_differences = (use_incremental_assembly
+                                       && incremental_stokes_assembly->is_complete_for (timestep_number));
+
+    if (!assemble_differences)
+      {
+        if (rebuild_stokes_matrix == true)
+          system_matrix = 0;
 
-    system_rhs = 0;
+        system_rhs = 0;
+      }
     if (do_pressure_rhs_compatibility_modification)
       pressure_shape_function_integrals = 0;
 
@@ -760,6 +1549,9 @@ namespace aspect
     system_matrix.compress(VectorOperation::add);
     system_rhs.compress(VectorOperation::add);
 
+    if (use_incremental_assembly)
+      incremental_stokes_assembly->set_complete();
+
     // if the model is compressible then we need to adjust the right hand
     // side of the equation to make it compatible with the matrix on the
     // left
@@ -770,23 +1562,142 @@ namespace aspect
       }
 
 
+    // the matrix-free Stokes solver replaces the matrix by the viscosity
+    // evaluated at the quadrature points
+    if (stokes_matrix_free && rebuild_stokes_matrix)
+      stokes_matrix_free->evaluate_viscosity();
+
     // record that we have just rebuilt the matrix
     rebuild_stokes_matrix = false;
   }
 
 
 
+  template <int dim>
+  bool
+  Simulator<dim>::reuses_composition_matrix (const AdvectionField &advection_field) const
+  {
+    return (!advection_field.is_temperature()
+            && composition_matrix_field != numbers::invalid_unsigned_int
+            && composition_matrix_field != advection_field.compositional_variable);
+  }
+
+
+
+  template <int dim>
+  void
+  Simulator<dim>::release_composition_matrix ()
+  {
+    if (composition_matrix_field != numbers::invalid_unsigned_int
+        && composition_matrix_field != 0)
+      {
+        const unsigned int block_idx = AdvectionField::composition(composition_matrix_field).block_index(introspection);
+        system_matrix.block(block_idx, block_idx).clear();
+      }
+
+    composition_matrix_field = numbers::invalid_unsigned_int;
+    composition_preconditioner.reset();
+  }
+
+
+
   template <int dim>
   void
-  Simulator<dim>::build_advection_preconditioner(const AdvectionField &advection_field,
-                                                 LinearAlgebra::PreconditionILU &preconditioner)
+  Simulator<dim>::build_advection_preconditioner(const AdvectionField                                          &advection_field,
+                                                 const typename Parameters<dim>::AdvectionPreconditioner::Kind  preconditioner_type,
+                                                 std::shared_ptr<LinearAlgebra::PreconditionBase>              &preconditioner)
   {
     TimerOutput::Scope timer (computing_timer, (advection_field.is_temperature() ?
                                                 "   Build temperature preconditioner" :
                                                 "   Build composition preconditioner"));
 
     const unsigned int block_idx = advection_field.block_index(introspection);
-    preconditioner.initialize (system_matrix.block(block_idx, block_idx));
+    const LinearAlgebra::SparseMatrix &matrix = system_matrix.block(block_idx, block_idx);
+
+    switch (preconditioner_type)
+      {
+        case Parameters<dim>::AdvectionPreconditioner::ilu:
+        {
+          std::shared_ptr<LinearAlgebra::PreconditionILU> ilu_preconditioner
+            = std::make_shared<LinearAlgebra::PreconditionILU> ();
+          ilu_preconditioner->initialize (matrix);
+          preconditioner = ilu_preconditioner;
+          break;
+        }
+
+        case Parameters<dim>::AdvectionPreconditioner::amg:
+        {
+          LinearAlgebra::PreconditionAMG::AdditionalData amg_data;
+#ifdef ASPECT_USE_PETSC
+          amg_data.symmetric_operator = false;
+#else
+          // the matrix is only nonsymmetric because of the advection term,
+          // which is small compared to the diffusion term if we get here
+          amg_data.elliptic = true;
+          amg_data.higher_order_elements = (advection_field.polynomial_degree(introspection) > 1);
+          amg_data.smoother_sweeps = 2;
+          amg_data.aggregation_threshold = parameters.AMG_aggregation_threshold;
+          amg_data.output_details = parameters.AMG_output_details;
+#endif
+          std::shared_ptr<LinearAlgebra::PreconditionAMG> amg_preconditioner
+            = std::make_shared<LinearAlgebra::PreconditionAMG> ();
+          amg_preconditioner->initialize (matrix, amg_data);
+          preconditioner = amg_preconditioner;
+          break;
+        }
+
+        case Parameters<dim>::AdvectionPreconditioner::jacobi:
+        {
+          std::shared_ptr<LinearAlgebra::PreconditionJacobi> jacobi_preconditioner
+            = std::make_shared<LinearAlgebra::PreconditionJacobi> ();
+          jacobi_preconditioner->initialize (matrix);
+          preconditioner = jacobi_preconditioner;
+          break;
+        }
+
+        case Parameters<dim>::AdvectionPreconditioner::chebyshev:
+        {
+#ifdef ASPECT_USE_PETSC
+          AssertThrow (false, ExcNotImplemented());
+#else
+          // the Chebyshev iteration needs an upper bound for the eigenvalues
+          // of the Jacobi preconditioned matrix. use the Gershgorin bound,
+          // i.e., the largest sum of the absolute values of a row divided
+          // by its diagonal entry
+          double max_row_sum = 0;
+          const std::pair<types::global_dof_index, types::global_dof_index> local_range = matrix.local_range();
+          for (types::global_dof_index row=local_range.first; row<local_range.second; ++row)
+            {
+              double row_sum = 0;
+              double diagonal = 0;
+              for (LinearAlgebra::SparseMatrix::const_iterator entry = matrix.begin(row);
+                   entry != matrix.end(row); ++entry)
+                {
+                  row_sum += std::abs(entry->value());
+                  if (entry->column() == row)
+                    diagonal = std::abs(entry->value());
+                }
+              if (diagonal > 0)
+                max_row_sum = std::max (max_row_sum, row_sum / diagonal);
+            }
+
+          TrilinosWrappers::PreconditionChebyshev::AdditionalData chebyshev_data;
+          chebyshev_data.degree = parameters.advection_chebyshev_degree;
+          chebyshev_data.max_eigenvalue = std::max (Utilities::MPI::max (max_row_sum, mpi_communicator),
+                                                    1.);
+          chebyshev_data.eigenvalue_ratio = parameters.advection_chebyshev_eigenvalue_ratio;
+
+          std::shared_ptr<TrilinosWrappers::PreconditionChebyshev> chebyshev_preconditioner
+            = std::make_shared<TrilinosWrappers::PreconditionChebyshev> ();
+          chebyshev_preconditioner->initialize (matrix, chebyshev_data);
+          preconditioner = chebyshev_preconditioner;
+#endif
+          break;
+        }
+
+        default:
+          AssertThrow (false, ExcNotImplemented());
+      }
   }
 
 
@@ -859,52 +1770,70 @@ namespace aspect
 
     heating_model_manager.create_additional_material_model_inputs_and_outputs(scratch.material_model_inputs,
                                                                               scratch.material_model_outputs);
-    material_model->fill_additional_material_model_inputs(scratch.material_model_inputs,
-                                                          current_linearization_point,
-                                                          scratch.finite_element_values,
-                                                          introspection);
 
-    material_model->evaluate(scratch.material_model_inputs,
-                             scratch.material_model_outputs);
-    if (parameters.formulation_temperature_equation ==
-        Parameters<dim>::Formulation::TemperatureEquation::reference_density_profile)
+    // if the material model and heating model outputs on this cell have
+    // already been computed for the current linearization point during the
+    // assembly of another advection field, reuse them. additional outputs
+    // can not be stored, so we can only do so if there are none.
+    const bool use_cache = (advection_material_model_cache
+                            && scratch.material_model_outputs.additional_outputs.empty());
+    if (!use_cache
+        || !advection_material_model_cache->get (cell->active_cell_index(),
+                                                 scratch.material_model_outputs,
+                                                 scratch.heating_model_outputs))
       {
-        const unsigned int n_q_points = scratch.finite_element_values.n_quadrature_points;
-        for (unsigned int q=0; q<n_q_points; ++q)
+        material_model->fill_additional_material_model_inputs(scratch.material_model_inputs,
+                                                              current_linearization_point,
+                                                              scratch.finite_element_values,
+                                                              introspection);
+
+        material_model->evaluate(scratch.material_model_inputs,
+                                 scratch.material_model_outputs);
+        if (parameters.formulation_temperature_equation ==
+            Parameters<dim>::Formulation::TemperatureEquation::reference_density_profile)
           {
-            scratch.material_model_outputs.densities[q] = adiabatic_conditions->density(scratch.material_model_inputs.position[q]);
+            const unsigned int n_q_points = scratch.finite_element_values.n_quadrature_points;
+            for (unsigned int q=0; q<n_q_points; ++q)
+              {
+                scratch.material_model_outputs.densities[q] = adiabatic_conditions->density(scratch.material_model_inputs.position[q]);
+              }
           }
-      }
 
 #ifdef DEBUG
-    // make sure that if the model does not use operator splitting,
-    // the material model outputs do not fill the reaction_rates (because the reaction_terms are used instead)
-    if (!parameters.use_operator_splitting)
-      {
-        material_model->create_additional_named_outputs(scratch.material_model_outputs);
-        MaterialModel::ReactionRateOutputs<dim> *reaction_rate_outputs
-          = scratch.material_model_outputs.template get_additional_output<MaterialModel::ReactionRateOutputs<dim> >();
-
-        Assert(reaction_rate_outputs == NULL,
-               ExcMessage("You are using a material model where the reaction rate outputs "
-                          "are created even though the operator splitting solver option is "
-                          "not used in the model, this is not supported! "
-                          "If operator splitting is disabled, the reaction_rates should not "
-                          "be created at all. If you want to run a model where reactions are "
-                          "much faster than the advection, which is what the reaction rate "
-                          "outputs are designed for, you should enable operator splitting."));
-      }
+        // make sure that if the model does not use operator splitting,
+        // the material model outputs do not fill the reaction_rates (because the reaction_terms are used instead)
+        if (!parameters.use_operator_splitting)
+          {
+            material_model->create_additional_named_outputs(scratch.material_model_outputs);
+            MaterialModel::ReactionRateOutputs<dim> *reaction_rate_outputs
+              = scratch.material_model_outputs.template get_additional_output<MaterialModel::ReactionRateOutputs<dim> >();
+
+            Assert(reaction_rate_outputs == NULL,
+                   ExcMessage("You are using a material model where the reaction rate outputs "
+                              "are created even though the operator splitting solver option is "
+                              "not used in the model, this is not supported! "
+                              "If operator splitting is disabled, the reaction_rates should not "
+                              "be created at all. If you want to run a model where reactions are "
+                              "much faster than the advection, which is what the reaction rate "
+                              "outputs are designed for, you should enable operator splitting."));
+          }
 #endif
 
-    MaterialModel::MaterialAveraging::average (parameters.material_averaging,
-                                               cell,
-                                               scratch.finite_element_values.get_quadrature(),
-                                               scratch.finite_element_values.get_mapping(),
-                                               scratch.material_model_outputs);
+        MaterialModel::MaterialAveraging::average (parameters.material_averaging,
+                                                   cell,
+                                                   scratch.finite_element_values.get_quadrature(),
+                                                   scratch.finite_element_values.get_mapping(),
+                                                   scratch.material_model_outputs);
+
+        heating_model_manager.evaluate(scratch.material_model_inputs,
+                                       scratch.material_model_outputs,
+                                       scratch.heating_model_outputs);
 
-    heating_model_manager.evaluate(scratch.material_model_inputs,
-                                   scratch.material_model_outputs,
-                                   scratch.heating_model_outputs);
+        if (use_cache && scratch.material_model_outputs.additional_outputs.empty())
+          advection_material_model_cache->store (cell->active_cell_index(),
+                                                 scratch.material_model_outputs,
+                                                 scratch.heating_model_outputs);
+      }
 
     // TODO: Compute artificial viscosity once per timestep instead of each time
     // temperature system is assembled (as this might happen more than once per
@@ -912,10 +1841,50 @@ namespace aspect
     scratch.artificial_viscosity = viscosity_per_cell[cell->active_cell_index()];
     Assert (scratch.artificial_viscosity >= 0, ExcMessage ("The artificial viscosity needs to be a non-negative quantity."));
 
+    // if the preconditioner is chosen automatically, compute the largest
+    // cell Peclet number u h / (2 kappa), where kappa is the sum of the
+    // physical and the artificial diffusivity
+    if (parameters.advection_preconditioner == Parameters<dim>::AdvectionPreconditioner::automatic)
+      {
+        const double h = cell->minimum_vertex_distance();
+        double cell_peclet_number = 0;
+        for (unsigned int q=0; q<scratch.finite_element_values.n_quadrature_points; ++q)
+          {
+            const double density_c_P = (advection_field.is_temperature()
+                                        ?
+                                        scratch.material_model_outputs.densities[q] *
+                                        scratch.material_model_outputs.specific_heat[q] +
+                                        scratch.heating_model_outputs.lhs_latent_heat_terms[q]
+                                        :
+                                        1.0);
+            const double diffusivity = ((advection_field.is_temperature()
+                                         ?
+                                         scratch.material_model_outputs.thermal_conductivities[q]
+                                         :
+                                         0.0)
+                                        + scratch.artificial_viscosity) / density_c_P;
+
+            Tensor<1,dim> current_u = scratch.current_velocity_values[q];
+            if (parameters.free_surface_enabled)
+              current_u -= scratch.mesh_velocity_values[q];
+
+            cell_peclet_number = std::max (cell_peclet_number,
+                                           (diffusivity > 0
+                                            ?
+                                            current_u.norm() * h / (2. * diffusivity)
+                                            :
+                                            std::numeric_limits<double>::infinity()));
+          }
+        advection_cell_peclet_numbers[cell->active_cell_index()] = cell_peclet_number;
+      }
+
     // trigger the invocation of the various functions that actually do
     // all of the assembling
-    for (unsigned int i=0; i<assemblers->advection_system.size(); ++i)
-      assemblers->advection_system[i]->execute(scratch,data);
+    if (assemblers->static_advection_system)
+      assemblers->static_advection_system(scratch,data);
+    else
+      for (unsigned int i=0; i<assemblers->advection_system.size(); ++i)
+        assemblers->advection_system[i]->execute(scratch,data);
 
     // then also work on possible face terms. if necessary, initialize
     // the material model data on faces
@@ -1011,6 +1980,18 @@ namespace aspect
   copy_local_to_global_advection_system (const AdvectionField &advection_field,
                                          const internal::Assembly::CopyData::AdvectionSystem<dim> &data)
   {
+    // if the field reuses the matrix of another compositional field, only
+    // copy the right hand side, but still use the local matrix to take
+    // care of inhomogeneous constraints
+    if (reuses_composition_matrix(advection_field))
+      {
+        current_constraints.distribute_local_to_global (data.local_rhs,
+                                                        data.local_dof_indices,
+                                                        system_rhs,
+                                                        data.local_matrix);
+        return;
+      }
+
     // copy entries into the global matrix. note that these local contributions
     // only correspond to the advection dofs, as assembled above
     current_constraints.distribute_local_to_global (data.local_matrix,
@@ -1062,16 +2043,59 @@ namespace aspect
 
     const unsigned int block_idx = advection_field.block_index(introspection);
 
-    if (!advection_field.is_temperature() && advection_field.compositional_variable!=0)
+    Vector<double> viscosity_per_cell;
+    viscosity_per_cell.reinit(triangulation.n_active_cells());
+    get_artificial_viscosity(viscosity_per_cell, advection_field);
+
+    if (!advection_field.is_temperature())
       {
-        // Allocate the system matrix for the current compositional field by
-        // reusing the Trilinos sparsity pattern from the matrix stored for
-        // composition 0 (this is the place we allocate the matrix at).
-        const unsigned int block0_idx = AdvectionField::composition(0).block_index(introspection);
-        system_matrix.block(block_idx, block_idx).reinit(system_matrix.block(block0_idx, block0_idx));
+        // Compositional fields whose matrix only depends on the artificial
+        // viscosity can reuse the matrix of the last such field, if their
+        // artificial viscosity is the same on all cells.
+        const bool matrix_is_field_independent
+          = (advection_field.advection_method(introspection) == Parameters<dim>::AdvectionFieldMethod::fem_field
+             &&
+             has_only_builtin_advection_assemblers (*assemblers, advection_field.field_index()));
+
+        const bool can_reuse_matrix
+          = (matrix_is_field_independent
+             &&
+             composition_matrix_field != numbers::invalid_unsigned_int
+             &&
+             assemblers->advection_system_assembler_on_face_properties[advection_field.field_index()].need_face_finite_element_evaluation
+             ==
+             assemblers->advection_system_assembler_on_face_properties[AdvectionField::composition(composition_matrix_field).field_index()].need_face_finite_element_evaluation
+             &&
+             Utilities::MPI::min ((viscosity_per_cell == composition_matrix_artificial_viscosity) ? 1 : 0,
+                                  mpi_communicator) == 1);
+
+        if (!can_reuse_matrix)
+          {
+            release_composition_matrix();
+
+            if (matrix_is_field_independent)
+              {
+                composition_matrix_field = advection_field.compositional_variable;
+                composition_matrix_artificial_viscosity = viscosity_per_cell;
+              }
+          }
       }
 
-    system_matrix.block(block_idx, block_idx) = 0;
+    const bool assemble_matrix = !reuses_composition_matrix(advection_field);
+
+    if (assemble_matrix)
+      {
+        if (!advection_field.is_temperature() && advection_field.compositional_variable!=0)
+          {
+            // Allocate the system matrix for the current compositional field by
+            // reusing the Trilinos sparsity pattern from the matrix stored for
+            // composition 0 (this is the place we allocate the matrix at).
+            const unsigned int block0_idx = AdvectionField::composition(0).block_index(introspection);
+            system_matrix.block(block_idx, block_idx).reinit(system_matrix.block(block0_idx, block0_idx));
+          }
+
+        system_matrix.block(block_idx, block_idx) = 0;
+      }
     system_rhs.block(block_idx) = 0;
 
 
@@ -1079,10 +2103,6 @@ namespace aspect
     FilteredIterator<typename DoFHandler<dim>::active_cell_iterator>
     CellFilter;
 
-    Vector<double> viscosity_per_cell;
-    viscosity_per_cell.reinit(triangulation.n_active_cells());
-    get_artificial_viscosity(viscosity_per_cell, advection_field);
-
     // We have to assemble the term u.grad phi_i * phi_j, which is
     // of total polynomial degree
     //   stokes_deg + 2*temp_deg -1
@@ -1105,6 +2125,24 @@ namespace aspect
     const bool allocate_neighbor_contributions = !assemblers->advection_system_on_interior_face.empty() &&
                                                  assemblers->advection_system_assembler_on_face_properties[advection_field.field_index()].need_face_finite_element_evaluation;;
 
+    if (parameters.cache_advection_material_model_outputs)
+      {
+        if (!advection_material_model_cache)
+          advection_material_model_cache = std::make_shared<internal::AdvectionMaterialModelCache<dim> > ();
+
+        LinearAlgebra::BlockVector distributed_linearization_point (introspection.index_sets.system_partitioning,
+                                                                    mpi_communicator);
+        distributed_linearization_point = current_linearization_point;
+        advection_material_model_cache->prepare (distributed_linearization_point,
+                                                 timestep_number,
+                                                 QGauss<dim>(advection_quadrature_degree).size(),
+                                                 triangulation.n_active_cells(),
+                                                 mpi_communicator);
+      }
+
+    if (parameters.advection_preconditioner == Parameters<dim>::AdvectionPreconditioner::automatic)
+      advection_cell_peclet_numbers.reinit (triangulation.n_active_cells());
+
     const UpdateFlags update_flags = update_values |
                                      update_gradients |
                                      update_quadrature_points |
@@ -1156,8 +2194,23 @@ namespace aspect
          AdvectionSystem<dim> (finite_element.base_element(advection_field.base_element(introspection)),
                                allocate_neighbor_contributions));
 
-    system_matrix.compress(VectorOperation::add);
+    if (assemble_matrix)
+      system_matrix.compress(VectorOperation::add);
     system_rhs.compress(VectorOperation::add);
+
+    if (parameters.advection_preconditioner == Parameters<dim>::AdvectionPreconditioner::automatic)
+      {
+        unsigned int n_diffusion_dominated_cells = 0;
+        for (typename DoFHandler<dim>::active_cell_iterator cell = dof_handler.begin_active();
+             cell != dof_handler.end(); ++cell)
+          if (cell->is_locally_owned()
+              && advection_cell_peclet_numbers[cell->active_cell_index()] < 1.)
+            ++n_diffusion_dominated_cells;
+
+        advection_field_is_diffusion_dominated
+          = (2 * Utilities::MPI::sum (n_diffusion_dominated_cells, mpi_communicator)
+             > triangulation.n_global_active_cells());
+      }
   }
 }
 
@@ -1176,6 +2229,7 @@ namespace aspect
                                                                              const internal::Assembly::CopyData::StokesPreconditioner<dim> &data); \
   template void Simulator<dim>::assemble_stokes_preconditioner (); \
   template void Simulator<dim>::build_stokes_preconditioner (); \
+  template void Simulator<dim>::build_weighted_bfbt_preconditioner (); \
   template void Simulator<dim>::local_assemble_stokes_system ( \
                                                                const DoFHandler<dim>::active_cell_iterator &cell, \
                                                                internal::Assembly::Scratch::StokesSystem<dim>  &scratch, \
@@ -1183,8 +2237,11 @@ namespace aspect
   template void Simulator<dim>::copy_local_to_global_stokes_system ( \
                                                                      const internal::Assembly::CopyData::StokesSystem<dim> &data); \
   template void Simulator<dim>::assemble_stokes_system (); \
+  template bool Simulator<dim>::reuses_composition_matrix (const AdvectionField &) const; \
+  template void Simulator<dim>::release_composition_matrix (); \
   template void Simulator<dim>::build_advection_preconditioner (const AdvectionField &, \
-                                                                aspect::LinearAlgebra::PreconditionILU &preconditioner); \
+                                                                const Parameters<dim>::AdvectionPreconditioner::Kind, \
+                                                                std::shared_ptr<aspect::LinearAlgebra::PreconditionBase> &preconditioner); \
   template void Simulator<dim>::local_assemble_advection_system ( \
                                                                   const AdvectionField          &advection_field, \
                                                                   const Vector<double>           &viscosity_per_cell, \
@@ -25,6 +25,7 @@
 #include <aspect/melt.h>
 #include <aspect/newton.h>
 #include <aspect/free_surface.h>
+#include <aspect/stokes_matrix_free.h>
 
 #include <aspect/simulator/assemblers/interface.h>
 #include <aspect/geometry_model/initial_topography_model/zero_topography.h>
@@ -33,7 +34,10 @@
 #include <deal.II/base/conditional_ostream.h>
 #include <deal.II/base/quadrature_lib.h>
 #include <deal.II/base/signaling_nan.h>
+#include <deal.II/base/multithread_info.h>
+#include <deal.II/base/thread_management.h>
 #include <deal.II/lac/block_sparsity_pattern.h>
+#include <deal.II/lac/dynamic_sparsity_pattern.h>
 #include <deal.II/lac/sparsity_tools.h>
 #include <deal.II/grid/grid_tools.h>
 
@@ -59,6 +63,7 @@
 #include <iostream>
 #include <iomanip>
 #include <locale>
+#include <numeric>
 #include <string>
 
 
@@ -107,6 +112,232 @@ namespace aspect
 
       return new MappingQ1<dim>();
     }
+
+
+
+    /**
+     * Helper function that adds the entries which the degrees of freedom of
+     * the cells with indices in the half-open range [@p begin, @p end) of
+     * @p cells create to @p pattern, for all pairs of degrees of freedom
+     * that are coupled in @p dof_mask. This is the work done by each of the
+     * tasks started in make_cell_sparsity_patterns().
+     */
+    template <int dim>
+    void
+    add_cell_range_to_sparsity_pattern (const std::vector<typename DoFHandler<dim>::active_cell_iterator> &cells,
+                                        const std::size_t begin,
+                                        const std::size_t end,
+                                        const ConstraintMatrix &constraints,
+                                        const Table<2,bool> &dof_mask,
+                                        DynamicSparsityPattern &pattern)
+    {
+      std::vector<types::global_dof_index> local_dof_indices (dof_mask.n_rows());
+      for (std::size_t c=begin; c<end; ++c)
+        {
+          cells[c]->get_dof_indices (local_dof_indices);
+          constraints.add_entries_local_to_global (local_dof_indices, pattern,
+                                                   false, dof_mask);
+        }
+    }
+
+
+
+    /**
+     * Helper function that adds the entries which the degrees of freedom of
+     * each locally owned cell create to a sparsity pattern, for all pairs of
+     * components that are coupled in @p coupling. Rows and columns of
+     * constrained degrees of freedom are dropped, as in
+     * DoFTools::make_sparsity_pattern().
+     *
+     * The locally owned cells are split into one contiguous range per
+     * thread, and each range is processed by a separate task that writes
+     * into its own pattern. The patterns are returned and need to be merged
+     * into the final one by the caller, see add_to_sparsity_pattern().
+     */
+    template <int dim>
+    std::vector<DynamicSparsityPattern>
+    make_cell_sparsity_patterns (const DoFHandler<dim> &dof_handler,
+                                 const ConstraintMatrix &constraints,
+                                 const IndexSet &locally_relevant_dofs,
+                                 const Table<2,DoFTools::Coupling> &coupling)
+    {
+      const FiniteElement<dim> &fe = dof_handler.get_fe();
+      Assert (fe.is_primitive(), ExcNotImplemented());
+
+      Table<2,bool> dof_mask (fe.dofs_per_cell, fe.dofs_per_cell);
+      for (unsigned int i=0; i<fe.dofs_per_cell; ++i)
+        for (unsigned int j=0; j<fe.dofs_per_cell; ++j)
+          dof_mask(i,j) = (coupling(fe.system_to_component_index(i).first,
+                                    fe.system_to_component_index(j).first) != DoFTools::none);
+
+      std::vector<typename DoFHandler<dim>::active_cell_iterator> cells;
+      for (typename DoFHandler<dim>::active_cell_iterator cell = dof_handler.begin_active();
+           cell != dof_handler.end(); ++cell)
+        if (cell->is_locally_owned())
+          cells.push_back (cell);
+
+      const unsigned int n_ranges = std::max<std::size_t> (1,
+                                                           std::min<std::size_t> (MultithreadInfo::n_threads(),
+                                                               cells.size()));
+      std::vector<DynamicSparsityPattern> patterns (n_ranges);
+
+      Threads::TaskGroup<> tasks;
+      for (unsigned int range=0; range<n_ranges; ++range)
+        {
+          patterns[range].reinit (dof_handler.n_dofs(), dof_handler.n_dofs(), locally_relevant_dofs);
+          tasks += Threads::new_task (&add_cell_range_to_sparsity_pattern<dim>,
+                                      cells,
+                                      cells.size()*range/n_ranges,
+                                      cells.size()*(range+1)/n_ranges,
+                                      constraints,
+                                      dof_mask,
+                                      patterns[range]);
+        }
+      tasks.join_all ();
+
+      return patterns;
+    }
+
+
+
+    /**
+     * Helper function that adds all entries of @p pattern to @p sp. If
+     * @p shift is nonzero, the entries of all rows in the half-open range
+     * @p copied_rows are in addition added to @p sp again with their row
+     * and column indices increased by @p shift, i.e., this copies the
+     * pattern of one diagonal block to another one with the same
+     * structure.
+     */
+    template <class SparsityPatternType>
+    void
+    add_to_sparsity_pattern (const DynamicSparsityPattern &pattern,
+                             const std::pair<types::global_dof_index,types::global_dof_index> &copied_rows,
+                             const types::global_dof_index shift,
+                             SparsityPatternType &sp)
+    {
+      std::vector<types::global_dof_index> columns;
+      const IndexSet &rows = pattern.row_index_set();
+      for (IndexSet::ElementIterator row = rows.begin(); row != rows.end(); ++row)
+        {
+          const unsigned int row_length = pattern.row_length(*row);
+          if (row_length == 0)
+            continue;
+
+          columns.resize (row_length);
+          for (unsigned int i=0; i<row_length; ++i)
+            columns[i] = pattern.column_number(*row, i);
+          sp.add_entries (*row, columns.begin(), columns.end(), true);
+
+          if (shift != 0 && *row >= copied_rows.first && *row < copied_rows.second)
+            {
+              for (unsigned int i=0; i<row_length; ++i)
+                {
+                  Assert (columns[i] >= copied_rows.first && columns[i] < copied_rows.second,
+                          ExcInternalError());
+                  columns[i] += shift;
+                }
+              sp.add_entries (*row + shift, columns.begin(), columns.end(), true);
+            }
+        }
+    }
+
+
+
+    /**
+     * Helper function that returns whether on every locally owned cell the
+     * k-th degree of freedom of @p second_component has the index of the
+     * k-th degree of freedom of @p first_component plus @p shift, and
+     * whether the two degrees of freedom are constrained in the same way
+     * in @p constraints, i.e., whether either both or none of them are
+     * constrained, and the degrees of freedom they are constrained to again
+     * differ by @p shift. If this is the case on all processors, then the
+     * sparsity pattern of the diagonal block of the second component is the
+     * one of the first component shifted by @p shift.
+     */
+    template <int dim>
+    bool
+    components_have_shifted_dofs (const DoFHandler<dim> &dof_handler,
+                                  const ConstraintMatrix &constraints,
+                                  const unsigned int first_component,
+                                  const unsigned int second_component,
+                                  const types::global_dof_index shift)
+    {
+      const FiniteElement<dim> &fe = dof_handler.get_fe();
+      std::vector<unsigned int> first_dofs, second_dofs;
+      for (unsigned int i=0; i<fe.dofs_per_cell; ++i)
+        if (fe.system_to_component_index(i).first == first_component)
+          first_dofs.push_back (i);
+        else if (fe.system_to_component_index(i).first == second_component)
+          second_dofs.push_back (i);
+
+      if (first_dofs.size() != second_dofs.size())
+        return false;
+
+      std::vector<types::global_dof_index> local_dof_indices (fe.dofs_per_cell);
+      for (typename DoFHandler<dim>::active_cell_iterator cell = dof_handler.begin_active();
+           cell != dof_handler.end(); ++cell)
+        if (cell->is_locally_owned())
+          {
+            cell->get_dof_indices (local_dof_indices);
+            for (unsigned int k=0; k<first_dofs.size(); ++k)
+              {
+                const types::global_dof_index first_dof = local_dof_indices[first_dofs[k]];
+                const types::global_dof_index second_dof = local_dof_indices[second_dofs[k]];
+                if (second_dof != first_dof + shift)
+                  return false;
+
+                const std::vector<std::pair<types::global_dof_index,double> > *first_entries
+                  = constraints.get_constraint_entries (first_dof);
+                const std::vector<std::pair<types::global_dof_index,double> > *second_entries
+                  = constraints.get_constraint_entries (second_dof);
+                if (constraints.is_constrained (first_dof) != constraints.is_constrained (second_dof)
+                    || (first_entries == 0) != (second_entries == 0))
+                  return false;
+                if (first_entries != 0)
+                  {
+                    if (first_entries->size() != second_entries->size())
+                      return false;
+                    for (unsigned int e=0; e<first_entries->size(); ++e)
+                      if ((*second_entries)[e].first != (*first_entries)[e].first + shift)
+                        return false;
+                  }
+              }
+          }
+
+      return true;
+    }
+
+
+    /**
+     * Set @p result to the linear combination of @p vectors with the
+     * coefficients @p weights. The input vectors may contain ghost
+     * elements. @p distributed_vector is only used for the parallel
+     * layout of the intermediate vectors.
+     */
+    void
+    linear_combination_of_ghosted_vectors (const LinearAlgebra::BlockVector                      &distributed_vector,
+                                           const std::vector<double>                             &weights,
+                                           const std::vector<const LinearAlgebra::BlockVector *> &vectors,
+                                           LinearAlgebra::BlockVector                            &result)
+    {
+      Assert (weights.size() == vectors.size() && vectors.size() > 0,
+              ExcInternalError());
+
+      // TODO: Trilinos sadd does not like ghost vectors even as input. Copy
+      // into distributed vectors for now:
+      LinearAlgebra::BlockVector distr_result (distributed_vector);
+      distr_result = *vectors[0];
+      distr_result *= weights[0];
+
+      LinearAlgebra::BlockVector distr_vector (distributed_vector);
+      for (unsigned int i=1; i<vectors.size(); ++i)
+        {
+          distr_vector = *vectors[i];
+          distr_result.add (weights[i], distr_vector);
+        }
+
+      result = distr_result;
+    }
   }
 
 
@@ -169,14 +400,29 @@ namespace aspect
     time (numbers::signaling_nan<double>()),
     time_step (numbers::signaling_nan<double>()),
     old_time_step (numbers::signaling_nan<double>()),
+    old_old_time_step (numbers::signaling_nan<double>()),
     timestep_number (numbers::invalid_unsigned_int),
     nonlinear_iteration (numbers::invalid_unsigned_int),
 
+    // the geometric multigrid Stokes solver needs the multigrid hierarchy
+    // and requires that neighboring cells on the levels differ by at most
+    // one refinement level across vertices
     triangulation (mpi_communicator,
                    typename Triangulation<dim>::MeshSmoothing
                    (Triangulation<dim>::smoothing_on_refinement |
-                    Triangulation<dim>::smoothing_on_coarsening),
-                   parallel::distributed::Triangulation<dim>::mesh_reconstruction_after_repartitioning),
+                    Triangulation<dim>::smoothing_on_coarsening |
+                    (parameters.stokes_solver_type == Parameters<dim>::StokesSolverType::block_gmg
+                     ?
+                     Triangulation<dim>::limit_level_difference_at_vertices
+                     :
+                     Triangulation<dim>::none)),
+                   (parameters.stokes_solver_type == Parameters<dim>::StokesSolverType::block_gmg
+                    ?
+                    typename parallel::distributed::Triangulation<dim>::Settings
+                    (parallel::distributed::Triangulation<dim>::mesh_reconstruction_after_repartitioning |
+                     parallel::distributed::Triangulation<dim>::construct_multigrid_hierarchy)
+                    :
+                    parallel::distributed::Triangulation<dim>::mesh_reconstruction_after_repartitioning)),
 
     mapping(construct_mapping<dim>(*geometry_model,*initial_topography_model)),
 
@@ -187,10 +433,19 @@ namespace aspect
 
     last_pressure_normalization_adjustment (numbers::signaling_nan<double>()),
 
+    n_solution_shifts_since_mesh_change (0),
+
+    bfbt_has_null_space (false),
+
+    composition_matrix_field (numbers::invalid_unsigned_int),
+    advection_field_is_diffusion_dominated (false),
+
     rebuild_stokes_matrix (true),
     assemble_newton_stokes_matrix (true),
     assemble_newton_stokes_system (parameters.nonlinear_solver == NonlinearSolver::iterated_Advection_and_Newton_Stokes ? true : false),
-    rebuild_stokes_preconditioner (true)
+    rebuild_stokes_preconditioner (true),
+    stokes_iterations_after_preconditioner_rebuild (numbers::invalid_unsigned_int),
+    last_stokes_iterations (numbers::invalid_unsigned_int)
   {
     if (Utilities::MPI::this_mpi_process(mpi_communicator) == 0)
       {
@@ -322,6 +577,54 @@ namespace aspect
         free_surface.reset( new FreeSurfaceHandler<dim>( *this, prm ) );
       }
 
+    // Initialize the matrix-free Stokes solver, which checks that the model
+    // only uses features it supports
+    if (!parameters.use_direct_stokes_solver
+        && parameters.stokes_solver_type == Parameters<dim>::StokesSolverType::block_gmg)
+      stokes_matrix_free.reset (new StokesMatrixFreeHandler<dim>(*this, prm));
+
+    if (parameters.schur_complement_approximation == Parameters<dim>::SchurComplementApproximation::weighted_bfbt)
+      {
+#ifdef ASPECT_USE_PETSC
+        AssertThrow (false,
+                     ExcMessage ("The weighted BFBt Schur complement approximation is only "
+                                 "available if ASPECT is configured to use Trilinos."));
+#endif
+        AssertThrow (!parameters.include_melt_transport && !stokes_matrix_free,
+                     ExcMessage ("The weighted BFBt Schur complement approximation can only be "
+                                 "used with the `block AMG' Stokes solver type and without melt transport."));
+      }
+
+    if (parameters.stokes_krylov_solver_variant == Parameters<dim>::KrylovSolverVariant::pipelined_cg_classical_gram_schmidt)
+      {
+#ifdef ASPECT_USE_PETSC
+        AssertThrow (false,
+                     ExcMessage ("The pipelined CG and classical Gram-Schmidt FGMRES Krylov "
+                                 "solver variant is only available if ASPECT is configured "
+                                 "to use Trilinos."));
+#endif
+        AssertThrow (!stokes_matrix_free,
+                     ExcMessage ("The pipelined CG and classical Gram-Schmidt FGMRES Krylov "
+                                 "solver variant can only be used with the `block AMG' "
+                                 "Stokes solver type."));
+      }
+
+#ifdef ASPECT_USE_PETSC
+    AssertThrow (parameters.advection_preconditioner != Parameters<dim>::AdvectionPreconditioner::chebyshev,
+                 ExcMessage ("The Chebyshev advection solver preconditioner is only "
+                             "available if ASPECT is configured to use Trilinos."));
+#endif
+
+    if (parameters.use_explicit_discontinuous_composition_advection)
+      {
+        AssertThrow (!parameters.free_surface_enabled,
+                     ExcMessage ("The explicit advection method for compositional fields "
+                                 "can not be used together with a free surface."));
+        AssertThrow (geometry_model->get_periodic_boundary_pairs().empty(),
+                     ExcMessage ("The explicit advection method for compositional fields "
+                                 "does not support periodic boundaries."));
+      }
+
     // Initialize the melt handler
     if (parameters.include_melt_transport)
       {
@@ -788,13 +1091,22 @@ namespace aspect
   Simulator<dim>::
   setup_system_matrix (const std::vector<IndexSet> &system_partitioning)
   {
+    TimerOutput::Scope timer (computing_timer, "   Setup matrices");
+
+    direct_stokes_solver.reset ();
+    advection_material_model_cache.reset ();
+    incremental_stokes_assembly.reset ();
+    composition_matrix_field = numbers::invalid_unsigned_int;
+    composition_preconditioner.reset ();
     system_matrix.clear ();
 
     bool have_fem_compositional_field = false;
     for (unsigned int c=0; c<introspection.n_compositional_fields; ++c)
       {
         const AdvectionField adv_field (AdvectionField::composition(c));
-        if (adv_field.advection_method(introspection)==Parameters<dim>::AdvectionFieldMethod::fem_field
+        // fields that are advected explicitly do not need a matrix
+        if ((adv_field.advection_method(introspection)==Parameters<dim>::AdvectionFieldMethod::fem_field
+             && !parameters.use_explicit_discontinuous_composition_advection)
             || adv_field.advection_method(introspection)==Parameters<dim>::AdvectionFieldMethod::fem_melt_field)
           {
             have_fem_compositional_field = true;
@@ -815,13 +1127,16 @@ namespace aspect
     // - compositional fields only couple with themselves
     // - additionally, in models with melt transport fluid pressure
     //   and compaction pressures couple with themselves
+    // - if the matrix-free Stokes solver is used, the Stokes blocks
+    //   are not needed at all
     {
       const typename Introspection<dim>::ComponentIndices &x
         = introspection.component_indices;
 
-      for (unsigned int c=0; c<dim; ++c)
-        for (unsigned int d=0; d<dim; ++d)
-          coupling[x.velocities[c]][x.velocities[d]] = DoFTools::always;
+      if (!stokes_matrix_free)
+        for (unsigned int c=0; c<dim; ++c)
+          for (unsigned int d=0; d<dim; ++d)
+            coupling[x.velocities[c]][x.velocities[d]] = DoFTools::always;
 
       if (parameters.include_melt_transport)
         {
@@ -847,7 +1162,7 @@ namespace aspect
           [introspection.variable("compaction pressure").first_component_index]
             = DoFTools::always;
         }
-      else
+      else if (!stokes_matrix_free)
         {
           for (unsigned int d=0; d<dim; ++d)
             {
@@ -865,6 +1180,41 @@ namespace aspect
         coupling[x.compositional_fields[0]][x.compositional_fields[0]] = DoFTools::always;
     }
 
+    // The block of the first compositional field is just a copy of the
+    // temperature block if both fields use the same element, are numbered
+    // in the same order, and have constraints with the same structure. In
+    // that case we only compute the temperature block and copy it.
+    std::pair<types::global_dof_index,types::global_dof_index> temperature_dofs;
+    temperature_dofs.first = std::accumulate (introspection.system_dofs_per_block.begin(),
+                                              introspection.system_dofs_per_block.begin()
+                                              + introspection.block_indices.temperature,
+                                              types::global_dof_index(0));
+    temperature_dofs.second = temperature_dofs.first
+                              + introspection.system_dofs_per_block[introspection.block_indices.temperature];
+    types::global_dof_index composition_shift = 0;
+    if (have_fem_compositional_field
+        && parameters.temperature_degree == parameters.composition_degree
+        && parameters.use_discontinuous_temperature_discretization == parameters.use_discontinuous_composition_discretization)
+      {
+        const types::global_dof_index first_composition_dof
+          = std::accumulate (introspection.system_dofs_per_block.begin(),
+                             introspection.system_dofs_per_block.begin()
+                             + introspection.block_indices.compositional_fields[0],
+                             types::global_dof_index(0));
+        const bool have_shifted_dofs
+          = components_have_shifted_dofs (dof_handler,
+                                          current_constraints,
+                                          introspection.component_indices.temperature,
+                                          introspection.component_indices.compositional_fields[0],
+                                          first_composition_dof - temperature_dofs.first);
+        if (Utilities::MPI::min (have_shifted_dofs ? 1 : 0, mpi_communicator) == 1)
+          {
+            composition_shift = first_composition_dof - temperature_dofs.first;
+            coupling[introspection.component_indices.compositional_fields[0]]
+            [introspection.component_indices.compositional_fields[0]] = DoFTools::none;
+          }
+      }
+
     LinearAlgebra::BlockDynamicSparsityPattern sp;
 #ifdef ASPECT_USE_PETSC
     sp.reinit (introspection.index_sets.system_relevant_partitioning);
@@ -875,6 +1225,16 @@ namespace aspect
                mpi_communicator);
 #endif
 
+    // build the couplings within cells in parallel
+    const std::vector<DynamicSparsityPattern> cell_patterns
+      = make_cell_sparsity_patterns (dof_handler,
+                                     current_constraints,
+                                     introspection.index_sets.system_relevant_set,
+                                     coupling);
+    for (unsigned int i=0; i<cell_patterns.size(); ++i)
+      add_to_sparsity_pattern (cell_patterns[i], temperature_dofs, composition_shift, sp);
+
+    // discontinuous fields additionally couple over faces
     if ((parameters.use_discontinuous_temperature_discretization) || (parameters.use_discontinuous_composition_discretization))
       {
         Table<2,DoFTools::Coupling> face_coupling (introspection.n_components,
@@ -886,24 +1246,29 @@ namespace aspect
         if (parameters.use_discontinuous_temperature_discretization)
           face_coupling[x.temperature][x.temperature] = DoFTools::always;
 
-        // Only allocate composition 0 matrix if needed. Same as the non-DG case (see above)
-        if (parameters.use_discontinuous_composition_discretization && have_fem_compositional_field)
+        // Only allocate composition 0 matrix if needed. Same as the non-DG
+        // case (see above), and not if it is copied from the temperature block.
+        if (parameters.use_discontinuous_composition_discretization && have_fem_compositional_field
+            && composition_shift == 0)
           face_coupling[x.compositional_fields[0]][x.compositional_fields[0]] = DoFTools::always;
 
+        // the cell couplings have already been added above
+        Table<2,DoFTools::Coupling> no_coupling (introspection.n_components,
+                                                 introspection.n_components);
+        no_coupling.fill (DoFTools::none);
+
+        DynamicSparsityPattern face_pattern (dof_handler.n_dofs(),
+                                             dof_handler.n_dofs(),
+                                             introspection.index_sets.system_relevant_set);
         DoFTools::make_flux_sparsity_pattern (dof_handler,
-                                              sp,
+                                              face_pattern,
                                               current_constraints, false,
-                                              coupling,
+                                              no_coupling,
                                               face_coupling,
                                               Utilities::MPI::
                                               this_mpi_process(mpi_communicator));
+        add_to_sparsity_pattern (face_pattern, temperature_dofs, composition_shift, sp);
       }
-    else
-      DoFTools::make_sparsity_pattern (dof_handler,
-                                       coupling, sp,
-                                       current_constraints, false,
-                                       Utilities::MPI::
-                                       this_mpi_process(mpi_communicator));
 
 #ifdef ASPECT_USE_PETSC
     SparsityTools::distribute_sparsity_pattern(sp,
@@ -931,6 +1296,22 @@ namespace aspect
         sp.block(block_idx, block_idx).compress();
       }
 
+    // The same is true for the Stokes blocks if we use the matrix-free
+    // Stokes solver.
+    if (stokes_matrix_free)
+      {
+        const unsigned int stokes_blocks[2] = {introspection.block_indices.velocities,
+                                               introspection.block_indices.pressure
+                                              };
+        for (unsigned int i=0; i<2; ++i)
+          for (unsigned int j=0; j<2; ++j)
+            {
+              LinearAlgebra::DynamicSparsityPattern &block = sp.block(stokes_blocks[i], stokes_blocks[j]);
+              block.reinit(block.locally_owned_range_indices(),block.locally_owned_domain_indices());
+              block.compress();
+            }
+      }
+
     system_matrix.reinit (sp);
 #endif
   }
@@ -941,13 +1322,18 @@ namespace aspect
   void Simulator<dim>::
   setup_system_preconditioner (const std::vector<IndexSet> &system_partitioning)
   {
+    TimerOutput::Scope timer (computing_timer, "   Setup matrices");
+
     Amg_preconditioner.reset ();
     Mp_preconditioner.reset ();
+    Bfbt_preconditioner.reset ();
+    bfbt_pressure_matrix.clear ();
     system_preconditioner_matrix.clear ();
 
     // The preconditioner matrix is only used for the Stokes block (velocity and Schur complement) and is of course not
-    // used if we use a direct solver.
-    if (parameters.use_direct_stokes_solver)
+    // used if we use a direct solver. The matrix-free Stokes solver does not
+    // need it either.
+    if (parameters.use_direct_stokes_solver || stokes_matrix_free)
       return;
 
     Table<2,DoFTools::Coupling> coupling (introspection.n_components,
@@ -995,11 +1381,15 @@ namespace aspect
                mpi_communicator);
 #endif
 
-    DoFTools::make_sparsity_pattern (dof_handler,
-                                     coupling, sp,
-                                     current_constraints, false,
-                                     Utilities::MPI::
-                                     this_mpi_process(mpi_communicator));
+    const std::vector<DynamicSparsityPattern> cell_patterns
+      = make_cell_sparsity_patterns (dof_handler,
+                                     current_constraints,
+                                     introspection.index_sets.system_relevant_set,
+                                     coupling);
+    for (unsigned int i=0; i<cell_patterns.size(); ++i)
+      add_to_sparsity_pattern (cell_patterns[i],
+                               std::pair<types::global_dof_index,types::global_dof_index>(),
+                               0, sp);
 
 #ifdef ASPECT_USE_PETSC
     SparsityTools::distribute_sparsity_pattern(sp,
@@ -1173,12 +1563,33 @@ namespace aspect
     old_old_solution.reinit(introspection.index_sets.system_partitioning, introspection.index_sets.system_relevant_partitioning, mpi_communicator);
     current_linearization_point.reinit (introspection.index_sets.system_partitioning, introspection.index_sets.system_relevant_partitioning, mpi_communicator);
 
+    if (parameters.initial_guess_extrapolation == Parameters<dim>::InitialGuessExtrapolation::quadratic)
+      old_old_old_solution.reinit (introspection.index_sets.system_partitioning, mpi_communicator);
+    n_solution_shifts_since_mesh_change = 0;
+
     if (parameters.use_operator_splitting)
       operator_split_reaction_vector.reinit (introspection.index_sets.system_partitioning, introspection.index_sets.system_relevant_partitioning, mpi_communicator);
 
     if (do_pressure_rhs_compatibility_modification)
       pressure_shape_function_integrals.reinit (introspection.index_sets.system_partitioning, mpi_communicator);
 
+    // The matrix-free Stokes solver has its own DoFHandler objects that
+    // need to be set up on the new mesh.
+    if (stokes_matrix_free)
+      stokes_matrix_free->setup_dofs();
+
+    // vectors recycled by the Stokes solver do not fit the new mesh
+    stokes_recycled_space.clear();
+
+    // cells that are translations of each other share their Stokes shape
+    // function data. This requires that the mapping is a function of the
+    // vertex locations only.
+    if (!cell_congruence_classes)
+      cell_congruence_classes = std::make_shared<internal::Assembly::CellCongruenceClasses<dim> >();
+    cell_congruence_classes->reinit (triangulation,
+                                     !geometry_model->has_curved_elements()
+                                     && !parameters.free_surface_enabled);
+
     rebuild_stokes_matrix         = true;
     rebuild_stokes_preconditioner = true;
   }
@@ -1464,21 +1875,37 @@ namespace aspect
   solve_timestep ()
   {
     // start any scheme with an extrapolated value from the previous
-    // two time steps if those are available
+    // two or three time steps if those are available
     current_linearization_point = old_solution;
 
-    if (timestep_number > 1)
+    if (parameters.initial_guess_extrapolation == Parameters<dim>::InitialGuessExtrapolation::quadratic
+        && timestep_number > 2
+        && n_solution_shifts_since_mesh_change >= 2)
+      {
+        // evaluate the quadratic interpolation polynomial through the last
+        // three solutions (at times -old_time_step-old_old_time_step,
+        // -old_time_step, and 0) at time time_step, i.e., use the Lagrange
+        // basis functions of these three points as weights
+        const double dt = time_step;
+        const double dt1 = old_time_step;
+        const double dt2 = old_old_time_step;
+
+        const double weight_old = (dt + dt1) * (dt + dt1 + dt2) / (dt1 * (dt1 + dt2));
+        const double weight_old_old = -dt * (dt + dt1 + dt2) / (dt1 * dt2);
+        const double weight_old_old_old = dt * (dt + dt1) / ((dt1 + dt2) * dt2);
+
+        linear_combination_of_ghosted_vectors (system_rhs,
+                                               {weight_old, weight_old_old, weight_old_old_old},
+                                               {&old_solution, &old_old_solution, &old_old_old_solution},
+                                               current_linearization_point);
+      }
+    else if (parameters.initial_guess_extrapolation != Parameters<dim>::InitialGuessExtrapolation::none
+             && timestep_number > 1)
       {
-        // TODO: Trilinos sadd does not like ghost vectors even as input. Copy
-        // into distributed vectors for now:
-        LinearAlgebra::BlockVector distr_solution (system_rhs);
-        distr_solution = old_solution;
-        LinearAlgebra::BlockVector distr_old_solution (system_rhs);
-        distr_old_solution = old_old_solution;
-        distr_solution.sadd ((1 + time_step/old_time_step),
-                             -time_step/old_time_step,
-                             distr_old_solution);
-        current_linearization_point = distr_solution;
+        linear_combination_of_ghosted_vectors (system_rhs,
+                                               {1 + time_step/old_time_step, -time_step/old_time_step},
+                                               {&old_solution, &old_old_solution},
+                                               current_linearization_point);
       }
 
     // The free surface scheme is currently not built to work inside a nonlinear solver.
@@ -1666,13 +2093,17 @@ namespace aspect
         // update values for timestep, increment time step by one. then prepare
         // for the next time step by shifting solution vectors
         // by one time step
+        old_old_time_step = old_time_step;
         old_time_step = time_step;
         time_step = new_time_step;
         time += time_step;
         ++timestep_number;
         {
+          if (parameters.initial_guess_extrapolation == Parameters<dim>::InitialGuessExtrapolation::quadratic)
+            old_old_old_solution = old_old_solution;
           old_old_solution      = old_solution;
           old_solution          = solution;
+          ++n_solution_shifts_since_mesh_change;
         }
 
         // check whether to terminate the simulation. the
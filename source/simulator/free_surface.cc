@@ -24,6 +24,7 @@
 #include <aspect/global.h>
 #include <aspect/simulator/assemblers/interface.h>
 #include <aspect/melt.h>
+#include <aspect/utilities.h>
 
 #include <deal.II/dofs/dof_renumbering.h>
 #include <deal.II/dofs/dof_accessor.h>
@@ -629,7 +630,15 @@ namespace aspect
     Amg_data.smoother_sweeps = 2;
     Amg_data.aggregation_threshold = 0.02;
 #endif
-    preconditioner_stiffness.initialize(mesh_matrix);
+    if (sim.parameters.AMG_use_rigid_body_modes)
+      Utilities::initialize_amg_with_rigid_body_modes (preconditioner_stiffness,
+                                                       mesh_matrix,
+                                                       Amg_data,
+                                                       *sim.mapping,
+                                                       free_surface_dof_handler,
+                                                       0);
+    else
+      preconditioner_stiffness.initialize(mesh_matrix);
 
     SolverControl solver_control(5*rhs.size(), sim.parameters.linear_stokes_solver_tolerance*rhs.l2_norm());
     SolverCG<LinearAlgebra::Vector> cg(solver_control);
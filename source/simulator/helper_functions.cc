@@ -22,6 +22,7 @@
 #include <aspect/simulator.h>
 #include <aspect/melt.h>
 #include <aspect/newton.h>
+#include <aspect/stokes_matrix_free.h>
 #include <aspect/global.h>
 
 #include <aspect/geometry_model/interface.h>
@@ -523,6 +524,9 @@ namespace aspect
                                                introspection.n_compositional_fields);
     MaterialModel::MaterialModelOutputs<dim> out(n_q_points,
                                                  introspection.n_compositional_fields);
+    out.requested_properties = MaterialModel::MaterialProperties::thermal_conductivity
+                               | MaterialModel::MaterialProperties::density
+                               | MaterialModel::MaterialProperties::specific_heat;
 
     for (; cell!=endc; ++cell)
       if (cell->is_locally_owned())
@@ -1217,6 +1221,11 @@ namespace aspect
 
     linearized_stokes_variables.block (block_p) /= pressure_scaling;
 
+    // the matrix-free Stokes solver does not assemble system_matrix, so
+    // let it compute the residual with its own operator
+    if (stokes_matrix_free)
+      return stokes_matrix_free->compute_initial_stokes_residual (linearized_stokes_variables);
+
     // we calculate the velocity residual with a zero velocity,
     // computing only the part of the RHS not balanced by the static pressure
     if (block_p == introspection.block_indices.velocities)
@@ -665,8 +665,18 @@ namespace aspect
     execute (internal::Assembly::Scratch::ScratchBase<dim>   &scratch_base,
              internal::Assembly::CopyData::CopyDataBase<dim> &data_base) const
     {
-      internal::Assembly::Scratch::AdvectionSystem<dim> &scratch = dynamic_cast<internal::Assembly::Scratch::AdvectionSystem<dim>& > (scratch_base);
-      internal::Assembly::CopyData::AdvectionSystem<dim> &data = dynamic_cast<internal::Assembly::CopyData::AdvectionSystem<dim>& > (data_base);
+      assemble (dynamic_cast<internal::Assembly::Scratch::AdvectionSystem<dim>& > (scratch_base),
+                dynamic_cast<internal::Assembly::CopyData::AdvectionSystem<dim>& > (data_base));
+    }
+
+
+
+    template <int dim>
+    void
+    MeltAdvectionSystem<dim>::
+    assemble (internal::Assembly::Scratch::AdvectionSystem<dim> &scratch,
+              internal::Assembly::CopyData::AdvectionSystem<dim> &data) const
+    {
 
       const Introspection<dim> &introspection = this->introspection();
       const FiniteElement<dim> &fe = this->get_fe();
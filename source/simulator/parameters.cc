@@ -25,6 +25,7 @@
 #include <aspect/melt.h>
 #include <aspect/newton.h>
 #include <aspect/free_surface.h>
+#include <aspect/stokes_matrix_free.h>
 
 #include <deal.II/base/parameter_handler.h>
 
@@ -212,6 +213,23 @@ namespace aspect
                        "iterations, in other words, if it is set to something other than "
                        "`single Advection, single Stokes' or `single Advection, no Stokes'.");
 
+    prm.declare_entry ("Anderson acceleration history depth", "0",
+                       Patterns::Integer (0),
+                       "The number of previous nonlinear iterates that are combined by Anderson "
+                       "acceleration of the Picard iterations of the `iterated Advection and Stokes', "
+                       "`single Advection, iterated Stokes', and `no Advection, iterated Stokes' "
+                       "nonlinear solver schemes. Instead of using the solution of the last "
+                       "nonlinear iteration as the linearization point of the next one, "
+                       "Anderson acceleration uses the linear combination of the last "
+                       "iterates that minimizes the (weighted) norm of the "
+                       "difference between the solution and the linearization point of an iteration. "
+                       "This often converges in much fewer iterations than the plain Picard "
+                       "iteration for strongly nonlinear rheologies, and does not need the "
+                       "derivatives of the material model that the Newton solver requires. "
+                       "Every iterate in the history requires the storage of two vectors of the "
+                       "size of the whole solution. The history is restarted whenever the "
+                       "nonlinear residual increases. A value of zero disables the acceleration.");
+
     prm.declare_entry ("Pressure normalization", "surface",
                        Patterns::Selection ("surface|volume|no"),
                        "If and how to normalize the pressure after the solution step. "
@@ -295,6 +313,81 @@ namespace aspect
                          "the composition system gets solved. See `Stokes solver "
                          "parameters/Linear solver tolerance' for more details.");
 
+      prm.declare_entry ("Advection solver preconditioner", "ILU",
+                         Patterns::Selection ("ILU|AMG|Jacobi|Chebyshev|automatic"),
+                         "The preconditioner of the GMRES solver for the linear systems "
+                         "of the temperature and the compositional fields. `ILU' uses an "
+                         "incomplete LU decomposition, whose setup is sequential on every "
+                         "process and whose quality deteriorates on fine meshes for "
+                         "diffusion dominated fields. `AMG' uses algebraic multigrid, "
+                         "which is the best choice for diffusion dominated fields. "
+                         "`Jacobi' uses the point Jacobi method, which is cheap to set up "
+                         "and works well for advection dominated fields, whose matrices are "
+                         "dominated by the mass matrix. `Chebyshev' uses a Chebyshev "
+                         "iteration with the Jacobi method as inner preconditioner (see "
+                         "`Advection Chebyshev degree' and `Advection Chebyshev eigenvalue "
+                         "ratio'). The Chebyshev iteration is designed for symmetric "
+                         "positive definite matrices, so it is only suited for fields whose "
+                         "matrix is nearly symmetric, i.e., whose advection term is small "
+                         "compared to the mass matrix; it is only available if ASPECT is "
+                         "configured to use Trilinos. `automatic' chooses `AMG' if the "
+                         "cell Peclet number $|\\mathbf u| h / (2 \\kappa)$ (where "
+                         "$\\kappa$ includes the physical and the artificial diffusivity) "
+                         "is less than one on the majority of cells, and `Jacobi' "
+                         "otherwise. It never chooses `Chebyshev', because the advection "
+                         "matrices are not symmetric. "
+                         "For all choices but `ILU', the setup and solve times of the "
+                         "preconditioner and solver are printed after every solve.");
+
+      prm.declare_entry ("Advection Chebyshev degree", "3",
+                         Patterns::Integer (1),
+                         "The degree of the Chebyshev polynomial, i.e., the number of "
+                         "matrix-vector products per application, of the `Chebyshev' "
+                         "advection solver preconditioner.");
+
+      prm.declare_entry ("Advection Chebyshev eigenvalue ratio", "30",
+                         Patterns::Double (1),
+                         "The ratio between the largest eigenvalue of the Jacobi "
+                         "preconditioned matrix, which is estimated from the Gershgorin "
+                         "circles, and the smallest eigenvalue that the `Chebyshev' "
+                         "advection solver preconditioner targets.");
+
+      prm.declare_entry ("Initial guess extrapolation", "linear",
+                         Patterns::Selection ("none|linear|quadratic"),
+                         "How the solution of the previous time steps is used as the "
+                         "initial guess (and first linearization point) for the solves "
+                         "of all variables (velocity, pressure, temperature, and "
+                         "compositional fields) in a new time step. `none' starts from "
+                         "the solution of the previous time step. `linear' extrapolates "
+                         "linearly in time from the solutions of the last two time steps, "
+                         "and `quadratic' extrapolates with a quadratic polynomial through "
+                         "the solutions of the last three time steps, in both cases taking "
+                         "into account the actual time step sizes. A better initial guess "
+                         "reduces the number of iterations of the linear solvers. Quadratic "
+                         "extrapolation needs one more vector of the size of the whole "
+                         "solution, and falls back to linear extrapolation in the first "
+                         "time steps and in the first two time steps after the mesh has "
+                         "changed, when not enough previous solutions are available.");
+
+      prm.declare_entry ("Cache material model outputs for advection assembly", "false",
+                         Patterns::Bool (),
+                         "Whether the material model and heating model outputs computed "
+                         "in the quadrature points of each cell while assembling the "
+                         "temperature or a compositional field system should be stored "
+                         "and reused in the assembly of all other advection fields, as "
+                         "long as the linearization point (i.e., the current solution "
+                         "that is used to evaluate the material model) does not change. "
+                         "In practice, this means that all compositional fields share a "
+                         "single evaluation of the material model per nonlinear "
+                         "iteration, which can save a large fraction of the assembly "
+                         "time for models with many compositional fields and expensive "
+                         "material models. The price is storing the material model "
+                         "outputs for every quadrature point of every cell. The cache is "
+                         "not used on cells for which the material model or the heating "
+                         "models create additional material model outputs, and it does "
+                         "not apply to the material model evaluation on faces that "
+                         "discontinuous Galerkin discretizations require.");
+
       prm.enter_subsection ("Stokes solver parameters");
       {
         prm.declare_entry ("Use direct solver for Stokes system", "false",
@@ -304,6 +397,61 @@ namespace aspect
                            "complement solver is used. The direct solver is only efficient "
                            "for small problems.");
 
+        prm.declare_entry ("Stokes solver type", "block AMG",
+                           Patterns::Selection ("block AMG|block GMG"),
+                           "This is the type of iterative solver used for the Stokes system "
+                           "if `Use direct solver for Stokes system' is set to false. Both "
+                           "choices use the same outer FGMRES iteration with a block Schur "
+                           "complement preconditioner, so their iteration counts can be compared "
+                           "directly. `block AMG' assembles the Stokes matrix and "
+                           "preconditions the velocity block with an algebraic multigrid method. "
+                           "`block GMG' never assembles the Stokes operator, but instead applies "
+                           "it cell by cell with sum factorization (matrix-free), and "
+                           "preconditions the velocity block with a geometric multigrid V-cycle "
+                           "on the mesh hierarchy with Chebyshev smoothing. This requires "
+                           "considerably less memory and setup time, but is currently "
+                           "restricted to $Q_2\\times Q_1$ elements, models without melt "
+                           "transport or a free surface, and the Stokes solvers that do "
+                           "not use the Newton method.");
+
+        prm.declare_entry ("Schur complement approximation", "weighted mass matrix",
+                           Patterns::Selection ("weighted mass matrix|weighted BFBt"),
+                           "The approximation of the Schur complement $S = BA^{-1}B^{T}$ that is "
+                           "used in the block preconditioner of the iterative Stokes solver. "
+                           "`weighted mass matrix' uses the pressure mass matrix scaled by the "
+                           "inverse of the viscosity, which is cheap, but whose quality deteriorates "
+                           "for large viscosity contrasts. `weighted BFBt' uses the approximation "
+                           "$S^{-1} \\approx (BD^{-1}B^T)^{-1} BD^{-1}AD^{-1}B^T (BD^{-1}B^T)^{-1}$, "
+                           "where $D$ is the diagonal of the velocity block $A$, and therefore "
+                           "contains the local viscosity as a weight (Rudi et al., 2017). The "
+                           "Poisson-type matrix $BD^{-1}B^T$ is computed from the Stokes matrix and "
+                           "its inverse is approximated by a CG solver preconditioned with an "
+                           "algebraic multigrid method up to the `Linear solver S block tolerance'. "
+                           "This is more expensive per iteration, but keeps the number of outer "
+                           "iterations nearly independent of the viscosity contrast. It is only "
+                           "available for the `block AMG' Stokes solver type with Trilinos, and "
+                           "not for models with melt transport.");
+
+        prm.declare_entry ("Krylov solver variant", "standard",
+                           Patterns::Selection ("standard|pipelined CG and classical Gram-Schmidt FGMRES"),
+                           "The variant of the Krylov methods that are used in the `block AMG' "
+                           "iterative Stokes solver. `standard' uses the FGMRES method "
+                           "of deal.II for the outer iteration and the CG method of Trilinos for "
+                           "the inner solves in the preconditioner. On large numbers of processes, "
+                           "the global reductions (i.e., the scalar products) of these methods "
+                           "dominate the run time of the solver. `pipelined CG and classical "
+                           "Gram-Schmidt FGMRES' instead uses a pipelined CG method (Ghysels and "
+                           "Vanroose, 2014) for the inner solves, which computes all scalar "
+                           "products of one iteration in a single non-blocking reduction that is "
+                           "overlapped with the preconditioner and the matrix-vector product, and "
+                           "an FGMRES method that orthogonalizes with the classical Gram-Schmidt "
+                           "method applied twice. The latter needs two blocking reductions per "
+                           "iteration instead of one per basis vector, but does not overlap them "
+                           "with other work. Both variants compute the same iterates up to "
+                           "round-off, but the second one needs some additional vector operations, "
+                           "so it is only faster if the solver is dominated by latency. "
+                           "It is only available with Trilinos.");
+
         prm.declare_entry ("Linear solver tolerance", "1e-7",
                            Patterns::Double(0,1),
                            "A relative tolerance up to which the linear Stokes systems in each "
@@ -396,6 +544,77 @@ namespace aspect
                            "in the preconditioning used in the GMRES solver. The exact definition of "
                            "this block preconditioner for the Stokes equation can be found in "
                            "\\cite{KHB12}.");
+
+        prm.declare_entry ("Preconditioner reuse iteration factor", "0",
+                           Patterns::Double(0),
+                           "By default (a value of zero), the Stokes preconditioner matrix is "
+                           "reassembled and the AMG preconditioner is rebuilt from scratch "
+                           "whenever the Stokes matrix may have changed, i.e., in every time "
+                           "step and often in every nonlinear iteration. For slowly evolving "
+                           "models, the setup of the preconditioner can be a significant part "
+                           "of the time spent in the Stokes solver, although the old "
+                           "preconditioner would still be good enough. If this parameter is "
+                           "set to a value of at least one, the preconditioner is kept "
+                           "(including the matrix it was built from) as long as the number "
+                           "of outer GMRES iterations of the last Stokes solve does not exceed "
+                           "this factor times the number of iterations of the first solve "
+                           "after the preconditioner was last rebuilt. A full rebuild is "
+                           "always done after the mesh has changed. A value of 1.5 to 2 is a "
+                           "reasonable choice. This parameter is not used by the direct "
+                           "solver and the `block GMG' Stokes solver.");
+
+        prm.declare_entry ("Krylov recycling space dimension", "0",
+                           Patterns::Integer(0),
+                           "The outer GMRES solver for the Stokes system usually starts from an "
+                           "empty Krylov space in every nonlinear iteration and time step, even "
+                           "though consecutive systems are nearly identical. In particular for "
+                           "large viscosity contrasts, every solve then stalls on the same few "
+                           "slowly converging modes. If this parameter is positive, the solver "
+                           "keeps the corrections of up to this many previous solves as a "
+                           "recycled space (which is dominated by these modes), first minimizes "
+                           "the residual over this space, and then runs GMRES on the system "
+                           "projected onto its orthogonal complement (a GCRO-type method). "
+                           "This costs two additional vectors of the size of the Stokes "
+                           "system and one additional matrix-vector product per recycled "
+                           "vector and solve. A value of zero disables recycling. "
+                           "The number of recycled vectors and an estimate of the saved "
+                           "iterations are printed after each Stokes solve. "
+                           "This parameter is not used by the direct solver and the "
+                           "`block GMG' Stokes solver.");
+
+        prm.declare_entry ("Use incremental assembly", "false",
+                           Patterns::Bool (),
+                           "In later nonlinear iterations of a time step, the viscosity and "
+                           "density often only change in small parts of the domain, for "
+                           "example in shear zones. If this parameter is set, the contributions "
+                           "of every cell to the Stokes matrix and right hand side are stored, "
+                           "and the nonlinear iterations after the first one of a time step "
+                           "only recompute the contributions of those cells on which the "
+                           "viscosity or density changed by more than the `Incremental "
+                           "assembly tolerance' since the cell was last assembled, and add "
+                           "the difference to the previous contributions to the system. "
+                           "This requires storing the local matrix of every cell. Cells "
+                           "for which the material model computes additional outputs are "
+                           "always reassembled. The incremental assembly is only used if the "
+                           "Stokes system consists of terms that only depend on the viscosity "
+                           "and density, i.e., for the `incompressible' mass conservation "
+                           "formulation, including the compressible part of the viscous "
+                           "stress of a compressible material model. It is not used for the "
+                           "other mass conservation formulations, melt transport, traction "
+                           "boundary conditions, assemblers added by plugins, Newton "
+                           "iterations, or the `block GMG' Stokes solver; in these cases "
+                           "the whole system is assembled as usual.");
+
+        prm.declare_entry ("Incremental assembly tolerance", "0",
+                           Patterns::Double (0.),
+                           "The relative change of the viscosity and the density in every "
+                           "quadrature point of a cell up to which the incremental assembly "
+                           "of the Stokes system (see `Use incremental assembly') keeps the "
+                           "previous contributions of the cell. A value of zero only skips "
+                           "cells whose viscosity and density did not change at all, which "
+                           "leads to the same solution as a full assembly. Positive values "
+                           "skip more cells, at the cost of assembling a system that is "
+                           "slightly different from the current linearization.");
       }
       prm.leave_subsection ();
       prm.enter_subsection ("AMG parameters");
@@ -437,6 +656,20 @@ namespace aspect
         prm.declare_entry ("AMG output details", "false",
                            Patterns::Bool(),
                            "Turns on extra information on the AMG solver. Note that this will generate much more output.");
+
+        prm.declare_entry ("AMG use rigid body modes", "false",
+                           Patterns::Bool(),
+                           "Whether the AMG preconditioners for the velocity block of the Stokes "
+                           "system and for the mesh deformation of the free surface use all rigid "
+                           "body modes (translations and rotations) as near null space, instead "
+                           "of only the constant (translational) mode of each velocity component. "
+                           "The rotations are computed from the positions of the degrees of freedom "
+                           "relative to the centroid of the domain. "
+                           "This improves the AMG for models in which rotations are (nearly) "
+                           "unconstrained, such as spherical shells and chunks with free slip "
+                           "boundaries, where otherwise the number of inner iterations for the "
+                           "velocity block grows with the resolution. This is only available "
+                           "with Trilinos and deal.II 9.2 or newer.");
       }
       prm.leave_subsection ();
       prm.enter_subsection ("Operator splitting parameters");
@@ -822,6 +1055,31 @@ namespace aspect
                          "as opposed to continuous. This then requires the assembly of face terms "
                          "between cells, and weak imposition of boundary terms for the composition "
                          "field via the discontinuous Galerkin method.");
+      prm.declare_entry ("Use explicit discontinuous composition advection", "false",
+                         Patterns::Bool (),
+                         "Whether to advect compositional fields that use a discontinuous "
+                         "discretization (see ``Use discontinuous composition discretization'') "
+                         "with an explicit, strong stability preserving third order Runge-Kutta "
+                         "method instead of assembling and solving a linear system in each time "
+                         "step. The time step is then subdivided into as many substeps as the "
+                         "CFL condition of the explicit method requires (see ``Explicit "
+                         "discontinuous advection CFL number''), and the limiter for "
+                         "discontinuous composition solutions, if enabled, is applied after each "
+                         "Runge-Kutta stage. No matrix is stored for these fields. "
+                         "Without operator splitting, the reaction terms of the material model "
+                         "are evaluated once per nonlinear iteration and added to every stage "
+                         "as a constant rate. "
+                         "\\note{Free surfaces and periodic boundaries are not supported.}");
+      prm.declare_entry ("Explicit discontinuous advection CFL number", "0.5",
+                         Patterns::Double (0.),
+                         "The CFL number that limits the length of the substeps of the explicit "
+                         "advection method for discontinuous compositional fields. Each substep "
+                         "$\\Delta t_s$ satisfies $\\Delta t_s \\le C h_K / ((2p+1) \\|u\\|_K)$ "
+                         "on every cell $K$, where $C$ is this number, $p$ is the polynomial "
+                         "degree of the compositional fields, $h_K$ is the minimal vertex "
+                         "distance of the cell and $\\|u\\|_K$ the maximal velocity on it. "
+                         "Only used if ``Use explicit discontinuous composition advection'' "
+                         "is set. Units: None.");
 
       prm.enter_subsection ("Stabilization parameters");
       {
@@ -1049,6 +1307,9 @@ namespace aspect
     // also declare the parameters that the FreeSurfaceHandler needs
     FreeSurfaceHandler<dim>::declare_parameters (prm);
 
+    // and the ones of the matrix-free Stokes solver
+    StokesMatrixFreeHandler<dim>::declare_parameters (prm);
+
     // then, finally, let user additions that do not go through the usual
     // plugin mechanism, declare their parameters if they have subscribed
     // to the relevant signals
@@ -1104,10 +1365,18 @@ namespace aspect
     {
       temperature_solver_tolerance    = prm.get_double ("Temperature solver tolerance");
       composition_solver_tolerance    = prm.get_double ("Composition solver tolerance");
+      advection_preconditioner        = AdvectionPreconditioner::parse(prm.get ("Advection solver preconditioner"));
+      advection_chebyshev_degree      = prm.get_integer ("Advection Chebyshev degree");
+      advection_chebyshev_eigenvalue_ratio = prm.get_double ("Advection Chebyshev eigenvalue ratio");
+      initial_guess_extrapolation     = InitialGuessExtrapolation::parse(prm.get ("Initial guess extrapolation"));
+      cache_advection_material_model_outputs = prm.get_bool ("Cache material model outputs for advection assembly");
 
       prm.enter_subsection ("Stokes solver parameters");
       {
         use_direct_stokes_solver        = prm.get_bool("Use direct solver for Stokes system");
+        stokes_solver_type              = StokesSolverType::parse(prm.get("Stokes solver type"));
+        schur_complement_approximation  = SchurComplementApproximation::parse(prm.get("Schur complement approximation"));
+        stokes_krylov_solver_variant    = KrylovSolverVariant::parse(prm.get("Krylov solver variant"));
         linear_stokes_solver_tolerance  = prm.get_double ("Linear solver tolerance");
         n_cheap_stokes_solver_steps     = prm.get_integer ("Number of cheap Stokes solver steps");
         n_expensive_stokes_solver_steps = prm.get_integer ("Maximum number of expensive Stokes solver steps");
@@ -1115,6 +1384,13 @@ namespace aspect
         use_full_A_block_preconditioner = prm.get_bool ("Use full A block as preconditioner");
         linear_solver_S_block_tolerance = prm.get_double ("Linear solver S block tolerance");
         stokes_gmres_restart_length     = prm.get_integer("GMRES solver restart length");
+        stokes_preconditioner_reuse_factor = prm.get_double ("Preconditioner reuse iteration factor");
+        AssertThrow (stokes_preconditioner_reuse_factor == 0. || stokes_preconditioner_reuse_factor >= 1.,
+                     ExcMessage ("The 'Preconditioner reuse iteration factor' needs to be either zero "
+                                 "(to disable reusing the Stokes preconditioner) or at least one."));
+        stokes_krylov_recycling_dimension = prm.get_integer ("Krylov recycling space dimension");
+        use_incremental_stokes_assembly = prm.get_bool ("Use incremental assembly");
+        incremental_stokes_assembly_tolerance = prm.get_double ("Incremental assembly tolerance");
       }
       prm.leave_subsection ();
       prm.enter_subsection ("AMG parameters");
@@ -1123,6 +1399,7 @@ namespace aspect
         AMG_smoother_sweeps                    = prm.get_integer ("AMG smoother sweeps");
         AMG_aggregation_threshold              = prm.get_double ("AMG aggregation threshold");
         AMG_output_details                     = prm.get_bool ("AMG output details");
+        AMG_use_rigid_body_modes               = prm.get_bool ("AMG use rigid body modes");
       }
       prm.leave_subsection ();
       prm.enter_subsection ("Operator splitting parameters");
@@ -1142,6 +1419,7 @@ namespace aspect
 
     max_nonlinear_iterations = prm.get_integer ("Max nonlinear iterations");
     max_nonlinear_iterations_in_prerefinement = prm.get_integer ("Max nonlinear iterations in pre-refinement");
+    anderson_acceleration_depth = prm.get_integer ("Anderson acceleration history depth");
 
     start_time              = prm.get_double ("Start time");
     if (convert_to_years == true)
@@ -1355,6 +1633,14 @@ namespace aspect
         = prm.get_bool("Use discontinuous temperature discretization");
       use_discontinuous_composition_discretization
         = prm.get_bool("Use discontinuous composition discretization");
+      use_explicit_discontinuous_composition_advection
+        = prm.get_bool("Use explicit discontinuous composition advection");
+      explicit_discontinuous_advection_cfl_number
+        = prm.get_double("Explicit discontinuous advection CFL number");
+      AssertThrow (!use_explicit_discontinuous_composition_advection
+                   || use_discontinuous_composition_discretization,
+                   ExcMessage ("The explicit advection method for compositional fields "
+                               "requires a discontinuous composition discretization."));
       prm.enter_subsection ("Stabilization parameters");
       {
         use_artificial_viscosity_smoothing  = prm.get_bool ("Use artificial viscosity smoothing");
@@ -22,6 +22,8 @@
 #include <aspect/simulator.h>
 #include <aspect/global.h>
 #include <aspect/melt.h>
+#include <aspect/stokes_matrix_free.h>
+#include <aspect/krylov_solvers.h>
 
 #include <deal.II/base/signaling_nan.h>
 #include <deal.II/lac/solver_gmres.h>
@@ -30,9 +32,13 @@
 #include <deal.II/lac/solver_cg.h>
 #else
 #include <deal.II/lac/trilinos_solver.h>
+
+#include <Amesos.h>
+#include <Epetra_LinearProblem.h>
 #endif
 
 #include <deal.II/lac/pointer_matrix.h>
+#include <deal.II/lac/full_matrix.h>
 
 #include <deal.II/fe/fe_values.h>
 
@@ -169,6 +175,392 @@ namespace aspect
     }
 
 
+
+    /**
+     * Implement multiplication with the Stokes block projected onto the
+     * orthogonal complement of a recycled subspace, i.e., with the operator
+     * $(I-CC^T)A$ where $A$ is the Stokes block and the columns of $C$ are
+     * the orthonormalized images $AU$ of the recycled vectors $U$. This is
+     * the operator the outer Krylov solver works with in GCRO-type
+     * recycling methods. If no recycled vectors are given, this is just
+     * the multiplication with the Stokes block.
+     */
+    class ProjectedStokesBlock
+    {
+      public:
+        /**
+         * @brief Constructor
+         *
+         * @param A The Stokes block
+         * @param C The orthonormal images of the recycled vectors
+         */
+        ProjectedStokesBlock (const StokesBlock                             &A,
+                              const std::vector<LinearAlgebra::BlockVector> &C)
+          : stokes_block(A), recycled_images(C) {}
+
+        /**
+         * Matrix vector product with the projected Stokes block.
+         */
+        void vmult (LinearAlgebra::BlockVector       &dst,
+                    const LinearAlgebra::BlockVector &src) const
+        {
+          stokes_block.vmult (dst, src);
+          for (unsigned int i=0; i<recycled_images.size(); ++i)
+            dst.add (-(recycled_images[i] * dst), recycled_images[i]);
+        }
+
+      private:
+        const StokesBlock                             &stokes_block;
+        const std::vector<LinearAlgebra::BlockVector> &recycled_images;
+    };
+
+
+
+    /**
+     * Given the recycled vectors @p recycled_space, compute their images
+     * under the current Stokes block and orthonormalize these images with
+     * the modified Gram-Schmidt method, applying the same linear
+     * combinations to the recycled vectors themselves so that
+     * @p recycled_images is $AU$ for the modified @p recycled_space.
+     * Vectors whose images are (numerically) linearly dependent on the
+     * previous ones are removed from the recycled space.
+     */
+    void
+    compute_recycled_images (const StokesBlock                       &stokes_block,
+                             std::vector<LinearAlgebra::BlockVector> &recycled_space,
+                             std::vector<LinearAlgebra::BlockVector> &recycled_images)
+    {
+      recycled_images.clear ();
+
+      std::vector<LinearAlgebra::BlockVector> kept_vectors;
+      for (unsigned int i=0; i<recycled_space.size(); ++i)
+        {
+          LinearAlgebra::BlockVector u (recycled_space[i]);
+          LinearAlgebra::BlockVector c (recycled_space[i]);
+          stokes_block.vmult (c, u);
+          const double initial_norm = c.l2_norm();
+
+          for (unsigned int j=0; j<recycled_images.size(); ++j)
+            {
+              const double beta = recycled_images[j] * c;
+              c.add (-beta, recycled_images[j]);
+              u.add (-beta, kept_vectors[j]);
+            }
+
+          const double norm = c.l2_norm();
+          if (norm <= 1e-10 * initial_norm || norm == 0)
+            continue;
+
+          c /= norm;
+          u /= norm;
+          recycled_images.push_back (c);
+          kept_vectors.push_back (u);
+        }
+
+      recycled_space.swap (kept_vectors);
+    }
+
+
+#ifndef ASPECT_USE_PETSC
+    /**
+     * A sparse direct solver (Amesos' KLU) for the Stokes system that
+     * computes the symbolic factorization (the fill-reducing ordering and
+     * the analysis of the sparsity pattern) of the matrix only once, and
+     * then only recomputes the numeric factorization in every solve. This
+     * requires that the matrix object and its sparsity pattern stay the
+     * same, so the Simulator deletes this object whenever the system
+     * matrix is recreated.
+     */
+    class DirectStokesSolver
+    {
+      public:
+        /**
+         * Constructor. Compute the symbolic factorization of @p matrix.
+         */
+        DirectStokesSolver (const LinearAlgebra::SparseMatrix &matrix);
+
+        /**
+         * Compute the numeric factorization of the current entries of the
+         * matrix given to the constructor, and solve with it.
+         */
+        void solve (LinearAlgebra::Vector       &dst,
+                    const LinearAlgebra::Vector &src);
+
+        /**
+         * Return whether this object was set up for @p matrix.
+         */
+        bool is_set_up_for (const LinearAlgebra::SparseMatrix &matrix) const;
+
+      private:
+        const Epetra_CrsMatrix *matrix;
+        Epetra_LinearProblem linear_problem;
+        std::unique_ptr<Amesos_BaseSolver> solver;
+    };
+
+
+
+    DirectStokesSolver::DirectStokesSolver (const LinearAlgebra::SparseMatrix &matrix)
+      :
+      matrix (&matrix.trilinos_matrix())
+    {
+      linear_problem.SetOperator (const_cast<Epetra_CrsMatrix *>(this->matrix));
+
+      Amesos factory;
+      AssertThrow (factory.Query ("Amesos_Klu"),
+                   ExcMessage ("The direct Stokes solver requires Trilinos to be "
+                               "configured with the Amesos KLU solver."));
+      solver.reset (factory.Create ("Amesos_Klu", linear_problem));
+
+      const int ierr = solver->SymbolicFactorization ();
+      AssertThrow (ierr == 0,
+                   ExcMessage ("The symbolic factorization of the Stokes matrix failed "
+                               "with Trilinos error code " + Utilities::int_to_string (ierr) + "."));
+    }
+
+
+
+    bool
+    DirectStokesSolver::is_set_up_for (const LinearAlgebra::SparseMatrix &matrix) const
+    {
+      return (this->matrix == &matrix.trilinos_matrix());
+    }
+
+
+
+    void
+    DirectStokesSolver::solve (LinearAlgebra::Vector       &dst,
+                               const LinearAlgebra::Vector &src)
+    {
+      linear_problem.SetLHS (&dst.trilinos_vector());
+      linear_problem.SetRHS (const_cast<Epetra_MultiVector *>(static_cast<const Epetra_MultiVector *>(&src.trilinos_vector())));
+
+      int ierr = solver->NumericFactorization ();
+      AssertThrow (ierr == 0,
+                   ExcMessage ("The numeric factorization of the Stokes matrix failed "
+                               "with Trilinos error code " + Utilities::int_to_string (ierr) + "."));
+
+      ierr = solver->Solve ();
+      AssertThrow (ierr == 0,
+                   ExcMessage ("The direct solve with the Stokes matrix failed "
+                               "with Trilinos error code " + Utilities::int_to_string (ierr) + "."));
+    }
+#endif
+
+
+
+    /**
+     * Solve the system @p matrix @p dst = @p src with the CG method,
+     * either with the standard implementation, or with the pipelined
+     * variant that needs only one (overlapped) global reduction per
+     * iteration.
+     */
+    template <class MatrixType, class PreconditionerType>
+    void
+    solve_with_cg (const MatrixType            &matrix,
+                   LinearAlgebra::Vector       &dst,
+                   const LinearAlgebra::Vector &src,
+                   const PreconditionerType    &preconditioner,
+                   SolverControl               &solver_control,
+                   const bool                   use_pipelined_cg)
+    {
+#ifdef ASPECT_USE_PETSC
+      (void)use_pipelined_cg;
+      SolverCG<LinearAlgebra::Vector> solver(solver_control);
+      solver.solve(matrix, dst, src, preconditioner);
+#else
+      if (use_pipelined_cg)
+        {
+          SolverPipelinedCG<LinearAlgebra::Vector> solver(solver_control);
+          solver.solve(matrix, dst, src, preconditioner);
+        }
+      else
+        {
+          TrilinosWrappers::SolverCG solver(solver_control);
+          solver.solve(matrix, dst, src, preconditioner);
+        }
+#endif
+    }
+
+
+
+    /**
+     * Apply the inverse of the weighted BFBt approximation of the Schur
+     * complement,
+     * $S^{-1} \approx (BD^{-1}B^T)^{-1} BD^{-1}AD^{-1}B^T (BD^{-1}B^T)^{-1}$,
+     * where $D$ is the diagonal of the velocity block $A$. The two solves
+     * with the Poisson-type matrix $BD^{-1}B^T$ are done with a CG solver
+     * preconditioned by an algebraic multigrid method, which is the
+     * pipelined CG method if the `Krylov solver variant' asks for it. See
+     * Simulator::build_weighted_bfbt_preconditioner() for how the matrices
+     * are set up.
+     */
+    class WeightedBFBtSchurComplementInverse
+    {
+      public:
+        /**
+         * Constructor. @p null_space is the normalized vector spanning the
+         * null space of @p pressure_matrix, or a null pointer if the matrix
+         * is nonsingular. @p use_pipelined_cg selects the CG variant of the
+         * inner solves, see solve_with_cg().
+         */
+        WeightedBFBtSchurComplementInverse (const LinearAlgebra::SparseMatrix    &velocity_matrix,
+                                            const LinearAlgebra::SparseMatrix    &gradient_matrix,
+                                            const LinearAlgebra::SparseMatrix    &pressure_matrix,
+                                            const LinearAlgebra::Vector          &inverse_diagonal,
+                                            const LinearAlgebra::PreconditionAMG &pressure_preconditioner,
+                                            const LinearAlgebra::Vector          *null_space,
+                                            const bool                            use_pipelined_cg);
+
+        /**
+         * Compute dst = S^{-1} src, where the inner solves are done up to
+         * the given relative @p tolerance. Return the total number of inner
+         * iterations.
+         */
+        unsigned int vmult (LinearAlgebra::Vector       &dst,
+                            const LinearAlgebra::Vector &src,
+                            const double                 tolerance) const;
+
+      private:
+        /**
+         * Solve with $BD^{-1}B^T$ and return the number of iterations.
+         */
+        unsigned int solve_pressure_matrix (LinearAlgebra::Vector       &dst,
+                                            const LinearAlgebra::Vector &src,
+                                            const double                 tolerance) const;
+
+        /**
+         * Remove the component in direction of the null space, if any.
+         */
+        void project (LinearAlgebra::Vector &v) const;
+
+        const LinearAlgebra::SparseMatrix    &velocity_matrix;
+        const LinearAlgebra::SparseMatrix    &gradient_matrix;
+        const LinearAlgebra::SparseMatrix    &pressure_matrix;
+        const LinearAlgebra::Vector          &inverse_diagonal;
+        const LinearAlgebra::PreconditionAMG &pressure_preconditioner;
+        const LinearAlgebra::Vector          *null_space;
+        const bool                            use_pipelined_cg;
+    };
+
+
+
+    WeightedBFBtSchurComplementInverse::
+    WeightedBFBtSchurComplementInverse (const LinearAlgebra::SparseMatrix    &velocity_matrix,
+                                        const LinearAlgebra::SparseMatrix    &gradient_matrix,
+                                        const LinearAlgebra::SparseMatrix    &pressure_matrix,
+                                        const LinearAlgebra::Vector          &inverse_diagonal,
+                                        const LinearAlgebra::PreconditionAMG &pressure_preconditioner,
+                                        const LinearAlgebra::Vector          *null_space,
+                                        const bool                            use_pipelined_cg)
+      :
+      velocity_matrix (velocity_matrix),
+      gradient_matrix (gradient_matrix),
+      pressure_matrix (pressure_matrix),
+      inverse_diagonal (inverse_diagonal),
+      pressure_preconditioner (pressure_preconditioner),
+      null_space (null_space),
+      use_pipelined_cg (use_pipelined_cg)
+    {}
+
+
+
+    void
+    WeightedBFBtSchurComplementInverse::project (LinearAlgebra::Vector &v) const
+    {
+      if (null_space != nullptr)
+        v.add (-(v * (*null_space)), *null_space);
+    }
+
+
+
+    unsigned int
+    WeightedBFBtSchurComplementInverse::
+    solve_pressure_matrix (LinearAlgebra::Vector       &dst,
+                           const LinearAlgebra::Vector &src,
+                           const double                 tolerance) const
+    {
+      dst = 0.0;
+
+      // see the comment in BlockSchurPreconditioner::vmult() about
+      // Trilinos' behavior for a zero right hand side
+      const double src_norm = src.l2_norm();
+      if (src_norm <= 1e-50)
+        return 0;
+
+      SolverControl solver_control(1000, src_norm * tolerance);
+      solve_with_cg (pressure_matrix, dst, src, pressure_preconditioner,
+                     solver_control, use_pipelined_cg);
+      return solver_control.last_step();
+    }
+
+
+
+    unsigned int
+    WeightedBFBtSchurComplementInverse::vmult (LinearAlgebra::Vector       &dst,
+                                               const LinearAlgebra::Vector &src,
+                                               const double                 tolerance) const
+    {
+      LinearAlgebra::Vector rhs (src);
+      project (rhs);
+
+      LinearAlgebra::Vector ptmp (src);
+      unsigned int n_iterations = solve_pressure_matrix (ptmp, rhs, tolerance);
+
+      // apply B D^{-1} A D^{-1} B^T
+      LinearAlgebra::Vector utmp (inverse_diagonal);
+      LinearAlgebra::Vector utmp2 (inverse_diagonal);
+      gradient_matrix.vmult (utmp, ptmp);
+      utmp.scale (inverse_diagonal);
+      velocity_matrix.vmult (utmp2, utmp);
+      utmp2.scale (inverse_diagonal);
+      gradient_matrix.Tvmult (rhs, utmp2);
+      project (rhs);
+
+      n_iterations += solve_pressure_matrix (dst, rhs, tolerance);
+      project (dst);
+
+      return n_iterations;
+    }
+
+
+
+    /**
+     * Solve the system @p matrix @p dst = @p src with the flexible GMRES
+     * method, either with the standard implementation of deal.II, or with
+     * the variant that orthogonalizes with the classical Gram-Schmidt
+     * method.
+     */
+    template <class MatrixType, class PreconditionerType>
+    void
+    solve_with_fgmres (const MatrixType                          &matrix,
+                       LinearAlgebra::BlockVector                &dst,
+                       const LinearAlgebra::BlockVector          &src,
+                       const PreconditionerType                  &preconditioner,
+                       SolverControl                             &solver_control,
+                       VectorMemory<LinearAlgebra::BlockVector>  &memory,
+                       const unsigned int                         restart_length,
+                       const bool                                 use_classical_gram_schmidt)
+    {
+#ifndef ASPECT_USE_PETSC
+      if (use_classical_gram_schmidt)
+        {
+          SolverFGMRESClassicalGramSchmidt<LinearAlgebra::BlockVector> solver(solver_control,
+                                                                              restart_length);
+          solver.solve(matrix, dst, src, preconditioner);
+          return;
+        }
+#else
+      (void)use_classical_gram_schmidt;
+#endif
+      SolverFGMRES<LinearAlgebra::BlockVector>
+      solver(solver_control, memory,
+             SolverFGMRES<LinearAlgebra::BlockVector>::
+             AdditionalData(restart_length, true));
+      solver.solve(matrix, dst, src, preconditioner);
+    }
+
+
+
     /**
      * Implement the block Schur preconditioner for the Stokes system.
      */
@@ -192,6 +584,11 @@ namespace aspect
          *     the inverse of the A block.
          * @param S_block_tolerance The tolerance for the CG solver which computes
          *     the inverse of the S block (Schur complement matrix).
+         * @param bfbt_inverse If not a null pointer, use this weighted BFBt
+         *     approximation of the inverse Schur complement instead of solving
+         *     with the S block of @p Spre.
+         * @param use_pipelined_cg Whether the inner solves with the A and S
+         *     blocks use the pipelined CG method instead of the standard one.
          **/
         BlockSchurPreconditioner (const LinearAlgebra::BlockSparseMatrix  &S,
                                   const LinearAlgebra::BlockSparseMatrix  &Spre,
@@ -199,7 +596,9 @@ namespace aspect
                                   const PreconditionerA                      &Apreconditioner,
                                   const bool                                  do_solve_A,
                                   const double                                A_block_tolerance,
-                                  const double                                S_block_tolerance);
+                                  const double                                S_block_tolerance,
+                                  const WeightedBFBtSchurComplementInverse   *bfbt_inverse = nullptr,
+                                  const bool                                  use_pipelined_cg = false);
 
         /**
          * Matrix vector product with this preconditioner object.
@@ -218,12 +617,14 @@ namespace aspect
         const LinearAlgebra::BlockSparseMatrix &stokes_preconditioner_matrix;
         const PreconditionerMp                    &mp_preconditioner;
         const PreconditionerA                     &a_preconditioner;
+        const WeightedBFBtSchurComplementInverse  *bfbt_inverse;
 
         /**
          * Whether to actually invert the $\tilde A$ part of the preconditioner matrix
          * or to just apply a single preconditioner step with it.
          **/
         const bool do_solve_A;
+        const bool use_pipelined_cg;
         mutable unsigned int n_iterations_A_;
         mutable unsigned int n_iterations_S_;
         const double A_block_tolerance;
@@ -239,13 +640,17 @@ namespace aspect
                               const PreconditionerA                      &Apreconditioner,
                               const bool                                  do_solve_A,
                               const double                                A_block_tolerance,
-                              const double                                S_block_tolerance)
+                              const double                                S_block_tolerance,
+                              const WeightedBFBtSchurComplementInverse   *bfbt_inverse,
+                              const bool                                  use_pipelined_cg)
       :
       stokes_matrix     (S),
       stokes_preconditioner_matrix     (Spre),
       mp_preconditioner (Mppreconditioner),
       a_preconditioner  (Apreconditioner),
+      bfbt_inverse      (bfbt_inverse),
       do_solve_A        (do_solve_A),
+      use_pipelined_cg  (use_pipelined_cg),
       n_iterations_A_(0),
       n_iterations_S_(0),
       A_block_tolerance(A_block_tolerance),
@@ -277,15 +682,11 @@ namespace aspect
       LinearAlgebra::Vector utmp(src.block(0));
 
       // first solve with the bottom left block, which we have built
-      // as a mass matrix with the inverse of the viscosity
+      // as a mass matrix with the inverse of the viscosity (or apply the
+      // weighted BFBt approximation of its inverse)
       {
         SolverControl solver_control(1000, src.block(1).l2_norm() * S_block_tolerance);
 
-#ifdef ASPECT_USE_PETSC
-        SolverCG<LinearAlgebra::Vector> solver(solver_control);
-#else
-        TrilinosWrappers::SolverCG solver(solver_control);
-#endif
         // Trilinos reports a breakdown
         // in case src=dst=0, even
         // though it should return
@@ -297,10 +698,18 @@ namespace aspect
             try
               {
                 dst.block(1) = 0.0;
-                solver.solve(stokes_preconditioner_matrix.block(1,1),
-                             dst.block(1), src.block(1),
-                             mp_preconditioner);
-                n_iterations_S_ += solver_control.last_step();
+                if (bfbt_inverse != nullptr)
+                  n_iterations_S_ += bfbt_inverse->vmult (dst.block(1), src.block(1),
+                                                          S_block_tolerance);
+                else
+                  {
+                    solve_with_cg (stokes_preconditioner_matrix.block(1,1),
+                                   dst.block(1), src.block(1),
+                                   mp_preconditioner,
+                                   solver_control,
+                                   use_pipelined_cg);
+                    n_iterations_S_ += solver_control.last_step();
+                  }
               }
             // if the solver fails, report the error from processor 0 with some additional
             // information about its location, and throw a quiet exception on all other
@@ -336,16 +745,13 @@ namespace aspect
       if (do_solve_A == true)
         {
           SolverControl solver_control(10000, utmp.l2_norm() * A_block_tolerance);
-#ifdef ASPECT_USE_PETSC
-          SolverCG<LinearAlgebra::Vector> solver(solver_control);
-#else
-          TrilinosWrappers::SolverCG solver(solver_control);
-#endif
           try
             {
               dst.block(0) = 0.0;
-              solver.solve(stokes_matrix.block(0,0), dst.block(0), utmp,
-                           a_preconditioner);
+              solve_with_cg (stokes_matrix.block(0,0), dst.block(0), utmp,
+                             a_preconditioner,
+                             solver_control,
+                             use_pipelined_cg);
               n_iterations_A_ += solver_control.last_step();
             }
           // if the solver fails, report the error from processor 0 with some additional
@@ -372,6 +778,148 @@ namespace aspect
         }
     }
 
+
+
+    /**
+     * Finite element objects and per-cell data used by
+     * Simulator::advect_composition_explicitly() to evaluate the time
+     * derivative of a discontinuous compositional field.
+     */
+    template <int dim>
+    struct ExplicitAdvectionScratch
+    {
+      ExplicitAdvectionScratch (const Mapping<dim>               &mapping,
+                                const FiniteElement<dim>         &finite_element,
+                                const unsigned int                quadrature_degree,
+                                const unsigned int                component_index,
+                                const FEValuesExtractors::Scalar &solution_field,
+                                const FEValuesExtractors::Vector &velocities);
+
+      /**
+       * Add the upwind flux over the inflow part of a face, i.e., the term
+       * (u.n) (c - c_exterior) phi_i, to #local_rate. The exterior values
+       * have to be stored in #exterior_field_values before calling this
+       * function.
+       */
+      void add_inflow_flux (const FEFaceValuesBase<dim>      &face_values,
+                            const LinearAlgebra::BlockVector &solution,
+                            const LinearAlgebra::BlockVector &linearization_point);
+
+      const FEValuesExtractors::Scalar solution_field;
+      const FEValuesExtractors::Vector velocities;
+
+      const QGauss<dim>   quadrature_formula;
+      const QGauss<dim-1> face_quadrature_formula;
+      const unsigned int  n_q_points;
+      const unsigned int  n_face_q_points;
+
+      FEValues<dim>        fe_values;
+      FEFaceValues<dim>    fe_face_values;
+      FESubfaceValues<dim> fe_subface_values;
+      FEFaceValues<dim>    neighbor_fe_face_values;
+      FESubfaceValues<dim> neighbor_fe_subface_values;
+
+      /**
+       * The shape functions of the current field within the cell.
+       */
+      std::vector<unsigned int> field_dofs;
+
+      std::vector<types::global_dof_index> local_dof_indices;
+      std::vector<Tensor<1,dim> > velocity_values;
+      std::vector<Tensor<1,dim> > field_gradients;
+      std::vector<Tensor<1,dim> > face_velocity_values;
+      std::vector<double>         face_field_values;
+      std::vector<double>         exterior_field_values;
+      Vector<double>              local_rate;
+      Vector<double>              local_update;
+
+      /**
+       * The inverse of the mass matrix of the current field on each locally
+       * owned cell, indexed by the active cell index.
+       */
+      std::vector<FullMatrix<double> > inverse_mass_matrices;
+    };
+
+
+
+    template <int dim>
+    ExplicitAdvectionScratch<dim>::
+    ExplicitAdvectionScratch (const Mapping<dim>               &mapping,
+                              const FiniteElement<dim>         &finite_element,
+                              const unsigned int                quadrature_degree,
+                              const unsigned int                component_index,
+                              const FEValuesExtractors::Scalar &solution_field,
+                              const FEValuesExtractors::Vector &velocities)
+      :
+      solution_field (solution_field),
+      velocities (velocities),
+      quadrature_formula (quadrature_degree),
+      face_quadrature_formula (quadrature_degree),
+      n_q_points (quadrature_formula.size()),
+      n_face_q_points (face_quadrature_formula.size()),
+      fe_values (mapping,
+                 finite_element,
+                 quadrature_formula,
+                 update_values | update_gradients |
+                 update_quadrature_points | update_JxW_values),
+      fe_face_values (mapping,
+                      finite_element,
+                      face_quadrature_formula,
+                      update_values | update_normal_vectors |
+                      update_quadrature_points | update_JxW_values),
+      fe_subface_values (mapping,
+                         finite_element,
+                         face_quadrature_formula,
+                         update_values | update_normal_vectors |
+                         update_JxW_values),
+      neighbor_fe_face_values (mapping,
+                               finite_element,
+                               face_quadrature_formula,
+                               update_values),
+      neighbor_fe_subface_values (mapping,
+                                  finite_element,
+                                  face_quadrature_formula,
+                                  update_values),
+      local_dof_indices (finite_element.dofs_per_cell),
+      velocity_values (n_q_points),
+      field_gradients (n_q_points),
+      face_velocity_values (n_face_q_points),
+      face_field_values (n_face_q_points),
+      exterior_field_values (n_face_q_points)
+    {
+      for (unsigned int i=0; i<finite_element.dofs_per_cell; ++i)
+        if (finite_element.system_to_component_index(i).first == component_index)
+          field_dofs.push_back(i);
+
+      local_rate.reinit (field_dofs.size());
+      local_update.reinit (field_dofs.size());
+    }
+
+
+
+    template <int dim>
+    void
+    ExplicitAdvectionScratch<dim>::
+    add_inflow_flux (const FEFaceValuesBase<dim>      &face_values,
+                     const LinearAlgebra::BlockVector &solution,
+                     const LinearAlgebra::BlockVector &linearization_point)
+    {
+      face_values[solution_field].get_function_values (solution, face_field_values);
+      face_values[velocities].get_function_values (linearization_point,
+                                                   face_velocity_values);
+
+      for (unsigned int q=0; q<n_face_q_points; ++q)
+        {
+          const double normal_velocity = face_velocity_values[q] * face_values.normal_vector(q);
+          if (normal_velocity < 0)
+            for (unsigned int i=0; i<field_dofs.size(); ++i)
+              local_rate(i) += normal_velocity
+                               * (face_field_values[q] - exterior_field_values[q])
+                               * face_values[solution_field].value(field_dofs[i], q)
+                               * face_values.JxW(q);
+        }
+    }
+
   }
 
   template <int dim>
@@ -418,17 +966,52 @@ namespace aspect
         return 0;
       }
 
-    AssertThrow(system_matrix.block(block_idx,
-                                    block_idx).linfty_norm() > std::numeric_limits<double>::min(),
+    // compositional fields with the same matrix share the matrix and the
+    // preconditioner of the field composition_matrix_field, see
+    // assemble_advection_system()
+    const bool use_composition_matrix = (!advection_field.is_temperature()
+                                         && composition_matrix_field != numbers::invalid_unsigned_int);
+    const AdvectionField matrix_field = (reuses_composition_matrix(advection_field)
+                                         ?
+                                         AdvectionField::composition(composition_matrix_field)
+                                         :
+                                         advection_field);
+    const unsigned int matrix_block_idx = matrix_field.block_index(introspection);
+    const LinearAlgebra::SparseMatrix &matrix = system_matrix.block(matrix_block_idx, matrix_block_idx);
+
+    AssertThrow(matrix.linfty_norm() > std::numeric_limits<double>::min(),
                 ExcMessage ("The " + field_name + " equation can not be solved, because the matrix is zero, "
                             "but the right-hand side is nonzero."));
 
-    LinearAlgebra::PreconditionILU preconditioner;
-    build_advection_preconditioner(advection_field, preconditioner);
+    // choose the preconditioner, see the 'Advection solver preconditioner'
+    // parameter
+    typename Parameters<dim>::AdvectionPreconditioner::Kind preconditioner_type = parameters.advection_preconditioner;
+    if (preconditioner_type == Parameters<dim>::AdvectionPreconditioner::automatic)
+      preconditioner_type = (advection_field_is_diffusion_dominated
+                             ?
+                             Parameters<dim>::AdvectionPreconditioner::amg
+                             :
+                             Parameters<dim>::AdvectionPreconditioner::jacobi);
+
+    Timer setup_timer (mpi_communicator, true);
+
+    std::shared_ptr<LinearAlgebra::PreconditionBase> preconditioner;
+    if (use_composition_matrix && composition_preconditioner)
+      preconditioner = composition_preconditioner;
+    else
+      {
+        build_advection_preconditioner(matrix_field, preconditioner_type, preconditioner);
+
+        if (use_composition_matrix)
+          composition_preconditioner = preconditioner;
+      }
+
+    setup_timer.stop();
 
     TimerOutput::Scope timer (computing_timer, (advection_field.is_temperature() ?
                                                 "   Solve temperature system" :
                                                 "   Solve composition system"));
+    Timer solve_timer (mpi_communicator, true);
     if (advection_field.is_temperature())
       {
         pcout << "   Solving temperature system... " << std::flush;
@@ -458,7 +1041,7 @@ namespace aspect
 
     // Compute the residual before we solve and return this at the end.
     // This is used in the nonlinear solver.
-    const double initial_residual = system_matrix.block(block_idx,block_idx).residual
+    const double initial_residual = matrix.residual
                                     (temp,
                                      distributed_solution.block(block_idx),
                                      system_rhs.block(block_idx));
@@ -466,10 +1049,10 @@ namespace aspect
     // solve the linear system:
     try
       {
-        solver.solve (system_matrix.block(block_idx,block_idx),
+        solver.solve (matrix,
                       distributed_solution.block(block_idx),
                       system_rhs.block(block_idx),
-                      preconditioner);
+                      *preconditioner);
       }
     // if the solver fails, report the error from processor 0 with some additional
     // information about its location, and throw a quiet exception on all other
@@ -501,10 +1084,23 @@ namespace aspect
     current_constraints.distribute (distributed_solution);
     solution.block(block_idx) = distributed_solution.block(block_idx);
 
+    solve_timer.stop();
+
     // print number of iterations and also record it in the
-    // statistics file
+    // statistics file. for preconditioners other than the default
+    // one, also print which one was used and how long setting it
+    // up and solving took.
     pcout << solver_control.last_step()
-          << " iterations." << std::endl;
+          << " iterations";
+    if (parameters.advection_preconditioner != Parameters<dim>::AdvectionPreconditioner::ilu)
+      {
+        static const char *const preconditioner_names[] = { "ILU", "AMG", "Jacobi", "Chebyshev" };
+        pcout << " (" << preconditioner_names[preconditioner_type]
+              << ", setup " << setup_timer.wall_time()
+              << "s, solve " << solve_timer.wall_time()
+              << "s)";
+      }
+    pcout << '.' << std::endl;
 
     if ((advection_field.is_temperature()
          && parameters.use_discontinuous_temperature_discretization
@@ -520,6 +1116,283 @@ namespace aspect
 
 
 
+  template <int dim>
+  void Simulator<dim>::advect_composition_explicitly (const AdvectionField &advection_field)
+  {
+    Assert (!advection_field.is_temperature()
+            && advection_field.is_discontinuous(introspection),
+            ExcInternalError());
+
+    TimerOutput::Scope timer (computing_timer, "   Solve composition system");
+
+    const unsigned int block_idx = advection_field.block_index(introspection);
+    const unsigned int degree = advection_field.polynomial_degree(introspection);
+
+    // use the same quadrature as the assembly of the implicit system
+    internal::ExplicitAdvectionScratch<dim> scratch (*mapping,
+                                                     finite_element,
+                                                     degree + (parameters.stokes_velocity_degree+1)/2,
+                                                     advection_field.component_index(introspection),
+                                                     advection_field.scalar_extractor(introspection),
+                                                     introspection.extractors.velocities);
+    const unsigned int n_q_points = scratch.n_q_points;
+    const unsigned int n_field_dofs = scratch.field_dofs.size();
+
+    // the vectors below only store the current block, so we have to
+    // translate global DoF indices into indices within that block
+    const types::global_dof_index block_start = solution.get_block_indices().block_start(block_idx);
+
+    // Without operator splitting, the reaction terms of the material model
+    // are part of the advection equation. As in the assemblers of the
+    // implicit method, they are evaluated for the current linearization
+    // point. Since they are increments over the whole time step, they enter
+    // every stage as the constant rate reaction_terms/time_step, or are
+    // added at once if the time step is zero.
+    const bool include_reactions = !parameters.use_operator_splitting;
+    LinearAlgebra::Vector reaction_increment (introspection.index_sets.system_partitioning[block_idx],
+                                              mpi_communicator);
+    MaterialModel::MaterialModelInputs<dim> in (n_q_points,
+                                                introspection.n_compositional_fields);
+    MaterialModel::MaterialModelOutputs<dim> out (n_q_points,
+                                                  introspection.n_compositional_fields);
+    out.requested_properties = MaterialModel::MaterialProperties::reaction_terms;
+
+    // The velocity is the same in all stages and substeps of this function,
+    // so the inverse mass matrices, the reaction terms and the admissible
+    // substep length are computed once per call. Because the function is
+    // called again in every nonlinear iteration, they are recomputed for
+    // the updated velocity there.
+    scratch.inverse_mass_matrices.resize (triangulation.n_active_cells());
+    double max_substep_length = std::numeric_limits<double>::max();
+    for (typename DoFHandler<dim>::active_cell_iterator cell = dof_handler.begin_active();
+         cell != dof_handler.end(); ++cell)
+      if (cell->is_locally_owned())
+        {
+          scratch.fe_values.reinit (cell);
+          scratch.fe_values[introspection.extractors.velocities].get_function_values (current_linearization_point,
+                                                                                       scratch.velocity_values);
+
+          FullMatrix<double> mass_matrix (n_field_dofs, n_field_dofs);
+          for (unsigned int q=0; q<n_q_points; ++q)
+            for (unsigned int i=0; i<n_field_dofs; ++i)
+              for (unsigned int j=0; j<n_field_dofs; ++j)
+                mass_matrix(i,j) += scratch.fe_values[scratch.solution_field].value(scratch.field_dofs[i], q) *
+                                    scratch.fe_values[scratch.solution_field].value(scratch.field_dofs[j], q) *
+                                    scratch.fe_values.JxW(q);
+
+          FullMatrix<double> &inverse_mass_matrix = scratch.inverse_mass_matrices[cell->active_cell_index()];
+          inverse_mass_matrix.reinit (n_field_dofs, n_field_dofs);
+          inverse_mass_matrix.invert (mass_matrix);
+
+          if (include_reactions)
+            {
+              in.reinit (scratch.fe_values, cell, introspection, current_linearization_point);
+              material_model->fill_additional_material_model_inputs (in,
+                                                                     current_linearization_point,
+                                                                     scratch.fe_values,
+                                                                     introspection);
+              material_model->evaluate (in, out);
+
+              scratch.local_rate = 0;
+              for (unsigned int q=0; q<n_q_points; ++q)
+                for (unsigned int i=0; i<n_field_dofs; ++i)
+                  scratch.local_rate(i) += out.reaction_terms[q][advection_field.compositional_variable]
+                                           * scratch.fe_values[scratch.solution_field].value(scratch.field_dofs[i], q)
+                                           * scratch.fe_values.JxW(q);
+
+              inverse_mass_matrix.vmult (scratch.local_update, scratch.local_rate);
+
+              cell->get_dof_indices (scratch.local_dof_indices);
+              for (unsigned int i=0; i<n_field_dofs; ++i)
+                reaction_increment(scratch.local_dof_indices[scratch.field_dofs[i]] - block_start) = scratch.local_update(i);
+            }
+
+          double max_velocity = 0;
+          for (unsigned int q=0; q<n_q_points; ++q)
+            max_velocity = std::max (max_velocity, scratch.velocity_values[q].norm());
+
+          if (max_velocity > 0)
+            max_substep_length = std::min (max_substep_length,
+                                           parameters.explicit_discontinuous_advection_cfl_number
+                                           * cell->minimum_vertex_distance()
+                                           / ((2*degree+1) * max_velocity));
+        }
+    max_substep_length = Utilities::MPI::min (max_substep_length, mpi_communicator);
+    if (include_reactions)
+      reaction_increment.compress (VectorOperation::insert);
+
+    const unsigned int n_substeps = std::max (1U,
+                                              static_cast<unsigned int>(std::ceil(time_step / max_substep_length)));
+    const double substep_length = time_step / n_substeps;
+
+    pcout << "   Advecting "
+          << introspection.name_for_compositional_index(advection_field.compositional_variable)
+          << " explicitly... " << std::flush;
+
+    LinearAlgebra::Vector field_rate (introspection.index_sets.system_partitioning[block_idx],
+                                      mpi_communicator);
+    LinearAlgebra::Vector stage_field (introspection.index_sets.system_partitioning[block_idx],
+                                       mpi_communicator);
+
+    // Always start from the old solution, so that calling this function
+    // again in a later nonlinear iteration yields a consistent result.
+    LinearAlgebra::Vector substep_start (introspection.index_sets.system_partitioning[block_idx],
+                                         mpi_communicator);
+    solution.block(block_idx) = old_solution.block(block_idx);
+
+    // Shu-Osher form of SSP-RK3:
+    //   c1      = c^n + dt L(c^n)
+    //   c2      = 3/4 c^n + 1/4 (c1 + dt L(c1))
+    //   c^{n+1} = 1/3 c^n + 2/3 (c2 + dt L(c2))
+    // where stage_weights holds the weight of the new stage in each line.
+    const double stage_weights[3] = { 1., 1./4., 2./3. };
+
+    for (unsigned int substep=0; substep<n_substeps; ++substep)
+      {
+        substep_start = solution.block(block_idx);
+
+        for (unsigned int stage=0; stage<3; ++stage)
+          {
+            compute_explicit_advection_rate (advection_field, scratch, field_rate);
+            if (include_reactions && time_step > 0)
+              field_rate.add (1./time_step, reaction_increment);
+
+            stage_field = solution.block(block_idx);
+            stage_field.add (substep_length, field_rate);
+            stage_field.sadd (stage_weights[stage], 1.-stage_weights[stage], substep_start);
+
+            // the rate of the next stage and the limiter act on the
+            // solution vector
+            solution.block(block_idx) = stage_field;
+            if (parameters.use_limiter_for_discontinuous_composition_solution)
+              apply_limiter_to_dg_solutions (advection_field);
+          }
+      }
+
+    if (include_reactions && time_step == 0)
+      {
+        stage_field = solution.block(block_idx);
+        stage_field.add (1.0, reaction_increment);
+        solution.block(block_idx) = stage_field;
+        if (parameters.use_limiter_for_discontinuous_composition_solution)
+          apply_limiter_to_dg_solutions (advection_field);
+      }
+
+    pcout << n_substeps << " SSP-RK3 substeps." << std::endl;
+
+    // there is no linear solver, but still let the user know that the
+    // field has been updated
+    SolverControl dummy;
+    signals.post_advection_solver(*this,
+                                  false,
+                                  advection_field.compositional_variable,
+                                  dummy);
+  }
+
+
+
+  template <int dim>
+  void Simulator<dim>::compute_explicit_advection_rate (const AdvectionField                    &advection_field,
+                                                        internal::ExplicitAdvectionScratch<dim> &scratch,
+                                                        LinearAlgebra::Vector                   &field_rate)
+  {
+    const unsigned int block_idx = advection_field.block_index(introspection);
+    const types::global_dof_index block_start = solution.get_block_indices().block_start(block_idx);
+    const unsigned int n_field_dofs = scratch.field_dofs.size();
+
+    const std::set<types::boundary_id> &fixed_composition_boundaries
+      = boundary_composition_manager.get_fixed_composition_boundary_indicators();
+
+    for (typename DoFHandler<dim>::active_cell_iterator cell = dof_handler.begin_active();
+         cell != dof_handler.end(); ++cell)
+      if (cell->is_locally_owned())
+        {
+          scratch.local_rate = 0;
+
+          scratch.fe_values.reinit (cell);
+          scratch.fe_values[scratch.solution_field].get_function_gradients (solution,
+                                                                            scratch.field_gradients);
+          scratch.fe_values[introspection.extractors.velocities].get_function_values (current_linearization_point,
+                                                                                       scratch.velocity_values);
+
+          for (unsigned int q=0; q<scratch.n_q_points; ++q)
+            {
+              const double advection = scratch.velocity_values[q] * scratch.field_gradients[q];
+              for (unsigned int i=0; i<n_field_dofs; ++i)
+                scratch.local_rate(i) -= advection
+                                         * scratch.fe_values[scratch.solution_field].value(scratch.field_dofs[i], q)
+                                         * scratch.fe_values.JxW(q);
+            }
+
+          for (unsigned int face_no=0; face_no<GeometryInfo<dim>::faces_per_cell; ++face_no)
+            {
+              const typename DoFHandler<dim>::face_iterator face = cell->face(face_no);
+
+              if (face->at_boundary())
+                {
+                  // outside of fixed composition boundaries there is no
+                  // exterior value, and consequently no flux
+                  if (fixed_composition_boundaries.find(face->boundary_id())
+                      == fixed_composition_boundaries.end())
+                    continue;
+
+                  scratch.fe_face_values.reinit (cell, face_no);
+                  for (unsigned int q=0; q<scratch.n_face_q_points; ++q)
+                    scratch.exterior_field_values[q]
+                      = boundary_composition_manager.boundary_composition (face->boundary_id(),
+                                                                           scratch.fe_face_values.quadrature_point(q),
+                                                                           advection_field.compositional_variable);
+                  scratch.add_inflow_flux (scratch.fe_face_values, solution, current_linearization_point);
+                }
+              else if (face->has_children())
+                {
+                  // the neighbor is finer than this cell
+                  const unsigned int neighbor_face_no = cell->neighbor_of_neighbor(face_no);
+                  for (unsigned int subface_no=0; subface_no<face->number_of_children(); ++subface_no)
+                    {
+                      scratch.fe_subface_values.reinit (cell, face_no, subface_no);
+                      scratch.neighbor_fe_face_values.reinit (cell->neighbor_child_on_subface(face_no, subface_no),
+                                                              neighbor_face_no);
+                      scratch.neighbor_fe_face_values[scratch.solution_field].get_function_values (solution,
+                                                                                                   scratch.exterior_field_values);
+                      scratch.add_inflow_flux (scratch.fe_subface_values, solution, current_linearization_point);
+                    }
+                }
+              else if (cell->neighbor_is_coarser(face_no))
+                {
+                  const std::pair<unsigned int, unsigned int> neighbor_face_subface
+                    = cell->neighbor_of_coarser_neighbor(face_no);
+                  scratch.fe_face_values.reinit (cell, face_no);
+                  scratch.neighbor_fe_subface_values.reinit (cell->neighbor(face_no),
+                                                             neighbor_face_subface.first,
+                                                             neighbor_face_subface.second);
+                  scratch.neighbor_fe_subface_values[scratch.solution_field].get_function_values (solution,
+                                                                                                  scratch.exterior_field_values);
+                  scratch.add_inflow_flux (scratch.fe_face_values, solution, current_linearization_point);
+                }
+              else
+                {
+                  scratch.fe_face_values.reinit (cell, face_no);
+                  scratch.neighbor_fe_face_values.reinit (cell->neighbor(face_no),
+                                                          cell->neighbor_of_neighbor(face_no));
+                  scratch.neighbor_fe_face_values[scratch.solution_field].get_function_values (solution,
+                                                                                               scratch.exterior_field_values);
+                  scratch.add_inflow_flux (scratch.fe_face_values, solution, current_linearization_point);
+                }
+            }
+
+          scratch.inverse_mass_matrices[cell->active_cell_index()].vmult (scratch.local_update, scratch.local_rate);
+
+          // every DoF of a locally owned DG cell is locally owned
+          cell->get_dof_indices (scratch.local_dof_indices);
+          for (unsigned int i=0; i<n_field_dofs; ++i)
+            field_rate(scratch.local_dof_indices[scratch.field_dofs[i]] - block_start) = scratch.local_update(i);
+        }
+    field_rate.compress (VectorOperation::insert);
+  }
+
+
+
   template <int dim>
   std::pair<double,double>
   Simulator<dim>::solve_stokes ()
@@ -582,18 +1455,24 @@ namespace aspect
                                        distributed_stokes_solution.block(0),
                                        system_rhs.block(0));
 
-        SolverControl cn;
-        // TODO: can we re-use the direct solver?
-#ifdef ASPECT_USE_PETSC
-        PETScWrappers::SparseDirectMUMPS solver(cn, mpi_communicator);
-#else
-        TrilinosWrappers::SolverDirect solver(cn);
-#endif
         try
           {
+#ifdef ASPECT_USE_PETSC
+            SolverControl cn;
+            PETScWrappers::SparseDirectMUMPS solver(cn, mpi_communicator);
             solver.solve(system_matrix.block(0,0),
                          distributed_stokes_solution.block(0),
                          system_rhs.block(0));
+#else
+            // reuse the symbolic factorization of the last solve, unless
+            // the matrix has been recreated since then
+            if (!direct_stokes_solver
+                || !direct_stokes_solver->is_set_up_for (system_matrix.block(0,0)))
+              direct_stokes_solver = std::make_shared<internal::DirectStokesSolver> (system_matrix.block(0,0));
+
+            direct_stokes_solver->solve (distributed_stokes_solution.block(0),
+                                         system_rhs.block(0));
+#endif
 
             // if we got here, we have successfully solved the linear system
             // with a direct solver, and the final linear residual should
@@ -639,6 +1518,15 @@ namespace aspect
 
         pcout << "done." << std::endl;
       }
+    else if (stokes_matrix_free)
+      {
+        // solve with the matrix-free operators and the geometric
+        // multigrid preconditioner
+        const std::pair<double,double> residuals
+          = stokes_matrix_free->solve (distributed_stokes_solution);
+        initial_nonlinear_residual = residuals.first;
+        final_linear_residual = residuals.second;
+      }
     else
       {
         // Many parts of the solver depend on the block layout (velocity = 0,
@@ -748,6 +1636,45 @@ namespace aspect
         distributed_stokes_rhs.block(block_vel) = system_rhs.block(block_vel);
         distributed_stokes_rhs.block(block_p) = system_rhs.block(block_p);
 
+        // If Krylov subspace recycling is enabled and we have recycled
+        // vectors U from previous solves, we use a GCRO-type method: With
+        // C=AU orthonormal, we first minimize the residual over the recycled
+        // space, x_0 <- x_0 + U C^T r_0 and r_0 <- (I-CC^T) r_0, and then solve
+        // (I-CC^T) A y = r_0 for the correction y with FGMRES, starting from
+        // zero. The solution is then x = x_0 + y - U C^T A y, and the residual
+        // of this solution is exactly the residual FGMRES computes for the
+        // projected system, so the solver tolerance keeps its meaning.
+        std::vector<LinearAlgebra::BlockVector> recycled_images;
+        LinearAlgebra::BlockVector recycling_initial_guess;
+        double residual_before_recycling = 0;
+        double residual_after_recycling = 0;
+        if (parameters.stokes_krylov_recycling_dimension > 0
+            && stokes_recycled_space.size() > 0)
+          {
+            internal::compute_recycled_images (stokes_block,
+                                               stokes_recycled_space,
+                                               recycled_images);
+
+            LinearAlgebra::BlockVector initial_residual (introspection.index_sets.stokes_partitioning, mpi_communicator);
+            residual_before_recycling = stokes_block.residual (initial_residual,
+                                                               distributed_stokes_solution,
+                                                               distributed_stokes_rhs);
+
+            recycling_initial_guess.reinit (distributed_stokes_solution);
+            recycling_initial_guess = distributed_stokes_solution;
+            for (unsigned int i=0; i<recycled_images.size(); ++i)
+              {
+                const double alpha = recycled_images[i] * initial_residual;
+                recycling_initial_guess.add (alpha, stokes_recycled_space[i]);
+                initial_residual.add (-alpha, recycled_images[i]);
+              }
+            residual_after_recycling = initial_residual.l2_norm();
+
+            distributed_stokes_solution = 0;
+            distributed_stokes_rhs = initial_residual;
+          }
+        const internal::ProjectedStokesBlock projected_stokes_block (stokes_block, recycled_images);
+
         PrimitiveVectorMemory< LinearAlgebra::BlockVector > mem;
 
         // create Solver controls for the cheap and expensive solver phase
@@ -760,6 +1687,28 @@ namespace aspect
         solver_control_cheap.enable_history_data();
         solver_control_expensive.enable_history_data();
 
+        // if requested, use the pipelined CG method for the inner solves and
+        // the classical Gram-Schmidt FGMRES method for the outer solve
+        const bool use_pipelined_solver_variant
+          = (parameters.stokes_krylov_solver_variant ==
+             Parameters<dim>::KrylovSolverVariant::pipelined_cg_classical_gram_schmidt);
+
+        // if requested, approximate the Schur complement by the weighted
+        // BFBt operator instead of the weighted pressure mass matrix
+        std::unique_ptr<internal::WeightedBFBtSchurComplementInverse> bfbt_inverse;
+        if (parameters.schur_complement_approximation == Parameters<dim>::SchurComplementApproximation::weighted_bfbt)
+          bfbt_inverse.reset (new internal::WeightedBFBtSchurComplementInverse (system_matrix.block(0,0),
+                                                                                system_matrix.block(0,1),
+                                                                                bfbt_pressure_matrix,
+                                                                                bfbt_inverse_diagonal,
+                                                                                *Bfbt_preconditioner,
+                                                                                bfbt_has_null_space
+                                                                                ?
+                                                                                &bfbt_null_space
+                                                                                :
+                                                                                nullptr,
+                                                                                use_pipelined_solver_variant));
+
         // create a cheap preconditioner that consists of only a single V-cycle
         const internal::BlockSchurPreconditioner<LinearAlgebra::PreconditionAMG,
               LinearAlgebra::PreconditionBase>
@@ -767,7 +1716,9 @@ namespace aspect
                                     *Mp_preconditioner, *Amg_preconditioner,
                                     false,
                                     parameters.linear_solver_A_block_tolerance,
-                                    parameters.linear_solver_S_block_tolerance);
+                                    parameters.linear_solver_S_block_tolerance,
+                                    bfbt_inverse.get(),
+                                    use_pipelined_solver_variant);
 
         // create an expensive preconditioner that solves for the A block with CG
         const internal::BlockSchurPreconditioner<LinearAlgebra::PreconditionAMG,
@@ -776,7 +1727,9 @@ namespace aspect
                                         *Mp_preconditioner, *Amg_preconditioner,
                                         true,
                                         parameters.linear_solver_A_block_tolerance,
-                                        parameters.linear_solver_S_block_tolerance);
+                                        parameters.linear_solver_S_block_tolerance,
+                                        bfbt_inverse.get(),
+                                        use_pipelined_solver_variant);
 
         // step 1a: try if the simple and fast solver
         // succeeds in n_cheap_stokes_solver_steps steps or less.
@@ -787,15 +1740,14 @@ namespace aspect
             if (parameters.n_cheap_stokes_solver_steps == 0)
               throw SolverControl::NoConvergence(0,0);
 
-            SolverFGMRES<LinearAlgebra::BlockVector>
-            solver(solver_control_cheap, mem,
-                   SolverFGMRES<LinearAlgebra::BlockVector>::
-                   AdditionalData(parameters.stokes_gmres_restart_length, true));
-
-            solver.solve (stokes_block,
-                          distributed_stokes_solution,
-                          distributed_stokes_rhs,
-                          preconditioner_cheap);
+            internal::solve_with_fgmres (projected_stokes_block,
+                                         distributed_stokes_solution,
+                                         distributed_stokes_rhs,
+                                         preconditioner_cheap,
+                                         solver_control_cheap,
+                                         mem,
+                                         parameters.stokes_gmres_restart_length,
+                                         use_pipelined_solver_variant);
 
             final_linear_residual = solver_control_cheap.last_value();
           }
@@ -812,17 +1764,16 @@ namespace aspect
                                                               parameters.stokes_gmres_restart_length :
                                                               std::max(parameters.stokes_gmres_restart_length, 100U));
 
-            SolverFGMRES<LinearAlgebra::BlockVector>
-            solver(solver_control_expensive, mem,
-                   SolverFGMRES<LinearAlgebra::BlockVector>::
-                   AdditionalData(number_of_temporary_vectors, true));
-
             try
               {
-                solver.solve(stokes_block,
-                             distributed_stokes_solution,
-                             distributed_stokes_rhs,
-                             preconditioner_expensive);
+                internal::solve_with_fgmres (projected_stokes_block,
+                                             distributed_stokes_solution,
+                                             distributed_stokes_rhs,
+                                             preconditioner_expensive,
+                                             solver_control_expensive,
+                                             mem,
+                                             number_of_temporary_vectors,
+                                             use_pipelined_solver_variant);
 
                 final_linear_residual = solver_control_expensive.last_value();
               }
@@ -895,6 +1846,47 @@ namespace aspect
                                    solver_control_cheap,
                                    solver_control_expensive);
 
+        // record the number of outer iterations, which decides whether the
+        // preconditioner can be reused (see build_stokes_preconditioner())
+        last_stokes_iterations = (solver_control_cheap.last_step() != numbers::invalid_unsigned_int ?
+                                  solver_control_cheap.last_step():
+                                  0)
+                                 +
+                                 (solver_control_expensive.last_step() != numbers::invalid_unsigned_int ?
+                                  solver_control_expensive.last_step():
+                                  0);
+        if (stokes_iterations_after_preconditioner_rebuild == numbers::invalid_unsigned_int)
+          stokes_iterations_after_preconditioner_rebuild = last_stokes_iterations;
+
+        // if we solved for a correction in the complement of the recycled
+        // space, assemble the solution from its parts. then add the
+        // normalized total correction of this solve to the recycled space,
+        // replacing the oldest vector if the space is full. since
+        // consecutive solves stall on the same slowly converging modes,
+        // these corrections are dominated by these modes.
+        if (recycled_images.size() > 0)
+          {
+            LinearAlgebra::BlockVector Ay (introspection.index_sets.stokes_partitioning, mpi_communicator);
+            stokes_block.vmult (Ay, distributed_stokes_solution);
+            for (unsigned int i=0; i<recycled_images.size(); ++i)
+              distributed_stokes_solution.add (-(recycled_images[i] * Ay), stokes_recycled_space[i]);
+            distributed_stokes_solution += recycling_initial_guess;
+          }
+
+        if (parameters.stokes_krylov_recycling_dimension > 0)
+          {
+            LinearAlgebra::BlockVector correction (distributed_stokes_solution);
+            correction -= linearized_stokes_initial_guess;
+            const double norm = correction.l2_norm();
+            if (norm > 0)
+              {
+                correction /= norm;
+                if (stokes_recycled_space.size() >= parameters.stokes_krylov_recycling_dimension)
+                  stokes_recycled_space.erase (stokes_recycled_space.begin());
+                stokes_recycled_space.push_back (correction);
+              }
+          }
+
         // distribute hanging node and
         // other constraints
         current_constraints.distribute (distributed_stokes_solution);
@@ -917,6 +1909,32 @@ namespace aspect
                   0)
               << " iterations.";
         pcout << std::endl;
+
+        // report how much the recycled space helped. we estimate the number
+        // of saved iterations from the average convergence rate of the
+        // FGMRES iteration on the projected system
+        if (recycled_images.size() > 0)
+          {
+            pcout << "      Recycled Krylov space of dimension " << recycled_images.size()
+                  << " reduced the initial residual by a factor of "
+                  << (residual_after_recycling > 0 ?
+                      residual_before_recycling / residual_after_recycling :
+                      std::numeric_limits<double>::infinity());
+
+            if (last_stokes_iterations > 0
+                && final_linear_residual > 0
+                && final_linear_residual < residual_after_recycling
+                && residual_after_recycling < residual_before_recycling)
+              {
+                const double log_rate = std::log(final_linear_residual / residual_after_recycling)
+                                        / last_stokes_iterations;
+                pcout << " (about "
+                      << static_cast<unsigned int>(std::log(residual_after_recycling / residual_before_recycling)
+                                                   / log_rate + 0.5)
+                      << " iterations saved)";
+              }
+            pcout << '.' << std::endl;
+          }
       }
 
 
@@ -944,6 +1962,10 @@ namespace aspect
 {
 #define INSTANTIATE(dim) \
   template double Simulator<dim>::solve_advection (const AdvectionField &); \
+  template void Simulator<dim>::advect_composition_explicitly (const AdvectionField &); \
+  template void Simulator<dim>::compute_explicit_advection_rate (const AdvectionField &, \
+                                                                 internal::ExplicitAdvectionScratch<dim> &, \
+                                                                 LinearAlgebra::Vector &); \
   template std::pair<double,double> Simulator<dim>::solve_stokes ();
 
   ASPECT_INSTANTIATE(INSTANTIATE)
@@ -25,8 +25,12 @@
 #include <aspect/newton.h>
 #include <aspect/melt.h>
 
+#include <deal.II/lac/full_matrix.h>
+#include <deal.II/lac/vector.h>
 #include <deal.II/numerics/vector_tools.h>
 
+#include <deque>
+
 namespace aspect
 {
 
@@ -130,6 +134,191 @@ namespace aspect
 
     };
 
+
+
+    /**
+     * Implement Anderson acceleration for the fixed point iteration
+     * $x_{k+1} = G(x_k)$ that the Picard-type nonlinear solver schemes
+     * represent, where $x_k$ is the linearization point at the beginning of
+     * a nonlinear iteration and $G(x_k)$ the linearization point after all
+     * systems have been solved once. With the residuals $f_k = G(x_k)-x_k$,
+     * the accelerated iterate is
+     * $x_{k+1} = G(x_k) - \sum_i \gamma_i (G(x_{i+1})-G(x_i))$, where the
+     * coefficients $\gamma$ minimize
+     * $\|f_k - \sum_i \gamma_i (f_{i+1}-f_i)\|$ over the last iterations
+     * kept in the history. Since the blocks of the solution vector have
+     * vastly different magnitudes, the norm weights each block by the
+     * inverse of its norm in the first iterate.
+     */
+    class AndersonAcceleration
+    {
+      public:
+        /**
+         * Constructor. @p distributed_template is a vector without ghost
+         * entries that has the layout of the solution vector. No vectors are
+         * allocated if @p history_depth is zero.
+         */
+        AndersonAcceleration (const unsigned int history_depth,
+                              const LinearAlgebra::BlockVector &distributed_template);
+
+        /**
+         * Store the linearization point $x_k$ at the beginning of a
+         * nonlinear iteration.
+         */
+        void begin_iteration (const LinearAlgebra::BlockVector &current_linearization_point);
+
+        /**
+         * Given $G(x_k)$ in @p current_linearization_point, replace it by the
+         * accelerated iterate $x_{k+1}$. @p nonlinear_residual is the
+         * (relative) nonlinear residual that the solver scheme computed for
+         * its convergence check; if it increased compared to the last
+         * iteration, the history is discarded and no acceleration is done.
+         * Return the number of previous iterations that were used.
+         */
+        unsigned int accelerate (LinearAlgebra::BlockVector &current_linearization_point,
+                                 const double nonlinear_residual);
+
+      private:
+        /**
+         * Compute the weighted scalar product of two vectors.
+         */
+        double weighted_product (const LinearAlgebra::BlockVector &a,
+                                 const LinearAlgebra::BlockVector &b) const;
+
+        const unsigned int history_depth;
+
+        LinearAlgebra::BlockVector linearization_point;
+        LinearAlgebra::BlockVector last_iterate;
+        LinearAlgebra::BlockVector last_residual;
+        bool have_last_iterate;
+        double last_nonlinear_residual;
+
+        std::deque<LinearAlgebra::BlockVector> iterate_differences;
+        std::deque<LinearAlgebra::BlockVector> residual_differences;
+        std::vector<double> block_weights;
+    };
+
+
+
+    AndersonAcceleration::AndersonAcceleration (const unsigned int history_depth,
+                                                const LinearAlgebra::BlockVector &distributed_template)
+      :
+      history_depth (history_depth),
+      have_last_iterate (false),
+      last_nonlinear_residual (std::numeric_limits<double>::max())
+    {
+      if (history_depth > 0)
+        {
+          linearization_point.reinit (distributed_template);
+          last_iterate.reinit (distributed_template);
+          last_residual.reinit (distributed_template);
+        }
+    }
+
+
+
+    void
+    AndersonAcceleration::begin_iteration (const LinearAlgebra::BlockVector &current_linearization_point)
+    {
+      linearization_point = current_linearization_point;
+    }
+
+
+
+    double
+    AndersonAcceleration::weighted_product (const LinearAlgebra::BlockVector &a,
+                                            const LinearAlgebra::BlockVector &b) const
+    {
+      double product = 0;
+      for (unsigned int block=0; block<a.n_blocks(); ++block)
+        if (block_weights[block] != 0)
+          product += block_weights[block] * block_weights[block] * (a.block(block) * b.block(block));
+      return product;
+    }
+
+
+
+    unsigned int
+    AndersonAcceleration::accelerate (LinearAlgebra::BlockVector &current_linearization_point,
+                                      const double nonlinear_residual)
+    {
+      LinearAlgebra::BlockVector iterate (linearization_point);
+      iterate = current_linearization_point;
+      LinearAlgebra::BlockVector residual (iterate);
+      residual -= linearization_point;
+
+      if (block_weights.size() == 0)
+        {
+          block_weights.resize (iterate.n_blocks());
+          for (unsigned int block=0; block<iterate.n_blocks(); ++block)
+            {
+              const double norm = iterate.block(block).l2_norm();
+              block_weights[block] = (norm > 0 ? 1./norm : 0.);
+            }
+        }
+
+      // update the history, or restart it if the iteration diverged
+      if (have_last_iterate && nonlinear_residual <= last_nonlinear_residual)
+        {
+          iterate_differences.push_back (iterate);
+          iterate_differences.back() -= last_iterate;
+          residual_differences.push_back (residual);
+          residual_differences.back() -= last_residual;
+
+          if (iterate_differences.size() > history_depth)
+            {
+              iterate_differences.pop_front ();
+              residual_differences.pop_front ();
+            }
+        }
+      else
+        {
+          iterate_differences.clear ();
+          residual_differences.clear ();
+        }
+
+      last_iterate = iterate;
+      last_residual = residual;
+      have_last_iterate = true;
+      last_nonlinear_residual = nonlinear_residual;
+
+      const unsigned int n_history = iterate_differences.size();
+      if (n_history == 0)
+        return 0;
+
+      // solve the (small) least squares problem for the coefficients
+      // via its normal equations, with a little regularization to guard
+      // against linearly dependent residual differences
+      FullMatrix<double> normal_matrix (n_history, n_history);
+      Vector<double> normal_rhs (n_history);
+      Vector<double> coefficients (n_history);
+      double trace = 0;
+      for (unsigned int i=0; i<n_history; ++i)
+        {
+          for (unsigned int j=0; j<=i; ++j)
+            {
+              normal_matrix(i,j) = weighted_product (residual_differences[i], residual_differences[j]);
+              normal_matrix(j,i) = normal_matrix(i,j);
+            }
+          normal_rhs(i) = weighted_product (residual_differences[i], residual);
+          trace += normal_matrix(i,i);
+        }
+
+      if (trace == 0)
+        return 0;
+
+      for (unsigned int i=0; i<n_history; ++i)
+        normal_matrix(i,i) += 1e-12 * trace;
+
+      normal_matrix.gauss_jordan ();
+      normal_matrix.vmult (coefficients, normal_rhs);
+
+      for (unsigned int i=0; i<n_history; ++i)
+        iterate.add (-coefficients(i), iterate_differences[i]);
+
+      current_linearization_point = iterate;
+      return n_history;
+    }
   }
 
 
@@ -179,6 +368,17 @@ namespace aspect
             case Parameters<dim>::AdvectionFieldMethod::fem_field:
             case Parameters<dim>::AdvectionFieldMethod::fem_melt_field:
             {
+              // the explicit method does not solve a linear system, and
+              // consequently has no residual
+              if (method == Parameters<dim>::AdvectionFieldMethod::fem_field
+                  && parameters.use_explicit_discontinuous_composition_advection)
+                {
+                  advect_composition_explicitly (adv_field);
+                  if (compute_initial_residual)
+                    (*initial_residual)[c] = 0.0;
+                  break;
+                }
+
               assemble_advection_system (adv_field);
 
               if (compute_initial_residual)
@@ -186,9 +386,10 @@ namespace aspect
 
               current_residual[c] = solve_advection(adv_field);
 
-              // free matrix:
+              // free matrix, unless the following fields may reuse it:
               const unsigned int block_idx = adv_field.block_index(introspection);
-              if (adv_field.compositional_variable!=0)
+              if (adv_field.compositional_variable!=0
+                  && adv_field.compositional_variable!=composition_matrix_field)
                 system_matrix.block(block_idx, block_idx).clear();
               break;
             }
@@ -214,6 +415,10 @@ namespace aspect
           }
       }
 
+    // the next call of this function uses a different linearization point, so
+    // the matrix assembled for the compositional fields can not be reused anymore
+    release_composition_matrix();
+
     // for consistency we update the current linearization point only after we have solved
     // all fields, so that we use the same point in time for every field when solving
     for (unsigned int c=0; c<introspection.n_compositional_fields; ++c)
@@ -318,8 +523,14 @@ namespace aspect
                parameters.max_nonlinear_iterations_in_prerefinement)
       :
       parameters.max_nonlinear_iterations;
+
+    AndersonAcceleration anderson_acceleration (parameters.anderson_acceleration_depth, system_rhs);
+
     do
       {
+        if (parameters.anderson_acceleration_depth > 0)
+          anderson_acceleration.begin_iteration (current_linearization_point);
+
         const double relative_nonlinear_stokes_residual =
           assemble_and_solve_stokes(nonlinear_iteration == 0, &initial_stokes_residual);
 
@@ -334,6 +545,15 @@ namespace aspect
         if (relative_nonlinear_stokes_residual < parameters.nonlinear_tolerance)
           break;
 
+        if (parameters.anderson_acceleration_depth > 0)
+          {
+            const unsigned int n_accelerated =
+              anderson_acceleration.accelerate (current_linearization_point, relative_nonlinear_stokes_residual);
+            if (n_accelerated > 0)
+              pcout << "      Anderson acceleration using " << n_accelerated
+                    << " previous iteration(s)." << std::endl;
+          }
+
         ++nonlinear_iteration;
       }
     while (nonlinear_iteration < max_nonlinear_iterations);
@@ -369,8 +589,13 @@ namespace aspect
       :
       parameters.max_nonlinear_iterations;
 
+    AndersonAcceleration anderson_acceleration (parameters.anderson_acceleration_depth, system_rhs);
+
     do
       {
+        if (parameters.anderson_acceleration_depth > 0)
+          anderson_acceleration.begin_iteration (current_linearization_point);
+
         const double relative_temperature_residual =
           assemble_and_solve_temperature(nonlinear_iteration == 0, &initial_temperature_residual);
 
@@ -416,6 +641,15 @@ namespace aspect
         if (max < parameters.nonlinear_tolerance)
           break;
 
+        if (parameters.anderson_acceleration_depth > 0)
+          {
+            const unsigned int n_accelerated =
+              anderson_acceleration.accelerate (current_linearization_point, max);
+            if (n_accelerated > 0)
+              pcout << "      Anderson acceleration using " << n_accelerated
+                    << " previous iteration(s)." << std::endl;
+          }
+
         ++nonlinear_iteration;
       }
     while (nonlinear_iteration < max_nonlinear_iterations);
@@ -444,8 +678,13 @@ namespace aspect
       :
       parameters.max_nonlinear_iterations;
 
+    AndersonAcceleration anderson_acceleration (parameters.anderson_acceleration_depth, system_rhs);
+
     do
       {
+        if (parameters.anderson_acceleration_depth > 0)
+          anderson_acceleration.begin_iteration (current_linearization_point);
+
         const double relative_nonlinear_stokes_residual =
           assemble_and_solve_stokes(nonlinear_iteration == 0, &initial_stokes_residual);
 
@@ -461,6 +700,15 @@ namespace aspect
         if (relative_nonlinear_stokes_residual < parameters.nonlinear_tolerance)
           break;
 
+        if (parameters.anderson_acceleration_depth > 0)
+          {
+            const unsigned int n_accelerated =
+              anderson_acceleration.accelerate (current_linearization_point, relative_nonlinear_stokes_residual);
+            if (n_accelerated > 0)
+              pcout << "      Anderson acceleration using " << n_accelerated
+                    << " previous iteration(s)." << std::endl;
+          }
+
         ++nonlinear_iteration;
       }
     while (nonlinear_iteration < max_nonlinear_iterations);
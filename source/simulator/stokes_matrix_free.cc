@@ -0,0 +1,1590 @@
+/*
+  Copyright (C) 2018 by the authors of the ASPECT code.
+
+  This file is part of ASPECT.
+
+  ASPECT is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2, or (at your option)
+  any later version.
+
+  ASPECT is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with ASPECT; see the file LICENSE.  If not see
+  <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <aspect/stokes_matrix_free.h>
+
+#if DEAL_II_VERSION_GTE(9,1,0)
+
+#include <aspect/compat.h>
+#include <aspect/material_model/interface.h>
+
+#include <deal.II/base/quadrature_lib.h>
+#include <deal.II/base/signaling_nan.h>
+
+#include <deal.II/lac/solver_cg.h>
+#include <deal.II/lac/solver_gmres.h>
+#include <deal.II/lac/precondition.h>
+#include <deal.II/lac/diagonal_matrix.h>
+
+#include <deal.II/dofs/dof_tools.h>
+
+#include <deal.II/fe/fe_values.h>
+
+#include <deal.II/multigrid/multigrid.h>
+#include <deal.II/multigrid/mg_coarse.h>
+#include <deal.II/multigrid/mg_smoother.h>
+#include <deal.II/multigrid/mg_matrix.h>
+#include <deal.II/multigrid/mg_tools.h>
+
+#include <deal.II/numerics/vector_tools.h>
+
+#include <algorithm>
+#include <fstream>
+
+
+namespace aspect
+{
+  namespace internal
+  {
+    /**
+     * Apply the viscous part of the velocity operator at all quadrature
+     * points of the current cell batch of @p velocity, i.e., submit
+     * $2\eta\varepsilon(u) - \frac 23 \eta (\nabla \cdot u) I$ (the
+     * second term only for compressible models) as the symmetric gradient
+     * to be tested against. If the viscosity table only has a single entry
+     * per cell batch, this value is used at all quadrature points.
+     */
+    template <int dim, typename number, class FEEvaluationType>
+    void
+    submit_viscous_stress (FEEvaluationType                         &velocity,
+                           const Table<2, VectorizedArray<number> > &viscosity_x_2,
+                           const unsigned int                        cell,
+                           const bool                                is_compressible)
+    {
+      const bool use_cell_average = (viscosity_x_2.size(1) == 1);
+
+      for (unsigned int q=0; q<velocity.n_q_points; ++q)
+        {
+          const VectorizedArray<number> eta_x_2 = viscosity_x_2(cell, use_cell_average ? 0 : q);
+
+          SymmetricTensor<2,dim,VectorizedArray<number> > sym_grad_u
+            = velocity.get_symmetric_gradient (q);
+          const VectorizedArray<number> div = trace(sym_grad_u);
+          sym_grad_u *= eta_x_2;
+
+          if (is_compressible)
+            for (unsigned int d=0; d<dim; ++d)
+              sym_grad_u[d][d] -= eta_x_2 * (number(1.)/number(3.)) * div;
+
+          velocity.submit_symmetric_gradient (sym_grad_u, q);
+        }
+    }
+
+
+
+    /**
+     * Implement the block Schur preconditioner for the Stokes system with
+     * matrix-free operators. This is the same preconditioner as
+     * internal::BlockSchurPreconditioner in solver.cc, but it applies
+     * $B^T$ through the Stokes operator and solves with the A block
+     * operator rather than with assembled matrix blocks.
+     */
+    template <class StokesMatrixType, class ABlockMatrixType, class SchurComplementMatrixType,
+              class ABlockPreconditionerType, class SchurComplementPreconditionerType>
+    class BlockSchurGMGPreconditioner : public Subscriptor
+    {
+      public:
+        typedef dealii::LinearAlgebra::distributed::Vector<double> VectorType;
+        typedef dealii::LinearAlgebra::distributed::BlockVector<double> BlockVectorType;
+
+        /**
+         * @brief Constructor
+         *
+         * @param Stokes_matrix The matrix-free Stokes operator.
+         * @param A_block The matrix-free operator of the velocity block.
+         * @param Schur_complement_block The matrix-free operator that
+         *     approximates the Schur complement (the weighted pressure mass
+         *     matrix).
+         * @param A_block_preconditioner Preconditioner for the A block,
+         *     typically one multigrid V-cycle.
+         * @param Schur_complement_preconditioner Preconditioner for the
+         *     Schur complement approximation.
+         * @param do_solve_A A flag indicating whether we should actually solve with
+         *     the matrix $A$, or only apply one preconditioner step with it.
+         * @param A_block_tolerance The tolerance for the CG solver which computes
+         *     the inverse of the A block.
+         * @param S_block_tolerance The tolerance for the CG solver which computes
+         *     the inverse of the S block (Schur complement matrix).
+         */
+        BlockSchurGMGPreconditioner (const StokesMatrixType                  &Stokes_matrix,
+                                     const ABlockMatrixType                  &A_block,
+                                     const SchurComplementMatrixType         &Schur_complement_block,
+                                     const ABlockPreconditionerType          &A_block_preconditioner,
+                                     const SchurComplementPreconditionerType &Schur_complement_preconditioner,
+                                     const bool                               do_solve_A,
+                                     const double                             A_block_tolerance,
+                                     const double                             S_block_tolerance);
+
+        /**
+         * Matrix vector product with this preconditioner object.
+         */
+        void vmult (BlockVectorType       &dst,
+                    const BlockVectorType &src) const;
+
+        unsigned int n_iterations_A() const;
+        unsigned int n_iterations_S() const;
+
+      private:
+        /**
+         * References to the various operator objects this preconditioner
+         * works on.
+         */
+        const StokesMatrixType                  &stokes_matrix;
+        const ABlockMatrixType                  &velocity_matrix;
+        const SchurComplementMatrixType         &mass_matrix;
+        const ABlockPreconditionerType          &a_preconditioner;
+        const SchurComplementPreconditionerType &mp_preconditioner;
+
+        /**
+         * Whether to actually invert the $\tilde A$ part of the preconditioner matrix
+         * or to just apply a single preconditioner step with it.
+         */
+        const bool do_solve_A;
+        mutable unsigned int n_iterations_A_;
+        mutable unsigned int n_iterations_S_;
+        const double A_block_tolerance;
+        const double S_block_tolerance;
+    };
+
+
+
+    template <class StokesMatrixType, class ABlockMatrixType, class SchurComplementMatrixType,
+              class ABlockPreconditionerType, class SchurComplementPreconditionerType>
+    BlockSchurGMGPreconditioner<StokesMatrixType, ABlockMatrixType, SchurComplementMatrixType,
+                                ABlockPreconditionerType, SchurComplementPreconditionerType>::
+                                BlockSchurGMGPreconditioner (const StokesMatrixType                  &Stokes_matrix,
+                                                             const ABlockMatrixType                  &A_block,
+                                                             const SchurComplementMatrixType         &Schur_complement_block,
+                                                             const ABlockPreconditionerType          &A_block_preconditioner,
+                                                             const SchurComplementPreconditionerType &Schur_complement_preconditioner,
+                                                             const bool                               do_solve_A,
+                                                             const double                             A_block_tolerance,
+                                                             const double                             S_block_tolerance)
+                                  :
+                                  stokes_matrix (Stokes_matrix),
+                                  velocity_matrix (A_block),
+                                  mass_matrix (Schur_complement_block),
+                                  a_preconditioner (A_block_preconditioner),
+                                  mp_preconditioner (Schur_complement_preconditioner),
+                                  do_solve_A (do_solve_A),
+                                  n_iterations_A_ (0),
+                                  n_iterations_S_ (0),
+                                  A_block_tolerance (A_block_tolerance),
+                                  S_block_tolerance (S_block_tolerance)
+    {}
+
+
+
+    template <class StokesMatrixType, class ABlockMatrixType, class SchurComplementMatrixType,
+              class ABlockPreconditionerType, class SchurComplementPreconditionerType>
+    unsigned int
+    BlockSchurGMGPreconditioner<StokesMatrixType, ABlockMatrixType, SchurComplementMatrixType,
+                                ABlockPreconditionerType, SchurComplementPreconditionerType>::
+                                n_iterations_A() const
+    {
+      return n_iterations_A_;
+    }
+
+
+
+    template <class StokesMatrixType, class ABlockMatrixType, class SchurComplementMatrixType,
+              class ABlockPreconditionerType, class SchurComplementPreconditionerType>
+    unsigned int
+    BlockSchurGMGPreconditioner<StokesMatrixType, ABlockMatrixType, SchurComplementMatrixType,
+                                ABlockPreconditionerType, SchurComplementPreconditionerType>::
+                                n_iterations_S() const
+    {
+      return n_iterations_S_;
+    }
+
+
+
+    template <class StokesMatrixType, class ABlockMatrixType, class SchurComplementMatrixType,
+              class ABlockPreconditionerType, class SchurComplementPreconditionerType>
+    void
+    BlockSchurGMGPreconditioner<StokesMatrixType, ABlockMatrixType, SchurComplementMatrixType,
+                                ABlockPreconditionerType, SchurComplementPreconditionerType>::
+                                vmult (BlockVectorType       &dst,
+                                       const BlockVectorType &src) const
+    {
+      BlockVectorType utmp (src);
+
+      // first solve with the bottom right block, which is the mass
+      // matrix weighted by the inverse of the viscosity
+      {
+        SolverControl solver_control (1000, src.block(1).l2_norm() * S_block_tolerance);
+        SolverCG<VectorType> solver (solver_control);
+
+        // skip the solve if the right hand side is zero, for consistency
+        // with the matrix-based preconditioner
+        if (src.block(1).l2_norm() > 1e-50)
+          {
+            try
+              {
+                dst.block(1) = 0.0;
+                solver.solve (mass_matrix,
+                              dst.block(1), src.block(1),
+                              mp_preconditioner);
+                n_iterations_S_ += solver_control.last_step();
+              }
+            // if the solver fails, report the error from processor 0 with some additional
+            // information about its location, and throw a quiet exception on all other
+            // processors
+            catch (const std::exception &exc)
+              {
+                if (Utilities::MPI::this_mpi_process(src.block(0).get_mpi_communicator()) == 0)
+                  AssertThrow (false,
+                               ExcMessage (std::string("The iterative (bottom right) solver in BlockSchurGMGPreconditioner::vmult "
+                                                       "did not converge to a tolerance of "
+                                                       + Utilities::to_string(solver_control.tolerance()) +
+                                                       ". It reported the following error:\n\n")
+                                           +
+                                           exc.what()))
+                  else
+                    throw QuietException();
+              }
+          }
+
+        dst.block(1) *= -1.0;
+      }
+
+      // apply the top right block: multiplying the Stokes operator with
+      // (0, dst_p) yields (B^T dst_p, 0)
+      {
+        dst.block(0) = 0.0;
+        stokes_matrix.vmult (utmp, dst);
+        utmp.block(0) *= -1.0;
+        utmp.block(0) += src.block(0);
+      }
+
+      // now either solve with the top left block (if do_solve_A==true)
+      // or just apply one preconditioner sweep (for the first few
+      // iterations of our two-stage outer GMRES iteration)
+      if (do_solve_A == true)
+        {
+          SolverControl solver_control (10000, utmp.block(0).l2_norm() * A_block_tolerance);
+          SolverCG<VectorType> solver (solver_control);
+          try
+            {
+              dst.block(0) = 0.0;
+              solver.solve (velocity_matrix, dst.block(0), utmp.block(0),
+                            a_preconditioner);
+              n_iterations_A_ += solver_control.last_step();
+            }
+          // if the solver fails, report the error from processor 0 with some additional
+          // information about its location, and throw a quiet exception on all other
+          // processors
+          catch (const std::exception &exc)
+            {
+              if (Utilities::MPI::this_mpi_process(src.block(0).get_mpi_communicator()) == 0)
+                AssertThrow (false,
+                             ExcMessage (std::string("The iterative (top left) solver in BlockSchurGMGPreconditioner::vmult "
+                                                     "did not converge to a tolerance of "
+                                                     + Utilities::to_string(solver_control.tolerance()) +
+                                                     ". It reported the following error:\n\n")
+                                         +
+                                         exc.what()))
+                else
+                  throw QuietException();
+            }
+        }
+      else
+        {
+          a_preconditioner.vmult (dst.block(0), utmp.block(0));
+          n_iterations_A_ += 1;
+        }
+    }
+  }
+
+
+
+  namespace MatrixFreeStokesOperators
+  {
+    template <int dim, int degree_v, typename number>
+    StokesOperator<dim,degree_v,number>::StokesOperator ()
+      :
+      MatrixFreeOperators::Base<dim, dealii::LinearAlgebra::distributed::BlockVector<number> >(),
+      viscosity_x_2 (NULL),
+      pressure_scaling (numbers::signaling_nan<double>()),
+      is_compressible (false)
+    {}
+
+
+
+    template <int dim, int degree_v, typename number>
+    void
+    StokesOperator<dim,degree_v,number>::clear ()
+    {
+      viscosity_x_2 = NULL;
+      MatrixFreeOperators::Base<dim, dealii::LinearAlgebra::distributed::BlockVector<number> >::clear();
+    }
+
+
+
+    template <int dim, int degree_v, typename number>
+    void
+    StokesOperator<dim,degree_v,number>::
+    fill_cell_data (const Table<2, VectorizedArray<number> > &viscosity_table,
+                    const double pressure_scaling,
+                    const bool is_compressible)
+    {
+      this->viscosity_x_2 = &viscosity_table;
+      this->pressure_scaling = pressure_scaling;
+      this->is_compressible = is_compressible;
+    }
+
+
+
+    template <int dim, int degree_v, typename number>
+    void
+    StokesOperator<dim,degree_v,number>::compute_diagonal ()
+    {
+      Assert (false, ExcNotImplemented());
+    }
+
+
+
+    template <int dim, int degree_v, typename number>
+    void
+    StokesOperator<dim,degree_v,number>::
+    local_apply (const dealii::MatrixFree<dim, number> &data,
+                 dealii::LinearAlgebra::distributed::BlockVector<number> &dst,
+                 const dealii::LinearAlgebra::distributed::BlockVector<number> &src,
+                 const std::pair<unsigned int, unsigned int> &cell_range) const
+    {
+      typedef VectorizedArray<number> vector_t;
+      FEEvaluation<dim,degree_v,degree_v+1,dim,number> velocity (data, 0);
+      FEEvaluation<dim,degree_v-1,degree_v+1,1,number> pressure (data, 1);
+
+      for (unsigned int cell=cell_range.first; cell<cell_range.second; ++cell)
+        {
+          velocity.reinit (cell);
+          velocity.read_dof_values (src.block(0));
+          velocity.evaluate (false,true,false);
+          pressure.reinit (cell);
+          pressure.read_dof_values (src.block(1));
+          pressure.evaluate (true,false,false);
+
+          for (unsigned int q=0; q<velocity.n_q_points; ++q)
+            {
+              SymmetricTensor<2,dim,vector_t> sym_grad_u
+                = velocity.get_symmetric_gradient (q);
+              const vector_t pres = pressure.get_value (q);
+              const vector_t div = trace(sym_grad_u);
+
+              // assemble -div(u) as -(div u, q), scaled like the pressure
+              pressure.submit_value (-number(pressure_scaling) * div, q);
+
+              sym_grad_u *= (*viscosity_x_2)(cell,q);
+
+              // assemble \nabla p as -(p, div v), and the compressible
+              // strain rate term
+              for (unsigned int d=0; d<dim; ++d)
+                {
+                  if (is_compressible)
+                    sym_grad_u[d][d] -= (*viscosity_x_2)(cell,q) * (number(1.)/number(3.)) * div;
+
+                  sym_grad_u[d][d] -= number(pressure_scaling) * pres;
+                }
+
+              velocity.submit_symmetric_gradient (sym_grad_u, q);
+            }
+
+          velocity.integrate (false,true);
+          velocity.distribute_local_to_global (dst.block(0));
+          pressure.integrate (true,false);
+          pressure.distribute_local_to_global (dst.block(1));
+        }
+    }
+
+
+
+    template <int dim, int degree_v, typename number>
+    void
+    StokesOperator<dim,degree_v,number>::
+    apply_add (dealii::LinearAlgebra::distributed::BlockVector<number> &dst,
+               const dealii::LinearAlgebra::distributed::BlockVector<number> &src) const
+    {
+      MatrixFreeOperators::Base<dim, dealii::LinearAlgebra::distributed::BlockVector<number> >::
+      data->cell_loop (&StokesOperator::local_apply, this, dst, src);
+    }
+
+
+
+    template <int dim, int degree_p, typename number>
+    MassMatrixOperator<dim,degree_p,number>::MassMatrixOperator ()
+      :
+      MatrixFreeOperators::Base<dim, dealii::LinearAlgebra::distributed::Vector<number> >(),
+      viscosity_x_2 (NULL),
+      pressure_scaling (numbers::signaling_nan<double>())
+    {}
+
+
+
+    template <int dim, int degree_p, typename number>
+    void
+    MassMatrixOperator<dim,degree_p,number>::clear ()
+    {
+      viscosity_x_2 = NULL;
+      MatrixFreeOperators::Base<dim, dealii::LinearAlgebra::distributed::Vector<number> >::clear();
+    }
+
+
+
+    template <int dim, int degree_p, typename number>
+    void
+    MassMatrixOperator<dim,degree_p,number>::
+    fill_cell_data (const Table<2, VectorizedArray<number> > &viscosity_table,
+                    const double pressure_scaling)
+    {
+      this->viscosity_x_2 = &viscosity_table;
+      this->pressure_scaling = pressure_scaling;
+    }
+
+
+
+    template <int dim, int degree_p, typename number>
+    void
+    MassMatrixOperator<dim,degree_p,number>::
+    local_apply (const dealii::MatrixFree<dim, number> &data,
+                 dealii::LinearAlgebra::distributed::Vector<number> &dst,
+                 const dealii::LinearAlgebra::distributed::Vector<number> &src,
+                 const std::pair<unsigned int, unsigned int> &cell_range) const
+    {
+      FEEvaluation<dim,degree_p,degree_p+2,1,number> pressure (data, this->selected_rows[0]);
+
+      // 2 pressure_scaling^2 / (2 eta) = pressure_scaling^2 / eta
+      const VectorizedArray<number> two_pressure_scaling_squared
+        = make_vectorized_array<number> (2. * pressure_scaling * pressure_scaling);
+
+      for (unsigned int cell=cell_range.first; cell<cell_range.second; ++cell)
+        {
+          pressure.reinit (cell);
+          pressure.read_dof_values (src);
+          pressure.evaluate (true, false);
+          for (unsigned int q=0; q<pressure.n_q_points; ++q)
+            pressure.submit_value (two_pressure_scaling_squared / (*viscosity_x_2)(cell,q)
+                                   * pressure.get_value(q), q);
+          pressure.integrate (true, false);
+          pressure.distribute_local_to_global (dst);
+        }
+    }
+
+
+
+    template <int dim, int degree_p, typename number>
+    void
+    MassMatrixOperator<dim,degree_p,number>::
+    apply_add (dealii::LinearAlgebra::distributed::Vector<number> &dst,
+               const dealii::LinearAlgebra::distributed::Vector<number> &src) const
+    {
+      MatrixFreeOperators::Base<dim, dealii::LinearAlgebra::distributed::Vector<number> >::
+      data->cell_loop (&MassMatrixOperator::local_apply, this, dst, src);
+    }
+
+
+
+    template <int dim, int degree_p, typename number>
+    void
+    MassMatrixOperator<dim,degree_p,number>::compute_diagonal ()
+    {
+      this->inverse_diagonal_entries.
+      reset(new DiagonalMatrix<dealii::LinearAlgebra::distributed::Vector<number> >());
+      this->diagonal_entries.
+      reset(new DiagonalMatrix<dealii::LinearAlgebra::distributed::Vector<number> >());
+
+      dealii::LinearAlgebra::distributed::Vector<number> &inverse_diagonal =
+        this->inverse_diagonal_entries->get_vector();
+      dealii::LinearAlgebra::distributed::Vector<number> &diagonal =
+        this->diagonal_entries->get_vector();
+
+      unsigned int dummy = 0;
+      this->data->initialize_dof_vector (inverse_diagonal, this->selected_rows[0]);
+      this->data->initialize_dof_vector (diagonal, this->selected_rows[0]);
+
+      this->data->cell_loop (&MassMatrixOperator::local_compute_diagonal, this,
+                             diagonal, dummy);
+
+      this->set_constrained_entries_to_one (diagonal);
+      inverse_diagonal = diagonal;
+      const unsigned int local_size = inverse_diagonal.local_size();
+      for (unsigned int i=0; i<local_size; ++i)
+        {
+          Assert (inverse_diagonal.local_element(i) > 0.,
+                  ExcMessage("No diagonal entry in a positive definite operator "
+                             "should be zero or negative."));
+          inverse_diagonal.local_element(i) = 1./inverse_diagonal.local_element(i);
+        }
+    }
+
+
+
+    template <int dim, int degree_p, typename number>
+    void
+    MassMatrixOperator<dim,degree_p,number>::
+    local_compute_diagonal (const MatrixFree<dim,number> &data,
+                            dealii::LinearAlgebra::distributed::Vector<number> &dst,
+                            const unsigned int &,
+                            const std::pair<unsigned int,unsigned int> &cell_range) const
+    {
+      FEEvaluation<dim,degree_p,degree_p+2,1,number> pressure (data, this->selected_rows[0]);
+
+      const VectorizedArray<number> two_pressure_scaling_squared
+        = make_vectorized_array<number> (2. * pressure_scaling * pressure_scaling);
+
+      AlignedVector<VectorizedArray<number> > diagonal (pressure.dofs_per_cell);
+      for (unsigned int cell=cell_range.first; cell<cell_range.second; ++cell)
+        {
+          pressure.reinit (cell);
+          for (unsigned int i=0; i<pressure.dofs_per_cell; ++i)
+            {
+              for (unsigned int j=0; j<pressure.dofs_per_cell; ++j)
+                pressure.begin_dof_values()[j] = VectorizedArray<number>();
+              pressure.begin_dof_values()[i] = make_vectorized_array<number> (1.);
+
+              pressure.evaluate (true,false,false);
+              for (unsigned int q=0; q<pressure.n_q_points; ++q)
+                pressure.submit_value (two_pressure_scaling_squared / (*viscosity_x_2)(cell,q)
+                                       * pressure.get_value(q), q);
+              pressure.integrate (true,false);
+
+              diagonal[i] = pressure.begin_dof_values()[i];
+            }
+
+          for (unsigned int i=0; i<pressure.dofs_per_cell; ++i)
+            pressure.begin_dof_values()[i] = diagonal[i];
+          pressure.distribute_local_to_global (dst);
+        }
+    }
+
+
+
+    template <int dim, int degree_v, typename number>
+    ABlockOperator<dim,degree_v,number>::ABlockOperator ()
+      :
+      MatrixFreeOperators::Base<dim, dealii::LinearAlgebra::distributed::Vector<number> >(),
+      viscosity_x_2 (NULL),
+      is_compressible (false)
+    {}
+
+
+
+    template <int dim, int degree_v, typename number>
+    void
+    ABlockOperator<dim,degree_v,number>::clear ()
+    {
+      viscosity_x_2 = NULL;
+      MatrixFreeOperators::Base<dim, dealii::LinearAlgebra::distributed::Vector<number> >::clear();
+    }
+
+
+
+    template <int dim, int degree_v, typename number>
+    void
+    ABlockOperator<dim,degree_v,number>::
+    fill_cell_data (const Table<2, VectorizedArray<number> > &viscosity_table,
+                    const bool is_compressible)
+    {
+      this->viscosity_x_2 = &viscosity_table;
+      this->is_compressible = is_compressible;
+    }
+
+
+
+    template <int dim, int degree_v, typename number>
+    void
+    ABlockOperator<dim,degree_v,number>::
+    local_apply (const dealii::MatrixFree<dim, number> &data,
+                 dealii::LinearAlgebra::distributed::Vector<number> &dst,
+                 const dealii::LinearAlgebra::distributed::Vector<number> &src,
+                 const std::pair<unsigned int, unsigned int> &cell_range) const
+    {
+      FEEvaluation<dim,degree_v,degree_v+1,dim,number> velocity (data, this->selected_rows[0]);
+
+      for (unsigned int cell=cell_range.first; cell<cell_range.second; ++cell)
+        {
+          velocity.reinit (cell);
+          velocity.read_dof_values (src);
+          velocity.evaluate (false, true, false);
+          internal::submit_viscous_stress<dim,number> (velocity, *viscosity_x_2, cell, is_compressible);
+          velocity.integrate (false, true);
+          velocity.distribute_local_to_global (dst);
+        }
+    }
+
+
+
+    template <int dim, int degree_v, typename number>
+    void
+    ABlockOperator<dim,degree_v,number>::
+    apply_add (dealii::LinearAlgebra::distributed::Vector<number> &dst,
+               const dealii::LinearAlgebra::distributed::Vector<number> &src) const
+    {
+      MatrixFreeOperators::Base<dim, dealii::LinearAlgebra::distributed::Vector<number> >::
+      data->cell_loop (&ABlockOperator::local_apply, this, dst, src);
+    }
+
+
+
+    template <int dim, int degree_v, typename number>
+    void
+    ABlockOperator<dim,degree_v,number>::compute_diagonal ()
+    {
+      this->inverse_diagonal_entries.
+      reset(new DiagonalMatrix<dealii::LinearAlgebra::distributed::Vector<number> >());
+      dealii::LinearAlgebra::distributed::Vector<number> &inverse_diagonal =
+        this->inverse_diagonal_entries->get_vector();
+      this->data->initialize_dof_vector (inverse_diagonal, this->selected_rows[0]);
+
+      unsigned int dummy = 0;
+      this->data->cell_loop (&ABlockOperator::local_compute_diagonal, this,
+                             inverse_diagonal, dummy);
+
+      this->set_constrained_entries_to_one (inverse_diagonal);
+
+      for (unsigned int i=0; i<inverse_diagonal.local_size(); ++i)
+        {
+          Assert (inverse_diagonal.local_element(i) > 0.,
+                  ExcMessage("No diagonal entry in a positive definite operator "
+                             "should be zero or negative."));
+          inverse_diagonal.local_element(i) = 1./inverse_diagonal.local_element(i);
+        }
+    }
+
+
+
+    template <int dim, int degree_v, typename number>
+    void
+    ABlockOperator<dim,degree_v,number>::
+    local_compute_diagonal (const MatrixFree<dim,number> &data,
+                            dealii::LinearAlgebra::distributed::Vector<number> &dst,
+                            const unsigned int &,
+                            const std::pair<unsigned int,unsigned int> &cell_range) const
+    {
+      FEEvaluation<dim,degree_v,degree_v+1,dim,number> velocity (data, this->selected_rows[0]);
+
+      AlignedVector<VectorizedArray<number> > diagonal (velocity.dofs_per_cell);
+      for (unsigned int cell=cell_range.first; cell<cell_range.second; ++cell)
+        {
+          velocity.reinit (cell);
+          for (unsigned int i=0; i<velocity.dofs_per_cell; ++i)
+            {
+              for (unsigned int j=0; j<velocity.dofs_per_cell; ++j)
+                velocity.begin_dof_values()[j] = VectorizedArray<number>();
+              velocity.begin_dof_values()[i] = make_vectorized_array<number> (1.);
+
+              velocity.evaluate (false, true, false);
+              internal::submit_viscous_stress<dim,number> (velocity, *viscosity_x_2, cell, is_compressible);
+              velocity.integrate (false, true);
+
+              diagonal[i] = velocity.begin_dof_values()[i];
+            }
+
+          for (unsigned int i=0; i<velocity.dofs_per_cell; ++i)
+            velocity.begin_dof_values()[i] = diagonal[i];
+          velocity.distribute_local_to_global (dst);
+        }
+    }
+  }
+
+
+
+  template <int dim>
+  StokesMatrixFreeHandler<dim>::StokesMatrixFreeHandler (Simulator<dim> &simulator,
+                                                         ParameterHandler &prm)
+    :
+    sim (simulator),
+    fe_v (FE_Q<dim>(velocity_degree), dim),
+    fe_p (velocity_degree-1),
+    fe_projection (0),
+    dof_handler_v (simulator.triangulation),
+    dof_handler_p (simulator.triangulation),
+    dof_handler_projection (simulator.triangulation)
+  {
+    parse_parameters (prm);
+
+    const Parameters<dim> &parameters = sim.parameters;
+
+    AssertThrow (parameters.stokes_velocity_degree == velocity_degree
+                 &&
+                 parameters.use_locally_conservative_discretization == false,
+                 ExcMessage ("The 'block GMG' Stokes solver is currently only implemented "
+                             "for the Q2xQ1 element, i.e., a 'Stokes velocity polynomial degree' "
+                             "of 2 and a continuous pressure."));
+    AssertThrow (parameters.include_melt_transport == false
+                 &&
+                 parameters.free_surface_enabled == false,
+                 ExcMessage ("The 'block GMG' Stokes solver does not support models "
+                             "with melt transport or with a free surface."));
+    AssertThrow (parameters.nonlinear_solver != Parameters<dim>::NonlinearSolver::iterated_Advection_and_Newton_Stokes,
+                 ExcMessage ("The 'block GMG' Stokes solver can not be used with the Newton solver."));
+    AssertThrow (parameters.formulation_mass_conservation !=
+                 Parameters<dim>::Formulation::MassConservation::implicit_reference_density_profile,
+                 ExcMessage ("The 'block GMG' Stokes solver does not support the implicit "
+                             "reference density profile formulation, because it adds terms "
+                             "to the Stokes matrix that are not part of the matrix-free operator."));
+    AssertThrow (sim.geometry_model->get_periodic_boundary_pairs().size() == 0,
+                 ExcMessage ("The 'block GMG' Stokes solver does not support periodic boundaries."));
+    AssertThrow (!(parameters.nullspace_removal & (Parameters<dim>::NullspaceRemoval::linear_momentum
+                                                   | Parameters<dim>::NullspaceRemoval::net_translation)),
+                 ExcMessage ("The 'block GMG' Stokes solver does not support the removal of "
+                             "translational nullspace components, because these are implemented "
+                             "as constraints that are not known to the multigrid hierarchy."));
+  }
+
+
+
+  template <int dim>
+  StokesMatrixFreeHandler<dim>::~StokesMatrixFreeHandler ()
+  {}
+
+
+
+  template <int dim>
+  void
+  StokesMatrixFreeHandler<dim>::parse_parameters (ParameterHandler &prm)
+  {
+    prm.enter_subsection ("Solver parameters");
+    {
+      prm.enter_subsection ("Matrix free");
+      {
+        chebyshev_degree = prm.get_integer ("Chebyshev smoother degree");
+        use_single_precision_multigrid = prm.get_bool ("Use single precision multigrid");
+      }
+      prm.leave_subsection ();
+    }
+    prm.leave_subsection ();
+  }
+
+
+
+  template <int dim>
+  void
+  StokesMatrixFreeHandler<dim>::setup_dofs ()
+  {
+    const Mapping<dim> &mapping = *sim.mapping;
+
+    // distribute the degrees of freedom for velocity, pressure, and the
+    // piecewise constant element used to transfer the viscosity to the
+    // multigrid levels, on the active mesh as well as on all levels
+    dof_handler_v.clear ();
+    dof_handler_v.distribute_dofs (fe_v);
+    dof_handler_v.distribute_mg_dofs ();
+
+    dof_handler_p.clear ();
+    dof_handler_p.distribute_dofs (fe_p);
+
+    dof_handler_projection.clear ();
+    dof_handler_projection.distribute_dofs (fe_projection);
+    dof_handler_projection.distribute_mg_dofs ();
+
+    // The boundaries on which the velocity is prescribed. In the matrix-free
+    // solver, all of these constraints are homogeneous: the inhomogeneities
+    // of the current time step are already part of the right hand side
+    // computed by Simulator::assemble_stokes_system().
+    std::map<types::boundary_id, ComponentMask> dirichlet_boundaries;
+    {
+      const std::set<types::boundary_id> &zero_boundaries
+        = sim.boundary_velocity_manager.get_zero_boundary_velocity_indicators();
+      for (std::set<types::boundary_id>::const_iterator p = zero_boundaries.begin();
+           p != zero_boundaries.end(); ++p)
+        dirichlet_boundaries[*p] = ComponentMask (dim, true);
+
+      for (typename std::map<types::boundary_id,std::pair<std::string, std::vector<std::string> > >::const_iterator
+           p = sim.boundary_velocity_manager.get_active_boundary_velocity_names().begin();
+           p != sim.boundary_velocity_manager.get_active_boundary_velocity_names().end(); ++p)
+        {
+          const std::string &comp = p->second.first;
+          std::vector<bool> mask (dim, comp.length() == 0);
+          for (std::string::const_iterator direction=comp.begin(); direction!=comp.end(); ++direction)
+            {
+              const unsigned int d = (*direction == 'x' ? 0 : (*direction == 'y' ? 1 : 2));
+              Assert (d < dim, ExcInternalError());
+              mask[d] = true;
+            }
+          dirichlet_boundaries[p->first] = ComponentMask (mask);
+        }
+    }
+    const std::set<types::boundary_id> &tangential_boundaries
+      = sim.boundary_velocity_manager.get_tangential_boundary_velocity_indicators();
+
+    // constraints on the active level
+    {
+      IndexSet locally_relevant_dofs;
+      DoFTools::extract_locally_relevant_dofs (dof_handler_v, locally_relevant_dofs);
+      constraints_v.clear ();
+      constraints_v.reinit (locally_relevant_dofs);
+      DoFTools::make_hanging_node_constraints (dof_handler_v, constraints_v);
+      for (typename std::map<types::boundary_id, ComponentMask>::const_iterator
+           p = dirichlet_boundaries.begin(); p != dirichlet_boundaries.end(); ++p)
+        VectorTools::interpolate_boundary_values (mapping,
+                                                  dof_handler_v,
+                                                  p->first,
+                                                  ZeroFunction<dim>(dim),
+                                                  constraints_v,
+                                                  p->second);
+      VectorTools::compute_no_normal_flux_constraints (dof_handler_v,
+                                                       /* first_vector_component= */ 0,
+                                                       tangential_boundaries,
+                                                       constraints_v,
+                                                       mapping);
+      constraints_v.close ();
+    }
+    {
+      IndexSet locally_relevant_dofs;
+      DoFTools::extract_locally_relevant_dofs (dof_handler_p, locally_relevant_dofs);
+      constraints_p.clear ();
+      constraints_p.reinit (locally_relevant_dofs);
+      DoFTools::make_hanging_node_constraints (dof_handler_p, constraints_p);
+      constraints_p.close ();
+    }
+
+    // the matrix-free storage and operators on the active level
+    {
+      typename MatrixFree<dim,double>::AdditionalData additional_data;
+      additional_data.tasks_parallel_scheme =
+        MatrixFree<dim,double>::AdditionalData::none;
+      additional_data.mapping_update_flags = (update_values | update_gradients |
+                                              update_JxW_values | update_quadrature_points);
+
+      std::vector<const DoFHandler<dim>*> stokes_dofs;
+      stokes_dofs.push_back (&dof_handler_v);
+      stokes_dofs.push_back (&dof_handler_p);
+      std::vector<const ConstraintMatrix *> stokes_constraints;
+      stokes_constraints.push_back (&constraints_v);
+      stokes_constraints.push_back (&constraints_p);
+
+      stokes_mf_storage.reset (new MatrixFree<dim,double>());
+      stokes_mf_storage->reinit (mapping, stokes_dofs, stokes_constraints,
+                                 QGauss<1>(velocity_degree+1), additional_data);
+
+      stokes_matrix.clear ();
+      stokes_matrix.initialize (stokes_mf_storage);
+
+      velocity_matrix.clear ();
+      velocity_matrix.initialize (stokes_mf_storage, std::vector<unsigned int>(1, 0));
+
+      mass_matrix.clear ();
+      mass_matrix.initialize (stokes_mf_storage, std::vector<unsigned int>(1, 1));
+    }
+
+    // the constraints, operators and transfer on the multigrid levels
+    {
+      const unsigned int n_levels = sim.triangulation.n_global_levels();
+
+      mg_constrained_dofs.clear ();
+      mg_constrained_dofs.initialize (dof_handler_v);
+      for (typename std::map<types::boundary_id, ComponentMask>::const_iterator
+           p = dirichlet_boundaries.begin(); p != dirichlet_boundaries.end(); ++p)
+        mg_constrained_dofs.make_zero_boundary_constraints (dof_handler_v,
+                                                            std::set<types::boundary_id>(&p->first, &p->first+1),
+                                                            p->second);
+
+#if DEAL_II_VERSION_GTE(9,2,0)
+      // no-normal-flux constraints on the levels, which also work
+      // for curved boundaries
+      for (unsigned int level=0; level<n_levels; ++level)
+        {
+          IndexSet relevant_dofs;
+          DoFTools::extract_locally_relevant_level_dofs (dof_handler_v, level, relevant_dofs);
+          ConstraintMatrix user_level_constraints;
+          user_level_constraints.reinit (relevant_dofs);
+          VectorTools::compute_no_normal_flux_constraints_on_level (dof_handler_v,
+                                                                    /* first_vector_component= */ 0,
+                                                                    tangential_boundaries,
+                                                                    user_level_constraints,
+                                                                    mapping,
+                                                                    mg_constrained_dofs.get_refinement_edge_indices(level),
+                                                                    level);
+          user_level_constraints.close ();
+          mg_constrained_dofs.add_user_constraints (level, user_level_constraints);
+        }
+#else
+      // without support for general no-normal-flux constraints on the
+      // levels, only boundaries that are aligned with the coordinate
+      // axes are handled correctly
+      for (std::set<types::boundary_id>::const_iterator p = tangential_boundaries.begin();
+           p != tangential_boundaries.end(); ++p)
+        mg_constrained_dofs.make_no_normal_flux_constraints (dof_handler_v, *p, 0);
+#endif
+
+      if (use_single_precision_multigrid)
+        setup_multigrid_levels (mg_data_float);
+      else
+        setup_multigrid_levels (mg_data_double);
+
+      mg_transfer_projection.clear ();
+      mg_transfer_projection.build (dof_handler_projection);
+    }
+
+    // finally, build the maps between the numbering of the velocity and
+    // pressure degrees of freedom in Simulator::dof_handler and in the
+    // DoFHandler objects of this class. A degree of freedom on an interface
+    // between two processors is owned by the same processor in both
+    // numberings, because ownership is only determined by the cells.
+    {
+      const FiniteElement<dim> &fe = sim.finite_element;
+      std::vector<types::global_dof_index> local_dof_indices (fe.dofs_per_cell);
+      std::vector<types::global_dof_index> local_dof_indices_v (fe_v.dofs_per_cell);
+      std::vector<types::global_dof_index> local_dof_indices_p (fe_p.dofs_per_cell);
+
+      const IndexSet &owned_dofs_v = dof_handler_v.locally_owned_dofs();
+      const IndexSet &owned_dofs_p = dof_handler_p.locally_owned_dofs();
+      velocity_index_map.assign (owned_dofs_v.n_elements(), numbers::invalid_dof_index);
+      pressure_index_map.assign (owned_dofs_p.n_elements(), numbers::invalid_dof_index);
+
+      for (typename DoFHandler<dim>::active_cell_iterator cell = sim.dof_handler.begin_active();
+           cell != sim.dof_handler.end(); ++cell)
+        if (cell->is_locally_owned())
+          {
+            cell->get_dof_indices (local_dof_indices);
+
+            const typename DoFHandler<dim>::active_cell_iterator
+            cell_v (&sim.triangulation, cell->level(), cell->index(), &dof_handler_v);
+            cell_v->get_dof_indices (local_dof_indices_v);
+            for (unsigned int i=0; i<fe_v.dofs_per_cell; ++i)
+              if (owned_dofs_v.is_element (local_dof_indices_v[i]))
+                {
+                  const std::pair<unsigned int, unsigned int> component_and_index
+                    = fe_v.system_to_component_index(i);
+                  const unsigned int system_index
+                    = fe.component_to_system_index (sim.introspection.component_indices.velocities[component_and_index.first],
+                                                    component_and_index.second);
+                  velocity_index_map[owned_dofs_v.index_within_set(local_dof_indices_v[i])]
+                    = local_dof_indices[system_index];
+                }
+
+            const typename DoFHandler<dim>::active_cell_iterator
+            cell_p (&sim.triangulation, cell->level(), cell->index(), &dof_handler_p);
+            cell_p->get_dof_indices (local_dof_indices_p);
+            for (unsigned int i=0; i<fe_p.dofs_per_cell; ++i)
+              if (owned_dofs_p.is_element (local_dof_indices_p[i]))
+                {
+                  const unsigned int system_index
+                    = fe.component_to_system_index (sim.introspection.component_indices.pressure, i);
+                  pressure_index_map[owned_dofs_p.index_within_set(local_dof_indices_p[i])]
+                    = local_dof_indices[system_index];
+                }
+          }
+
+      Assert (std::find (velocity_index_map.begin(), velocity_index_map.end(),
+                         numbers::invalid_dof_index) == velocity_index_map.end()
+              &&
+              std::find (pressure_index_map.begin(), pressure_index_map.end(),
+                         numbers::invalid_dof_index) == pressure_index_map.end(),
+              ExcInternalError());
+    }
+  }
+
+
+
+  template <int dim>
+  template <typename number>
+  void
+  StokesMatrixFreeHandler<dim>::setup_multigrid_levels (MultigridData<number> &mg_data)
+  {
+    const Mapping<dim> &mapping = *sim.mapping;
+    const unsigned int n_levels = sim.triangulation.n_global_levels();
+
+    mg_data.matrices.clear_elements ();
+    mg_data.matrices.resize (0, n_levels-1);
+    mg_data.viscosity_x_2.resize (0, n_levels-1);
+
+    for (unsigned int level=0; level<n_levels; ++level)
+      {
+        IndexSet relevant_dofs;
+        DoFTools::extract_locally_relevant_level_dofs (dof_handler_v, level, relevant_dofs);
+        ConstraintMatrix level_constraints;
+        level_constraints.reinit (relevant_dofs);
+        level_constraints.add_lines (mg_constrained_dofs.get_boundary_indices(level));
+#if DEAL_II_VERSION_GTE(9,2,0)
+        level_constraints.merge (mg_constrained_dofs.get_user_constraint_matrix(level),
+                                 ConstraintMatrix::MergeConflictBehavior::right_object_wins);
+#endif
+        level_constraints.close ();
+
+        typename MatrixFree<dim,number>::AdditionalData additional_data;
+        additional_data.tasks_parallel_scheme =
+          MatrixFree<dim,number>::AdditionalData::none;
+        additional_data.mapping_update_flags = (update_gradients | update_JxW_values);
+        additional_data.level_mg_handler = level;
+
+        std::shared_ptr<MatrixFree<dim,number> > mg_mf_storage_level (new MatrixFree<dim,number>());
+        mg_mf_storage_level->reinit (mapping, dof_handler_v, level_constraints,
+                                     QGauss<1>(velocity_degree+1), additional_data);
+
+        mg_data.matrices[level].clear ();
+        mg_data.matrices[level].initialize (mg_mf_storage_level, mg_constrained_dofs, level);
+      }
+
+    mg_data.transfer.clear ();
+    mg_data.transfer.initialize_constraints (mg_constrained_dofs);
+    mg_data.transfer.build (dof_handler_v);
+  }
+
+
+
+  template <int dim>
+  void
+  StokesMatrixFreeHandler<dim>::evaluate_viscosity ()
+  {
+    const QGauss<dim> quadrature_formula (velocity_degree+1);
+    const unsigned int n_q_points = quadrature_formula.size();
+
+    FEValues<dim> fe_values (*sim.mapping,
+                             sim.finite_element,
+                             quadrature_formula,
+                             update_values   |
+                             update_gradients |
+                             update_quadrature_points |
+                             update_JxW_values);
+
+    MaterialModel::MaterialModelInputs<dim> in (n_q_points, sim.introspection.n_compositional_fields);
+    MaterialModel::MaterialModelOutputs<dim> out (n_q_points, sim.introspection.n_compositional_fields);
+
+    // the piecewise constant viscosity average, used to compute the
+    // viscosity on the multigrid levels
+    IndexSet locally_relevant_dofs_projection;
+    DoFTools::extract_locally_relevant_dofs (dof_handler_projection, locally_relevant_dofs_projection);
+    VectorType active_viscosity_projection (dof_handler_projection.locally_owned_dofs(),
+                                            locally_relevant_dofs_projection,
+                                            sim.mpi_communicator);
+    std::vector<types::global_dof_index> local_dof_indices (fe_projection.dofs_per_cell);
+
+    // The quadrature points of the matrix-free operators are the tensor
+    // product of the 1d Gauss points in the same (lexicographic) order as
+    // those of QGauss<dim>, so we can fill the table for each cell batch
+    // with the values computed by FEValues.
+    const unsigned int n_cells = stokes_mf_storage->n_macro_cells();
+    active_viscosity_x_2.reinit (n_cells, n_q_points);
+    for (unsigned int cell=0; cell<n_cells; ++cell)
+      {
+        const unsigned int n_components_filled = stokes_mf_storage->n_components_filled(cell);
+        for (unsigned int v=0; v<n_components_filled; ++v)
+          {
+            const typename DoFHandler<dim>::cell_iterator matrix_free_cell
+              = stokes_mf_storage->get_cell_iterator(cell, v);
+            const typename DoFHandler<dim>::active_cell_iterator
+            simulator_cell (&sim.triangulation, matrix_free_cell->level(), matrix_free_cell->index(), &sim.dof_handler);
+
+            fe_values.reinit (simulator_cell);
+            sim.compute_material_model_input_values (sim.current_linearization_point,
+                                                     fe_values,
+                                                     simulator_cell,
+                                                     true,
+                                                     in);
+            sim.material_model->evaluate (in, out);
+            MaterialModel::MaterialAveraging::average (sim.parameters.material_averaging,
+                                                       simulator_cell,
+                                                       quadrature_formula,
+                                                       *sim.mapping,
+                                                       out);
+
+            double cell_average = 0;
+            for (unsigned int q=0; q<n_q_points; ++q)
+              {
+                active_viscosity_x_2(cell, q)[v] = 2. * out.viscosities[q];
+                cell_average += out.viscosities[q];
+              }
+
+            const typename DoFHandler<dim>::active_cell_iterator
+            projection_cell (&sim.triangulation, matrix_free_cell->level(), matrix_free_cell->index(), &dof_handler_projection);
+            projection_cell->get_dof_indices (local_dof_indices);
+            active_viscosity_projection(local_dof_indices[0]) = 2. * cell_average / n_q_points;
+          }
+
+        // fill the unused lanes of partially filled cell batches with
+        // valid values, so that the operators never divide by zero
+        for (unsigned int v=n_components_filled; v<VectorizedArray<double>::n_array_elements; ++v)
+          for (unsigned int q=0; q<n_q_points; ++q)
+            active_viscosity_x_2(cell, q)[v] = active_viscosity_x_2(cell, q)[0];
+      }
+    active_viscosity_projection.compress (VectorOperation::insert);
+    active_viscosity_projection.update_ghost_values ();
+
+    const bool is_compressible = sim.material_model->is_compressible();
+    stokes_matrix.fill_cell_data (active_viscosity_x_2, sim.pressure_scaling, is_compressible);
+    velocity_matrix.fill_cell_data (active_viscosity_x_2, is_compressible);
+    mass_matrix.fill_cell_data (active_viscosity_x_2, sim.pressure_scaling);
+
+    // Transfer the cell averages to the multigrid levels. For the piecewise
+    // constant element, the value on a parent cell is the average of the
+    // values of its children.
+    const unsigned int n_levels = sim.triangulation.n_global_levels();
+    MGLevelObject<VectorType> level_viscosity_projection (0, n_levels-1);
+    mg_transfer_projection.interpolate_to_mg (dof_handler_projection,
+                                              level_viscosity_projection,
+                                              active_viscosity_projection);
+
+    for (unsigned int level=0; level<n_levels; ++level)
+      level_viscosity_projection[level].update_ghost_values ();
+
+    if (use_single_precision_multigrid)
+      fill_level_viscosity (mg_data_float, level_viscosity_projection, is_compressible);
+    else
+      fill_level_viscosity (mg_data_double, level_viscosity_projection, is_compressible);
+  }
+
+
+
+  template <int dim>
+  template <typename number>
+  void
+  StokesMatrixFreeHandler<dim>::fill_level_viscosity (MultigridData<number> &mg_data,
+                                                      const MGLevelObject<VectorType> &level_viscosity_projection,
+                                                      const bool is_compressible)
+  {
+    std::vector<types::global_dof_index> local_dof_indices (fe_projection.dofs_per_cell);
+
+    for (unsigned int level=mg_data.matrices.min_level(); level<=mg_data.matrices.max_level(); ++level)
+      {
+        const MatrixFree<dim,number> &level_data = *mg_data.matrices[level].get_matrix_free();
+        const unsigned int n_level_cells = level_data.n_macro_cells();
+        mg_data.viscosity_x_2[level].reinit (n_level_cells, 1);
+
+        for (unsigned int cell=0; cell<n_level_cells; ++cell)
+          {
+            const unsigned int n_components_filled = level_data.n_components_filled(cell);
+            for (unsigned int v=0; v<n_components_filled; ++v)
+              {
+                const typename DoFHandler<dim>::cell_iterator matrix_free_cell
+                  = level_data.get_cell_iterator(cell, v);
+                const typename DoFHandler<dim>::level_cell_iterator
+                projection_cell (&sim.triangulation, matrix_free_cell->level(), matrix_free_cell->index(), &dof_handler_projection);
+                projection_cell->get_mg_dof_indices (local_dof_indices);
+                mg_data.viscosity_x_2[level](cell, 0)[v] = level_viscosity_projection[level](local_dof_indices[0]);
+              }
+            for (unsigned int v=n_components_filled; v<VectorizedArray<number>::n_array_elements; ++v)
+              mg_data.viscosity_x_2[level](cell, 0)[v] = mg_data.viscosity_x_2[level](cell, 0)[0];
+          }
+
+        mg_data.matrices[level].fill_cell_data (mg_data.viscosity_x_2[level], is_compressible);
+      }
+  }
+
+
+
+  template <int dim>
+  void
+  StokesMatrixFreeHandler<dim>::build_preconditioner ()
+  {
+    if (use_single_precision_multigrid)
+      for (unsigned int level=mg_data_float.matrices.min_level(); level<=mg_data_float.matrices.max_level(); ++level)
+        mg_data_float.matrices[level].compute_diagonal ();
+    else
+      for (unsigned int level=mg_data_double.matrices.min_level(); level<=mg_data_double.matrices.max_level(); ++level)
+        mg_data_double.matrices[level].compute_diagonal ();
+
+    mass_matrix.compute_diagonal ();
+  }
+
+
+
+  template <int dim>
+  void
+  StokesMatrixFreeHandler<dim>::copy_to_matrix_free (const LinearAlgebra::BlockVector &src,
+                                                     BlockVectorType &dst) const
+  {
+    for (unsigned int i=0; i<velocity_index_map.size(); ++i)
+      dst.block(0).local_element(i) = src(velocity_index_map[i]);
+    for (unsigned int i=0; i<pressure_index_map.size(); ++i)
+      dst.block(1).local_element(i) = src(pressure_index_map[i]);
+  }
+
+
+
+  template <int dim>
+  void
+  StokesMatrixFreeHandler<dim>::copy_from_matrix_free (const BlockVectorType &src,
+                                                       LinearAlgebra::BlockVector &dst) const
+  {
+    for (unsigned int i=0; i<velocity_index_map.size(); ++i)
+      dst(velocity_index_map[i]) = src.block(0).local_element(i);
+    for (unsigned int i=0; i<pressure_index_map.size(); ++i)
+      dst(pressure_index_map[i]) = src.block(1).local_element(i);
+    dst.compress (VectorOperation::insert);
+  }
+
+
+
+  template <int dim>
+  double
+  StokesMatrixFreeHandler<dim>::
+  compute_initial_stokes_residual (const LinearAlgebra::BlockVector &linearized_stokes_variables) const
+  {
+    BlockVectorType rhs (2);
+    BlockVectorType pressure_only (2);
+    BlockVectorType residual (2);
+    stokes_matrix.initialize_dof_vector (rhs);
+    stokes_matrix.initialize_dof_vector (pressure_only);
+    stokes_matrix.initialize_dof_vector (residual);
+
+    copy_to_matrix_free (sim.system_rhs, rhs);
+    copy_to_matrix_free (linearized_stokes_variables, pressure_only);
+    constraints_v.set_zero (rhs.block(0));
+    constraints_p.set_zero (rhs.block(1));
+    pressure_only.block(0) = 0;
+
+    // compute B^T p - f_u, using only the velocity part of the product
+    stokes_matrix.vmult (residual, pressure_only);
+    residual.block(0) -= rhs.block(0);
+
+    const double residual_u = residual.block(0).l2_norm();
+    const double residual_p = rhs.block(1).l2_norm();
+    return std::sqrt(residual_u*residual_u+residual_p*residual_p);
+  }
+
+
+
+  template <int dim>
+  template <typename number>
+  double
+  StokesMatrixFreeHandler<dim>::solve_with_multigrid (MultigridData<number> &mg_data,
+                                                      BlockVectorType &solution,
+                                                      const BlockVectorType &rhs,
+                                                      const double solver_tolerance)
+  {
+    const Parameters<dim> &parameters = sim.parameters;
+
+    // set up the geometric multigrid V-cycle for the velocity block
+    typedef typename MultigridData<number>::LevelMatrixType LevelMatrixType;
+    typedef typename MultigridData<number>::LevelVectorType LevelVectorType;
+    typedef PreconditionChebyshev<LevelMatrixType,LevelVectorType> SmootherType;
+    MGSmootherPrecondition<LevelMatrixType, SmootherType, LevelVectorType> mg_smoother;
+    {
+      MGLevelObject<typename SmootherType::AdditionalData> smoother_data;
+      smoother_data.resize (mg_data.matrices.min_level(), mg_data.matrices.max_level());
+      for (unsigned int level=mg_data.matrices.min_level(); level<=mg_data.matrices.max_level(); ++level)
+        {
+          if (level > 0)
+            {
+              smoother_data[level].smoothing_range = 15.;
+              smoother_data[level].degree = chebyshev_degree;
+              smoother_data[level].eig_cg_n_iterations = 10;
+            }
+          else
+            {
+              // on the coarsest level, use the Chebyshev iteration
+              // as an (approximate) solver
+              smoother_data[0].smoothing_range = 1e-3;
+              smoother_data[0].degree = numbers::invalid_unsigned_int;
+              smoother_data[0].eig_cg_n_iterations = mg_data.matrices[0].m();
+            }
+          smoother_data[level].preconditioner = mg_data.matrices[level].get_matrix_diagonal_inverse();
+        }
+      mg_smoother.initialize (mg_data.matrices, smoother_data);
+    }
+
+    MGCoarseGridApplySmoother<LevelVectorType> mg_coarse;
+    mg_coarse.initialize (mg_smoother);
+
+    mg::Matrix<LevelVectorType> mg_matrix (mg_data.matrices);
+
+    MGLevelObject<MatrixFreeOperators::MGInterfaceOperator<LevelMatrixType> > mg_interface_matrices;
+    mg_interface_matrices.resize (mg_data.matrices.min_level(), mg_data.matrices.max_level());
+    for (unsigned int level=mg_data.matrices.min_level(); level<=mg_data.matrices.max_level(); ++level)
+      mg_interface_matrices[level].initialize (mg_data.matrices[level]);
+    mg::Matrix<LevelVectorType> mg_interface (mg_interface_matrices);
+
+    Multigrid<LevelVectorType> mg (mg_matrix,
+                                   mg_coarse,
+                                   mg_data.transfer,
+                                   mg_smoother,
+                                   mg_smoother);
+    mg.set_edge_matrices (mg_interface, mg_interface);
+
+    PreconditionMG<dim, LevelVectorType, MGTransferMatrixFree<dim,number> >
+    prec_A (dof_handler_v, mg, mg_data.transfer);
+
+    // the Schur complement approximation is preconditioned with
+    // its diagonal
+    const DiagonalMatrix<VectorType> &prec_S = *mass_matrix.get_matrix_diagonal_inverse();
+
+    typedef internal::BlockSchurGMGPreconditioner<StokesMatrixType, ABlockMatrixType, SchurComplementMatrixType,
+            PreconditionMG<dim, LevelVectorType, MGTransferMatrixFree<dim,number> >,
+            DiagonalMatrix<VectorType> > GMGPreconditioner;
+
+    // create a cheap preconditioner that consists of only a single V-cycle
+    const GMGPreconditioner preconditioner_cheap (stokes_matrix, velocity_matrix, mass_matrix,
+                                                  prec_A, prec_S,
+                                                  false,
+                                                  parameters.linear_solver_A_block_tolerance,
+                                                  parameters.linear_solver_S_block_tolerance);
+
+    // create an expensive preconditioner that solves for the A block with CG
+    const GMGPreconditioner preconditioner_expensive (stokes_matrix, velocity_matrix, mass_matrix,
+                                                      prec_A, prec_S,
+                                                      true,
+                                                      parameters.linear_solver_A_block_tolerance,
+                                                      parameters.linear_solver_S_block_tolerance);
+
+    PrimitiveVectorMemory<BlockVectorType> mem;
+
+    // create Solver controls for the cheap and expensive solver phase
+    SolverControl solver_control_cheap (parameters.n_cheap_stokes_solver_steps,
+                                        solver_tolerance);
+    SolverControl solver_control_expensive (parameters.n_expensive_stokes_solver_steps,
+                                            solver_tolerance);
+
+    solver_control_cheap.enable_history_data();
+    solver_control_expensive.enable_history_data();
+
+    double final_linear_residual = numbers::signaling_nan<double>();
+
+    // step 1a: try if the simple and fast solver
+    // succeeds in n_cheap_stokes_solver_steps steps or less.
+    try
+      {
+        // if this cheaper solver is not desired, then simply short-cut
+        // the attempt at solving with the cheaper preconditioner
+        if (parameters.n_cheap_stokes_solver_steps == 0)
+          throw SolverControl::NoConvergence(0,0);
+
+        SolverFGMRES<BlockVectorType>
+        solver(solver_control_cheap, mem,
+               SolverFGMRES<BlockVectorType>::
+               AdditionalData(parameters.stokes_gmres_restart_length, true));
+
+        solver.solve (stokes_matrix,
+                      solution,
+                      rhs,
+                      preconditioner_cheap);
+
+        final_linear_residual = solver_control_cheap.last_value();
+      }
+
+    // step 1b: take the stronger solver in case
+    // the simple solver failed and attempt solving
+    // it in n_expensive_stokes_solver_steps steps or less.
+    catch (SolverControl::NoConvergence)
+      {
+        SolverFGMRES<BlockVectorType>
+        solver(solver_control_expensive, mem,
+               SolverFGMRES<BlockVectorType>::
+               AdditionalData(parameters.stokes_gmres_restart_length, true));
+
+        try
+          {
+            solver.solve (stokes_matrix,
+                          solution,
+                          rhs,
+                          preconditioner_expensive);
+
+            final_linear_residual = solver_control_expensive.last_value();
+          }
+        // if the solver fails, report the error from processor 0 with some additional
+        // information about its location, and throw a quiet exception on all other
+        // processors
+        catch (const std::exception &exc)
+          {
+            sim.signals.post_stokes_solver(sim,
+                                           preconditioner_cheap.n_iterations_S() + preconditioner_expensive.n_iterations_S(),
+                                           preconditioner_cheap.n_iterations_A() + preconditioner_expensive.n_iterations_A(),
+                                           solver_control_cheap,
+                                           solver_control_expensive);
+
+            if (Utilities::MPI::this_mpi_process(sim.mpi_communicator) == 0)
+              {
+                // output solver history
+                std::ofstream f((parameters.output_directory+"solver_history.txt").c_str());
+
+                // Only request the solver history if a history has actually been created
+                if (parameters.n_cheap_stokes_solver_steps > 0)
+                  {
+                    for (unsigned int i=0; i<solver_control_cheap.get_history_data().size(); ++i)
+                      f << i << " " << solver_control_cheap.get_history_data()[i] << "\n";
+
+                    f << "\n";
+                  }
+
+                for (unsigned int i=0; i<solver_control_expensive.get_history_data().size(); ++i)
+                  f << i << " " << solver_control_expensive.get_history_data()[i] << "\n";
+
+                f.close();
+
+                AssertThrow (false,
+                             ExcMessage (std::string("The iterative (matrix-free) Stokes solver "
+                                                     "did not converge. It reported the following error:\n\n")
+                                         +
+                                         exc.what()
+                                         + "\n See " + parameters.output_directory+"solver_history.txt"
+                                         + " for convergence history."));
+              }
+            else
+              throw QuietException();
+          }
+      }
+
+    // signal successful solver
+    sim.signals.post_stokes_solver(sim,
+                                   preconditioner_cheap.n_iterations_S() + preconditioner_expensive.n_iterations_S(),
+                                   preconditioner_cheap.n_iterations_A() + preconditioner_expensive.n_iterations_A(),
+                                   solver_control_cheap,
+                                   solver_control_expensive);
+
+    // print the number of iterations to screen
+    sim.pcout << (solver_control_cheap.last_step() != numbers::invalid_unsigned_int ?
+                  solver_control_cheap.last_step():
+                  0)
+              << '+'
+              << (solver_control_expensive.last_step() != numbers::invalid_unsigned_int ?
+                  solver_control_expensive.last_step():
+                  0)
+              << " iterations.";
+    sim.pcout << std::endl;
+
+    return final_linear_residual;
+  }
+
+
+
+  template <int dim>
+  std::pair<double,double>
+  StokesMatrixFreeHandler<dim>::solve (LinearAlgebra::BlockVector &distributed_stokes_solution)
+  {
+    const unsigned int block_vel = sim.introspection.block_indices.velocities;
+    const unsigned int block_p = sim.introspection.block_indices.pressure;
+    Assert(block_vel == 0, ExcNotImplemented());
+    Assert(block_p == 1, ExcNotImplemented());
+
+    const Parameters<dim> &parameters = sim.parameters;
+
+    // create a completely distributed vector that will be used for
+    // the scaled and denormalized solution and later used as a
+    // starting guess for the linear solver, exactly as in
+    // Simulator::solve_stokes()
+    LinearAlgebra::BlockVector linearized_stokes_initial_guess (sim.introspection.index_sets.stokes_partitioning,
+                                                                sim.mpi_communicator);
+    linearized_stokes_initial_guess.block (block_vel) = sim.current_linearization_point.block (block_vel);
+    linearized_stokes_initial_guess.block (block_p) = sim.current_linearization_point.block (block_p);
+    sim.denormalize_pressure (sim.last_pressure_normalization_adjustment,
+                              linearized_stokes_initial_guess,
+                              sim.current_linearization_point);
+    sim.current_constraints.set_zero (linearized_stokes_initial_guess);
+    linearized_stokes_initial_guess.block (block_p) /= sim.pressure_scaling;
+
+    // copy the initial guess and the right hand side into vectors that are
+    // compatible with the matrix-free operators. the right hand side of
+    // constrained degrees of freedom is set to zero, since the inhomogeneous
+    // boundary values are added back by current_constraints.distribute()
+    // after the solve
+    BlockVectorType solution_copy (2);
+    BlockVectorType rhs_copy (2);
+    BlockVectorType tmp (2);
+    stokes_matrix.initialize_dof_vector (solution_copy);
+    stokes_matrix.initialize_dof_vector (rhs_copy);
+    stokes_matrix.initialize_dof_vector (tmp);
+
+    copy_to_matrix_free (linearized_stokes_initial_guess, solution_copy);
+    copy_to_matrix_free (sim.system_rhs, rhs_copy);
+    constraints_v.set_zero (solution_copy.block(0));
+    constraints_p.set_zero (solution_copy.block(1));
+    constraints_v.set_zero (rhs_copy.block(0));
+    constraints_p.set_zero (rhs_copy.block(1));
+
+    // compute the initial nonlinear residual || A^{k+1} U^k - F^{k+1} ||
+    // and the solver tolerance from the residual with a zero velocity,
+    // see Simulator::solve_stokes() for a discussion of both
+    stokes_matrix.vmult (tmp, solution_copy);
+    tmp.sadd (-1., 1., rhs_copy);
+    const double initial_nonlinear_residual = tmp.l2_norm();
+
+    const double solver_tolerance = parameters.linear_stokes_solver_tolerance *
+                                    compute_initial_stokes_residual (linearized_stokes_initial_guess);
+
+    const double final_linear_residual
+      = (use_single_precision_multigrid
+         ?
+         solve_with_multigrid (mg_data_float, solution_copy, rhs_copy, solver_tolerance)
+         :
+         solve_with_multigrid (mg_data_double, solution_copy, rhs_copy, solver_tolerance));
+
+    // copy the solution back, distribute hanging node and
+    // other constraints, and rescale the pressure back to
+    // real physical units
+    copy_from_matrix_free (solution_copy, distributed_stokes_solution);
+    sim.current_constraints.distribute (distributed_stokes_solution);
+    distributed_stokes_solution.block(block_p) *= sim.pressure_scaling;
+
+    // then copy back the solution from the temporary (non-ghosted) vector
+    // into the ghosted one with all solution components
+    sim.solution.block(block_vel) = distributed_stokes_solution.block(block_vel);
+    sim.solution.block(block_p) = distributed_stokes_solution.block(block_p);
+
+    return std::pair<double,double>(initial_nonlinear_residual,
+                                    final_linear_residual);
+  }
+}
+
+
+
+#endif
+
+
+
+// The parameters are declared independently of the deal.II version, so
+// that input files which set them can be read with every version.
+namespace aspect
+{
+  template <int dim>
+  void
+  StokesMatrixFreeHandler<dim>::declare_parameters (ParameterHandler &prm)
+  {
+    prm.enter_subsection ("Solver parameters");
+    {
+      prm.enter_subsection ("Matrix free");
+      {
+        prm.declare_entry ("Chebyshev smoother degree", "4",
+                           Patterns::Integer(1),
+                           "The polynomial degree of the Chebyshev smoother that is used "
+                           "on every level of the geometric multigrid V-cycle of the "
+                           "`block GMG' Stokes solver, i.e., the number of matrix-vector "
+                           "products with the level operator per smoothing step. Larger "
+                           "values make each V-cycle more expensive but more effective.");
+
+        prm.declare_entry ("Use single precision multigrid", "false",
+                           Patterns::Bool(),
+                           "Whether the geometric multigrid V-cycle that preconditions the "
+                           "velocity block of the `block GMG' Stokes solver is done in single "
+                           "precision. The level operators, the transfer between the levels, "
+                           "and the Chebyshev smoothers then work on float numbers, which "
+                           "halves the memory traffic of the V-cycle, the dominant cost of "
+                           "the solver. The outer FGMRES iteration and its residuals are still "
+                           "computed in double precision and act as an iterative refinement, "
+                           "so the accuracy of the converged solution is not affected, though "
+                           "the number of iterations may increase slightly.");
+      }
+      prm.leave_subsection ();
+    }
+    prm.leave_subsection ();
+  }
+}
+
+
+
+// explicit instantiation of the functions we implement in this file
+namespace aspect
+{
+#define INSTANTIATE(dim) \
+  template class StokesMatrixFreeHandler<dim>;
+
+  ASPECT_INSTANTIATE(INSTANTIATE)
+}
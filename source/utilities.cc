@@ -37,6 +37,15 @@
 #include <deal.II/base/parameter_handler.h>
 #endif
 
+#include <deal.II/fe/fe_values.h>
+#include <deal.II/fe/mapping.h>
+
+#ifndef ASPECT_USE_PETSC
+#include <Epetra_Map.h>
+#include <Epetra_MultiVector.h>
+#include <Teuchos_ParameterList.hpp>
+#endif
+
 #include <aspect/geometry_model/box.h>
 #include <aspect/geometry_model/spherical_shell.h>
 #include <aspect/geometry_model/chunk.h>
@@ -340,6 +349,122 @@ namespace aspect
 
 
 
+    template <int dim>
+    void
+    initialize_amg_with_rigid_body_modes (LinearAlgebra::PreconditionAMG                       &preconditioner,
+                                          const LinearAlgebra::SparseMatrix                    &matrix,
+                                          const LinearAlgebra::PreconditionAMG::AdditionalData &amg_data,
+                                          const Mapping<dim>                                   &mapping,
+                                          const DoFHandler<dim>                                &dof_handler,
+                                          const unsigned int                                    first_vector_component)
+    {
+#if defined(ASPECT_USE_PETSC) || !DEAL_II_VERSION_GTE(9,2,0)
+      (void)preconditioner;
+      (void)matrix;
+      (void)amg_data;
+      (void)mapping;
+      (void)dof_handler;
+      (void)first_vector_component;
+      AssertThrow (false,
+                   ExcMessage ("Rigid body modes for the algebraic multigrid preconditioner "
+                               "are only available if ASPECT is configured to use Trilinos "
+                               "and deal.II 9.2 or newer."));
+#else
+      const FiniteElement<dim> &fe = dof_handler.get_fe();
+      const unsigned int base_element = fe.component_to_base_index (first_vector_component).first;
+      AssertThrow (fe.base_element(base_element).n_components() == 1
+                   &&
+                   fe.base_element(base_element).has_support_points(),
+                   ExcMessage ("Rigid body modes can only be computed for vector-valued fields "
+                               "that are discretized by a scalar element with support points."));
+
+      // dim translations, plus one rotation in 2d and three in 3d
+      const unsigned int n_rotations = (dim == 2 ? 1 : 3);
+      const unsigned int n_modes = dim + n_rotations;
+
+      const Epetra_Map &domain_map = matrix.trilinos_matrix().DomainMap();
+      Epetra_MultiVector modes (domain_map, n_modes);
+
+      // Rotations around the origin are badly scaled relative to the
+      // translations for domains far from the origin, so rotate around the
+      // centroid of the domain instead. The centroid has to be the same on
+      // all processes, otherwise the modes would not be rigid body modes
+      // of the whole domain.
+      Point<dim> centroid;
+      double n_locally_owned_cells = 0;
+      for (typename DoFHandler<dim>::active_cell_iterator cell=dof_handler.begin_active();
+           cell!=dof_handler.end(); ++cell)
+        if (cell->is_locally_owned())
+          {
+            centroid += cell->center();
+            n_locally_owned_cells += 1;
+          }
+      const MPI_Comm mpi_communicator = matrix.get_mpi_communicator();
+      for (unsigned int d=0; d<dim; ++d)
+        centroid[d] = Utilities::MPI::sum (centroid[d], mpi_communicator);
+      centroid /= Utilities::MPI::sum (n_locally_owned_cells, mpi_communicator);
+
+      const Quadrature<dim> support_points (fe.base_element(base_element).get_unit_support_points());
+      FEValues<dim> fe_values (mapping, fe, support_points, update_quadrature_points);
+      std::vector<types::global_dof_index> local_dof_indices (fe.dofs_per_cell);
+
+      for (typename DoFHandler<dim>::active_cell_iterator cell=dof_handler.begin_active();
+           cell!=dof_handler.end(); ++cell)
+        if (cell->is_locally_owned())
+          {
+            fe_values.reinit (cell);
+            cell->get_dof_indices (local_dof_indices);
+
+            for (unsigned int i=0; i<fe.dofs_per_cell; ++i)
+              {
+                const std::pair<std::pair<unsigned int, unsigned int>, unsigned int> base_index
+                  = fe.system_to_base_index(i);
+                if (base_index.first.first != base_element)
+                  continue;
+
+                const int row = domain_map.LID (static_cast<TrilinosWrappers::types::int_type>(local_dof_indices[i]));
+                if (row < 0)
+                  continue;
+
+                const unsigned int component = fe.system_to_component_index(i).first - first_vector_component;
+                const Tensor<1,dim> position = fe_values.quadrature_point (base_index.second) - centroid;
+
+                modes[component][row] = 1.;
+
+                // the rotation around the axis e_a is given by
+                // e_a x position = position_b e_c - position_c e_b
+                // with (a,b,c) a cyclic permutation of (0,1,2)
+                if (dim == 2)
+                  modes[dim][row] = (component == 0 ? -position[1] : position[0]);
+                else
+                  for (unsigned int a=0; a<n_rotations; ++a)
+                    {
+                      const unsigned int b = (a+1) % 3;
+                      const unsigned int c = (a+2) % 3;
+                      if (component == c)
+                        modes[dim+a][row] = position[b];
+                      else if (component == b)
+                        modes[dim+a][row] = -position[c];
+                    }
+              }
+          }
+
+      // let deal.II set up the parameters for ML from amg_data, and only
+      // replace the near null space by the rigid body modes
+      Teuchos::ParameterList parameter_list;
+      std::unique_ptr<Epetra_MultiVector> constant_modes;
+      amg_data.set_parameters (parameter_list, constant_modes, matrix.trilinos_matrix());
+
+      parameter_list.set ("null space: type", "pre-computed");
+      parameter_list.set ("null space: dimension", static_cast<int>(n_modes));
+      parameter_list.set ("null space: vectors", modes.Values());
+
+      preconditioner.initialize (matrix, parameter_list);
+#endif
+    }
+
+
+
     namespace Coordinates
     {
 
@@ -2909,6 +3034,14 @@ namespace aspect
   IndexSet extract_locally_active_dofs_with_component(const DoFHandler<dim> &, \
                                                       const ComponentMask &); \
   template \
+  void \
+  initialize_amg_with_rigid_body_modes<dim> (LinearAlgebra::PreconditionAMG &, \
+                                             const LinearAlgebra::SparseMatrix &, \
+                                             const LinearAlgebra::PreconditionAMG::AdditionalData &, \
+                                             const Mapping<dim> &, \
+                                             const DoFHandler<dim> &, \
+                                             const unsigned int); \
+  template \
   std::vector<std::string> \
   expand_dimensional_variable_names<dim> (const std::vector<std::string> &var_declarations);
 
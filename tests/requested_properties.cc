@@ -0,0 +1,175 @@
+#include <aspect/material_model/interface.h>
+#include <aspect/postprocess/interface.h>
+#include <aspect/simulator_access.h>
+#include <aspect/global.h>
+
+#include <deal.II/base/quadrature_lib.h>
+#include <deal.II/base/signaling_nan.h>
+#include <deal.II/fe/fe_values.h>
+
+#include <cstring>
+
+
+namespace aspect
+{
+  using namespace dealii;
+
+  namespace
+  {
+    // The outputs are initialized with signaling NaNs, which can not be
+    // compared with floating point operations without raising FE_INVALID.
+    // Detect values that the material model did not write by comparing
+    // the bit patterns instead.
+    bool is_untouched (const double value)
+    {
+      const double sentinel = numbers::signaling_nan<double>();
+      return std::memcmp (&value, &sentinel, sizeof(double)) == 0;
+    }
+
+
+
+    // Check one value of an evaluation with some properties requested
+    // against the same value of an evaluation with all properties
+    // requested. Requested values have to agree, other values either have
+    // to be untouched or agree. Return whether the value was untouched.
+    bool check_value (const double masked_value,
+                      const double reference_value,
+                      const bool   requested)
+    {
+      if (is_untouched (masked_value))
+        {
+          AssertThrow (!requested,
+                       ExcMessage ("A requested property has not been computed."));
+          return true;
+        }
+
+      AssertThrow (!is_untouched (reference_value) && masked_value == reference_value,
+                   ExcMessage ("A property changed when not all properties were requested."));
+      return false;
+    }
+  }
+
+
+
+  /**
+   * Evaluate the material model on every cell once with all properties
+   * requested, once with only the viscosity requested, and once with only
+   * the equation of state properties requested. Check that the requested
+   * properties agree with the ones of the full evaluation, and that all
+   * other properties were either left untouched or agree as well. The
+   * number of untouched values is written to the statistics file.
+   */
+  template <int dim>
+  class RequestedPropertiesPostprocessor : public Postprocess::Interface<dim>, public ::aspect::SimulatorAccess<dim>
+  {
+    public:
+      virtual
+      std::pair<std::string,std::string>
+      execute (TableHandler &statistics);
+
+    private:
+      /**
+       * Evaluate the material model with the given @p requested_properties
+       * and compare the result to @p reference_outputs. Return the number
+       * of untouched values.
+       */
+      unsigned int
+      check_evaluation (const MaterialModel::MaterialModelInputs<dim>  &in,
+                        const MaterialModel::MaterialModelOutputs<dim> &reference_outputs,
+                        const MaterialModel::MaterialProperties::Property requested_properties) const;
+  };
+
+
+
+  template <int dim>
+  unsigned int
+  RequestedPropertiesPostprocessor<dim>::
+  check_evaluation (const MaterialModel::MaterialModelInputs<dim>  &in,
+                    const MaterialModel::MaterialModelOutputs<dim> &reference_outputs,
+                    const MaterialModel::MaterialProperties::Property requested_properties) const
+  {
+    const unsigned int n_points = in.position.size();
+    MaterialModel::MaterialModelOutputs<dim> out (n_points, this->n_compositional_fields());
+    out.requested_properties = requested_properties;
+    this->get_material_model().evaluate (in, out);
+
+    unsigned int n_untouched = 0;
+    for (unsigned int q=0; q<n_points; ++q)
+      {
+        n_untouched += check_value (out.viscosities[q], reference_outputs.viscosities[q],
+                                    out.requests_property(MaterialModel::MaterialProperties::viscosity));
+        n_untouched += check_value (out.densities[q], reference_outputs.densities[q],
+                                    out.requests_property(MaterialModel::MaterialProperties::density));
+        n_untouched += check_value (out.thermal_expansion_coefficients[q], reference_outputs.thermal_expansion_coefficients[q],
+                                    out.requests_property(MaterialModel::MaterialProperties::thermal_expansion_coefficient));
+        n_untouched += check_value (out.specific_heat[q], reference_outputs.specific_heat[q],
+                                    out.requests_property(MaterialModel::MaterialProperties::specific_heat));
+        n_untouched += check_value (out.thermal_conductivities[q], reference_outputs.thermal_conductivities[q],
+                                    out.requests_property(MaterialModel::MaterialProperties::thermal_conductivity));
+        n_untouched += check_value (out.compressibilities[q], reference_outputs.compressibilities[q],
+                                    out.requests_property(MaterialModel::MaterialProperties::compressibility));
+        n_untouched += check_value (out.entropy_derivative_pressure[q], reference_outputs.entropy_derivative_pressure[q],
+                                    out.requests_property(MaterialModel::MaterialProperties::entropy_derivative_pressure));
+        n_untouched += check_value (out.entropy_derivative_temperature[q], reference_outputs.entropy_derivative_temperature[q],
+                                    out.requests_property(MaterialModel::MaterialProperties::entropy_derivative_temperature));
+        for (unsigned int c=0; c<this->n_compositional_fields(); ++c)
+          n_untouched += check_value (out.reaction_terms[q][c], reference_outputs.reaction_terms[q][c],
+                                      out.requests_property(MaterialModel::MaterialProperties::reaction_terms));
+      }
+
+    return n_untouched;
+  }
+
+
+
+  template <int dim>
+  std::pair<std::string,std::string>
+  RequestedPropertiesPostprocessor<dim>::execute (TableHandler &statistics)
+  {
+    const QGauss<dim> quadrature_formula (this->get_fe().base_element(this->introspection().base_elements.velocities).degree+1);
+    FEValues<dim> fe_values (this->get_mapping(),
+                             this->get_fe(),
+                             quadrature_formula,
+                             update_values | update_gradients | update_quadrature_points);
+
+    MaterialModel::MaterialModelInputs<dim> in (quadrature_formula.size(), this->n_compositional_fields());
+
+    unsigned int n_untouched_viscosity_only = 0;
+    unsigned int n_untouched_equation_of_state_only = 0;
+    for (typename DoFHandler<dim>::active_cell_iterator cell = this->get_dof_handler().begin_active();
+         cell != this->get_dof_handler().end(); ++cell)
+      if (cell->is_locally_owned())
+        {
+          fe_values.reinit (cell);
+          in.reinit (fe_values, cell, this->introspection(), this->get_solution());
+
+          MaterialModel::MaterialModelOutputs<dim> all_outputs (quadrature_formula.size(), this->n_compositional_fields());
+          this->get_material_model().evaluate (in, all_outputs);
+
+          n_untouched_viscosity_only
+            += check_evaluation (in, all_outputs, MaterialModel::MaterialProperties::viscosity);
+          n_untouched_equation_of_state_only
+            += check_evaluation (in, all_outputs, MaterialModel::MaterialProperties::equation_of_state_properties);
+        }
+
+    n_untouched_viscosity_only = Utilities::MPI::sum (n_untouched_viscosity_only, this->get_mpi_communicator());
+    n_untouched_equation_of_state_only = Utilities::MPI::sum (n_untouched_equation_of_state_only, this->get_mpi_communicator());
+
+    statistics.add_value ("Untouched values (viscosity requested)", n_untouched_viscosity_only);
+    statistics.add_value ("Untouched values (equation of state requested)", n_untouched_equation_of_state_only);
+
+    std::ostringstream os;
+    os << n_untouched_viscosity_only << ", " << n_untouched_equation_of_state_only;
+    return std::make_pair ("Untouched values (viscosity, equation of state):", os.str());
+  }
+}
+
+
+
+// explicit instantiations
+namespace aspect
+{
+  ASPECT_REGISTER_POSTPROCESSOR(RequestedPropertiesPostprocessor,
+                                "requested properties",
+                                "")
+}
@@ -0,0 +1 @@
+#include "requested_properties.cc"
@@ -0,0 +1,63 @@
+/*
+  Copyright (C) 2018 by the authors of the ASPECT code.
+
+  This file is part of ASPECT.
+
+  ASPECT is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2, or (at your option)
+  any later version.
+
+  ASPECT is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with ASPECT; see the file LICENSE.  If not see
+  <http://www.gnu.org/licenses/>.
+*/
+
+#include "common.h"
+#include <aspect/material_model/interface.h>
+
+// Verify that the values of a CompositionTable can be accessed point by
+// point and field by field, and that the fields are stored contiguously.
+
+TEST_CASE("CompositionTable access")
+{
+  using namespace aspect::MaterialModel;
+
+  const unsigned int n_points = 3;
+  const unsigned int n_fields = 2;
+  CompositionTable table (n_points, n_fields, 1.0);
+
+  REQUIRE(table.size() == n_points);
+  REQUIRE(table.n_points() == n_points);
+  REQUIRE(table.n_fields() == n_fields);
+  REQUIRE(table[2].size() == n_fields);
+  REQUIRE(table.field(1).size() == n_points);
+  REQUIRE(table[1][1] == 1.0);
+
+  for (unsigned int q=0; q<n_points; ++q)
+    for (unsigned int c=0; c<n_fields; ++c)
+      table[q][c] = 10.0*q + c;
+
+  // the values of one field follow each other in memory
+  const double *field_1 = table.field_data(1);
+  for (unsigned int q=0; q<n_points; ++q)
+    REQUIRE(field_1[q] == 10.0*q + 1);
+
+  const CompositionTable &const_table = table;
+  compare_vectors_approx(const_table[2], {20.0, 21.0});
+  compare_vectors_approx(const_table.field(0), {0.0, 10.0, 20.0});
+
+  std::vector<double> values (5, 0.0);
+  const_table[1].copy_to(values);
+  compare_vectors_approx(values, {10.0, 11.0});
+
+  table.reinit (2, 3, 0.5);
+  REQUIRE(table.n_points() == 2);
+  REQUIRE(table.n_fields() == 3);
+  compare_vectors_approx(table.field(2), {0.5, 0.5});
+}
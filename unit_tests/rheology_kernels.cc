@@ -0,0 +1,163 @@
+/*
+  Copyright (C) 2018 by the authors of the ASPECT code.
+
+  This file is part of ASPECT.
+
+  ASPECT is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2, or (at your option)
+  any later version.
+
+  ASPECT is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with ASPECT; see the file LICENSE.  If not see
+  <http://www.gnu.org/licenses/>.
+*/
+
+#include "common.h"
+#include <aspect/material_model/rheology_kernels.h>
+
+#include <chrono>
+#include <cmath>
+
+// Verify that the batched creep law kernels compute the same values as
+// the scalar reference implementations, and measure how much faster they
+// are.
+
+namespace
+{
+  using namespace aspect::MaterialModel::RheologyKernels;
+
+  // The batched kernels rearrange the flow laws into logarithmic form,
+  // so they agree with the reference implementation only up to roundoff
+  // amplified by the size of the exponents.
+  const double tolerance = 1e-10;
+
+  // Parameters of dry olivine (Hirth and Kohlstedt 2004), as in the
+  // visco_plastic and diffusion_dislocation material models.
+  const PowerLawCreep diffusion_creep (1.5e-15, 1.0, 3.0, 375e3, 6e-6, 1e-3);
+  const PowerLawCreep dislocation_creep (2.2e-16, 3.5, 0.0, 530e3, 1.4e-5, 1e-3);
+
+  void
+  fill_inputs (const unsigned int n_points,
+               std::vector<double> &pressures,
+               std::vector<double> &temperatures,
+               std::vector<double> &strain_rates)
+  {
+    pressures.resize(n_points);
+    temperatures.resize(n_points);
+    strain_rates.resize(n_points);
+    for (unsigned int q=0; q<n_points; ++q)
+      {
+        const double x = static_cast<double>(q) / n_points;
+        pressures[q] = 1e5 + x * 1e10;
+        temperatures[q] = 1300. + 400. * x;
+        strain_rates[q] = std::pow(10., -20. + 8. * x);
+      }
+  }
+}
+
+
+TEST_CASE("RheologyKernels batched viscosities")
+{
+  const unsigned int n_points = 100;
+  std::vector<double> pressures, temperatures, strain_rates;
+  fill_inputs(n_points, pressures, temperatures, strain_rates);
+
+  std::vector<double> log_strain_rates(n_points);
+  for (unsigned int q=0; q<n_points; ++q)
+    log_strain_rates[q] = std::log(strain_rates[q]);
+
+  const PowerLawCreep creep_laws[] = {diffusion_creep, dislocation_creep};
+  for (unsigned int c=0; c<2; ++c)
+    {
+      std::vector<double> viscosities(n_points);
+      compute_viscosities(creep_laws[c], n_points, &pressures[0], &temperatures[0],
+                          &log_strain_rates[0], &viscosities[0]);
+
+      for (unsigned int q=0; q<n_points; ++q)
+        REQUIRE(viscosities[q] == Approx(compute_viscosity(creep_laws[c], pressures[q],
+                                                           temperatures[q], strain_rates[q])).epsilon(tolerance));
+    }
+}
+
+
+TEST_CASE("RheologyKernels batched strain rate prefactors")
+{
+  const unsigned int n_points = 100;
+  std::vector<double> pressures, temperatures, strain_rates;
+  fill_inputs(n_points, pressures, temperatures, strain_rates);
+
+  // include negative pressures, for which the activation enthalpy is cut off
+  pressures[0] = -1e11;
+
+  const PowerLawCreep creep_laws[] = {diffusion_creep, dislocation_creep};
+  for (unsigned int c=0; c<2; ++c)
+    {
+      std::vector<double> prefactors(n_points);
+      compute_strain_rate_prefactors(creep_laws[c], n_points, &pressures[0], &temperatures[0],
+                                     &prefactors[0]);
+
+      for (unsigned int q=0; q<n_points; ++q)
+        REQUIRE(prefactors[q] == Approx(compute_strain_rate_prefactor(creep_laws[c], pressures[q],
+                                                                      temperatures[q])).epsilon(tolerance));
+    }
+}
+
+
+TEST_CASE("RheologyKernels benchmark", "[.benchmark]")
+{
+  // A typical cell of a 3d model has 27 quadrature points. Evaluate
+  // the creep laws for many such cells and compare the time spent in the
+  // scalar and the batched functions. The result is only reported as a
+  // warning, since timings are not reliable enough to be tested for. The
+  // test is hidden, so it only runs if it is selected explicitly, e.g.
+  // with 'aspect --test [.benchmark]'.
+  const unsigned int n_points = 27;
+  const unsigned int n_repetitions = 20000;
+  std::vector<double> pressures, temperatures, strain_rates;
+  fill_inputs(n_points, pressures, temperatures, strain_rates);
+
+  std::vector<double> log_strain_rates(n_points);
+  std::vector<double> viscosities(n_points);
+  double scalar_sum = 0;
+  double batched_sum = 0;
+
+  const std::chrono::steady_clock::time_point scalar_start = std::chrono::steady_clock::now();
+  for (unsigned int r=0; r<n_repetitions; ++r)
+    for (unsigned int q=0; q<n_points; ++q)
+      {
+        scalar_sum += compute_viscosity(diffusion_creep, pressures[q], temperatures[q], strain_rates[q]);
+        scalar_sum += compute_viscosity(dislocation_creep, pressures[q], temperatures[q], strain_rates[q]);
+      }
+  const std::chrono::steady_clock::time_point batched_start = std::chrono::steady_clock::now();
+  for (unsigned int r=0; r<n_repetitions; ++r)
+    {
+      for (unsigned int q=0; q<n_points; ++q)
+        log_strain_rates[q] = std::log(strain_rates[q]);
+
+      compute_viscosities(diffusion_creep, n_points, &pressures[0], &temperatures[0],
+                          &log_strain_rates[0], &viscosities[0]);
+      for (unsigned int q=0; q<n_points; ++q)
+        batched_sum += viscosities[q];
+
+      compute_viscosities(dislocation_creep, n_points, &pressures[0], &temperatures[0],
+                          &log_strain_rates[0], &viscosities[0]);
+      for (unsigned int q=0; q<n_points; ++q)
+        batched_sum += viscosities[q];
+    }
+  const std::chrono::steady_clock::time_point batched_end = std::chrono::steady_clock::now();
+
+  const double scalar_time = std::chrono::duration<double>(batched_start - scalar_start).count();
+  const double batched_time = std::chrono::duration<double>(batched_end - batched_start).count();
+
+  WARN("Creep law evaluation: scalar " << scalar_time << "s, batched "
+       << batched_time << "s, speedup " << scalar_time / batched_time);
+
+  // use the results, so that the compiler cannot remove the loops
+  REQUIRE(batched_sum == Approx(scalar_sum).epsilon(tolerance));
+}